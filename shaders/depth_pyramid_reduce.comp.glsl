@@ -0,0 +1,33 @@
+#version 450
+
+// NexDepthPyramid, one level from the one below it (or from a single sampled depth for level 0)
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(set = 0, binding = 0) uniform sampler2D source;
+layout(set = 0, binding = 1, r32f) uniform writeonly image2D destination;
+
+layout(push_constant) uniform Push {
+    ivec2 source_size;
+    ivec2 destination_size;
+} push;
+
+void main() {
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(texel, push.destination_size))) {
+        return;
+    }
+
+    // the last column and row also take the leftover texel of an odd sized source, so no depth is ever dropped
+    ivec2 last  = push.source_size - 1;
+    ivec2 first = min(texel * 2, last);
+    ivec2 end   = min(first + 1 + ivec2(equal(texel, push.destination_size - 1)), last);
+
+    float depth = 0.0;
+    for (int y = first.y; y <= end.y; ++y) {
+        for (int x = first.x; x <= end.x; ++x) {
+            depth = max(depth, texelFetch(source, ivec2(x, y), 0).r);
+        }
+    }
+
+    imageStore(destination, texel, vec4(depth));
+}
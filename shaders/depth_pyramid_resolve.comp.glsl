@@ -0,0 +1,35 @@
+#version 450
+
+// NexDepthPyramid level 0 from the multisampled scene depth, the farthest of every sample is kept
+layout(local_size_x = 8, local_size_y = 8) in;
+
+layout(set = 0, binding = 0) uniform sampler2DMS source;
+layout(set = 0, binding = 1, r32f) uniform writeonly image2D destination;
+
+layout(push_constant) uniform Push {
+    ivec2 source_size;
+    ivec2 destination_size;
+} push;
+
+void main() {
+    ivec2 texel = ivec2(gl_GlobalInvocationID.xy);
+    if (any(greaterThanEqual(texel, push.destination_size))) {
+        return;
+    }
+
+    ivec2 last  = push.source_size - 1;
+    ivec2 first = min(texel * 2, last);
+    ivec2 end   = min(first + 1 + ivec2(equal(texel, push.destination_size - 1)), last);
+    int samples = textureSamples(source);
+
+    float depth = 0.0;
+    for (int y = first.y; y <= end.y; ++y) {
+        for (int x = first.x; x <= end.x; ++x) {
+            for (int s = 0; s < samples; ++s) {
+                depth = max(depth, texelFetch(source, ivec2(x, y), s).r);
+            }
+        }
+    }
+
+    imageStore(destination, texel, vec4(depth));
+}
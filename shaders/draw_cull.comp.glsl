@@ -0,0 +1,170 @@
+#version 450
+
+// CullingSystem, tests every indirect command of the gpu scene against its pass' frustum and, for the main pass, against
+// the depth pyramid of last frame, then writes the surviving commands to the culled command buffer
+layout(local_size_x = 64) in;
+
+struct DrawCommand {
+    uint index_count;
+    uint instance_count;
+    uint first_index;
+    int  vertex_offset;
+    uint first_instance;
+};
+
+struct ObjectData {
+    mat4 model_matrix;
+    mat4 normal_matrix;
+    vec4 bounding_sphere;
+    int material_index;
+    uint texture_index;
+};
+
+struct CullRecord {
+    uint batch;
+    uint first_command;
+};
+
+layout(set = 0, binding = 0) uniform CullUbo {
+    vec4 camera_planes[6];
+    vec4 light_planes[6];
+    mat4 occlusion_view_projection;  // the matrix the depth pyramid was rendered with
+    vec2 depth_size;
+    uint pyramid_levels;
+    uint command_count;
+    uint main_command_count;  // the main pass' commands come first, the shadow pass' after them
+    uint occlusion;
+    uint compact;
+} ubo;
+
+layout(std430, set = 0, binding = 1) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+layout(std430, set = 0, binding = 2) readonly buffer CommandBuffer {
+    DrawCommand commands[];
+};
+
+layout(std430, set = 0, binding = 3) readonly buffer CullRecordBuffer {
+    CullRecord records[];
+};
+
+layout(std430, set = 0, binding = 4) writeonly buffer CulledCommandBuffer {
+    DrawCommand culled_commands[];
+};
+
+// NexCullingStats followed by the draw count of every batch
+layout(std430, set = 0, binding = 5) buffer DrawCountBuffer {
+    uint stats[8];
+    uint draw_counts[];
+};
+
+layout(set = 0, binding = 6) uniform sampler2D depth_pyramid;
+
+const uint stat_tested           = 0;
+const uint stat_visible          = 1;
+const uint stat_frustum_culled   = 2;
+const uint stat_occlusion_culled = 3;
+const uint stat_shadow_tested    = 4;
+const uint stat_shadow_visible   = 5;
+const uint stat_count            = 6;
+
+shared uint group_stats[stat_count];
+
+bool isOccluded(vec4 sphere) {
+    vec3 ndc_min = vec3(1e30);
+    vec3 ndc_max = vec3(-1e30);
+
+    for (int i = 0; i < 8; ++i) {
+        vec3 corner = sphere.xyz + sphere.w * vec3((i & 1) != 0 ? 1.0 : -1.0, (i & 2) != 0 ? 1.0 : -1.0, (i & 4) != 0 ? 1.0 : -1.0);
+        vec4 clip   = ubo.occlusion_view_projection * vec4(corner, 1.0);
+
+        // in front of the near plane there is nothing to compare against
+        if (clip.w <= 0.0 || clip.z < 0.0) {
+            return false;
+        }
+
+        vec3 ndc = clip.xyz / clip.w;
+        ndc_min  = min(ndc_min, ndc);
+        ndc_max  = max(ndc_max, ndc);
+    }
+
+    // last frame never saw what lies outside its view, so only boxes fully on screen can be rejected
+    if (any(lessThan(ndc_min.xy, vec2(-1.0))) || any(greaterThan(ndc_max.xy, vec2(1.0)))) {
+        return false;
+    }
+
+    vec2 pixel_min = min((ndc_min.xy * 0.5 + 0.5) * ubo.depth_size, ubo.depth_size - 1.0);
+    vec2 pixel_max = min((ndc_max.xy * 0.5 + 0.5) * ubo.depth_size, ubo.depth_size - 1.0);
+    vec2 extent    = pixel_max - pixel_min;
+
+    // a texel of level l covers 2^(l + 1) depth pixels, on the level picked here the box touches at most 2x2 texels
+    int level = max(int(ceil(log2(max(max(extent.x, extent.y), 1.0)))) - 1, 0);
+    if (level >= int(ubo.pyramid_levels)) {
+        return false;
+    }
+
+    ivec2 last      = textureSize(depth_pyramid, level) - 1;
+    ivec2 texel_min = min(ivec2(pixel_min) >> (level + 1), last);
+    ivec2 texel_max = min(ivec2(pixel_max) >> (level + 1), last);
+
+    float farthest = max(max(texelFetch(depth_pyramid, texel_min, level).r, texelFetch(depth_pyramid, ivec2(texel_max.x, texel_min.y), level).r),
+                         max(texelFetch(depth_pyramid, ivec2(texel_min.x, texel_max.y), level).r, texelFetch(depth_pyramid, texel_max, level).r));
+
+    return ndc_min.z > farthest;
+}
+
+void main() {
+    if (gl_LocalInvocationIndex < stat_count) {
+        group_stats[gl_LocalInvocationIndex] = 0;
+    }
+    barrier();
+
+    uint index = gl_GlobalInvocationID.x;
+    if (index < ubo.command_count) {
+        DrawCommand command   = commands[index];
+        CullRecord  record    = records[index];
+        vec4        sphere    = objects[command.first_instance].bounding_sphere;
+        bool        main_pass = index < ubo.main_command_count;
+
+        bool visible = true;
+        for (int i = 0; i < 6; ++i) {
+            vec4 plane = main_pass ? ubo.camera_planes[i] : ubo.light_planes[i];
+            visible    = visible && dot(plane.xyz, sphere.xyz) + plane.w >= -sphere.w;
+        }
+
+        if (main_pass) {
+            atomicAdd(group_stats[stat_tested], 1);
+            if (!visible) {
+                atomicAdd(group_stats[stat_frustum_culled], 1);
+            } else if (ubo.occlusion != 0 && isOccluded(sphere)) {
+                visible = false;
+                atomicAdd(group_stats[stat_occlusion_culled], 1);
+            }
+            if (visible) {
+                atomicAdd(group_stats[stat_visible], 1);
+            }
+        } else {
+            atomicAdd(group_stats[stat_shadow_tested], 1);
+            if (visible) {
+                atomicAdd(group_stats[stat_shadow_visible], 1);
+            }
+        }
+
+        if (ubo.compact != 0) {
+            if (visible) {
+                uint slot                                    = atomicAdd(draw_counts[record.batch], 1);
+                culled_commands[record.first_command + slot] = command;
+            }
+        } else {
+            command.instance_count = visible ? command.instance_count : 0;
+            culled_commands[index] = command;
+        }
+    }
+
+    // one atomic per group and counter on the shared buffer
+    barrier();
+    if (gl_LocalInvocationIndex < stat_count && group_stats[gl_LocalInvocationIndex] != 0) {
+        atomicAdd(stats[gl_LocalInvocationIndex], group_stats[gl_LocalInvocationIndex]);
+    }
+}
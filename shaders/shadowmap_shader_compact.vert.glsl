@@ -0,0 +1,12 @@
+#version 450
+
+// NexMesh::CompactVertex, w holds the vertex color and is not needed here
+layout(location = 0) in uvec4 position;
+
+layout(push_constant) uniform Push {
+    mat4 light_space_model_matrix;  // includes the mesh's dequantization
+} push;
+
+void main() {
+    gl_Position = push.light_space_model_matrix * vec4(vec3(position.xyz), 1.0);
+}
@@ -0,0 +1,24 @@
+#version 450
+
+// NexMesh::CompactVertex, w holds the vertex color and is not needed here
+layout(location = 0) in uvec4 position;
+
+struct ObjectData {
+    mat4 model_matrix;  // includes the mesh's dequantization
+    mat4 normal_matrix;
+    vec4 bounding_sphere;
+    int material_index;
+    uint texture_index;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+layout(push_constant) uniform Push {
+    mat4 light_space_matrix;
+} push;
+
+void main() {
+    gl_Position = push.light_space_matrix * objects[gl_InstanceIndex].model_matrix * vec4(vec3(position.xyz), 1.0);
+}
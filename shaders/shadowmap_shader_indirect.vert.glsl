@@ -0,0 +1,23 @@
+#version 450
+
+layout(location = 0) in vec3 position;
+
+struct ObjectData {
+    mat4 model_matrix;
+    mat4 normal_matrix;
+    vec4 bounding_sphere;
+    int material_index;
+    uint texture_index;
+};
+
+layout(std430, set = 0, binding = 0) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+layout(push_constant) uniform Push {
+    mat4 light_space_matrix;
+} push;
+
+void main() {
+    gl_Position = push.light_space_matrix * objects[gl_InstanceIndex].model_matrix * vec4(position, 1.0);
+}
@@ -1,10 +1,13 @@
 #version 450
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec3 fragColor;
 layout(location = 1) in vec3 fragPosWorld;
 layout(location = 2) in vec3 fragNormalWorld;
 layout(location = 3) in vec2 fragUV;
 layout(location = 4) in vec4 fragPosLightSpace;
+layout(location = 5) flat in int fragMaterialIndex;
+layout(location = 6) flat in uint fragTextureIndex;
 
 layout(location = 0) out vec4 outColor;
 
@@ -22,16 +25,10 @@ layout(set = 0, binding = 0) uniform GlobalUbo {
     int light_count;
 } ubo;
 
-layout(set = 1, binding = 0) uniform sampler2D texture_sampler;
+// NexTextureTable, the index differs between the instances of one indirect or instanced draw
+layout(set = 1, binding = 0) uniform sampler2D textures[];
 layout(set = 2, binding = 0) uniform sampler2D shadow_map;
 
-layout(push_constant) uniform Push {
-    mat4 model_matrix;
-    mat4 normal_matrix;
-    mat4 light_space_matrix;
-    int material_index;
-} push;
-
 float textureProj(vec4 shadowCoord, vec2 off)
 {
     float shadow = 1.0;
@@ -100,7 +97,7 @@ void main() {
 
         diffuse_light += intensity * cos_angle_incident;
 
-        if (push.material_index == 0) {
+        if (fragMaterialIndex == 0) {
             continue;
         }
 
@@ -111,7 +108,7 @@ void main() {
         specular_light += intensity * blinn_phong_exponent;
     }
 
-    vec3 texture_color = texture(texture_sampler, fragUV).xyz;
+    vec3 texture_color = texture(textures[nonuniformEXT(fragTextureIndex)], fragUV).xyz;
 
     vec3 ambient_light = ubo.ambient_light_color.xyz * ubo.ambient_light_color.w * 0.5;
     vec3 final_color = (ambient_light + diffuse_light) * texture_color + specular_light;
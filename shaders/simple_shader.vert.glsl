@@ -10,6 +10,8 @@ layout(location = 1) out vec3 fragPosWorld;
 layout(location = 2) out vec3 fragNormalWorld;
 layout(location = 3) out vec2 fragUV;
 layout(location = 4) out vec4 fragPosLightSpace;
+layout(location = 5) flat out int fragMaterialIndex;
+layout(location = 6) flat out uint fragTextureIndex;
 
 struct PointLight {
     vec4 position;
@@ -30,6 +32,7 @@ layout(push_constant) uniform Push {
     mat4 normal_matrix;
     mat4 light_space_matrix;
     int material_index;
+    uint texture_index;  // into the texture table
 } push;
 
 void main() {
@@ -41,4 +44,6 @@ void main() {
     fragColor = color;
     fragUV = uv;
     fragPosLightSpace = push.light_space_matrix * position_in_world;
+    fragMaterialIndex = push.material_index;
+    fragTextureIndex = push.texture_index;
 }
@@ -0,0 +1,76 @@
+#version 450
+
+// NexMesh::CompactVertex
+layout(location = 0) in uvec4 position_color;  // xyz quantized to the mesh bounds, w is rgb565
+layout(location = 1) in vec2 octahedral_normal;
+layout(location = 2) in vec2 uv;
+
+layout(location = 0) out vec3 fragColor;
+layout(location = 1) out vec3 fragPosWorld;
+layout(location = 2) out vec3 fragNormalWorld;
+layout(location = 3) out vec2 fragUV;
+layout(location = 4) out vec4 fragPosLightSpace;
+layout(location = 5) flat out int fragMaterialIndex;
+layout(location = 6) flat out uint fragTextureIndex;
+
+struct PointLight {
+    vec4 position;
+    vec4 color;
+};
+
+layout(set = 0, binding = 0) uniform GlobalUbo {
+    mat4 projection_matrix;
+    mat4 view_matrix;
+    mat4 inverse_view_matrix;
+    vec4 ambient_light_color;
+    PointLight point_lights[10];
+    int light_count;
+} ubo;
+
+struct ObjectData {
+    mat4 model_matrix;  // includes the mesh's dequantization
+    mat4 normal_matrix;
+    vec4 bounding_sphere;
+    int material_index;
+    uint texture_index;  // into the texture table, ~0 for the renderer's default texture
+};
+
+// NexGpuScene's per object buffer or NexInstancer's instance buffer, the draws put the first index in firstInstance
+layout(std430, set = 3, binding = 0) readonly buffer ObjectBuffer {
+    ObjectData objects[];
+};
+
+layout(push_constant) uniform Push {
+    mat4 light_space_matrix;
+    uint default_texture_index;
+} push;
+
+vec3 decodeOctahedral(vec2 e) {
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+vec3 decodeColor565(uint c) {
+    return vec3(float((c >> 11) & 31u) / 31.0, float((c >> 5) & 63u) / 63.0, float(c & 31u) / 31.0);
+}
+
+void main() {
+    vec3 position = vec3(position_color.xyz);
+    vec3 normal = decodeOctahedral(octahedral_normal);
+    vec3 color = decodeColor565(position_color.w);
+
+    ObjectData object = objects[gl_InstanceIndex];
+
+    vec4 position_in_world = object.model_matrix * vec4(position, 1.0);
+    gl_Position = ubo.projection_matrix * ubo.view_matrix * position_in_world;
+
+    fragNormalWorld = normalize(mat3(object.normal_matrix) * normal);
+    fragPosWorld = position_in_world.xyz;
+    fragColor = color;
+    fragUV = uv;
+    fragPosLightSpace = push.light_space_matrix * position_in_world;
+    fragMaterialIndex = object.material_index;
+    fragTextureIndex = object.texture_index == 0xFFFFFFFFu ? push.default_texture_index : object.texture_index;
+}
@@ -0,0 +1,145 @@
+#include "nex_dedup_benchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+#include "../core/nex_job_system.hpp"
+#include "../core/nex_utils.hpp"
+#include "../scene/nex_mesh.hpp"
+#include "tiny_obj_loader.hpp"
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/hash.hpp>
+
+namespace std {
+    template <>
+    struct hash<nex::NexMesh::Vertex> {
+        size_t operator()(const nex::NexMesh::Vertex& vertex) const {
+            size_t seed = 0;
+            nex::hashCombine(seed, vertex.m_position, vertex.m_color, vertex.m_normal, vertex.m_uv);
+            return seed;
+        }
+    };
+};  // namespace std
+
+namespace nex {
+    // the deduplication NexMesh::Builder used before the triplet table, kept as the baseline
+    static void deduplicateByValue(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes, std::vector<NexMesh::Vertex>& vertices, std::vector<uint32_t>& indices) {
+        vertices.clear();
+        indices.clear();
+
+        std::unordered_map<NexMesh::Vertex, uint32_t> unique_vertices = {};
+
+        for (const auto& shape : shapes) {
+            for (const auto& index : shape.mesh.indices) {
+                NexMesh::Vertex vertex = {};
+
+                if (index.vertex_index >= 0) {
+                    vertex.m_position = {attrib.vertices[3 * index.vertex_index + 0], attrib.vertices[3 * index.vertex_index + 1], attrib.vertices[3 * index.vertex_index + 2]};
+                    vertex.m_color    = {attrib.colors[3 * index.vertex_index + 0], attrib.colors[3 * index.vertex_index + 1], attrib.colors[3 * index.vertex_index + 2]};
+                }
+
+                if (index.normal_index >= 0) {
+                    vertex.m_normal = {attrib.normals[3 * index.normal_index + 0], attrib.normals[3 * index.normal_index + 1], attrib.normals[3 * index.normal_index + 2]};
+                }
+
+                if (index.texcoord_index >= 0) {
+                    vertex.m_uv = {attrib.texcoords[2 * index.texcoord_index + 0], 1.0f - attrib.texcoords[2 * index.texcoord_index + 1]};
+                }
+
+                if (unique_vertices.count(vertex) == 0) {
+                    unique_vertices[vertex] = static_cast<uint32_t>(vertices.size());
+                    vertices.push_back(vertex);
+                }
+                indices.push_back(unique_vertices[vertex]);
+            }
+        }
+    }
+
+    // best of n, so the first cold run and scheduler noise do not count
+    template <typename F>
+    static double bestMilliseconds(uint32_t iterations, F&& run) {
+        double best = std::numeric_limits<double>::max();
+        for (uint32_t i = 0; i < iterations; ++i) {
+            auto begin = std::chrono::steady_clock::now();
+            run();
+            best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+        }
+        return best;
+    }
+
+    // both results must describe the same triangles, even if the triplet table keeps a few extra vertices
+    static bool sameCorners(const std::vector<NexMesh::Vertex>& a_vertices, const std::vector<uint32_t>& a_indices, std::span<const NexMesh::Vertex> b_vertices,
+                            std::span<const uint32_t> b_indices) {
+        if (a_indices.size() != b_indices.size()) {
+            return false;
+        }
+
+        for (size_t i = 0; i < a_indices.size(); ++i) {
+            if (!(a_vertices[a_indices[i]] == b_vertices[b_indices[i]])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    int runDedupBenchmark(const std::string& models_dir, uint32_t iterations) {
+        std::vector<std::filesystem::path> models;
+        for (const auto& entry : std::filesystem::directory_iterator(models_dir)) {
+            if (entry.path().extension() == ".obj") {
+                models.push_back(entry.path());
+            }
+        }
+        std::sort(models.begin(), models.end());
+
+        if (models.empty()) {
+            std::cerr << "no .obj files found in " << models_dir << std::endl;
+            return EXIT_FAILURE;
+        }
+
+        NexJobSystem job_system;
+        bool         all_match = true;
+
+        std::cout << std::left << std::setw(20) << "model" << std::right << std::setw(10) << "corners" << std::setw(10) << "by value" << std::setw(10) << "triplet" << std::setw(12)
+                  << "value ms" << std::setw(12) << "triplet ms" << std::setw(12) << "shapes ms" << std::setw(10) << "speedup" << std::endl;
+
+        for (const auto& model : models) {
+            tinyobj::attrib_t                attrib;
+            std::vector<tinyobj::shape_t>    shapes;
+            std::vector<tinyobj::material_t> materials;
+
+            std::string warn, err;
+            if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, model.c_str())) {
+                std::cerr << "failed to load " << model << ": " << warn << err << std::endl;
+                return EXIT_FAILURE;
+            }
+
+            std::vector<NexMesh::Vertex> value_vertices;
+            std::vector<uint32_t>        value_indices;
+            NexMesh::Builder             serial;
+            NexMesh::Builder             parallel;
+
+            double value_ms    = bestMilliseconds(iterations, [&]() { deduplicateByValue(attrib, shapes, value_vertices, value_indices); });
+            double triplet_ms  = bestMilliseconds(iterations, [&]() { serial.deduplicate(attrib, shapes); });
+            double parallel_ms = bestMilliseconds(iterations, [&]() { parallel.deduplicate(attrib, shapes, &job_system); });
+
+            bool match = sameCorners(value_vertices, value_indices, serial.vertices(), serial.indices()) && sameCorners(value_vertices, value_indices, parallel.vertices(), parallel.indices());
+            all_match  = all_match && match;
+
+            std::cout << std::left << std::setw(20) << model.filename().string() << std::right << std::setw(10) << value_indices.size() << std::setw(10) << value_vertices.size()
+                      << std::setw(10) << serial.m_vertices.size() << std::fixed << std::setprecision(3) << std::setw(12) << value_ms << std::setw(12) << triplet_ms << std::setw(12)
+                      << parallel_ms << std::setprecision(2) << std::setw(9) << value_ms / std::min(triplet_ms, parallel_ms) << "x" << (match ? "" : "  MISMATCH") << std::endl;
+        }
+
+        std::cout << "shapes ms uses one table per obj shape on " << job_system.getThreadCount() << " worker threads plus the caller" << std::endl;
+        return all_match ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+}  // namespace nex
@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace nex {
+    // Times vertex deduplication of every .obj in models_dir: the original unordered_map<Vertex> approach against the
+    // index triplet table, serial and per shape on the job system. Parsing is done once up front and is not timed.
+    int runDedupBenchmark(const std::string& models_dir, uint32_t iterations = 10);
+}  // namespace nex
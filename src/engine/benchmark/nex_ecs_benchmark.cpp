@@ -0,0 +1,155 @@
+#include "nex_ecs_benchmark.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <unordered_map>
+
+#include "../scene/nex_entity.hpp"
+
+namespace nex {
+    // no mesh can be created without a device and the queries only test the handle for null, so an id stands in for the mesh.
+    // The component is laid out like MeshComponent, the views walk the same memory as they would in the engine
+    struct BenchmarkMesh {
+        uint32_t m_id = 0;
+    };
+
+    struct BenchmarkMeshComponent {
+        std::shared_ptr<BenchmarkMesh> m_mesh           = {};
+        int                            m_material_index = 0;
+    };
+    static_assert(sizeof(BenchmarkMeshComponent) == sizeof(MeshComponent));
+
+    // the entity the engine stored by value in an unordered_map before the registry, kept as the baseline
+    struct LegacyEntity {
+        int                                  m_material_index = 0;
+        glm::vec3                            m_color          = {};
+        TransformComponent                   m_transform      = {};
+        std::shared_ptr<BenchmarkMesh>       m_model          = {};
+        std::unique_ptr<PointLightComponent> m_point_light    = {};
+        std::shared_ptr<NexTexture>          m_texture        = {};
+    };
+
+    // best of n, so the first cold run and scheduler noise do not count
+    template <typename F>
+    static double bestMilliseconds(uint32_t iterations, F&& run) {
+        double best = std::numeric_limits<double>::max();
+        for (uint32_t i = 0; i < iterations; ++i) {
+            auto begin = std::chrono::steady_clock::now();
+            run();
+            best = std::min(best, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - begin).count());
+        }
+        return best;
+    }
+
+    int runEcsBenchmark(uint32_t entity_count, uint32_t iterations) {
+        auto mesh = std::make_shared<BenchmarkMesh>();
+
+        std::unordered_map<uint32_t, LegacyEntity> legacy   = {};
+        NexRegistry                                registry = {};
+
+        // mostly meshes, one light in a thousand and some entities with neither, like transform only helpers
+        for (uint32_t i = 0; i < entity_count; ++i) {
+            TransformComponent transform = {};
+            transform.m_translation      = {static_cast<float>(i % 1000), 0.0f, static_cast<float>(i / 1000)};
+            transform.m_rotation         = {0.001f * static_cast<float>(i % 628), 0.0f, 0.0f};
+
+            LegacyEntity& entity = legacy[i];
+            entity.m_transform   = transform;
+
+            NexEntity id = registry.create();
+            registry.emplace<TransformComponent>(id, transform);
+
+            if (i % 1000 == 0) {
+                entity.m_point_light = std::make_unique<PointLightComponent>();
+                registry.emplace<PointLightComponent>(id);
+            } else if (i % 10 != 0) {
+                entity.m_model          = mesh;
+                entity.m_material_index = static_cast<int>(i % 2);
+                registry.emplace<BenchmarkMeshComponent>(id, BenchmarkMeshComponent{mesh, static_cast<int>(i % 2)});
+            }
+        }
+
+        // what the render and shadow passes do per drawn entity, minus the draw
+        glm::vec4 legacy_mesh_sum = {};
+        glm::vec4 view_mesh_sum   = {};
+        double    legacy_mesh_ms  = bestMilliseconds(iterations, [&]() {
+            legacy_mesh_sum = {};
+            for (auto& [id, entity] : legacy) {
+                if (entity.m_model) {
+                    legacy_mesh_sum += entity.m_transform.localMatrix()[3] * static_cast<float>(entity.m_material_index + 1);
+                }
+            }
+        });
+        double    view_mesh_ms    = bestMilliseconds(iterations, [&]() {
+            view_mesh_sum = {};
+            registry.view<TransformComponent, BenchmarkMeshComponent>().each([&](NexEntity, TransformComponent& transform, BenchmarkMeshComponent& mesh_component) {
+                if (mesh_component.m_mesh) {
+                    view_mesh_sum += transform.localMatrix()[3] * static_cast<float>(mesh_component.m_material_index + 1);
+                }
+            });
+        });
+
+        // what the point light system does every frame
+        glm::vec3 legacy_light_sum = {};
+        glm::vec3 view_light_sum   = {};
+        double    legacy_light_ms  = bestMilliseconds(iterations, [&]() {
+            legacy_light_sum = {};
+            for (auto& [id, entity] : legacy) {
+                if (entity.m_point_light) {
+                    legacy_light_sum += entity.m_transform.m_translation * entity.m_point_light->m_intensity;
+                }
+            }
+        });
+        double    view_light_ms    = bestMilliseconds(iterations, [&]() {
+            view_light_sum = {};
+            registry.view<TransformComponent, PointLightComponent>().each([&](NexEntity, TransformComponent& transform, PointLightComponent& light) {
+                view_light_sum += transform.m_translation * light.m_intensity;
+            });
+        });
+
+        // a pass over every transform, as a transform update would do
+        glm::vec3 legacy_transform_sum = {};
+        glm::vec3 view_transform_sum   = {};
+        double    legacy_transform_ms  = bestMilliseconds(iterations, [&]() {
+            legacy_transform_sum = {};
+            for (auto& [id, entity] : legacy) {
+                legacy_transform_sum += entity.m_transform.m_translation;
+            }
+        });
+        double    view_transform_ms    = bestMilliseconds(iterations, [&]() {
+            view_transform_sum = {};
+            registry.view<TransformComponent>().each([&](NexEntity, TransformComponent& transform) {
+                view_transform_sum += transform.m_translation;
+            });
+        });
+
+        // the sums are taken in a different order, so they are only compared roughly
+        auto close = [](float a, float b) {
+            return std::abs(a - b) <= 1e-3f * std::max({1.0f, std::abs(a), std::abs(b)});
+        };
+        bool match = close(legacy_mesh_sum.x, view_mesh_sum.x) && close(legacy_mesh_sum.z, view_mesh_sum.z) && close(legacy_light_sum.x, view_light_sum.x) &&
+                     close(legacy_transform_sum.z, view_transform_sum.z);
+
+        std::cout << entity_count << " entities, best of " << iterations << std::endl;
+        std::cout << std::left << std::setw(24) << "query" << std::right << std::setw(12) << "map ms" << std::setw(12) << "view ms" << std::setw(10) << "speedup" << std::endl;
+
+        auto row = [](const char* name, double map_ms, double view_ms) {
+            std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(3) << std::setw(12) << map_ms << std::setw(12) << view_ms
+                      << std::setprecision(2) << std::setw(9) << map_ms / view_ms << "x" << std::endl;
+        };
+        row("transform + mesh", legacy_mesh_ms, view_mesh_ms);
+        row("transform + light", legacy_light_ms, view_light_ms);
+        row("transform", legacy_transform_ms, view_transform_ms);
+
+        if (!match) {
+            std::cerr << "MISMATCH between the map and the registry results" << std::endl;
+        }
+        return match ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+}  // namespace nex
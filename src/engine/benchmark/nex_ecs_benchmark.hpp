@@ -0,0 +1,10 @@
+#pragma once
+
+#include <cstdint>
+
+namespace nex {
+    // Times the per frame entity queries of the render, shadow and point light systems over entity_count entities: the
+    // unordered_map of NexEntity objects the engine used before NexRegistry against the registry's views.
+    // Nothing is drawn, so this runs without a window or a device.
+    int runEcsBenchmark(uint32_t entity_count = 1000000, uint32_t iterations = 10);
+}  // namespace nex
@@ -0,0 +1,192 @@
+#include "nex_frame_benchmark.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+
+namespace nex {
+    NexFrameBenchmark::NexFrameBenchmark(std::string scene, std::string camera_path, uint32_t frame_count, float timestep)
+        : m_scene{std::move(scene)}, m_camera_path{std::move(camera_path)}, m_frame_count{frame_count}, m_timestep{timestep} {
+        m_samples.reserve(frame_count);
+    }
+
+    void NexFrameBenchmark::addFrame(uint64_t frame_number, double cpu_ms, double frame_ms) {
+        if (m_samples.empty()) {
+            m_first_frame = frame_number;
+        }
+        if (isDone()) {
+            return;
+        }
+        m_samples.push_back({cpu_ms, frame_ms, -1.0});
+    }
+
+    void NexFrameBenchmark::addGpuTime(uint64_t frame_number, double gpu_ms) {
+        // warm up frames finish before the run starts, and the frames after it may still drain
+        if (m_samples.empty() || frame_number < m_first_frame || frame_number - m_first_frame >= m_samples.size()) {
+            return;
+        }
+        m_samples[frame_number - m_first_frame].m_gpu_ms = gpu_ms;
+    }
+
+    std::vector<double> NexFrameBenchmark::collect(double NexFrameSample::* field) const {
+        std::vector<double> values = {};
+        values.reserve(m_samples.size());
+        for (const auto& sample : m_samples) {
+            if (sample.*field >= 0.0) {
+                values.push_back(sample.*field);
+            }
+        }
+        return values;
+    }
+
+    NexTimingSummary NexFrameBenchmark::summarize(std::vector<double> values) {
+        NexTimingSummary summary = {};
+        if (values.empty()) {
+            return summary;
+        }
+
+        std::sort(values.begin(), values.end());
+
+        // nearest rank, so every percentile is a frame that actually happened
+        auto percentile = [&](double p) {
+            size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * static_cast<double>(values.size())));
+            return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+        };
+
+        summary.m_mean = std::accumulate(values.begin(), values.end(), 0.0) / static_cast<double>(values.size());
+        summary.m_min  = values.front();
+        summary.m_max  = values.back();
+        summary.m_p50  = percentile(50.0);
+        summary.m_p95  = percentile(95.0);
+        summary.m_p99  = percentile(99.0);
+        return summary;
+    }
+
+    // quoted, with the characters json doesn't allow raw escaped. Scene and camera path come from the command line, the device name from the driver
+    static void writeString(std::ofstream& file, const std::string& value) {
+        file << '"';
+        for (char c : value) {
+            switch (c) {
+                case '"':
+                    file << "\\\"";
+                    break;
+                case '\\':
+                    file << "\\\\";
+                    break;
+                case '\n':
+                    file << "\\n";
+                    break;
+                case '\r':
+                    file << "\\r";
+                    break;
+                case '\t':
+                    file << "\\t";
+                    break;
+                default:
+                    if (static_cast<unsigned char>(c) < 0x20) {
+                        char buffer[8];
+                        std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned>(c));
+                        file << buffer;
+                    } else {
+                        file << c;
+                    }
+                    break;
+            }
+        }
+        file << '"';
+    }
+
+    static void writeSummary(std::ofstream& file, const char* name, const NexTimingSummary& summary, size_t count) {
+        file << "    \"" << name << "\": {\"samples\": " << count << ", \"mean\": " << summary.m_mean << ", \"min\": " << summary.m_min << ", \"max\": " << summary.m_max
+             << ", \"p50\": " << summary.m_p50 << ", \"p95\": " << summary.m_p95 << ", \"p99\": " << summary.m_p99 << "}";
+    }
+
+    // bins of histogram_bin_ms starting at zero, up to the bin of the slowest frame
+    static void writeHistogram(std::ofstream& file, const char* name, const std::vector<double>& values, double bin_ms) {
+        std::vector<uint32_t> bins = {};
+        for (double value : values) {
+            size_t bin = static_cast<size_t>(value / bin_ms);
+            if (bin >= bins.size()) {
+                bins.resize(bin + 1, 0);
+            }
+            bins[bin]++;
+        }
+
+        file << "    \"" << name << "\": {\"bin_ms\": " << bin_ms << ", \"counts\": [";
+        for (size_t i = 0; i < bins.size(); ++i) {
+            file << (i > 0 ? ", " : "") << bins[i];
+        }
+        file << "]}";
+    }
+
+    void NexFrameBenchmark::write(const std::string& path_prefix, const std::string& device_name) const {
+        std::vector<double> cpu   = collect(&NexFrameSample::m_cpu_ms);
+        std::vector<double> frame = collect(&NexFrameSample::m_frame_ms);
+        std::vector<double> gpu   = collect(&NexFrameSample::m_gpu_ms);
+
+        std::ofstream json(path_prefix + ".json");
+        if (!json) {
+            throw std::runtime_error("Failed to open " + path_prefix + ".json for writing!");
+        }
+
+        json << std::fixed << std::setprecision(4);
+        json << "{\n";
+        json << "    \"scene\": ";
+        writeString(json, m_scene);
+        json << ",\n    \"camera_path\": ";
+        writeString(json, m_camera_path);
+        json << ",\n    \"device\": ";
+        writeString(json, device_name);
+        json << ",\n";
+        json << "    \"frames\": " << m_samples.size() << ",\n";
+        json << "    \"timestep\": " << m_timestep << ",\n";
+        writeSummary(json, "cpu_ms", summarize(cpu), cpu.size());
+        json << ",\n";
+        writeSummary(json, "frame_ms", summarize(frame), frame.size());
+        json << ",\n";
+        writeSummary(json, "gpu_ms", summarize(gpu), gpu.size());
+        json << ",\n";
+        writeHistogram(json, "frame_ms_histogram", frame, histogram_bin_ms);
+        json << ",\n";
+        writeHistogram(json, "gpu_ms_histogram", gpu, histogram_bin_ms);
+        json << "\n}\n";
+
+        std::ofstream csv(path_prefix + ".csv");
+        if (!csv) {
+            throw std::runtime_error("Failed to open " + path_prefix + ".csv for writing!");
+        }
+
+        // missing gpu times are left empty
+        csv << std::fixed << std::setprecision(4);
+        csv << "frame,cpu_ms,frame_ms,gpu_ms\n";
+        for (size_t i = 0; i < m_samples.size(); ++i) {
+            csv << i << ',' << m_samples[i].m_cpu_ms << ',' << m_samples[i].m_frame_ms << ',';
+            if (m_samples[i].m_gpu_ms >= 0.0) {
+                csv << m_samples[i].m_gpu_ms;
+            }
+            csv << '\n';
+        }
+
+        std::cout << "benchmark results written to " << path_prefix << ".json and " << path_prefix << ".csv" << std::endl;
+    }
+
+    void NexFrameBenchmark::printSummary() const {
+        auto print = [](const char* name, const std::vector<double>& values) {
+            NexTimingSummary summary = summarize(values);
+            std::cout << "  " << std::left << std::setw(6) << name << std::right << std::fixed << std::setprecision(3) << " mean " << summary.m_mean << " ms, p50 "
+                      << summary.m_p50 << " ms, p95 " << summary.m_p95 << " ms, p99 " << summary.m_p99 << " ms, max " << summary.m_max << " ms (" << values.size()
+                      << " samples)" << std::endl;
+        };
+
+        std::cout << "benchmark " << m_scene << " along " << m_camera_path << ", " << m_samples.size() << " frames:" << std::endl;
+        print("cpu", collect(&NexFrameSample::m_cpu_ms));
+        print("frame", collect(&NexFrameSample::m_frame_ms));
+        print("gpu", collect(&NexFrameSample::m_gpu_ms));
+    }
+}  // namespace nex
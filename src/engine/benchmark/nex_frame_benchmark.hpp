@@ -0,0 +1,56 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace nex {
+    struct NexFrameSample {
+        double m_cpu_ms   = 0.0;   // from the start of the frame's update to its submission
+        double m_frame_ms = 0.0;   // wall time since the previous frame started
+        double m_gpu_ms   = -1.0;  // first to last command of the frame, negative until its timestamps are read back
+    };
+
+    struct NexTimingSummary {
+        double m_mean = 0.0;
+        double m_min  = 0.0;
+        double m_max  = 0.0;
+        double m_p50  = 0.0;
+        double m_p95  = 0.0;
+        double m_p99  = 0.0;
+    };
+
+    // Per frame timings of a benchmark run. The gpu times arrive a few frames late, so samples are keyed by the renderer's frame
+    // number and the first frame recorded sets where the run starts. write() adds a .json summary with percentiles and a frame time
+    // histogram, and a .csv of every frame, so runs can be compared across commits.
+    class NexFrameBenchmark {
+      public:
+        static constexpr double histogram_bin_ms = 0.5;
+
+        NexFrameBenchmark(std::string scene, std::string camera_path, uint32_t frame_count, float timestep);
+
+        void addFrame(uint64_t frame_number, double cpu_ms, double frame_ms);
+        void addGpuTime(uint64_t frame_number, double gpu_ms);
+
+        bool isDone() const {
+            return m_samples.size() >= m_frame_count;
+        }
+
+        void write(const std::string& path_prefix, const std::string& device_name) const;
+        void printSummary() const;
+
+      private:
+        // gpu samples that never arrived are left out
+        std::vector<double> collect(double NexFrameSample::* field) const;
+
+        static NexTimingSummary summarize(std::vector<double> values);
+
+        std::string m_scene;
+        std::string m_camera_path;
+        uint32_t    m_frame_count = 0;
+        float       m_timestep    = 0.0f;
+
+        uint64_t                    m_first_frame = 0;
+        std::vector<NexFrameSample> m_samples     = {};
+    };
+}  // namespace nex
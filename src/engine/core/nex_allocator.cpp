@@ -0,0 +1,398 @@
+#include "nex_allocator.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <iostream>
+#include <set>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace nex {
+    static VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment) {
+        return (value + alignment - 1) & ~(alignment - 1);
+    }
+
+    static VkDeviceSize alignDown(VkDeviceSize value, VkDeviceSize alignment) {
+        return value & ~(alignment - 1);
+    }
+
+    // One vkAllocateMemory. Sub-allocated either with a buddy allocator or as a linear arena,
+    // a dedicated block holds a single resource that was too big to share a block with others.
+    class NexMemoryBlock {
+      public:
+        static constexpr uint32_t min_order = 8;  // 256 byte smallest buddy node
+
+        NexMemoryBlock(VkDevice device, uint32_t memory_type, VkDeviceSize size, bool host_visible, bool linear_resource, NexAllocationStrategy strategy, bool dedicated)
+            : m_device{device}
+            , m_memory_type{memory_type}
+            , m_size{size}
+            , m_linear_resource{linear_resource}
+            , m_strategy{strategy}
+            , m_dedicated{dedicated} {
+            VkMemoryAllocateInfo alloc_info = {};
+            alloc_info.sType                = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+            alloc_info.allocationSize       = size;
+            alloc_info.memoryTypeIndex      = memory_type;
+
+            if (vkAllocateMemory(m_device, &alloc_info, nullptr, &m_memory) != VK_SUCCESS) {
+                throw std::runtime_error("failed to allocate device memory block!");
+            }
+
+            // host visible blocks stay mapped for their whole lifetime, since a VkDeviceMemory can only be mapped once
+            if (host_visible && vkMapMemory(m_device, m_memory, 0, VK_WHOLE_SIZE, 0, &m_mapped) != VK_SUCCESS) {
+                throw std::runtime_error("failed to map device memory block!");
+            }
+
+            if (!m_dedicated && m_strategy == NexAllocationStrategy::buddy) {
+                assert(std::has_single_bit(size) && "Buddy blocks must be a power of two");
+                m_max_order = static_cast<uint32_t>(std::countr_zero(size));
+                m_free_lists.resize(m_max_order - min_order + 1);
+                m_free_lists.back().insert(0);
+            }
+        }
+
+        ~NexMemoryBlock() {
+            if (m_mapped) {
+                vkUnmapMemory(m_device, m_memory);
+            }
+            vkFreeMemory(m_device, m_memory, nullptr);
+        }
+
+        NexMemoryBlock(const NexMemoryBlock&)            = delete;
+        NexMemoryBlock& operator=(const NexMemoryBlock&) = delete;
+
+        bool allocate(VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize& offset) {
+            if (m_dedicated) {
+                if (m_allocation_count > 0 || size > m_size) {
+                    return false;
+                }
+                offset = 0;
+                m_used = m_size;
+                m_allocation_count++;
+                return true;
+            }
+
+            if (m_strategy == NexAllocationStrategy::linear) {
+                VkDeviceSize aligned = alignUp(m_head, alignment);
+                if (aligned + size > m_size) {
+                    return false;
+                }
+                offset = aligned;
+                m_head = aligned + size;
+                m_used = m_head;
+                m_allocation_count++;
+                return true;
+            }
+
+            // buddy nodes are aligned to their own size, so rounding up to the alignment is enough
+            uint32_t order = std::max(min_order, static_cast<uint32_t>(std::bit_width(std::max(size, alignment) - 1)));
+            if (order > m_max_order) {
+                return false;
+            }
+
+            uint32_t level = order;
+            while (level <= m_max_order && m_free_lists[level - min_order].empty()) {
+                level++;
+            }
+            if (level > m_max_order) {
+                return false;
+            }
+
+            auto& free_list = m_free_lists[level - min_order];
+            offset          = *free_list.begin();
+            free_list.erase(free_list.begin());
+
+            // split down to the requested order, handing the upper halves back to the free lists
+            while (level > order) {
+                level--;
+                m_free_lists[level - min_order].insert(offset + (VkDeviceSize{1} << level));
+            }
+
+            m_allocated_orders[offset] = order;
+            m_used += VkDeviceSize{1} << order;
+            m_allocation_count++;
+            return true;
+        }
+
+        void free(VkDeviceSize offset) {
+            assert(m_allocation_count > 0 && "Freeing from an empty memory block");
+            m_allocation_count--;
+
+            if (m_dedicated) {
+                m_used = 0;
+                return;
+            }
+
+            if (m_strategy == NexAllocationStrategy::linear) {
+                if (m_allocation_count == 0) {
+                    m_head = 0;
+                    m_used = 0;
+                }
+                return;
+            }
+
+            auto it = m_allocated_orders.find(offset);
+            assert(it != m_allocated_orders.end() && "Freeing an offset that was never allocated");
+            uint32_t order = it->second;
+            m_allocated_orders.erase(it);
+            m_used -= VkDeviceSize{1} << order;
+
+            // merge with the buddy for as long as it is free as well
+            while (order < m_max_order) {
+                VkDeviceSize buddy     = offset ^ (VkDeviceSize{1} << order);
+                auto&        free_list = m_free_lists[order - min_order];
+                auto         buddy_it  = free_list.find(buddy);
+                if (buddy_it == free_list.end()) {
+                    break;
+                }
+                free_list.erase(buddy_it);
+                offset = std::min(offset, buddy);
+                order++;
+            }
+            m_free_lists[order - min_order].insert(offset);
+        }
+
+        VkDeviceSize largestFreeRange() const {
+            if (m_dedicated) {
+                return m_allocation_count == 0 ? m_size : 0;
+            }
+            if (m_strategy == NexAllocationStrategy::linear) {
+                return m_size - m_head;
+            }
+            for (uint32_t level = m_max_order + 1; level-- > min_order;) {
+                if (!m_free_lists[level - min_order].empty()) {
+                    return VkDeviceSize{1} << level;
+                }
+            }
+            return 0;
+        }
+
+        bool isCompatible(bool linear_resource, NexAllocationStrategy strategy) const {
+            return !m_dedicated && m_linear_resource == linear_resource && m_strategy == strategy;
+        }
+
+        VkDeviceMemory memory() const {
+            return m_memory;
+        }
+        void* mapped() const {
+            return m_mapped;
+        }
+        uint32_t memoryType() const {
+            return m_memory_type;
+        }
+        VkDeviceSize size() const {
+            return m_size;
+        }
+        VkDeviceSize used() const {
+            return m_used;
+        }
+        uint32_t allocationCount() const {
+            return m_allocation_count;
+        }
+        bool isDedicated() const {
+            return m_dedicated;
+        }
+
+      private:
+        VkDevice       m_device;
+        VkDeviceMemory m_memory = VK_NULL_HANDLE;
+        void*          m_mapped = nullptr;
+        uint32_t       m_memory_type;
+        VkDeviceSize   m_size;
+
+        bool                  m_linear_resource;
+        NexAllocationStrategy m_strategy;
+        bool                  m_dedicated;
+
+        VkDeviceSize m_used             = 0;
+        uint32_t     m_allocation_count = 0;
+
+        // linear
+        VkDeviceSize m_head = 0;
+
+        // buddy, one free list per order starting at min_order
+        uint32_t                                   m_max_order = 0;
+        std::vector<std::set<VkDeviceSize>>        m_free_lists;
+        std::unordered_map<VkDeviceSize, uint32_t> m_allocated_orders;
+    };
+
+    NexAllocator::NexAllocator(VkPhysicalDevice physical_device, VkDevice device) : m_device{device} {
+        vkGetPhysicalDeviceMemoryProperties(physical_device, &m_memory_properties);
+
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(physical_device, &properties);
+        m_non_coherent_atom_size = properties.limits.nonCoherentAtomSize;
+
+        m_blocks.resize(m_memory_properties.memoryTypeCount);
+    }
+
+    NexAllocator::~NexAllocator() {
+        for (auto& blocks : m_blocks) {
+            for (auto& block : blocks) {
+                if (block->allocationCount() > 0) {
+                    std::cerr << "allocator: " << block->allocationCount() << " allocation(s) leaked in memory type " << block->memoryType() << std::endl;
+                }
+            }
+        }
+    }
+
+    uint32_t NexAllocator::findMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties) const {
+        for (uint32_t i = 0; i < m_memory_properties.memoryTypeCount; i++) {
+            if ((type_filter & (1 << i)) && (m_memory_properties.memoryTypes[i].propertyFlags & properties) == properties) {
+                return i;
+            }
+        }
+
+        throw std::runtime_error("failed to find suitable memory type!");
+    }
+
+    VkDeviceSize NexAllocator::preferredBlockSize(uint32_t memory_type) const {
+        // small heaps (e.g. the 256MB host visible device local heap without resizable BAR) get smaller blocks
+        VkDeviceSize heap_size = m_memory_properties.memoryHeaps[m_memory_properties.memoryTypes[memory_type].heapIndex].size;
+        return std::bit_floor(std::min(default_block_size, std::max<VkDeviceSize>(heap_size / 8, 1 << 20)));
+    }
+
+    NexAllocation NexAllocator::allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear_resource, NexAllocationStrategy strategy) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        uint32_t memory_type  = findMemoryType(requirements.memoryTypeBits, properties);
+        bool     host_visible = m_memory_properties.memoryTypes[memory_type].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT;
+        auto&    blocks       = m_blocks[memory_type];
+
+        NexMemoryBlock* block  = nullptr;
+        VkDeviceSize    offset = 0;
+
+        VkDeviceSize block_size = preferredBlockSize(memory_type);
+        if (requirements.size > block_size / 2) {
+            // large resources (render targets, the shadow map) would waste most of a shared block
+            blocks.push_back(std::make_unique<NexMemoryBlock>(m_device, memory_type, requirements.size, host_visible, linear_resource, strategy, true));
+            block = blocks.back().get();
+            block->allocate(requirements.size, requirements.alignment, offset);
+        } else {
+            // linear and optimal resources live in separate blocks, so bufferImageGranularity never has to be
+            // honoured between neighbouring sub-allocations
+            for (auto& candidate : blocks) {
+                if (candidate->isCompatible(linear_resource, strategy) && candidate->allocate(requirements.size, requirements.alignment, offset)) {
+                    block = candidate.get();
+                    break;
+                }
+            }
+
+            if (block == nullptr) {
+                blocks.push_back(std::make_unique<NexMemoryBlock>(m_device, memory_type, block_size, host_visible, linear_resource, strategy, false));
+                block = blocks.back().get();
+                if (!block->allocate(requirements.size, requirements.alignment, offset)) {
+                    throw std::runtime_error("failed to sub-allocate from a fresh memory block!");
+                }
+            }
+        }
+
+        NexAllocation allocation = {};
+        allocation.m_memory      = block->memory();
+        allocation.m_offset      = offset;
+        allocation.m_size        = requirements.size;
+        allocation.m_mapped      = block->mapped() ? static_cast<char*>(block->mapped()) + offset : nullptr;
+        allocation.m_memory_type = memory_type;
+        allocation.m_block       = block;
+        return allocation;
+    }
+
+    void NexAllocator::free(NexAllocation& allocation) {
+        if (allocation.m_block == nullptr) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        NexMemoryBlock* block = allocation.m_block;
+        block->free(allocation.m_offset);
+
+        if (block->allocationCount() == 0) {
+            auto& blocks = m_blocks[allocation.m_memory_type];
+
+            // keep one empty shared block per memory type around so alternating alloc/free doesn't thrash vkAllocateMemory
+            bool keep = !block->isDedicated() && std::count_if(blocks.begin(), blocks.end(), [&](const auto& other) {
+                                                     return other.get() != block && other->allocationCount() == 0 && !other->isDedicated();
+                                                 }) == 0;
+            if (!keep) {
+                blocks.erase(std::find_if(blocks.begin(), blocks.end(), [&](const auto& other) {
+                    return other.get() == block;
+                }));
+            }
+        }
+
+        allocation = {};
+    }
+
+    VkMappedMemoryRange NexAllocator::mappedRange(const NexAllocation& allocation, VkDeviceSize size, VkDeviceSize offset) const {
+        // ranges on non coherent memory must be aligned to nonCoherentAtomSize, relative to the start of the VkDeviceMemory
+        VkDeviceSize block_size = allocation.m_block->size();
+        VkDeviceSize begin      = alignDown(allocation.m_offset + offset, m_non_coherent_atom_size);
+        VkDeviceSize end        = size == VK_WHOLE_SIZE ? allocation.m_offset + allocation.m_size : allocation.m_offset + offset + size;
+        end                     = std::min(alignUp(end, m_non_coherent_atom_size), block_size);
+
+        VkMappedMemoryRange mapped_range = {};
+        mapped_range.sType               = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
+        mapped_range.memory              = allocation.m_memory;
+        mapped_range.offset              = begin;
+        mapped_range.size                = end == block_size ? VK_WHOLE_SIZE : end - begin;
+        return mapped_range;
+    }
+
+    VkResult NexAllocator::flush(const NexAllocation& allocation, VkDeviceSize size, VkDeviceSize offset) {
+        VkMappedMemoryRange mapped_range = mappedRange(allocation, size, offset);
+        return vkFlushMappedMemoryRanges(m_device, 1, &mapped_range);
+    }
+
+    VkResult NexAllocator::invalidate(const NexAllocation& allocation, VkDeviceSize size, VkDeviceSize offset) {
+        VkMappedMemoryRange mapped_range = mappedRange(allocation, size, offset);
+        return vkInvalidateMappedMemoryRanges(m_device, 1, &mapped_range);
+    }
+
+    void NexAllocator::accumulateStats(const NexMemoryBlock& block, NexAllocatorStats& stats) const {
+        stats.m_bytes_reserved += block.size();
+        stats.m_bytes_used += block.used();
+        stats.m_bytes_free += block.size() - block.used();
+        stats.m_largest_free = std::max(stats.m_largest_free, block.largestFreeRange());
+        stats.m_allocation_count += block.allocationCount();
+        stats.m_block_count++;
+        if (block.isDedicated()) {
+            stats.m_dedicated_count++;
+        }
+    }
+
+    NexAllocatorStats NexAllocator::getStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        NexAllocatorStats stats = {};
+        for (const auto& blocks : m_blocks) {
+            for (const auto& block : blocks) {
+                accumulateStats(*block, stats);
+            }
+        }
+        return stats;
+    }
+
+    NexAllocatorStats NexAllocator::getMemoryTypeStats(uint32_t memory_type) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        NexAllocatorStats stats = {};
+        for (const auto& block : m_blocks[memory_type]) {
+            accumulateStats(*block, stats);
+        }
+        return stats;
+    }
+
+    void NexAllocator::printStats() const {
+        for (uint32_t i = 0; i < m_memory_properties.memoryTypeCount; i++) {
+            NexAllocatorStats stats = getMemoryTypeStats(i);
+            if (stats.m_block_count == 0) {
+                continue;
+            }
+            std::cout << "memory type " << i << " (heap " << m_memory_properties.memoryTypes[i].heapIndex << "): " << stats.m_bytes_used / 1024 << " KiB used / "
+                      << stats.m_bytes_reserved / 1024 << " KiB reserved, " << stats.m_allocation_count << " allocations in " << stats.m_block_count << " blocks ("
+                      << stats.m_dedicated_count << " dedicated), fragmentation " << stats.fragmentation() << std::endl;
+        }
+    }
+}  // namespace nex
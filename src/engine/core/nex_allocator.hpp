@@ -0,0 +1,78 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace nex {
+    class NexMemoryBlock;
+
+    enum class NexAllocationStrategy {
+        buddy,   // general purpose, power of two nodes that coalesce on free
+        linear,  // bump allocator that rewinds once every allocation in the block is freed (staging, transient data)
+    };
+
+    struct NexAllocation {
+        VkDeviceMemory  m_memory      = VK_NULL_HANDLE;
+        VkDeviceSize    m_offset      = 0;
+        VkDeviceSize    m_size        = 0;
+        void*           m_mapped      = nullptr;  // points at m_offset inside the persistently mapped block, null for device local memory
+        uint32_t        m_memory_type = 0;
+        NexMemoryBlock* m_block       = nullptr;
+    };
+
+    struct NexAllocatorStats {
+        VkDeviceSize m_bytes_reserved   = 0;  // sum of every vkAllocateMemory we made
+        VkDeviceSize m_bytes_used       = 0;  // bytes handed out, including alignment padding
+        VkDeviceSize m_bytes_free       = 0;
+        VkDeviceSize m_largest_free     = 0;
+        uint32_t     m_allocation_count = 0;
+        uint32_t     m_block_count      = 0;
+        uint32_t     m_dedicated_count  = 0;
+
+        // 0 when all free memory is one contiguous range, approaching 1 as it gets split into small holes
+        float fragmentation() const {
+            return m_bytes_free == 0 ? 0.0f : 1.0f - static_cast<float>(m_largest_free) / static_cast<float>(m_bytes_free);
+        }
+    };
+
+    class NexAllocator {
+      public:
+        static constexpr VkDeviceSize default_block_size = 64ull * 1024 * 1024;
+
+        NexAllocator(VkPhysicalDevice physical_device, VkDevice device);
+        ~NexAllocator();
+
+        NexAllocator(const NexAllocator&)            = delete;
+        NexAllocator& operator=(const NexAllocator&) = delete;
+
+        NexAllocation allocate(const VkMemoryRequirements& requirements, VkMemoryPropertyFlags properties, bool linear_resource,
+                               NexAllocationStrategy strategy = NexAllocationStrategy::buddy);
+        void          free(NexAllocation& allocation);
+
+        VkResult flush(const NexAllocation& allocation, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+        VkResult invalidate(const NexAllocation& allocation, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+
+        uint32_t findMemoryType(uint32_t type_filter, VkMemoryPropertyFlags properties) const;
+
+        NexAllocatorStats getStats() const;
+        NexAllocatorStats getMemoryTypeStats(uint32_t memory_type) const;
+        void              printStats() const;
+
+      private:
+        VkDeviceSize        preferredBlockSize(uint32_t memory_type) const;
+        VkMappedMemoryRange mappedRange(const NexAllocation& allocation, VkDeviceSize size, VkDeviceSize offset) const;
+        void                accumulateStats(const NexMemoryBlock& block, NexAllocatorStats& stats) const;
+
+        VkDevice                         m_device;
+        VkPhysicalDeviceMemoryProperties m_memory_properties;
+        VkDeviceSize                     m_non_coherent_atom_size;
+
+        // indexed by memory type
+        std::vector<std::vector<std::unique_ptr<NexMemoryBlock>>> m_blocks;
+
+        mutable std::mutex m_mutex;
+    };
+}  // namespace nex
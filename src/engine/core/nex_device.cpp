@@ -1,10 +1,15 @@
 #include "nex_device.hpp"
 
+#include <algorithm>
+#include <cassert>
 #include <cstring>
 #include <iostream>
 #include <set>
 #include <unordered_set>
 
+#include "../graphics/nex_geometry_pool.hpp"
+#include "../graphics/nex_texture_table.hpp"
+
 namespace nex {
 
     // local callback functions
@@ -33,24 +38,40 @@ namespace nex {
     }
 
     // class member functions
-    NexDevice::NexDevice(NexWindow& window) : m_window{window} {
+    NexDevice::NexDevice(NexWindow& window, const std::string& pipeline_cache_path) : m_window{window} {
+        if (!m_window.isHeadless()) {
+            m_device_extensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+        }
+
         createInstance();
         setupDebugMessenger();
         createSurface();
         pickPhysicalDevice();
         createLogicalDevice();
-        createCommandPool();
+        m_single_time_commands.m_command_pool = createCommandPool();
+        createAllocator();
+        createUploadQueue();
+        createGeometryPool();
+        createTextureTable();
+        createPipelineCache(pipeline_cache_path);
     }
 
     NexDevice::~NexDevice() {
-        vkDestroyCommandPool(m_device, m_command_pool, nullptr);
+        m_pipeline_cache.reset();
+        m_texture_table.reset();
+        m_geometry_pool.reset();
+        m_upload_queue.reset();
+        m_allocator.reset();
+        vkDestroyCommandPool(m_device, m_single_time_commands.m_command_pool, nullptr);
         vkDestroyDevice(m_device, nullptr);
 
         if (m_enable_validation_layers) {
             destroyDebugUtilsMessengerExt(m_instance, m_debug_messenger, nullptr);
         }
 
-        vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+        if (m_surface != VK_NULL_HANDLE) {
+            vkDestroySurfaceKHR(m_instance, m_surface, nullptr);
+        }
         vkDestroyInstance(m_instance, nullptr);
     }
 
@@ -65,7 +86,7 @@ namespace nex {
         app_info.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
         app_info.pEngineName        = "No Engine";
         app_info.engineVersion      = VK_MAKE_VERSION(1, 0, 0);
-        app_info.apiVersion         = VK_API_VERSION_1_0;
+        app_info.apiVersion         = VK_API_VERSION_1_2;
 
         VkInstanceCreateInfo create_info = {};
         create_info.sType                = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
@@ -118,13 +139,33 @@ namespace nex {
 
         vkGetPhysicalDeviceProperties(m_physical_device, &m_properties);
         std::cout << "physical device: " << m_properties.deviceName << std::endl;
+
+        VkPhysicalDeviceVulkan12Properties vulkan12_properties = {};
+        vulkan12_properties.sType                              = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES;
+
+        VkPhysicalDeviceProperties2 properties2 = {};
+        properties2.sType                       = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        properties2.pNext                       = &vulkan12_properties;
+        vkGetPhysicalDeviceProperties2(m_physical_device, &properties2);
+
+        m_max_bindless_textures = std::min({vulkan12_properties.maxDescriptorSetUpdateAfterBindSampledImages, vulkan12_properties.maxDescriptorSetUpdateAfterBindSamplers,
+                                            vulkan12_properties.maxPerStageDescriptorUpdateAfterBindSampledImages, vulkan12_properties.maxPerStageDescriptorUpdateAfterBindSamplers});
     }
 
     void NexDevice::createLogicalDevice() {
         QueueFamilyIndices indices = findQueueFamilies(m_physical_device);
 
+        uint32_t queue_family_count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(m_physical_device, &queue_family_count, nullptr);
+        std::vector<VkQueueFamilyProperties> queue_families(queue_family_count);
+        vkGetPhysicalDeviceQueueFamilyProperties(m_physical_device, &queue_family_count, queue_families.data());
+        m_timestamp_valid_bits = queue_families[indices.m_graphics_family].timestampValidBits;
+
         std::vector<VkDeviceQueueCreateInfo> queue_create_infos;
         std::set<uint32_t>                   unique_queue_families = {indices.m_graphics_family, indices.m_present_family};
+        if (indices.m_transfer_family_has_value) {
+            unique_queue_families.insert(indices.m_transfer_family);
+        }
 
         float queue_priority = 1.0f;
         for (uint32_t queue_family : unique_queue_families) {
@@ -136,11 +177,42 @@ namespace nex {
             queue_create_infos.push_back(queue_create_info);
         }
 
-        VkPhysicalDeviceFeatures device_features = {};
-        device_features.samplerAnisotropy        = VK_TRUE;
+        VkPhysicalDeviceFeatures supported_features;
+        vkGetPhysicalDeviceFeatures(m_physical_device, &supported_features);
+
+        // optional, the gpu driven path needs firstInstance and falls back to one indirect draw per command without multiDrawIndirect
+        VkPhysicalDeviceFeatures device_features  = {};
+        device_features.samplerAnisotropy         = VK_TRUE;
+        device_features.multiDrawIndirect         = supported_features.multiDrawIndirect;
+        device_features.drawIndirectFirstInstance = supported_features.drawIndirectFirstInstance;
+        device_features.pipelineStatisticsQuery   = supported_features.pipelineStatisticsQuery;  // only the gpu profiler counts with them
+        m_enabled_features                        = device_features;
+
+        VkPhysicalDeviceVulkan12Features supported_vulkan12_features = {};
+        supported_vulkan12_features.sType                            = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+
+        VkPhysicalDeviceFeatures2 supported_features2 = {};
+        supported_features2.sType                     = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supported_features2.pNext                     = &supported_vulkan12_features;
+        vkGetPhysicalDeviceFeatures2(m_physical_device, &supported_features2);
+
+        // drawIndirectCount lets the culling pass compact the indirect commands, without it culled commands are drawn with no instances
+        VkPhysicalDeviceVulkan12Features vulkan12_features = {};
+        vulkan12_features.sType                            = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
+        vulkan12_features.timelineSemaphore                = VK_TRUE;
+        vulkan12_features.drawIndirectCount                = supported_vulkan12_features.drawIndirectCount;
+        m_draw_indirect_count                              = supported_vulkan12_features.drawIndirectCount == VK_TRUE;
+
+        // the bindless texture table, isDeviceSuitable() already checked for all of them
+        vulkan12_features.runtimeDescriptorArray                       = VK_TRUE;
+        vulkan12_features.descriptorBindingPartiallyBound              = VK_TRUE;
+        vulkan12_features.descriptorBindingVariableDescriptorCount     = VK_TRUE;
+        vulkan12_features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        vulkan12_features.shaderSampledImageArrayNonUniformIndexing    = VK_TRUE;
 
         VkDeviceCreateInfo create_info = {};
         create_info.sType              = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+        create_info.pNext              = &vulkan12_features;
 
         create_info.queueCreateInfoCount = static_cast<uint32_t>(queue_create_infos.size());
         create_info.pQueueCreateInfos    = queue_create_infos.data();
@@ -164,22 +236,50 @@ namespace nex {
 
         vkGetDeviceQueue(m_device, indices.m_graphics_family, 0, &m_graphics_queue);
         vkGetDeviceQueue(m_device, indices.m_present_family, 0, &m_present_queue);
+        vkGetDeviceQueue(m_device, indices.m_transfer_family_has_value ? indices.m_transfer_family : indices.m_graphics_family, 0, &m_transfer_queue);
     }
 
-    void NexDevice::createCommandPool() {
+    VkCommandPool NexDevice::createCommandPool(VkCommandPoolCreateFlags flags) {
         QueueFamilyIndices queue_family_indices = findPhysicalQueueFamilies();
 
         VkCommandPoolCreateInfo pool_info = {};
         pool_info.sType                   = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         pool_info.queueFamilyIndex        = queue_family_indices.m_graphics_family;
-        pool_info.flags                   = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT | VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+        pool_info.flags                   = flags;
 
-        if (vkCreateCommandPool(m_device, &pool_info, nullptr, &m_command_pool) != VK_SUCCESS) {
+        VkCommandPool command_pool = VK_NULL_HANDLE;
+        if (vkCreateCommandPool(m_device, &pool_info, nullptr, &command_pool) != VK_SUCCESS) {
             throw std::runtime_error("failed to create command pool!");
         }
+        return command_pool;
+    }
+
+    void NexDevice::createAllocator() {
+        m_allocator = std::make_unique<NexAllocator>(m_physical_device, m_device);
+    }
+
+    void NexDevice::createUploadQueue() {
+        QueueFamilyIndices indices         = findPhysicalQueueFamilies();
+        uint32_t           transfer_family = indices.m_transfer_family_has_value ? indices.m_transfer_family : indices.m_graphics_family;
+        m_upload_queue                     = std::make_unique<NexUploadQueue>(m_device, *m_allocator, m_transfer_queue, transfer_family, indices.m_graphics_family);
+    }
+
+    void NexDevice::createGeometryPool() {
+        m_geometry_pool = std::make_unique<NexGeometryPool>(*this);
+    }
+
+    void NexDevice::createTextureTable() {
+        m_texture_table = std::make_unique<NexTextureTable>(*this);
+    }
+
+    void NexDevice::createPipelineCache(const std::string& filepath) {
+        m_pipeline_cache = std::make_unique<NexPipelineCache>(m_device, m_properties, filepath);
     }
 
     void NexDevice::createSurface() {
+        if (m_window.isHeadless()) {
+            return;
+        }
         m_window.createWindowSurface(m_instance, &m_surface);
     }
 
@@ -188,16 +288,30 @@ namespace nex {
 
         bool extensions_supported = checkDeviceExtensionSupport(device);
 
-        bool swap_chain_adequate = false;
-        if (extensions_supported) {
+        bool swap_chain_adequate = m_window.isHeadless();
+        if (extensions_supported && !swap_chain_adequate) {
             SwapChainSupportDetails swap_chain_support = querySwapChainSupport(device);
             swap_chain_adequate                        = !swap_chain_support.m_formats.empty() && !swap_chain_support.m_present_modes.empty();
         }
 
-        VkPhysicalDeviceFeatures supported_features;
-        vkGetPhysicalDeviceFeatures(device, &supported_features);
+        VkPhysicalDeviceProperties properties;
+        vkGetPhysicalDeviceProperties(device, &properties);
+
+        VkPhysicalDeviceVulkan12Features vulkan12_features = {};
+        vulkan12_features.sType                            = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES;
 
-        return indices.isComplete() && extensions_supported && swap_chain_adequate && supported_features.samplerAnisotropy;
+        VkPhysicalDeviceFeatures2 supported_features = {};
+        supported_features.sType                     = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+        supported_features.pNext                     = &vulkan12_features;
+        if (properties.apiVersion >= VK_API_VERSION_1_2) {
+            vkGetPhysicalDeviceFeatures2(device, &supported_features);
+        }
+
+        bool descriptor_indexing = vulkan12_features.runtimeDescriptorArray && vulkan12_features.descriptorBindingPartiallyBound && vulkan12_features.descriptorBindingVariableDescriptorCount &&
+                                   vulkan12_features.descriptorBindingSampledImageUpdateAfterBind && vulkan12_features.shaderSampledImageArrayNonUniformIndexing;
+
+        return indices.isComplete() && extensions_supported && swap_chain_adequate && supported_features.features.samplerAnisotropy && vulkan12_features.timelineSemaphore &&
+               descriptor_indexing;
     }
 
     void NexDevice::populateDebugMessengerCreateInfo(VkDebugUtilsMessengerCreateInfoEXT& createInfo) {
@@ -245,9 +359,12 @@ namespace nex {
     }
 
     std::vector<const char*> NexDevice::getRequiredExtensions() {
+        // glfw isn't initialized without a window, and nothing needs its surface extensions then
         uint32_t     glfw_extension_count = 0;
-        const char** glfw_extensions;
-        glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+        const char** glfw_extensions      = nullptr;
+        if (!m_window.isHeadless()) {
+            glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+        }
 
         std::vector<const char*> extensions(glfw_extensions, glfw_extensions + glfw_extension_count);
 
@@ -312,8 +429,10 @@ namespace nex {
                 indices.m_graphics_family           = i;
                 indices.m_graphics_family_has_value = true;
             }
-            VkBool32 present_support = false;
-            vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &present_support);
+            VkBool32 present_support = m_window.isHeadless() && queue_family.queueFlags & VK_QUEUE_GRAPHICS_BIT;
+            if (!m_window.isHeadless()) {
+                vkGetPhysicalDeviceSurfaceSupportKHR(device, i, m_surface, &present_support);
+            }
             if (queue_family.queueCount > 0 && present_support) {
                 indices.m_present_family           = i;
                 indices.m_present_family_has_value = true;
@@ -325,6 +444,19 @@ namespace nex {
             i++;
         }
 
+        // prefer a transfer-only family (the DMA engine on discrete GPUs), then any family without graphics
+        for (int pass = 0; pass < 2 && !indices.m_transfer_family_has_value; pass++) {
+            for (uint32_t j = 0; j < queue_family_count; j++) {
+                VkQueueFlags flags = queue_families[j].queueFlags;
+                if (queue_families[j].queueCount == 0 || !(flags & VK_QUEUE_TRANSFER_BIT) || (flags & VK_QUEUE_GRAPHICS_BIT) || (pass == 0 && (flags & VK_QUEUE_COMPUTE_BIT))) {
+                    continue;
+                }
+                indices.m_transfer_family           = j;
+                indices.m_transfer_family_has_value = true;
+                break;
+            }
+        }
+
         return indices;
     }
 
@@ -379,31 +511,27 @@ namespace nex {
 
     VkFormat NexDevice::findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features) {
         for (VkFormat format : candidates) {
-            VkFormatProperties props;
-            vkGetPhysicalDeviceFormatProperties(m_physical_device, format, &props);
-
-            if (tiling == VK_IMAGE_TILING_LINEAR && (props.linearTilingFeatures & features) == features) {
-                return format;
-            } else if (tiling == VK_IMAGE_TILING_OPTIMAL && (props.optimalTilingFeatures & features) == features) {
+            if (isFormatSupported(format, tiling, features)) {
                 return format;
             }
         }
         throw std::runtime_error("failed to find supported format!");
     }
 
-    uint32_t NexDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
-        VkPhysicalDeviceMemoryProperties mem_properties;
-        vkGetPhysicalDeviceMemoryProperties(m_physical_device, &mem_properties);
-        for (uint32_t i = 0; i < mem_properties.memoryTypeCount; i++) {
-            if ((typeFilter & (1 << i)) && (mem_properties.memoryTypes[i].propertyFlags & properties) == properties) {
-                return i;
-            }
-        }
+    bool NexDevice::isFormatSupported(VkFormat format, VkImageTiling tiling, VkFormatFeatureFlags features) {
+        VkFormatProperties props;
+        vkGetPhysicalDeviceFormatProperties(m_physical_device, format, &props);
 
-        throw std::runtime_error("failed to find suitable memory type!");
+        VkFormatFeatureFlags supported = tiling == VK_IMAGE_TILING_LINEAR ? props.linearTilingFeatures : props.optimalTilingFeatures;
+        return (supported & features) == features;
     }
 
-    void NexDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory) {
+    uint32_t NexDevice::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties) {
+        return m_allocator->findMemoryType(typeFilter, properties);
+    }
+
+    void NexDevice::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, NexAllocation& allocation,
+                                 NexAllocationStrategy strategy) {
         VkBufferCreateInfo buffer_info{};
         buffer_info.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
         buffer_info.size        = size;
@@ -417,27 +545,72 @@ namespace nex {
         VkMemoryRequirements mem_requirements;
         vkGetBufferMemoryRequirements(m_device, buffer, &mem_requirements);
 
-        VkMemoryAllocateInfo alloc_info{};
-        alloc_info.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        alloc_info.allocationSize  = mem_requirements.size;
-        alloc_info.memoryTypeIndex = findMemoryType(mem_requirements.memoryTypeBits, properties);
+        allocation = m_allocator->allocate(mem_requirements, properties, true, strategy);
+
+        if (vkBindBufferMemory(m_device, buffer, allocation.m_memory, allocation.m_offset) != VK_SUCCESS) {
+            throw std::runtime_error("failed to bind vertex buffer memory!");
+        }
+    }
+
+    void NexDevice::destroyBuffer(VkBuffer buffer, NexAllocation& allocation) {
+        vkDestroyBuffer(m_device, buffer, nullptr);
+        m_allocator->free(allocation);
+        logDestroyed((uint64_t)buffer);
+    }
+
+    void NexDevice::destroyImageView(VkImageView image_view) {
+        vkDestroyImageView(m_device, image_view, nullptr);
+        logDestroyed((uint64_t)image_view);
+    }
+
+    void NexDevice::destroySampler(VkSampler sampler) {
+        vkDestroySampler(m_device, sampler, nullptr);
+        logDestroyed((uint64_t)sampler);
+    }
+
+    void NexDevice::logDestroyed(uint64_t handle) {
+        std::lock_guard<std::mutex> lock(m_destroyed_mutex);
+
+        uint64_t count                                  = m_destroyed_count.load(std::memory_order_relaxed);
+        m_destroyed_handles[count % destroyed_log_size] = handle;
+        m_destroyed_count.store(count + 1, std::memory_order_release);
+    }
 
-        if (vkAllocateMemory(m_device, &alloc_info, nullptr, &bufferMemory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate vertex buffer memory!");
+    bool NexDevice::destroyedHandlesSince(uint64_t& cursor, std::vector<uint64_t>& handles) {
+        // nothing destroyed is the common case and needs no lock
+        if (destroyedHandleCount() == cursor) {
+            return true;
         }
 
-        vkBindBufferMemory(m_device, buffer, bufferMemory, 0);
+        std::lock_guard<std::mutex> lock(m_destroyed_mutex);
+
+        uint64_t count = m_destroyed_count.load(std::memory_order_relaxed);
+        if (count - cursor > destroyed_log_size) {
+            cursor = count;
+            return false;
+        }
+
+        for (; cursor < count; ++cursor) {
+            handles.push_back(m_destroyed_handles[cursor % destroyed_log_size]);
+        }
+        return true;
     }
 
     VkCommandBuffer NexDevice::beginSingleTimeCommands() {
-        VkCommandBufferAllocateInfo alloc_info{};
-        alloc_info.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        alloc_info.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        alloc_info.commandPool        = m_command_pool;
-        alloc_info.commandBufferCount = 1;
+        SingleTimeCommands& commands = m_single_time_commands;
+        if (commands.m_used == commands.m_command_buffers.size()) {
+            VkCommandBufferAllocateInfo alloc_info{};
+            alloc_info.sType              = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            alloc_info.level              = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            alloc_info.commandPool        = commands.m_command_pool;
+            alloc_info.commandBufferCount = 1;
+
+            VkCommandBuffer command_buffer;
+            vkAllocateCommandBuffers(m_device, &alloc_info, &command_buffer);
+            commands.m_command_buffers.push_back(command_buffer);
+        }
 
-        VkCommandBuffer command_buffer;
-        vkAllocateCommandBuffers(m_device, &alloc_info, &command_buffer);
+        VkCommandBuffer command_buffer = commands.m_command_buffers[commands.m_used++];
 
         VkCommandBufferBeginInfo begin_info{};
         begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
@@ -458,7 +631,12 @@ namespace nex {
         vkQueueSubmit(m_graphics_queue, 1, &submit_info, VK_NULL_HANDLE);
         vkQueueWaitIdle(m_graphics_queue);
 
-        vkFreeCommandBuffers(m_device, m_command_pool, 1, &commandBuffer);
+        // the buffers are kept, resetting the whole pool once none is recording replaces freeing each one
+        SingleTimeCommands& commands = m_single_time_commands;
+        assert(commands.m_used > 0 && "Ended single time commands that were never begun");
+        if (--commands.m_used == 0) {
+            vkResetCommandPool(m_device, commands.m_command_pool, 0);
+        }
     }
 
     void NexDevice::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size) {
@@ -493,7 +671,7 @@ namespace nex {
         endSingleTimeCommands(command_buffer);
     }
 
-    void NexDevice::createImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory) {
+    void NexDevice::createImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, NexAllocation& allocation) {
         if (vkCreateImage(m_device, &imageInfo, nullptr, &image) != VK_SUCCESS) {
             throw std::runtime_error("failed to create image!");
         }
@@ -501,20 +679,18 @@ namespace nex {
         VkMemoryRequirements mem_requirements;
         vkGetImageMemoryRequirements(m_device, image, &mem_requirements);
 
-        VkMemoryAllocateInfo alloc_info{};
-        alloc_info.sType           = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-        alloc_info.allocationSize  = mem_requirements.size;
-        alloc_info.memoryTypeIndex = findMemoryType(mem_requirements.memoryTypeBits, properties);
+        allocation = m_allocator->allocate(mem_requirements, properties, imageInfo.tiling == VK_IMAGE_TILING_LINEAR);
 
-        if (vkAllocateMemory(m_device, &alloc_info, nullptr, &imageMemory) != VK_SUCCESS) {
-            throw std::runtime_error("failed to allocate image memory!");
-        }
-
-        if (vkBindImageMemory(m_device, image, imageMemory, 0) != VK_SUCCESS) {
+        if (vkBindImageMemory(m_device, image, allocation.m_memory, allocation.m_offset) != VK_SUCCESS) {
             throw std::runtime_error("failed to bind image memory!");
         }
     }
 
+    void NexDevice::destroyImage(VkImage image, NexAllocation& allocation) {
+        vkDestroyImage(m_device, image, nullptr);
+        m_allocator->free(allocation);
+    }
+
     void NexDevice::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels, uint32_t layerCount) {
         // uses an image memory barrier transition image layouts and transfer queue
         // family ownership when VK_SHARING_MODE_EXCLUSIVE is used. There is an
@@ -1,10 +1,18 @@
 #pragma once
 
+#include <atomic>
+#include <memory>
+#include <mutex>
 #include <vector>
 
+#include "nex_allocator.hpp"
+#include "nex_pipeline_cache.hpp"
+#include "nex_upload_queue.hpp"
 #include "nex_window.hpp"
 
 namespace nex {
+    class NexGeometryPool;
+    class NexTextureTable;
 
     struct SwapChainSupportDetails {
         VkSurfaceCapabilitiesKHR        m_capabilities;
@@ -15,8 +23,10 @@ namespace nex {
     struct QueueFamilyIndices {
         uint32_t m_graphics_family;
         uint32_t m_present_family;
+        uint32_t m_transfer_family;
         bool     m_graphics_family_has_value = false;
         bool     m_present_family_has_value  = false;
+        bool     m_transfer_family_has_value = false;  // only set for a family without graphics support
         bool     isComplete() {
             return m_graphics_family_has_value && m_present_family_has_value;
         }
@@ -30,7 +40,8 @@ namespace nex {
         const bool m_enable_validation_layers = true;
 #endif
 
-        NexDevice(NexWindow& window);
+        // pipelines are cached in pipeline_cache_path across launches, an empty path keeps the cache in memory only
+        NexDevice(NexWindow& window, const std::string& pipeline_cache_path);
         ~NexDevice();
 
         // Not copyable or movable
@@ -39,21 +50,40 @@ namespace nex {
         NexDevice(NexDevice&&)                 = delete;
         NexDevice& operator=(NexDevice&&)      = delete;
 
-        VkCommandPool getCommandPool() {
-            return m_command_pool;
-        }
         VkDevice device() {
             return m_device;
         }
         VkSurfaceKHR surface() {
             return m_surface;
         }
+        // no surface and no swapchain extension, the present queue is the graphics queue
+        bool isHeadless() const {
+            return m_window.isHeadless();
+        }
         VkQueue graphicsQueue() {
             return m_graphics_queue;
         }
         VkQueue presentQueue() {
             return m_present_queue;
         }
+        VkQueue transferQueue() {
+            return m_transfer_queue;
+        }
+        NexAllocator& allocator() {
+            return *m_allocator;
+        }
+        NexUploadQueue& uploadQueue() {
+            return *m_upload_queue;
+        }
+        NexGeometryPool& geometryPool() {
+            return *m_geometry_pool;
+        }
+        NexTextureTable& textureTable() {
+            return *m_texture_table;
+        }
+        NexPipelineCache& pipelineCache() {
+            return *m_pipeline_cache;
+        }
 
         SwapChainSupportDetails getSwapChainSupport() {
             return querySwapChainSupport(m_physical_device);
@@ -68,18 +98,42 @@ namespace nex {
         }
 
         VkFormat findSupportedFormat(const std::vector<VkFormat>& candidates, VkImageTiling tiling, VkFormatFeatureFlags features);
+        bool     isFormatSupported(VkFormat format, VkImageTiling tiling, VkFormatFeatureFlags features);
 
         // Buffer Helper Functions
-        void            createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
+        void            createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, NexAllocation& allocation,
+                                     NexAllocationStrategy strategy = NexAllocationStrategy::buddy);
+        void            destroyBuffer(VkBuffer buffer, NexAllocation& allocation);
+        // recorded from the device's transient pool, which is reset wholesale once its last buffer finished executing.
+        // Main thread only, like every other submission to the graphics queue
         VkCommandBuffer beginSingleTimeCommands();
         void            endSingleTimeCommands(VkCommandBuffer commandBuffer);
+
+        // on the graphics family, transient by default since every pool of the engine is reset wholesale
+        VkCommandPool   createCommandPool(VkCommandPoolCreateFlags flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
         void            copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
         void            copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height, uint32_t layerCount);
 
-        void createImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, VkDeviceMemory& imageMemory);
+        void createImageWithInfo(const VkImageCreateInfo& imageInfo, VkMemoryPropertyFlags properties, VkImage& image, NexAllocation& allocation);
+        void destroyImage(VkImage image, NexAllocation& allocation);
+
+        // destroyed buffers, image views and samplers are logged, a cache keyed on raw handles drops the entries of a handle that may be reused
+        void destroyImageView(VkImageView image_view);
+        void destroySampler(VkSampler sampler);
+
+        uint64_t destroyedHandleCount() const {
+            return m_destroyed_count.load(std::memory_order_acquire);
+        }
+        // appends the handles destroyed since cursor and advances it. False when the log no longer reaches back to the cursor,
+        // every handle seen before then has to be assumed destroyed
+        bool destroyedHandlesSince(uint64_t& cursor, std::vector<uint64_t>& handles);
         void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t mipLevels = 1, uint32_t layerCount = 1);
 
         VkPhysicalDeviceProperties m_properties;
+        VkPhysicalDeviceFeatures   m_enabled_features      = {};
+        bool                       m_draw_indirect_count   = false;  // Vulkan 1.2 drawIndirectCount is enabled
+        uint32_t                   m_max_bindless_textures = 0;      // update after bind sampler limits, caps the texture table
+        uint32_t                   m_timestamp_valid_bits  = 0;      // of the graphics queue family, timestamps wrap past them
 
       private:
         void createInstance();
@@ -87,7 +141,11 @@ namespace nex {
         void createSurface();
         void pickPhysicalDevice();
         void createLogicalDevice();
-        void createCommandPool();
+        void createAllocator();
+        void createUploadQueue();
+        void createGeometryPool();
+        void createTextureTable();
+        void createPipelineCache(const std::string& filepath);
 
         // helper functions
         bool                     isDeviceSuitable(VkPhysicalDevice device);
@@ -104,17 +162,40 @@ namespace nex {
         VkDebugUtilsMessengerEXT m_debug_messenger;
         VkPhysicalDevice         m_physical_device = VK_NULL_HANDLE;
         NexWindow&               m_window;
-        VkCommandPool            m_command_pool;
 
         VkDevice     m_device;
-        VkSurfaceKHR m_surface;
+        VkSurfaceKHR m_surface = VK_NULL_HANDLE;
         VkQueue      m_graphics_queue;
         VkQueue      m_present_queue;
+        VkQueue      m_transfer_queue;
 
         VkSampleCountFlagBits m_msaa_samples;
 
+        std::unique_ptr<NexAllocator>     m_allocator;
+        std::unique_ptr<NexUploadQueue>   m_upload_queue;
+        std::unique_ptr<NexGeometryPool>  m_geometry_pool;
+        std::unique_ptr<NexTextureTable>  m_texture_table;
+        std::unique_ptr<NexPipelineCache> m_pipeline_cache;
+
+        // ring of the last destroyed_log_size handles, the count is the total ever destroyed
+        static constexpr uint64_t destroyed_log_size = 4096;
+
+        void logDestroyed(uint64_t handle);
+
+        std::vector<uint64_t> m_destroyed_handles = std::vector<uint64_t>(destroyed_log_size);
+        std::atomic<uint64_t> m_destroyed_count   = 0;
+        std::mutex            m_destroyed_mutex;
+
+        struct SingleTimeCommands {
+            VkCommandPool                m_command_pool    = VK_NULL_HANDLE;
+            std::vector<VkCommandBuffer> m_command_buffers = {};  // grows only when single time commands nest
+            uint32_t                     m_used            = 0;
+        };
+
+        SingleTimeCommands m_single_time_commands = {};
+
         const std::vector<const char*> m_validation_layers = {"VK_LAYER_KHRONOS_validation"};
-        const std::vector<const char*> m_device_extensions = {VK_KHR_SWAPCHAIN_EXTENSION_NAME};
+        std::vector<const char*>       m_device_extensions = {};  // the swapchain extension unless headless
     };
 
 }  // namespace nex
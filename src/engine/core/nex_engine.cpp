@@ -1,33 +1,57 @@
 #include "nex_engine.hpp"
 
 #include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
 #define GLM_FORCE_RADIANS
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "nex_gpu_profiler.hpp"
+#include "nex_parallel_recorder.hpp"
+#include "nex_trace.hpp"
+#include "../benchmark/nex_frame_benchmark.hpp"
 #include "../graphics/nex_buffer.hpp"
+#include "../graphics/nex_geometry_pool.hpp"
 #include "../graphics/nex_texture.hpp"
 #include "../input/nex_input.hpp"
 #include "../scene/nex_camera.hpp"
+#include "../scene/nex_camera_path.hpp"
+#include "../scene/nex_entity_culler.hpp"
+#include "../scene/nex_gpu_scene.hpp"
+#include "../scene/nex_instancer.hpp"
+#include "../scene/nex_scene_graph.hpp"
+#include "../systems/culling_system.hpp"
 #include "../systems/point_light_system.hpp"
 #include "../systems/shadowmap_system.hpp"
 #include "../systems/simple_render_system.hpp"
 
 namespace nex {
-    NexEngine::NexEngine() {
-        m_descriptor_pool =
-            NexDescriptorPool::Builder(m_device).setMaxSets(NexSwapChain::max_frames_in_flight).addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, NexSwapChain::max_frames_in_flight).build();
+    // frame 42 of renders/frame.png goes to renders/frame_42.png
+    static std::string numberedCapturePath(const std::string& path, uint32_t frame) {
+        size_t dot = path.find_last_of('.');
+        size_t sep = path.find_last_of('/');
+        if (dot == std::string::npos || (sep != std::string::npos && dot < sep)) {
+            return path + "_" + std::to_string(frame);
+        }
+        return path.substr(0, dot) + "_" + std::to_string(frame) + path.substr(dot);
+    }
 
-        // build frame descriptor pools
+    NexEngine::NexEngine(const NexEngineOptions& options) : m_options{options} {
+        m_descriptor_allocator = std::make_unique<NexDescriptorAllocator>(m_device, std::vector<NexDescriptorAllocator::PoolSizeRatio>{{VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f}},
+                                                                          NexSwapChain::max_frames_in_flight);
+
+        if (m_options.m_scene == "stress") {
+            m_options.m_stress_count = m_options.m_stress_count > 0 ? m_options.m_stress_count : 100000;
+        } else if (m_options.m_scene != "default") {
+            throw std::runtime_error("Unknown scene " + m_options.m_scene + "!");
+        }
+
+        // one per frame in flight, each is advanced once its frame's fence has been waited on
         for (int i = 0; i < NexSwapChain::max_frames_in_flight; ++i) {
-            m_frame_descriptor_pools.push_back(NexDescriptorPool::Builder(m_device)
-                                                   .setMaxSets(1000)
-                                                   .addPoolSize(VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 100)
-                                                   .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 100)
-                                                   .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 100)
-                                                   .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT)
-                                                   .build());
+            m_frame_descriptor_allocators.push_back(std::make_unique<NexDescriptorAllocator>(m_device));
         }
 
         loadEntities();
@@ -36,6 +60,11 @@ namespace nex {
     NexEngine::~NexEngine() {}
 
     void NexEngine::run() {
+        NexTrace::setThreadName("main");
+        if (!m_options.m_trace_path.empty()) {
+            NexTrace::setEnabled(true);
+        }
+
         std::vector<std::unique_ptr<NexBuffer>> ubo_buffers(NexSwapChain::max_frames_in_flight);
         for (int i = 0; i < NexSwapChain::max_frames_in_flight; ++i) {
             ubo_buffers[i] = std::make_unique<NexBuffer>(m_device, sizeof(GlobalUbo), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
@@ -47,111 +76,416 @@ namespace nex {
         std::vector<VkDescriptorSet> global_descriptor_sets(NexSwapChain::max_frames_in_flight);
         for (int i = 0; i < NexSwapChain::max_frames_in_flight; ++i) {
             auto buffer_info = ubo_buffers[i]->descriptorInfo();
-            NexDescriptorWriter(*global_set_layout, *m_descriptor_pool).writeBuffer(0, &buffer_info).build(global_descriptor_sets[i]);
+            NexDescriptorWriter(*global_set_layout, *m_descriptor_allocator).writeBuffer(0, &buffer_info).build(global_descriptor_sets[i]);
+        }
+
+        // the indirect commands carry the object index in firstInstance, which needs drawIndirectFirstInstance
+        std::unique_ptr<NexGpuScene> gpu_scene = {};
+        if (m_options.m_gpu_driven && m_device.m_enabled_features.drawIndirectFirstInstance) {
+            gpu_scene = std::make_unique<NexGpuScene>(m_device);
+        } else if (m_options.m_gpu_driven) {
+            std::cerr << "gpu driven rendering needs drawIndirectFirstInstance, drawing per entity instead" << std::endl;
+        }
+
+        // entities sharing a mesh and texture are drawn with one instanced draw when the scene isn't gpu driven
+        std::unique_ptr<NexInstancer> instancer = {};
+        if (m_options.m_instancing && !gpu_scene) {
+            instancer = std::make_unique<NexInstancer>(m_device);
+        }
+
+        // the per entity passes split their draws across the job system, the other paths record few enough commands already
+        std::unique_ptr<NexParallelRecorder> parallel_recorder = {};
+        if (m_options.m_parallel_recording && !gpu_scene && !instancer) {
+            parallel_recorder = std::make_unique<NexParallelRecorder>(m_device, m_job_system);
         }
 
-        SimpleRenderSystem simple_render_system(m_device, m_renderer.getSwapChainRenderPass(), global_set_layout->getDescriptorSetLayout());
+        // the benchmarks take their gpu times from the profiler too, without the statistics queries unless it was asked for
+        std::unique_ptr<NexGpuProfiler> gpu_profiler = {};
+        if (m_options.m_gpu_profiler || m_options.m_benchmark_frames > 0 || m_options.m_benchmark_shadows) {
+            gpu_profiler = std::make_unique<NexGpuProfiler>(m_device, m_options.m_gpu_profiler);
+        }
+
+        VkDescriptorSetLayout object_set_layout = gpu_scene ? gpu_scene->getObjectSetLayout() : instancer ? instancer->getInstanceSetLayout() : VK_NULL_HANDLE;
+
+        SimpleRenderSystem simple_render_system(m_device, m_renderer.getSwapChainRenderPass(), global_set_layout->getDescriptorSetLayout(), object_set_layout);
         PointLightSystem   point_light_system(m_device, m_renderer.getSwapChainRenderPass(), global_set_layout->getDescriptorSetLayout());
-        ShadowSystem       shadow_system(m_device);
+        ShadowSystem       shadow_system(m_device, m_options.m_benchmark_shadows, object_set_layout);
+
+        // occlusion culling reads back the main pass' depth, which not every device can sample at the swapchain's sample count
+        std::unique_ptr<CullingSystem> culling_system = {};
+        if (gpu_scene && m_options.m_gpu_culling) {
+            if (!m_renderer.isDepthSampled()) {
+                std::cerr << "the scene depth can't be sampled, culling against the frustums only" << std::endl;
+            }
+            culling_system = std::make_unique<CullingSystem>(m_device, m_renderer.getSwapChainExtent(), m_renderer.isDepthSampled());
+            gpu_scene->setCulling(true);
+        }
+
+        // every pipeline exists by now, a warm pipeline cache is what shortens this
+        m_device.pipelineCache().printStats();
+        std::cout << "startup took " << std::fixed << std::setprecision(2)
+                  << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start_time).count() << " ms" << std::endl;
+
+        // the per entity passes cull on the cpu instead, the benchmark switches culling on and off every window
+        NexSceneGraph      scene_graph      = {};
+        NexEntityCuller    entity_culler    = {};
+        NexVisibleEntities visible_entities = {};
+        bool               cpu_culling      = !gpu_scene && (m_options.m_cpu_culling || m_options.m_benchmark_culling);
 
         NexCamera camera = {};
 
-        auto viewer_object                        = NexEntity::create();
-        viewer_object.m_transform.m_translation.z = -2.5f;
-        Input camera_controller                   = {};
+        TransformComponent viewer_transform = {};
+        viewer_transform.m_translation.z    = -2.5f;
+        Input camera_controller             = {};
 
         auto current_time = std::chrono::high_resolution_clock::now();
+        bool assets_ready = false;
+
+        // cpu time spent recording and between frames, averaged over a window of frames in the stress scene
+        constexpr uint32_t      record_window       = 300;
+        uint32_t                record_frames       = 0;
+        double                  record_seconds      = 0.0;
+        double                  frame_seconds       = 0.0;
+        double                  cull_seconds        = 0.0;
+        double                  scalar_cull_seconds = 0.0;
+        std::vector<NexEntity>  scalar_visible      = {};
+        bool                    report              = m_options.m_stress_count > 0 || culling_system || m_options.m_benchmark_culling;
+
+        // headless and benchmark runs render a fixed number of frames once the scene is complete
+        constexpr uint32_t benchmark_warmup_frames = 60;
+        uint32_t           scene_frame             = 0;
+
+        // a benchmark replays a camera path at a fixed timestep and skips the frames that warm the caches up
+        std::unique_ptr<NexFrameBenchmark> benchmark        = {};
+        std::string                        camera_path_name = m_options.m_camera_path.empty() && m_options.m_benchmark_frames > 0 ? "orbit" : m_options.m_camera_path;
+        NexCameraPath                      camera_path      = {};
+        float                              camera_path_time = 0.0f;
+        NexCameraPath                      recorded_path    = {};
+        float                              recorded_time    = 0.0f;
+        uint32_t                           warmup_frames    = m_options.m_benchmark_frames > 0 ? benchmark_warmup_frames : 0;
+        if (!camera_path_name.empty()) {
+            camera_path = NexCameraPath::isScripted(camera_path_name) ? NexCameraPath::scripted(camera_path_name) : NexCameraPath::load(camera_path_name);
+        }
+        if (m_options.m_benchmark_frames > 0) {
+            benchmark = std::make_unique<NexFrameBenchmark>(m_options.m_scene, camera_path_name, m_options.m_benchmark_frames, m_options.m_benchmark_timestep);
+        }
 
         while (!m_window.shouldClose()) {
-            glfwPollEvents();
+            NEX_TRACE_SCOPE("frame");
+            m_window.pollEvents();
+
+            // entities pick up their mesh and texture as soon as the workers are done with them
+            m_asset_loader.update();
+            if (!assets_ready && m_asset_loader.isIdle()) {
+                assets_ready = true;
+                m_device.allocator().printStats();
+                m_device.geometryPool().printStats();
+            }
 
             auto  new_time   = std::chrono::high_resolution_clock::now();
             float delta_time = std::chrono::duration<float, std::chrono::seconds::period>(new_time - current_time).count();
             current_time     = new_time;
-
-            delta_time = std::min(delta_time, 0.1f);
-
-            camera_controller.moveInPlaneXZ(m_window.getGLFWwindow(), delta_time, viewer_object);
-            camera.setViewYXZ(viewer_object.m_transform.m_translation, viewer_object.m_transform.m_rotation);
-
-            float aspect_ratio = m_renderer.getAspectRatio();
-
-            camera.setPerspectiveProjection(glm::radians(50.0f), aspect_ratio, 0.1f, 100.0f);
+            frame_seconds += delta_time;
+            double frame_ms = delta_time * 1000.0;
+
+            delta_time = benchmark ? m_options.m_benchmark_timestep : std::min(delta_time, 0.1f);
+
+            {
+                NEX_TRACE_SCOPE("camera update");
+                if (!camera_path.isEmpty()) {
+                    camera_path.sample(camera_path_time, viewer_transform);
+                    if (assets_ready && scene_frame >= warmup_frames) {
+                        camera_path_time += delta_time;
+                    }
+                } else if (!m_window.isHeadless()) {
+                    camera_controller.moveInPlaneXZ(m_window.getGLFWwindow(), delta_time, viewer_transform);
+                    if (!m_options.m_record_camera_path.empty()) {
+                        recorded_path.addKey({recorded_time, viewer_transform.m_translation, viewer_transform.m_rotation});
+                        recorded_time += delta_time;
+                    }
+                }
+                camera.setViewYXZ(viewer_transform.m_translation, viewer_transform.m_rotation);
+
+                float aspect_ratio = m_renderer.getAspectRatio();
+
+                camera.setPerspectiveProjection(glm::radians(50.0f), aspect_ratio, 0.1f, 100.0f);
+            }
 
             if (auto command_buffer = m_renderer.beginFrame()) {
-                int frame_index = m_renderer.getFrameIndex();
-
-                // Reset the frame descriptor pool for this frame
-                m_frame_descriptor_pools[frame_index]->resetPool();
+                // timed from here to the submission, the fence wait, acquire and present aren't cpu work of ours
+                auto     record_start = std::chrono::high_resolution_clock::now();
+                int      frame_index  = m_renderer.getFrameIndex();
+                uint64_t frame_number = m_renderer.getFrameNumber();
+
+                // frees the sets this frame slot stopped asking for
+                m_frame_descriptor_allocators[frame_index]->nextFrame();
+                if (parallel_recorder) {
+                    parallel_recorder->beginFrame(frame_index);
+                }
+                // the frame scope spans everything recorded between here and endFrame()
+                uint32_t frame_scope = UINT32_MAX;
+                if (gpu_profiler) {
+                    gpu_profiler->beginFrame(command_buffer, frame_index, frame_number);
+                    double gpu_ms = gpu_profiler->getMilliseconds("frame");
+                    if (benchmark && gpu_ms >= 0.0) {
+                        benchmark->addGpuTime(gpu_profiler->getResultsFrame(), gpu_ms);
+                    }
+                    frame_scope = gpu_profiler->beginScope(command_buffer, "frame", false);
+                }
 
                 NexFrameInfo frame_info{
-                    frame_index, delta_time, command_buffer, camera, global_descriptor_sets[frame_index], *m_frame_descriptor_pools[frame_index], m_entities,
+                    frame_index, delta_time, command_buffer, camera, global_descriptor_sets[frame_index], *m_frame_descriptor_allocators[frame_index], m_registry, gpu_scene.get(),
                 };
 
+                // every pass below reads the cached matrices, so transforms that changed are rebuilt here once
+                scene_graph.update(m_registry);
+
+                glm::mat4 view_projection = camera.getProjectionMatrix() * camera.getViewMatrix();
+                shadow_system.updateLightSpaceMatrix();
+
+                if (gpu_scene) {
+                    gpu_scene->update(frame_index, m_registry);
+                }
+                if (culling_system) {
+                    NexGpuProfiler::Scope scope(gpu_profiler.get(), command_buffer, "culling");
+                    culling_system->cull(frame_info, m_renderer.getSwapChainExtent(), view_projection, shadow_system.getLightSpaceMatrix());
+                }
+                if (cpu_culling) {
+                    auto cull_start = std::chrono::high_resolution_clock::now();
+                    entity_culler.gather(m_registry);
+                    entity_culler.cull(NexFrustum::fromMatrix(view_projection), visible_entities.m_camera);
+                    entity_culler.cull(NexFrustum::fromMatrix(shadow_system.getLightSpaceMatrix()), visible_entities.m_light);
+                    frame_info.m_visible_entities = &visible_entities;
+                    cull_seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - cull_start).count();
+
+                    if (m_options.m_benchmark_culling) {
+                        auto scalar_start = std::chrono::high_resolution_clock::now();
+                        entity_culler.cullScalar(NexFrustum::fromMatrix(view_projection), scalar_visible);
+                        scalar_cull_seconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - scalar_start).count();
+                    }
+                }
+                if (instancer) {
+                    instancer->update(frame_index, m_registry, frame_info.m_visible_entities);
+                    frame_info.m_instancer = instancer.get();
+                }
+                frame_info.m_parallel_recorder = parallel_recorder.get();
+                frame_info.m_gpu_profiler      = gpu_profiler.get();
+
                 // update
                 GlobalUbo ubo             = {};
                 ubo.m_projection_matrix   = camera.getProjectionMatrix();
                 ubo.m_view_matrix         = camera.getViewMatrix();
                 ubo.m_inverse_view_matrix = camera.getInverseViewMatrix();
-                point_light_system.update(frame_info, ubo);
-                ubo_buffers[frame_index]->writeToBuffer(&ubo);
-                ubo_buffers[frame_index]->flush();
-
-                // render shadow map first
+                {
+                    NEX_TRACE_SCOPE("ubo write");
+                    point_light_system.update(frame_info, ubo);
+                    ubo_buffers[frame_index]->writeToBuffer(&ubo);
+                    ubo_buffers[frame_index]->flush();
+                }
+
+                // render shadow map first, it times itself as the "shadow" scope
                 shadow_system.renderShadowMap(frame_info);
 
-                // render main scene
-                m_renderer.beginSwapChainRenderPass(command_buffer);
-                simple_render_system.renderEntities(frame_info, shadow_system.getShadowMapDescriptor(), shadow_system.getLightSpaceMatrix());
-                point_light_system.render(frame_info);
-                m_renderer.endSwapChainRenderPass(command_buffer);
+                // render main scene, the per system scopes only fit in a pass recorded inline
+                {
+                    NexGpuProfiler*       inline_profiler = parallel_recorder ? nullptr : gpu_profiler.get();
+                    NexGpuProfiler::Scope main_scope(gpu_profiler.get(), command_buffer, "main pass", false);
+                    if (parallel_recorder) {
+                        m_renderer.beginSwapChainRenderPass(command_buffer, VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS);
+                        parallel_recorder->beginPass(m_renderer.getSwapChainRenderPass(), m_renderer.getCurrentFrameBuffer(), m_renderer.getSwapChainExtent());
+                    } else {
+                        m_renderer.beginSwapChainRenderPass(command_buffer);
+                    }
+                    {
+                        NexGpuProfiler::Scope scope(inline_profiler, command_buffer, "entities");
+                        simple_render_system.renderEntities(frame_info, shadow_system.getShadowMapDescriptor(), shadow_system.getLightSpaceMatrix());
+                    }
+                    {
+                        NexGpuProfiler::Scope scope(inline_profiler, command_buffer, "point lights");
+                        point_light_system.render(frame_info);
+                    }
+                    m_renderer.endSwapChainRenderPass(command_buffer);
+                }
+
+                // next frame's occlusion tests run against this frame's depth
+                if (culling_system && m_renderer.isDepthSampled()) {
+                    NexGpuProfiler::Scope scope(gpu_profiler.get(), command_buffer, "depth pyramid");
+                    culling_system->buildDepthPyramid(frame_info, m_renderer.getDepthImage(), m_renderer.getDepthImageView(), m_renderer.getDepthFormat(), m_renderer.getSwapChainExtent(),
+                                                      view_projection);
+                }
+                bool last_frame = false;
+                if (assets_ready) {
+                    scene_frame++;
+                    last_frame = benchmark ? scene_frame >= warmup_frames + m_options.m_benchmark_frames : m_window.isHeadless() && scene_frame >= m_options.m_headless_frames;
+                }
+                if (m_window.isHeadless() && assets_ready && !m_options.m_capture_path.empty()) {
+                    if (m_options.m_capture_interval > 0 && scene_frame % m_options.m_capture_interval == 0) {
+                        m_renderer.captureFrame(numberedCapturePath(m_options.m_capture_path, scene_frame));
+                    } else if (last_frame) {
+                        m_renderer.captureFrame(m_options.m_capture_path);
+                    }
+                }
+                if (gpu_profiler) {
+                    gpu_profiler->endScope(command_buffer, frame_scope);
+                }
+                double record_time = std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - record_start).count();
                 m_renderer.endFrame();
+
+                if (benchmark && assets_ready && scene_frame > warmup_frames) {
+                    benchmark->addFrame(frame_number, record_time * 1000.0, frame_ms);
+                }
+                if (last_frame) {
+                    m_window.requestClose();
+                }
+                if (m_options.m_gpu_profiler && gpu_profiler->printReport()) {
+                    m_window.setTitle("First app | " + gpu_profiler->getSummary());
+                }
+
+                if (report) {
+                    record_seconds += record_time;
+                    if (++record_frames == record_window) {
+                        const char* mode = gpu_scene ? "gpu driven" : cpu_culling ? "per entity, frustum culled" : "per entity, draw everything";
+                        std::cout << mode << (instancer ? ", instanced" : "");
+                        if (parallel_recorder) {
+                            std::cout << ", recorded on " << parallel_recorder->getSlotCount() << " threads";
+                        }
+                        std::cout << ": " << std::fixed << std::setprecision(3) << record_seconds * 1000.0 / record_frames << " ms cpu per frame, "
+                                  << frame_seconds * 1000.0 / record_frames << " ms frame time";
+                        if (gpu_scene) {
+                            std::cout << ", " << gpu_scene->getObjectCount() << " objects in " << gpu_scene->getBatches().size() << " batches of " << gpu_scene->getDrawCount()
+                                      << " draws";
+                        }
+                        if (culling_system) {
+                            const NexCullingStats& stats = culling_system->getStats();
+                            std::cout << ", main pass " << stats.m_visible << "/" << stats.m_tested << " visible (" << stats.m_frustum_culled << " frustum, " << stats.m_occlusion_culled
+                                      << " occlusion culled), shadow pass " << stats.m_shadow_visible << "/" << stats.m_shadow_tested << " visible";
+                        }
+                        if (instancer) {
+                            std::cout << ", " << instancer->getInstanceCount() << " instances in " << instancer->getGroups().size() << " main and " << instancer->getShadowGroups().size()
+                                      << " shadow draws";
+                        }
+                        if (cpu_culling) {
+                            std::cout << ", main pass " << visible_entities.m_camera.size() << "/" << entity_culler.getEntityCount() << " visible, shadow pass "
+                                      << visible_entities.m_light.size() << "/" << entity_culler.getEntityCount() << " visible, culling " << cull_seconds * 1000.0 / record_frames << " ms";
+                            if (m_options.m_benchmark_culling) {
+                                std::cout << " (" << scalar_cull_seconds * 1000.0 / record_frames << " ms for the scalar camera test)";
+                            }
+                        }
+                        std::cout << std::endl;
+
+                        // the frame time only differs with a present mode that doesn't wait for vblank
+                        if (m_options.m_benchmark_culling && !gpu_scene) {
+                            cpu_culling = !cpu_culling;
+                        }
+
+                        record_frames       = 0;
+                        record_seconds      = 0.0;
+                        frame_seconds       = 0.0;
+                        cull_seconds        = 0.0;
+                        scalar_cull_seconds = 0.0;
+                    }
+                }
             }
         }
 
-        vkDeviceWaitIdle(m_device.device());
+        m_renderer.waitIdle();
+
+        if (m_options.m_benchmark_shadows) {
+            shadow_system.printBenchmarkSummary();
+        }
+
+        if (benchmark) {
+            while (gpu_profiler->readInFlight()) {
+                benchmark->addGpuTime(gpu_profiler->getResultsFrame(), gpu_profiler->getMilliseconds("frame"));
+            }
+            benchmark->printSummary();
+            benchmark->write(m_options.m_benchmark_output, m_device.m_properties.deviceName);
+        }
+        if (!m_options.m_record_camera_path.empty()) {
+            recorded_path.save(m_options.m_record_camera_path);
+        }
+        if (!m_options.m_trace_path.empty()) {
+            NexTrace::setEnabled(false);
+            NexTrace::writeChromeTrace(m_options.m_trace_path);
+        }
+
+        for (int i = 0; i < NexSwapChain::max_frames_in_flight; ++i) {
+            m_frame_descriptor_allocators[i]->printStats(("frame " + std::to_string(i)).c_str());
+        }
     }
 
     void NexEngine::loadEntities() {
-        std::shared_ptr<NexMesh> nex_model    = NexMesh::createModelFromFile(m_device, "../models/viking_room.obj");
-        auto                     viking_room  = NexEntity::create();
-        viking_room.m_material_index          = 0;
-        viking_room.m_model                   = nex_model;
-        viking_room.m_transform.m_translation = {0.0f, 0.5f, 0.0f};
-        viking_room.m_transform.m_rotation    = glm::vec3{glm::radians(90.0f), glm::radians(90.0f), 0.0f};
-        viking_room.m_transform.m_scale       = glm::vec3{1.0f};
-        viking_room.m_texture                 = NexTexture::createTextureFromFile(m_device, "../textures/viking_room.png");
-        viking_room.m_texture->updateDescriptor();
-        m_entities.emplace(viking_room.getId(), std::move(viking_room));
-
-        nex_model                        = NexMesh::createModelFromFile(m_device, "../models/monkey.obj");
-        auto monkey                      = NexEntity::create();
-        monkey.m_material_index          = 1;
-        monkey.m_model                   = nex_model;
-        monkey.m_transform.m_translation = {1.5f, -1.0f, 0.0f};
-        monkey.m_transform.m_rotation    = glm::vec3{glm::radians(180.0f), 0.0f, 0.0f};
-        monkey.m_transform.m_scale       = glm::vec3{1.0f};
-        m_entities.emplace(monkey.getId(), std::move(monkey));
-
-        nex_model                       = NexMesh::createModelFromFile(m_device, "../models/quad.obj");
-        auto floor                      = NexEntity::create();
-        floor.m_material_index          = 1;
-        floor.m_model                   = nex_model;
-        floor.m_transform.m_translation = {0.0f, 0.5f, 0.0f};
-        floor.m_transform.m_scale       = glm::vec3{3.0f};
-        floor.m_texture                 = NexTexture::createTextureFromFile(m_device, "../textures/floor.png");
-        floor.m_texture->updateDescriptor();
-        m_entities.emplace(floor.getId(), std::move(floor));
-
-        // auto light_left                      = NexEntity::makePointLight(0.3f, 0.1f, {1.0f, 0.84f, 0.4f});
-        // light_left.m_transform.m_translation = {-0.56f, -0.10f, 0.25f};
-        // light_left.m_transform.m_scale       = glm::vec3{0.0f};
-        // m_entities.emplace(light_left.getId(), std::move(light_left));
-
-        // auto light_right                      = NexEntity::makePointLight(0.3f, 0.1f, {1.0f, 0.84f, 0.4f});
-        // light_right.m_transform.m_translation = {0.63f, -0.10f, 0.26f};
-        // light_right.m_transform.m_scale       = glm::vec3{0.0f};
-        // m_entities.emplace(light_right.getId(), std::move(light_right));
+        // entities exist right away, the loader hands them their mesh and texture once both are created
+        auto attach = [this](NexEntity entity) {
+            return [this, entity](std::shared_ptr<NexMesh> mesh, std::shared_ptr<NexTexture> texture) {
+                m_registry.get<MeshComponent>(entity).m_mesh = std::move(mesh);
+                if (texture) {
+                    m_registry.emplace<TextureComponent>(entity).m_texture = std::move(texture);
+                }
+            };
+        };
+
+        auto  viking_room                   = m_registry.create();
+        auto& viking_room_transform         = m_registry.emplace<TransformComponent>(viking_room);
+        viking_room_transform.m_translation = {0.0f, 0.5f, 0.0f};
+        viking_room_transform.m_rotation    = glm::vec3{glm::radians(90.0f), glm::radians(90.0f), 0.0f};
+        viking_room_transform.m_scale       = glm::vec3{1.0f};
+        m_registry.emplace<MeshComponent>(viking_room, MeshComponent{.m_material_index = 0});
+        m_asset_loader.load("../models/viking_room.obj", "../textures/viking_room.png", attach(viking_room));
+
+        auto  monkey                   = m_registry.create();
+        auto& monkey_transform         = m_registry.emplace<TransformComponent>(monkey);
+        monkey_transform.m_translation = {1.5f, -1.0f, 0.0f};
+        monkey_transform.m_rotation    = glm::vec3{glm::radians(180.0f), 0.0f, 0.0f};
+        monkey_transform.m_scale       = glm::vec3{1.0f};
+        m_registry.emplace<MeshComponent>(monkey, MeshComponent{.m_material_index = 1});
+        m_asset_loader.load("../models/monkey.obj", "", attach(monkey));
+
+        auto  floor                   = m_registry.create();
+        auto& floor_transform         = m_registry.emplace<TransformComponent>(floor);
+        floor_transform.m_translation = {0.0f, 0.5f, 0.0f};
+        floor_transform.m_scale       = glm::vec3{3.0f};
+        m_registry.emplace<MeshComponent>(floor, MeshComponent{.m_material_index = 1});
+        m_asset_loader.load("../models/quad.obj", "../textures/floor.png", attach(floor));
+
+        if (m_options.m_stress_count > 0) {
+            loadStressEntities();
+        }
+
+        // auto light_left                                              = makePointLight(m_registry, 0.3f, 0.1f, {1.0f, 0.84f, 0.4f});
+        // m_registry.get<TransformComponent>(light_left).m_translation = {-0.56f, -0.10f, 0.25f};
+
+        // auto light_right                                              = makePointLight(m_registry, 0.3f, 0.1f, {1.0f, 0.84f, 0.4f});
+        // m_registry.get<TransformComponent>(light_right).m_translation = {0.63f, -0.10f, 0.26f};
+    }
+
+    void NexEngine::loadStressEntities() {
+        // a square grid of small monkeys above the floor, all sharing one mesh so it is loaded once
+        uint32_t side    = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(m_options.m_stress_count))));
+        float    spacing = 0.25f;
+        float    start   = -0.5f * spacing * static_cast<float>(side - 1);
+
+        auto monkeys = std::make_shared<std::vector<NexEntity>>();
+        monkeys->reserve(m_options.m_stress_count);
+
+        for (uint32_t i = 0; i < m_options.m_stress_count; ++i) {
+            auto  monkey            = m_registry.create();
+            auto& transform         = m_registry.emplace<TransformComponent>(monkey);
+            transform.m_translation = {start + spacing * static_cast<float>(i % side), -1.0f, start + spacing * static_cast<float>(i / side)};
+            transform.m_rotation    = glm::vec3{glm::radians(180.0f), 0.0f, 0.0f};
+            transform.m_scale       = glm::vec3{0.1f};
+            m_registry.emplace<MeshComponent>(monkey, MeshComponent{.m_material_index = 1});
+            monkeys->push_back(monkey);
+        }
+
+        m_asset_loader.load("../models/monkey.obj", "", [this, monkeys](std::shared_ptr<NexMesh> mesh, std::shared_ptr<NexTexture> texture) {
+            for (auto monkey : *monkeys) {
+                m_registry.get<MeshComponent>(monkey).m_mesh = mesh;
+                if (texture) {
+                    m_registry.emplace<TextureComponent>(monkey).m_texture = texture;
+                }
+            }
+        });
     }
 
 }  // namespace nex
@@ -1,20 +1,51 @@
 #pragma once
 
+#include <chrono>
 #include <memory>
+#include <string>
 
 #include "../graphics/nex_descriptors.hpp"
 #include "nex_device.hpp"
+#include "nex_job_system.hpp"
+#include "../scene/nex_asset_loader.hpp"
 #include "../scene/nex_entity.hpp"
 #include "nex_renderer.hpp"
 #include "nex_window.hpp"
 
 namespace nex {
+    struct NexEngineOptions {
+        bool     m_benchmark_shadows  = false;  // alternate the shadow pass between mesh streams and print its gpu time
+        bool     m_gpu_driven         = false;  // draw both passes with multi draw indirect from a per object storage buffer
+        bool     m_gpu_culling        = false;  // cull the gpu driven draws in a compute pass, prints the culling counters
+        bool     m_cpu_culling        = false;  // frustum cull the entities on the cpu when drawing per entity
+        bool     m_benchmark_culling  = false;  // switch cpu culling on and off every few hundred frames and print the frame times of both
+        bool     m_instancing         = false;  // draw entities sharing a mesh and texture with one instanced draw when drawing per entity
+        bool     m_parallel_recording = false;  // record the per entity passes into secondary command buffers on the job system
+        bool     m_gpu_profiler       = false;  // time the passes with timestamp and pipeline statistics queries, printed and shown in the title
+        uint32_t m_stress_count       = 0;      // extra monkeys sharing one mesh, recording time is printed when set
+
+        bool        m_headless         = false;  // no window or surface, render offscreen and quit after m_headless_frames
+        uint32_t    m_headless_frames  = 300;    // counted from when every asset has loaded
+        std::string m_capture_path     = {};     // headless only, the last frame is written here, .png or raw rgba
+        uint32_t    m_capture_interval = 0;      // also capture every that many frames, numbered before the extension
+
+        std::string m_scene              = "default";     // "default", or "stress" which adds 100k monkeys unless m_stress_count asks for another count
+        std::string m_camera_path        = {};            // a scripted path name or a recorded file, drives the camera instead of the keyboard
+        std::string m_record_camera_path = {};            // the keyboard driven camera is saved here on exit
+        uint32_t    m_benchmark_frames   = 0;             // replay m_camera_path, orbit by default, at a fixed timestep and write the frame timings
+        float       m_benchmark_timestep = 1.0f / 60.0f;  // seconds the camera and the scene advance per benchmark frame
+        std::string m_benchmark_output   = "benchmark";   // the timings go to this with .json and .csv appended
+        std::string m_trace_path         = {};            // the cpu trace zones are written here on exit, chrome://tracing or Perfetto json
+
+        std::string m_pipeline_cache_path = "pipeline_cache.bin";  // compiled pipelines persist here across launches, empty to start cold every time
+    };
+
     class NexEngine {
       public:
         static constexpr int width  = 1500;
         static constexpr int height = 1000;
 
-        NexEngine();
+        explicit NexEngine(const NexEngineOptions& options = {});
         ~NexEngine();
 
         NexEngine(const NexEngine&)            = delete;
@@ -24,14 +55,22 @@ namespace nex {
 
       private:
         void loadEntities();
+        void loadStressEntities();
+
+        NexEngineOptions m_options;
 
-        NexWindow   m_window   = {"First app", width, height};
-        NexDevice   m_device   = m_window;
+        std::chrono::steady_clock::time_point m_start_time = std::chrono::steady_clock::now();  // before the window and device, startup is measured from here
+
+        NexWindow   m_window   = {"First app", width, height, m_options.m_headless};
+        NexDevice   m_device   = {m_window, m_options.m_pipeline_cache_path};
         NexRenderer m_renderer = {m_window, m_device};
 
+        NexJobSystem   m_job_system{};
+        NexAssetLoader m_asset_loader = {m_device, m_job_system};
+
         // note: order of declaration matters
-        std::unique_ptr<NexDescriptorPool>              m_descriptor_pool = {};
-        std::vector<std::unique_ptr<NexDescriptorPool>> m_frame_descriptor_pools;
-        NexEntity::Map                                  m_entities = {};
+        std::unique_ptr<NexDescriptorAllocator>              m_descriptor_allocator = {};  // sets that live as long as the engine
+        std::vector<std::unique_ptr<NexDescriptorAllocator>> m_frame_descriptor_allocators;
+        NexRegistry                                          m_registry;
     };
 }  // namespace nex
@@ -0,0 +1,243 @@
+#include "nex_gpu_profiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace nex {
+    // in the order vkGetQueryPoolResults writes them, which is by bit
+    static constexpr VkQueryPipelineStatisticFlags pipeline_statistics =
+        VK_QUERY_PIPELINE_STATISTIC_INPUT_ASSEMBLY_PRIMITIVES_BIT | VK_QUERY_PIPELINE_STATISTIC_VERTEX_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_CLIPPING_PRIMITIVES_BIT |
+        VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT | VK_QUERY_PIPELINE_STATISTIC_COMPUTE_SHADER_INVOCATIONS_BIT;
+    static constexpr uint32_t pipeline_statistic_count = 5;
+
+    NexGpuProfiler::Scope::Scope(NexGpuProfiler* profiler, VkCommandBuffer command_buffer, const char* name, bool statistics)
+        : m_profiler{profiler}, m_command_buffer{command_buffer}, m_scope{profiler ? profiler->beginScope(command_buffer, name, statistics) : UINT32_MAX} {}
+
+    NexGpuProfiler::Scope::~Scope() {
+        if (m_profiler) {
+            m_profiler->endScope(m_command_buffer, m_scope);
+        }
+    }
+
+    NexGpuProfiler::NexGpuProfiler(NexDevice& device, bool statistics) : m_device{device} {
+        if (!m_device.m_properties.limits.timestampComputeAndGraphics || m_device.m_timestamp_valid_bits == 0) {
+            std::cerr << "gpu profiler: timestamps are not supported on this device" << std::endl;
+            return;
+        }
+        // the counter wraps past the valid bits, a difference taken modulo them is right across one wrap
+        m_timestamp_mask = m_device.m_timestamp_valid_bits >= 64 ? UINT64_MAX : (uint64_t{1} << m_device.m_timestamp_valid_bits) - 1;
+
+        VkQueryPoolCreateInfo query_pool_info = {};
+        query_pool_info.sType                 = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        query_pool_info.queryType             = VK_QUERY_TYPE_TIMESTAMP;
+        query_pool_info.queryCount            = 2 * max_scopes * NexSwapChain::max_frames_in_flight;
+
+        if (vkCreateQueryPool(m_device.device(), &query_pool_info, nullptr, &m_timestamp_pool) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create timestamp query pool!");
+        }
+
+        if (!statistics) {
+            return;
+        }
+        if (!m_device.m_enabled_features.pipelineStatisticsQuery) {
+            std::cerr << "gpu profiler: pipeline statistics are not supported on this device, timing only" << std::endl;
+            return;
+        }
+
+        query_pool_info.queryType          = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+        query_pool_info.queryCount         = max_scopes * NexSwapChain::max_frames_in_flight;
+        query_pool_info.pipelineStatistics = pipeline_statistics;
+
+        if (vkCreateQueryPool(m_device.device(), &query_pool_info, nullptr, &m_statistics_pool) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create pipeline statistics query pool!");
+        }
+    }
+
+    NexGpuProfiler::~NexGpuProfiler() {
+        if (m_statistics_pool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(m_device.device(), m_statistics_pool, nullptr);
+        }
+        if (m_timestamp_pool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(m_device.device(), m_timestamp_pool, nullptr);
+        }
+    }
+
+    void NexGpuProfiler::beginFrame(VkCommandBuffer command_buffer, int frame_index, uint64_t frame_number) {
+        if (!isEnabled()) {
+            return;
+        }
+
+        readResults(frame_index);
+
+        m_frame_index      = frame_index;
+        m_open_scopes      = 0;
+        m_statistics_owner = UINT32_MAX;
+
+        FrameSlot& slot = m_slots[frame_index];
+        slot.m_scopes.clear();
+        slot.m_statistics_count = 0;
+        slot.m_frame_number     = frame_number;
+        slot.m_written          = true;
+
+        vkCmdResetQueryPool(command_buffer, m_timestamp_pool, 2 * max_scopes * frame_index, 2 * max_scopes);
+        if (hasPipelineStatistics()) {
+            vkCmdResetQueryPool(command_buffer, m_statistics_pool, max_scopes * frame_index, max_scopes);
+        }
+    }
+
+    uint32_t NexGpuProfiler::beginScope(VkCommandBuffer command_buffer, const char* name, bool statistics) {
+        FrameSlot& slot = m_slots[m_frame_index];
+        if (!isEnabled() || slot.m_scopes.size() >= max_scopes) {
+            return UINT32_MAX;
+        }
+
+        uint32_t     scope_index = static_cast<uint32_t>(slot.m_scopes.size());
+        PendingScope scope       = {name, m_open_scopes++};
+
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_timestamp_pool, 2 * (max_scopes * m_frame_index + scope_index));
+
+        if (statistics && hasPipelineStatistics() && m_statistics_owner == UINT32_MAX) {
+            scope.m_statistics = slot.m_statistics_count++;
+            m_statistics_owner = scope_index;
+            vkCmdBeginQuery(command_buffer, m_statistics_pool, max_scopes * m_frame_index + scope.m_statistics, 0);
+        }
+
+        slot.m_scopes.push_back(scope);
+        return scope_index;
+    }
+
+    void NexGpuProfiler::endScope(VkCommandBuffer command_buffer, uint32_t scope_index) {
+        if (scope_index == UINT32_MAX) {
+            return;
+        }
+
+        PendingScope& scope = m_slots[m_frame_index].m_scopes[scope_index];
+        if (m_statistics_owner == scope_index) {
+            vkCmdEndQuery(command_buffer, m_statistics_pool, max_scopes * m_frame_index + scope.m_statistics);
+            m_statistics_owner = UINT32_MAX;
+        }
+
+        vkCmdWriteTimestamp(command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, m_timestamp_pool, 2 * (max_scopes * m_frame_index + scope_index) + 1);
+        scope.m_ended = true;
+        m_open_scopes--;
+    }
+
+    double NexGpuProfiler::getMilliseconds(const char* name) const {
+        for (const auto& result : m_results) {
+            if (std::strcmp(result.m_name, name) == 0) {
+                return result.m_milliseconds;
+            }
+        }
+        return -1.0;
+    }
+
+    bool NexGpuProfiler::readInFlight() {
+        int oldest = -1;
+        for (int i = 0; i < NexSwapChain::max_frames_in_flight; ++i) {
+            if (m_slots[i].m_written && !m_slots[i].m_scopes.empty() && (oldest < 0 || m_slots[i].m_frame_number < m_slots[oldest].m_frame_number)) {
+                oldest = i;
+            }
+        }
+        return oldest >= 0 && readResults(oldest);
+    }
+
+    bool NexGpuProfiler::readResults(int frame_index) {
+        FrameSlot& slot = m_slots[frame_index];
+        m_results.clear();
+        if (!slot.m_written || slot.m_scopes.empty()) {
+            return false;
+        }
+        slot.m_written = false;
+
+        // the slot's fence has been waited on, so its queries are normally available and nothing here waits
+        uint32_t              scope_count = static_cast<uint32_t>(slot.m_scopes.size());
+        std::vector<uint64_t> timestamps(2 * scope_count);
+        if (vkGetQueryPoolResults(m_device.device(), m_timestamp_pool, 2 * max_scopes * frame_index, 2 * scope_count, timestamps.size() * sizeof(uint64_t), timestamps.data(),
+                                  sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) != VK_SUCCESS) {
+            return false;
+        }
+
+        std::vector<uint64_t> statistics(pipeline_statistic_count * slot.m_statistics_count);
+        bool                  has_statistics = slot.m_statistics_count > 0;
+        if (has_statistics) {
+            has_statistics = vkGetQueryPoolResults(m_device.device(), m_statistics_pool, max_scopes * frame_index, slot.m_statistics_count, statistics.size() * sizeof(uint64_t),
+                                                   statistics.data(), pipeline_statistic_count * sizeof(uint64_t), VK_QUERY_RESULT_64_BIT) == VK_SUCCESS;
+        }
+
+        double period   = m_device.m_properties.limits.timestampPeriod;
+        m_results_frame = slot.m_frame_number;
+        for (uint32_t i = 0; i < scope_count; ++i) {
+            const PendingScope& scope = slot.m_scopes[i];
+            if (!scope.m_ended) {
+                continue;
+            }
+
+            NexGpuScopeResult result = {};
+            result.m_name            = scope.m_name;
+            result.m_depth           = scope.m_depth;
+            result.m_milliseconds    = static_cast<double>((timestamps[2 * i + 1] - timestamps[2 * i]) & m_timestamp_mask) * period / 1e6;
+
+            if (has_statistics && scope.m_statistics != UINT32_MAX) {
+                const uint64_t* counters      = &statistics[pipeline_statistic_count * scope.m_statistics];
+                result.m_has_statistics       = true;
+                result.m_input_primitives     = counters[0];
+                result.m_vertex_invocations   = counters[1];
+                result.m_clipped_primitives   = counters[2];
+                result.m_fragment_invocations = counters[3];
+                result.m_compute_invocations  = counters[4];
+            }
+            m_results.push_back(result);
+        }
+
+        accumulate();
+        return true;
+    }
+
+    void NexGpuProfiler::accumulate() {
+        for (const auto& result : m_results) {
+            auto it = std::find_if(m_accumulated.begin(), m_accumulated.end(), [&](const Accumulated& accumulated) {
+                return accumulated.m_depth == result.m_depth && std::strcmp(accumulated.m_name, result.m_name) == 0;
+            });
+            if (it == m_accumulated.end()) {
+                it = m_accumulated.insert(m_accumulated.end(), Accumulated{result.m_name, result.m_depth});
+            }
+
+            it->m_milliseconds += result.m_milliseconds;
+            it->m_primitives += result.m_input_primitives;
+            it->m_fragments += result.m_fragment_invocations;
+            it->m_samples++;
+        }
+    }
+
+    bool NexGpuProfiler::printReport() {
+        if (!isEnabled() || ++m_frames < report_every) {
+            return false;
+        }
+        m_frames = 0;
+
+        std::ostringstream summary;
+        summary << std::fixed << std::setprecision(2);
+
+        std::cout << "gpu profile, averaged over " << report_every << " frames:" << std::endl;
+        for (const auto& accumulated : m_accumulated) {
+            double samples = std::max(accumulated.m_samples, 1u);
+            std::cout << "  " << std::string(2 * accumulated.m_depth, ' ') << std::left << std::setw(16) << accumulated.m_name << std::right << std::fixed
+                      << std::setprecision(3) << std::setw(8) << accumulated.m_milliseconds / samples << " ms";
+            if (hasPipelineStatistics() && (accumulated.m_primitives > 0 || accumulated.m_fragments > 0)) {
+                std::cout << ", " << static_cast<uint64_t>(accumulated.m_primitives / samples) << " primitives, " << static_cast<uint64_t>(accumulated.m_fragments / samples)
+                          << " fragment invocations";
+            }
+            std::cout << std::endl;
+
+            summary << (summary.tellp() > 0 ? " | " : "") << accumulated.m_name << " " << accumulated.m_milliseconds / samples << " ms";
+        }
+
+        m_summary = summary.str();
+        m_accumulated.clear();
+        return true;
+    }
+}  // namespace nex
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "nex_device.hpp"
+#include "nex_swapchain.hpp"
+
+namespace nex {
+    struct NexGpuScopeResult {
+        const char* m_name           = "";
+        uint32_t    m_depth          = 0;  // how many scopes were open around it
+        double      m_milliseconds   = 0.0;
+        bool        m_has_statistics = false;
+
+        // pipeline statistics, only for scopes opened while no other scope collected them
+        uint64_t m_input_primitives     = 0;
+        uint64_t m_vertex_invocations   = 0;
+        uint64_t m_clipped_primitives   = 0;  // primitives that came out of clipping
+        uint64_t m_fragment_invocations = 0;
+        uint64_t m_compute_invocations  = 0;
+    };
+
+    // Named gpu scopes timed with timestamp queries and, where the device has pipelineStatisticsQuery, counted with pipeline statistics.
+    // Every frame slot owns its own range of queries, which beginFrame() reads back once the slot's fence has been waited on, so reading
+    // never stalls and the results trail the frame being recorded by max_frames_in_flight. Scopes may nest. Statistics queries can't,
+    // so only the outermost open scope collects them, and a scope around executed secondaries must not collect them at all. Scopes inside
+    // a render pass must close in the same subpass, and can't be opened in one whose contents are secondary command buffers.
+    class NexGpuProfiler {
+      public:
+        static constexpr uint32_t max_scopes   = 32;   // per frame, further scopes are not timed
+        static constexpr uint32_t report_every = 120;  // frames averaged by printReport()
+
+        class Scope {
+          public:
+            // a null profiler makes the scope a no op
+            Scope(NexGpuProfiler* profiler, VkCommandBuffer command_buffer, const char* name, bool statistics = true);
+            ~Scope();
+
+            Scope(const Scope&)            = delete;
+            Scope& operator=(const Scope&) = delete;
+
+          private:
+            NexGpuProfiler* m_profiler;
+            VkCommandBuffer m_command_buffer;
+            uint32_t        m_scope;
+        };
+
+        // without statistics only timestamps are written, for benchmarks that shouldn't pay for the counters
+        explicit NexGpuProfiler(NexDevice& device, bool statistics = true);
+        ~NexGpuProfiler();
+
+        NexGpuProfiler(const NexGpuProfiler&)            = delete;
+        NexGpuProfiler& operator=(const NexGpuProfiler&) = delete;
+
+        // at the start of the frame's command buffer, outside any render pass. Reads back the frame slot's previous frame
+        void     beginFrame(VkCommandBuffer command_buffer, int frame_index, uint64_t frame_number);
+        uint32_t beginScope(VkCommandBuffer command_buffer, const char* name, bool statistics = true);
+        void     endScope(VkCommandBuffer command_buffer, uint32_t scope);
+
+        bool isEnabled() const {
+            return m_timestamp_pool != VK_NULL_HANDLE;
+        }
+
+        bool hasPipelineStatistics() const {
+            return m_statistics_pool != VK_NULL_HANDLE;
+        }
+
+        // the scopes of the last frame read back, in the order they were opened
+        const std::vector<NexGpuScopeResult>& getResults() const {
+            return m_results;
+        }
+
+        // the frame number getResults() belongs to, as passed to beginFrame()
+        uint64_t getResultsFrame() const {
+            return m_results_frame;
+        }
+
+        // of the first scope in getResults() with that name, negative when the frame didn't time one
+        double getMilliseconds(const char* name) const;
+
+        // once the device is idle, reads back the oldest frame still unread. False when none is left
+        bool readInFlight();
+
+        // scope names and average times over the last report window, e.g. for a window title
+        std::string getSummary() const {
+            return m_summary;
+        }
+
+        // prints the averages once every report_every frames, returns whether it did
+        bool printReport();
+
+      private:
+        struct PendingScope {
+            const char* m_name       = "";
+            uint32_t    m_depth      = 0;
+            uint32_t    m_statistics = UINT32_MAX;  // index of the statistics query in the slot's range
+            bool        m_ended      = false;
+        };
+
+        struct FrameSlot {
+            std::vector<PendingScope> m_scopes           = {};
+            uint32_t                  m_statistics_count = 0;
+            uint64_t                  m_frame_number     = 0;
+            bool                      m_written          = false;
+        };
+
+        struct Accumulated {
+            const char* m_name         = "";
+            uint32_t    m_depth        = 0;
+            double      m_milliseconds = 0.0;
+            uint32_t    m_samples      = 0;
+            uint64_t    m_primitives   = 0;
+            uint64_t    m_fragments    = 0;
+        };
+
+        bool readResults(int frame_index);
+        void accumulate();
+
+        NexDevice& m_device;
+
+        VkQueryPool m_timestamp_pool  = VK_NULL_HANDLE;  // 2 * max_scopes per frame slot
+        VkQueryPool m_statistics_pool = VK_NULL_HANDLE;  // max_scopes per frame slot
+        uint64_t    m_timestamp_mask  = UINT64_MAX;      // the graphics family's timestampValidBits
+
+        FrameSlot m_slots[NexSwapChain::max_frames_in_flight] = {};
+        int       m_frame_index                               = 0;
+        uint32_t  m_open_scopes                               = 0;
+        uint32_t  m_statistics_owner                          = UINT32_MAX;  // the scope whose statistics query is active
+
+        std::vector<NexGpuScopeResult> m_results       = {};
+        uint64_t                       m_results_frame = 0;
+        std::vector<Accumulated>       m_accumulated   = {};
+        uint32_t                       m_frames        = 0;
+        std::string                    m_summary       = {};
+    };
+}  // namespace nex
@@ -0,0 +1,126 @@
+#include "nex_job_system.hpp"
+
+#include <algorithm>
+#include <exception>
+#include <string>
+
+#include "nex_trace.hpp"
+
+namespace nex {
+    NexJobSystem::NexJobSystem(uint32_t thread_count) {
+        if (thread_count == 0) {
+            thread_count = std::max(2u, std::thread::hardware_concurrency()) - 1;
+        }
+
+        m_workers.reserve(thread_count);
+        for (uint32_t i = 0; i < thread_count; ++i) {
+            m_workers.emplace_back(&NexJobSystem::workerLoop, this, i);
+        }
+    }
+
+    NexJobSystem::~NexJobSystem() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_condition.notify_all();
+
+        for (auto& worker : m_workers) {
+            worker.join();
+        }
+    }
+
+    void NexJobSystem::push(std::function<void()> job) {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_jobs.push_back(std::move(job));
+        }
+        m_condition.notify_one();
+    }
+
+    bool NexJobSystem::runOne() {
+        std::function<void()> job;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (m_jobs.empty()) {
+                return false;
+            }
+            job = std::move(m_jobs.front());
+            m_jobs.pop_front();
+        }
+
+        NEX_TRACE_SCOPE("job");
+        job();
+        return true;
+    }
+
+    void NexJobSystem::workerLoop(uint32_t index) {
+        NexTrace::setThreadName("worker " + std::to_string(index));
+
+        while (true) {
+            std::function<void()> job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [this]() { return m_stopping || !m_jobs.empty(); });
+
+                // queued jobs are finished before shutting down so no future is left without a value
+                if (m_jobs.empty()) {
+                    return;
+                }
+                job = std::move(m_jobs.front());
+                m_jobs.pop_front();
+            }
+
+            NEX_TRACE_SCOPE("job");
+            job();
+        }
+    }
+
+    void NexJobSystem::parallelFor(uint32_t count, const std::function<void(uint32_t)>& job) {
+        if (count == 0) {
+            return;
+        }
+
+        // one chunk per thread is enough here, the callers hand us similarly sized work items
+        uint32_t chunk_count = std::min(count, getThreadCount() + 1);
+        uint32_t chunk_size  = (count + chunk_count - 1) / chunk_count;
+
+        std::vector<std::future<void>> chunks;
+        chunks.reserve(chunk_count);
+
+        for (uint32_t begin = chunk_size; begin < count; begin += chunk_size) {
+            uint32_t end = std::min(begin + chunk_size, count);
+            chunks.push_back(submit([&job, begin, end]() {
+                for (uint32_t i = begin; i < end; ++i) {
+                    job(i);
+                }
+            }));
+        }
+
+        // the calling thread takes the first chunk itself
+        std::exception_ptr failure = nullptr;
+        try {
+            for (uint32_t i = 0; i < std::min(chunk_size, count); ++i) {
+                job(i);
+            }
+        } catch (...) {
+            failure = std::current_exception();
+        }
+
+        // rethrow the first failure only after every chunk stopped touching job
+        for (auto& chunk : chunks) {
+            wait(chunk);
+            try {
+                chunk.get();
+            } catch (...) {
+                if (!failure) {
+                    failure = std::current_exception();
+                }
+            }
+        }
+
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+    }
+}  // namespace nex
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace nex {
+    class NexJobSystem {
+      public:
+        // 0 picks one worker per hardware thread, minus the calling thread
+        explicit NexJobSystem(uint32_t thread_count = 0);
+        ~NexJobSystem();
+
+        NexJobSystem(const NexJobSystem&)            = delete;
+        NexJobSystem& operator=(const NexJobSystem&) = delete;
+
+        template <typename F>
+        std::future<std::invoke_result_t<F>> submit(F&& job) {
+            auto task   = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(std::forward<F>(job));
+            auto future = task->get_future();
+            push([task]() { (*task)(); });
+            return future;
+        }
+
+        // runs job(i) for i in [0, count) across the workers and the calling thread, returns once all of them finished
+        void parallelFor(uint32_t count, const std::function<void(uint32_t)>& job);
+
+        // helps with queued jobs instead of blocking, so waiting from inside a job cannot starve the pool
+        template <typename T>
+        void wait(const std::future<T>& future) {
+            while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+                if (!runOne()) {
+                    future.wait_for(std::chrono::microseconds(100));
+                }
+            }
+        }
+
+        uint32_t getThreadCount() const {
+            return static_cast<uint32_t>(m_workers.size());
+        }
+
+      private:
+        void push(std::function<void()> job);
+        bool runOne();
+        void workerLoop(uint32_t index);
+
+        std::vector<std::thread>          m_workers;
+        std::deque<std::function<void()>> m_jobs;
+        std::mutex                        m_mutex;
+        std::condition_variable           m_condition;
+        bool                              m_stopping = false;
+    };
+}  // namespace nex
@@ -0,0 +1,36 @@
+#include "nex_mapped_file.hpp"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace nex {
+    NexMappedFile::NexMappedFile(const std::string& filepath) {
+        int fd = open(filepath.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return;
+        }
+
+        struct stat info = {};
+        if (fstat(fd, &info) == 0 && info.st_size > 0) {
+            void* mapped = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+            if (mapped != MAP_FAILED) {
+                m_data = static_cast<const std::byte*>(mapped);
+                m_size = static_cast<size_t>(info.st_size);
+
+                // the whole file is consumed front to back right after mapping it
+                madvise(mapped, m_size, MADV_WILLNEED);
+            }
+        }
+
+        // the mapping stays valid after the descriptor is closed
+        close(fd);
+    }
+
+    NexMappedFile::~NexMappedFile() {
+        if (m_data != nullptr) {
+            munmap(const_cast<std::byte*>(m_data), m_size);
+        }
+    }
+}  // namespace nex
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace nex {
+    // read only memory mapping of a whole file, the pages are faulted in lazily by the kernel
+    class NexMappedFile {
+      public:
+        explicit NexMappedFile(const std::string& filepath);
+        ~NexMappedFile();
+
+        NexMappedFile(const NexMappedFile&)            = delete;
+        NexMappedFile& operator=(const NexMappedFile&) = delete;
+
+        bool isValid() const {
+            return m_data != nullptr;
+        }
+
+        const std::byte* data() const {
+            return m_data;
+        }
+
+        size_t size() const {
+            return m_size;
+        }
+
+      private:
+        const std::byte* m_data = nullptr;
+        size_t           m_size = 0;
+    };
+}  // namespace nex
@@ -0,0 +1,115 @@
+#include "nex_parallel_recorder.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <stdexcept>
+
+#include "nex_trace.hpp"
+
+namespace nex {
+    NexParallelRecorder::NexParallelRecorder(NexDevice& device, NexJobSystem& job_system) : m_device{device}, m_job_system{job_system} {
+        // parallelFor hands chunk i to one thread at a time, so one slot per chunk it can create is enough
+        uint32_t slot_count = m_job_system.getThreadCount() + 1;
+        for (auto& slots : m_slots) {
+            slots.resize(slot_count);
+            for (auto& slot : slots) {
+                slot.m_command_pool = m_device.createCommandPool();
+            }
+        }
+    }
+
+    NexParallelRecorder::~NexParallelRecorder() {
+        // destroying the pools frees their command buffers
+        for (auto& slots : m_slots) {
+            for (auto& slot : slots) {
+                vkDestroyCommandPool(m_device.device(), slot.m_command_pool, nullptr);
+            }
+        }
+    }
+
+    void NexParallelRecorder::beginFrame(int frame_index) {
+        m_frame_index = frame_index;
+        for (auto& slot : m_slots[frame_index]) {
+            vkResetCommandPool(m_device.device(), slot.m_command_pool, 0);
+            slot.m_used = 0;
+        }
+    }
+
+    void NexParallelRecorder::beginPass(VkRenderPass render_pass, VkFramebuffer framebuffer, VkExtent2D extent) {
+        m_inheritance             = {};
+        m_inheritance.sType       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+        m_inheritance.renderPass  = render_pass;
+        m_inheritance.subpass     = 0;
+        m_inheritance.framebuffer = framebuffer;
+        m_extent                  = extent;
+    }
+
+    VkCommandBuffer NexParallelRecorder::nextCommandBuffer(Slot& slot) {
+        if (slot.m_used == slot.m_command_buffers.size()) {
+            VkCommandBufferAllocateInfo alloc_info = {};
+            alloc_info.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            alloc_info.level                       = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+            alloc_info.commandPool                 = slot.m_command_pool;
+            alloc_info.commandBufferCount          = 1;
+
+            VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+            if (vkAllocateCommandBuffers(m_device.device(), &alloc_info, &command_buffer) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to allocate secondary command buffer!");
+            }
+            slot.m_command_buffers.push_back(command_buffer);
+        }
+
+        return slot.m_command_buffers[slot.m_used++];
+    }
+
+    void NexParallelRecorder::record(NexFrameInfo& frame_info, size_t draw_count, const RecordFn& record) {
+        NEX_TRACE_SCOPE("parallel record");
+        assert(m_inheritance.renderPass != VK_NULL_HANDLE && "Recording without a render pass");
+
+        std::vector<Slot>& slots       = m_slots[m_frame_index];
+        size_t             chunk_count = std::clamp<size_t>((draw_count + min_chunk_draws - 1) / min_chunk_draws, 1, slots.size());
+        size_t             chunk_size  = (draw_count + chunk_count - 1) / chunk_count;
+
+        // the buffers are taken on this thread, the slots' vectors are left alone while the chunks record
+        m_recorded.resize(chunk_count);
+        for (size_t chunk = 0; chunk < chunk_count; ++chunk) {
+            m_recorded[chunk] = nextCommandBuffer(slots[chunk]);
+        }
+
+        VkViewport viewport = {};
+        viewport.width      = static_cast<float>(m_extent.width);
+        viewport.height     = static_cast<float>(m_extent.height);
+        viewport.maxDepth   = 1.0f;
+        VkRect2D scissor    = {{0, 0}, m_extent};
+
+        m_job_system.parallelFor(static_cast<uint32_t>(chunk_count), [&](uint32_t chunk) {
+            VkCommandBuffer command_buffer = m_recorded[chunk];
+
+            VkCommandBufferBeginInfo begin_info = {};
+            begin_info.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+            begin_info.flags                    = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+            begin_info.pInheritanceInfo         = &m_inheritance;
+            if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to begin recording secondary command buffer!");
+            }
+
+            // dynamic state is not inherited from the primary
+            vkCmdSetViewport(command_buffer, 0, 1, &viewport);
+            vkCmdSetScissor(command_buffer, 0, 1, &scissor);
+
+            NexFrameInfo chunk_info{
+                frame_info.m_frame_index, frame_info.m_frame_time, command_buffer, frame_info.m_camera, frame_info.m_global_descriptor_set, frame_info.m_frame_descriptor_allocator,
+                frame_info.m_registry, frame_info.m_gpu_scene, frame_info.m_visible_entities, frame_info.m_instancer,
+            };
+
+            size_t begin = std::min(chunk * chunk_size, draw_count);
+            record(chunk_info, begin, std::min(begin + chunk_size, draw_count));
+
+            if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to record secondary command buffer!");
+            }
+        });
+
+        vkCmdExecuteCommands(frame_info.m_command_buffer, static_cast<uint32_t>(m_recorded.size()), m_recorded.data());
+    }
+}  // namespace nex
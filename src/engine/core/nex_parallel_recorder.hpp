@@ -0,0 +1,62 @@
+#pragma once
+
+#include <functional>
+#include <vector>
+
+#include "../scene/nex_frame_info.hpp"
+#include "nex_device.hpp"
+#include "nex_job_system.hpp"
+#include "nex_swapchain.hpp"
+
+namespace nex {
+    // Records the draws of a render pass on the job system. Every recording slot owns a command pool per frame in flight, so the
+    // threads share nothing while recording: each chunk of draws goes into a secondary command buffer of its own slot, and the
+    // primary executes the secondaries in chunk order once all of them are recorded.
+    class NexParallelRecorder {
+      public:
+        // below this many draws a chunk costs more to hand out than it saves
+        static constexpr size_t min_chunk_draws = 256;
+
+        using RecordFn = std::function<void(NexFrameInfo& frame_info, size_t begin, size_t end)>;
+
+        NexParallelRecorder(NexDevice& device, NexJobSystem& job_system);
+        ~NexParallelRecorder();
+
+        NexParallelRecorder(const NexParallelRecorder&)            = delete;
+        NexParallelRecorder& operator=(const NexParallelRecorder&) = delete;
+
+        // the fence of the frame slot has been waited on, so its command pools are reset wholesale
+        void beginFrame(int frame_index);
+
+        // the render pass just begun on the primary with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS, which record() continues
+        void beginPass(VkRenderPass render_pass, VkFramebuffer framebuffer, VkExtent2D extent);
+
+        // splits [0, draw_count) into chunks, calls record for each with a copy of frame_info whose command buffer belongs to the chunk's
+        // slot, then executes the secondaries on frame_info's command buffer. The secondaries start with the pass' viewport and scissor
+        // set and nothing bound, record must only read shared state, which includes not building sets from the frame's allocator
+        void record(NexFrameInfo& frame_info, size_t draw_count, const RecordFn& record);
+
+        uint32_t getSlotCount() const {
+            return static_cast<uint32_t>(m_slots[0].size());
+        }
+
+      private:
+        struct Slot {
+            VkCommandPool                m_command_pool    = VK_NULL_HANDLE;
+            std::vector<VkCommandBuffer> m_command_buffers = {};  // reused after the pool reset, grows with the passes recorded per frame
+            uint32_t                     m_used            = 0;
+        };
+
+        VkCommandBuffer nextCommandBuffer(Slot& slot);
+
+        NexDevice&    m_device;
+        NexJobSystem& m_job_system;
+
+        std::vector<Slot> m_slots[NexSwapChain::max_frames_in_flight];
+        int               m_frame_index = 0;
+
+        VkCommandBufferInheritanceInfo m_inheritance = {};
+        VkExtent2D                     m_extent      = {};
+        std::vector<VkCommandBuffer>   m_recorded    = {};  // one per chunk of the current record()
+    };
+}  // namespace nex
@@ -0,0 +1,169 @@
+#include "nex_pipeline_cache.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace nex {
+    // 64 bit FNV-1a, catches a truncated or partially overwritten file before the driver sees it
+    static uint64_t hashBytes(const std::byte* data, size_t size) {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < size; ++i) {
+            hash ^= static_cast<uint64_t>(data[i]);
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    NexPipelineCache::NexPipelineCache(VkDevice device, const VkPhysicalDeviceProperties& properties, const std::string& filepath)
+        : m_device{device}, m_properties{properties}, m_filepath{filepath} {
+        std::unique_ptr<NexMappedFile> file = {};
+        if (m_filepath.empty()) {
+            m_cold_reason = "not persisted";
+        } else {
+            file = std::make_unique<NexMappedFile>(m_filepath);
+        }
+
+        VkPipelineCacheCreateInfo create_info = {};
+        create_info.sType                     = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+        if (file && isUsable(*file)) {
+            create_info.initialDataSize = file->size() - sizeof(NexPipelineCacheHeader);
+            create_info.pInitialData    = file->data() + sizeof(NexPipelineCacheHeader);
+        }
+
+        if (vkCreatePipelineCache(m_device, &create_info, nullptr, &m_cache) == VK_SUCCESS) {
+            m_loaded_bytes = create_info.initialDataSize;
+            return;
+        }
+
+        // data that passed our checks may still be refused by the driver, an empty cache always works
+        if (create_info.initialDataSize == 0) {
+            throw std::runtime_error("Failed to create pipeline cache!");
+        }
+        m_cold_reason               = "rejected by the driver";
+        create_info.initialDataSize = 0;
+        create_info.pInitialData    = nullptr;
+        if (vkCreatePipelineCache(m_device, &create_info, nullptr, &m_cache) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create pipeline cache!");
+        }
+    }
+
+    NexPipelineCache::~NexPipelineCache() {
+        if (!m_filepath.empty() && !save()) {
+            std::cerr << "failed to write the pipeline cache to " << m_filepath << std::endl;
+        }
+        vkDestroyPipelineCache(m_device, m_cache, nullptr);
+    }
+
+    void NexPipelineCache::fillHeader(NexPipelineCacheHeader& header) const {
+        header.m_version        = version;
+        header.m_vendor_id      = m_properties.vendorID;
+        header.m_device_id      = m_properties.deviceID;
+        header.m_driver_version = m_properties.driverVersion;
+        std::memcpy(header.m_cache_uuid, m_properties.pipelineCacheUUID, VK_UUID_SIZE);
+    }
+
+    bool NexPipelineCache::isUsable(const NexMappedFile& file) {
+        if (!file.isValid()) {
+            m_cold_reason = "no cache file";
+            return false;
+        }
+        if (file.size() < sizeof(NexPipelineCacheHeader)) {
+            m_cold_reason = "truncated file";
+            return false;
+        }
+
+        NexPipelineCacheHeader header;
+        std::memcpy(&header, file.data(), sizeof(header));
+
+        NexPipelineCacheHeader expected = {};
+        fillHeader(expected);
+        if (std::memcmp(header.m_magic, expected.m_magic, sizeof(header.m_magic)) != 0 || header.m_version != expected.m_version) {
+            m_cold_reason = "not a pipeline cache of this version";
+            return false;
+        }
+
+        // drivers are only required to reject foreign data when the uuid differs, a driver update may keep the uuid but not the binaries
+        if (header.m_vendor_id != expected.m_vendor_id || header.m_device_id != expected.m_device_id || header.m_driver_version != expected.m_driver_version ||
+            std::memcmp(header.m_cache_uuid, expected.m_cache_uuid, VK_UUID_SIZE) != 0) {
+            m_cold_reason = "written by another device or driver";
+            return false;
+        }
+
+        const std::byte* data      = file.data() + sizeof(header);
+        size_t           data_size = file.size() - sizeof(header);
+        if (header.m_data_size != data_size || header.m_data_hash != hashBytes(data, data_size)) {
+            m_cold_reason = "corrupt file";
+            return false;
+        }
+
+        // the driver's own header leads the data, it has to agree with ours
+        VkPipelineCacheHeaderVersionOne driver_header;
+        if (data_size < sizeof(driver_header)) {
+            m_cold_reason = "corrupt file";
+            return false;
+        }
+        std::memcpy(&driver_header, data, sizeof(driver_header));
+        if (driver_header.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || driver_header.headerSize < sizeof(driver_header) ||
+            driver_header.vendorID != expected.m_vendor_id || driver_header.deviceID != expected.m_device_id ||
+            std::memcmp(driver_header.pipelineCacheUUID, expected.m_cache_uuid, VK_UUID_SIZE) != 0) {
+            m_cold_reason = "driver header mismatch";
+            return false;
+        }
+        return true;
+    }
+
+    bool NexPipelineCache::save() const {
+        size_t data_size = 0;
+        if (vkGetPipelineCacheData(m_device, m_cache, &data_size, nullptr) != VK_SUCCESS) {
+            return false;
+        }
+        if (data_size == 0) {
+            return true;
+        }
+        std::vector<std::byte> data(data_size);
+        if (vkGetPipelineCacheData(m_device, m_cache, &data_size, data.data()) != VK_SUCCESS) {
+            return false;
+        }
+        data.resize(data_size);
+
+        NexPipelineCacheHeader header = {};
+        fillHeader(header);
+        header.m_data_size = data_size;
+        header.m_data_hash = hashBytes(data.data(), data_size);
+
+        std::string temp_path = m_filepath + ".tmp";
+        {
+            std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+            if (!file) {
+                return false;
+            }
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data_size));
+
+            if (!file) {
+                file.close();
+                std::remove(temp_path.c_str());
+                return false;
+            }
+        }
+
+        return std::rename(temp_path.c_str(), m_filepath.c_str()) == 0;
+    }
+
+    void NexPipelineCache::printStats() const {
+        std::cout << "pipeline cache: ";
+        if (isWarm()) {
+            std::cout << "warm, " << m_loaded_bytes << " bytes loaded";
+        } else {
+            std::cout << "cold, " << m_cold_reason;
+        }
+        std::cout << ", " << getPipelineCount() << " pipelines created in " << std::fixed << std::setprecision(2) << getCreationMilliseconds() << " ms" << std::defaultfloat
+                  << std::endl;
+    }
+}  // namespace nex
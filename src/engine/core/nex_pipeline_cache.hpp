@@ -0,0 +1,80 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <string>
+
+#include "nex_mapped_file.hpp"
+
+namespace nex {
+    // on disk layout of the pipeline cache file, the driver's cache data follows the header
+    struct NexPipelineCacheHeader {
+        char     m_magic[4]                 = {'N', 'X', 'P', 'C'};
+        uint32_t m_version                  = 0;
+        uint32_t m_vendor_id                = 0;
+        uint32_t m_device_id                = 0;
+        uint32_t m_driver_version           = 0;
+        uint8_t  m_cache_uuid[VK_UUID_SIZE] = {};
+        uint32_t m_reserved                 = 0;  // spells out the padding, so equal caches write equal files
+        uint64_t m_data_size                = 0;
+        uint64_t m_data_hash                = 0;
+    };
+    static_assert(sizeof(NexPipelineCacheHeader) == 56);
+
+    // A device wide VkPipelineCache persisted across launches. The file is only handed to the driver when it was written by the same
+    // vendor, device, driver version and cache UUID, anything else starts from an empty cache and is replaced on shutdown
+    class NexPipelineCache {
+      public:
+        // bump whenever the file layout changes
+        static constexpr uint32_t version = 1;
+
+        // an empty filepath keeps the cache in memory only, every launch is then a cold one
+        NexPipelineCache(VkDevice device, const VkPhysicalDeviceProperties& properties, const std::string& filepath);
+        ~NexPipelineCache();
+
+        NexPipelineCache(const NexPipelineCache&)            = delete;
+        NexPipelineCache& operator=(const NexPipelineCache&) = delete;
+
+        VkPipelineCache getCache() const {
+            return m_cache;
+        }
+
+        // a cache loaded from disk, pipelines created against it should mostly skip compilation
+        bool isWarm() const {
+            return m_loaded_bytes > 0;
+        }
+
+        // time spent in vkCreate*Pipelines, the part of startup a warm cache shortens
+        void addPipelineCreation(uint64_t nanoseconds) {
+            m_pipelines.fetch_add(1, std::memory_order_relaxed);
+            m_creation_ns.fetch_add(nanoseconds, std::memory_order_relaxed);
+        }
+        uint32_t getPipelineCount() const {
+            return m_pipelines.load(std::memory_order_relaxed);
+        }
+        double getCreationMilliseconds() const {
+            return static_cast<double>(m_creation_ns.load(std::memory_order_relaxed)) / 1e6;
+        }
+
+        void printStats() const;
+
+        // writes to a temporary file first and renames it, so a crash never leaves a torn cache behind
+        bool save() const;
+
+      private:
+        // checks the file against this device and records why it can't be used in m_cold_reason
+        bool isUsable(const NexMappedFile& file);
+        void fillHeader(NexPipelineCacheHeader& header) const;
+
+        VkDevice                   m_device;
+        VkPhysicalDeviceProperties m_properties;
+        std::string                m_filepath;
+        VkPipelineCache            m_cache        = VK_NULL_HANDLE;
+        size_t                     m_loaded_bytes = 0;
+        std::string                m_cold_reason  = {};  // why the file on disk was not used
+
+        std::atomic<uint32_t> m_pipelines   = 0;
+        std::atomic<uint64_t> m_creation_ns = 0;
+    };
+}  // namespace nex
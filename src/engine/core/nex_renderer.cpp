@@ -2,6 +2,11 @@
 
 #include <array>
 
+#include "../graphics/nex_geometry_pool.hpp"
+#include "../graphics/nex_image_writer.hpp"
+#include "../graphics/nex_texture_table.hpp"
+#include "nex_trace.hpp"
+
 namespace nex {
     NexRenderer::NexRenderer(NexWindow& window, NexDevice& device) : m_window(window), m_device(device) {
         recreateSwapChain();
@@ -9,11 +14,13 @@ namespace nex {
     }
 
     NexRenderer::~NexRenderer() {
-        freeCommandBuffers();
+        waitIdle();
+        destroyCommandBuffers();
     }
 
     VkCommandBuffer NexRenderer::beginFrame() {
         assert(!m_is_frame_started && "Frame already in progress");
+        NEX_TRACE_SCOPE("begin frame");
 
         auto result = m_swap_chain->acquireNextImage(&m_current_image_index);
         if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_window.wasWindowResized()) {
@@ -28,27 +35,47 @@ namespace nex {
 
         m_is_frame_started = true;
 
+        // the copy this frame slot made last time around has landed
+        writeCapture(m_current_frame_index);
+
+        // the fence of this frame slot was waited on in acquireNextImage, so geometry and texture slots freed that many frames ago are no longer read
+        m_device.geometryPool().nextFrame();
+        m_device.textureTable().nextFrame();
+
+        // the pool only holds this frame's primary, which the fence says is done executing
+        vkResetCommandPool(m_device.device(), m_command_pools[m_current_frame_index], 0);
+
         auto command_buffer = getCurrentCommandBuffer();
 
         VkCommandBufferBeginInfo begin_info = {};
         begin_info.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
         if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
             throw std::runtime_error("Failed to begin recording command buffer!");
         }
 
+        // kick off anything loaded since last frame, and take ownership of whatever finished uploading
+        m_device.uploadQueue().submit();
+        m_upload_wait_value = m_device.uploadQueue().recordAcquireBarriers(command_buffer);
+
         return command_buffer;
     }
 
     void NexRenderer::endFrame() {
         assert(m_is_frame_started && "Cannot end frame when frame is not in progress");
+        NEX_TRACE_SCOPE("end frame");
 
         auto command_buffer = getCurrentCommandBuffer();
 
+        if (!m_pending_capture.empty()) {
+            recordCapture(command_buffer);
+        }
+
         if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
             throw std::runtime_error("Failed to record command buffer!");
         }
 
-        auto result = m_swap_chain->submitCommandBuffers(&command_buffer, &m_current_image_index);
+        auto result = m_swap_chain->submitCommandBuffers(&command_buffer, &m_current_image_index, m_device.uploadQueue().getTimelineSemaphore(), m_upload_wait_value);
         if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || m_window.wasWindowResized()) {
             m_window.resetWindowResizeFlag();
             recreateSwapChain();
@@ -58,9 +85,10 @@ namespace nex {
 
         m_is_frame_started    = false;
         m_current_frame_index = (m_current_frame_index + 1) % NexSwapChain::max_frames_in_flight;
+        m_frame_number++;
     }
 
-    void NexRenderer::beginSwapChainRenderPass(VkCommandBuffer command_buffer) {
+    void NexRenderer::beginSwapChainRenderPass(VkCommandBuffer command_buffer, VkSubpassContents contents) {
         assert(m_is_frame_started && "Cannot begin render pass when frame is not in progress");
         assert(command_buffer == getCurrentCommandBuffer() && "Command buffer must be the current command buffer");
 
@@ -78,7 +106,10 @@ namespace nex {
         render_pass_info.clearValueCount         = static_cast<uint32_t>(clear_values.size());
         render_pass_info.pClearValues            = clear_values.data();
 
-        vkCmdBeginRenderPass(command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+        vkCmdBeginRenderPass(command_buffer, &render_pass_info, contents);
+        if (contents == VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS) {
+            return;
+        }
 
         VkViewport viewport = {};
         viewport.x          = 0.0f;
@@ -99,10 +130,82 @@ namespace nex {
         vkCmdEndRenderPass(command_buffer);
     }
 
+    void NexRenderer::captureFrame(const std::string& filepath) {
+        assert(m_is_frame_started && "Cannot capture a frame when frame not in progress");
+        if (!isHeadless()) {
+            throw std::runtime_error("Frames can only be captured when headless!");
+        }
+        m_pending_capture = filepath;
+    }
+
+    void NexRenderer::waitIdle() {
+        vkDeviceWaitIdle(m_device.device());
+        for (int i = 0; i < NexSwapChain::max_frames_in_flight; ++i) {
+            writeCapture(i);
+        }
+    }
+
+    void NexRenderer::recordCapture(VkCommandBuffer command_buffer) {
+        VkExtent2D   extent = m_swap_chain->getSwapChainExtent();
+        VkDeviceSize size   = static_cast<VkDeviceSize>(extent.width) * extent.height * 4;
+
+        auto& capture_buffer = m_capture_buffers[m_current_frame_index];
+        if (!capture_buffer || capture_buffer->getBufferSize() < size) {
+            capture_buffer = std::make_unique<NexBuffer>(m_device, size, 1, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+            capture_buffer->map();
+        }
+
+        // the render pass left the resolved image in TRANSFER_SRC_OPTIMAL, its external dependency orders the copy after the writes
+        VkBufferImageCopy region               = {};
+        region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel       = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount     = 1;
+        region.imageExtent                     = {extent.width, extent.height, 1};
+        vkCmdCopyImageToBuffer(command_buffer, m_swap_chain->getImage(m_current_image_index), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, capture_buffer->getBuffer(), 1, &region);
+
+        VkMemoryBarrier barrier = {};
+        barrier.sType           = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask   = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask   = VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &barrier, 0, nullptr, 0, nullptr);
+
+        m_capture_paths[m_current_frame_index]   = std::move(m_pending_capture);
+        m_capture_extents[m_current_frame_index] = extent;
+        m_pending_capture.clear();
+    }
+
+    void NexRenderer::writeCapture(int frame_index) {
+        if (m_capture_paths[frame_index].empty()) {
+            return;
+        }
+
+        auto&      capture_buffer = m_capture_buffers[frame_index];
+        VkExtent2D extent         = m_capture_extents[frame_index];
+        capture_buffer->invalidate();
+
+        // the offscreen images are usually bgra, the writers want rgba
+        auto* pixels = static_cast<uint8_t*>(capture_buffer->getMappedMemory());
+        if (m_swap_chain->getSwapChainImageFormat() == VK_FORMAT_B8G8R8A8_SRGB) {
+            for (size_t i = 0; i < static_cast<size_t>(extent.width) * extent.height; ++i) {
+                std::swap(pixels[i * 4], pixels[i * 4 + 2]);
+            }
+        }
+
+        NEX_TRACE_SCOPE("write capture");
+        const std::string& path = m_capture_paths[frame_index];
+        if (path.ends_with(".png")) {
+            writePng(path, extent.width, extent.height, pixels);
+        } else {
+            writeRaw(path, extent.width, extent.height, pixels);
+        }
+        m_capture_paths[frame_index].clear();
+    }
+
     void NexRenderer::recreateSwapChain() {
         auto extent = m_window.getExtent();
 
-        while (extent.width == 0 || extent.height == 0) {
+        while (!m_window.isHeadless() && (extent.width == 0 || extent.height == 0)) {
             extent = m_window.getExtent();
             glfwWaitEvents();
         }
@@ -124,19 +227,27 @@ namespace nex {
     void NexRenderer::createCommandBuffers() {
         m_command_buffers.resize(NexSwapChain::max_frames_in_flight);
 
-        VkCommandBufferAllocateInfo alloc_info = {};
-        alloc_info.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-        alloc_info.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        alloc_info.commandPool                 = m_device.getCommandPool();
-        alloc_info.commandBufferCount          = static_cast<uint32_t>(m_command_buffers.size());
+        for (int i = 0; i < NexSwapChain::max_frames_in_flight; ++i) {
+            m_command_pools[i] = m_device.createCommandPool();
+
+            VkCommandBufferAllocateInfo alloc_info = {};
+            alloc_info.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+            alloc_info.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+            alloc_info.commandPool                 = m_command_pools[i];
+            alloc_info.commandBufferCount          = 1;
 
-        if (vkAllocateCommandBuffers(m_device.device(), &alloc_info, m_command_buffers.data()) != VK_SUCCESS) {
-            throw std::runtime_error("Failed to allocate command buffers!");
+            if (vkAllocateCommandBuffers(m_device.device(), &alloc_info, &m_command_buffers[i]) != VK_SUCCESS) {
+                throw std::runtime_error("Failed to allocate command buffers!");
+            }
         }
     }
 
-    void NexRenderer::freeCommandBuffers() {
-        vkFreeCommandBuffers(m_device.device(), m_device.getCommandPool(), static_cast<uint32_t>(m_command_buffers.size()), m_command_buffers.data());
+    void NexRenderer::destroyCommandBuffers() {
+        // destroying a pool frees its buffers
+        for (auto& command_pool : m_command_pools) {
+            vkDestroyCommandPool(m_device.device(), command_pool, nullptr);
+            command_pool = VK_NULL_HANDLE;
+        }
         m_command_buffers.clear();
     }
 
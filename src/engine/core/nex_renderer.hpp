@@ -2,7 +2,9 @@
 
 #include <cassert>
 #include <memory>
+#include <string>
 
+#include "../graphics/nex_buffer.hpp"
 #include "nex_device.hpp"
 #include "nex_swapchain.hpp"
 #include "nex_window.hpp"
@@ -24,6 +26,34 @@ namespace nex {
             return m_swap_chain->extentAspectRatio();
         }
 
+        VkExtent2D getSwapChainExtent() const {
+            return m_swap_chain->getSwapChainExtent();
+        }
+
+        // depth of the image being recorded, see NexSwapChain::getDepthImage()
+        VkImage getDepthImage() const {
+            assert(m_is_frame_started && "Cannot get depth image when frame not in progress");
+            return m_swap_chain->getDepthImage(m_current_image_index);
+        }
+
+        VkImageView getDepthImageView() const {
+            assert(m_is_frame_started && "Cannot get depth image view when frame not in progress");
+            return m_swap_chain->getDepthImageView(m_current_image_index);
+        }
+
+        VkFramebuffer getCurrentFrameBuffer() const {
+            assert(m_is_frame_started && "Cannot get frame buffer when frame not in progress");
+            return m_swap_chain->getFrameBuffer(m_current_image_index);
+        }
+
+        bool isDepthSampled() const {
+            return m_swap_chain->isDepthSampled();
+        }
+
+        VkFormat getDepthFormat() const {
+            return m_swap_chain->findDepthFormat();
+        }
+
         bool isFrameInProgress() const {
             return m_is_frame_started;
         }
@@ -38,24 +68,51 @@ namespace nex {
             return m_current_frame_index;
         }
 
+        // frames ended so far, which is the number the frame in progress gets
+        uint64_t getFrameNumber() const {
+            return m_frame_number;
+        }
+
+        bool isHeadless() const {
+            return m_swap_chain->isHeadless();
+        }
+
         VkCommandBuffer beginFrame();
         void            endFrame();
 
-        void beginSwapChainRenderPass(VkCommandBuffer command_buffer);
+        // headless only, copies the frame in progress out once it's rendered and writes it when its fence comes around again.
+        // A .png path is written as png, anything else as raw rgba rows
+        void captureFrame(const std::string& filepath);
+
+        // waits for the device, then writes the captures still in flight
+        void waitIdle();
+
+        // with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS the viewport and scissor are left to the secondaries
+        void beginSwapChainRenderPass(VkCommandBuffer command_buffer, VkSubpassContents contents = VK_SUBPASS_CONTENTS_INLINE);
         void endSwapChainRenderPass(VkCommandBuffer command_buffer);
 
       private:
         void recreateSwapChain();
         void createCommandBuffers();
-        void freeCommandBuffers();
+        void destroyCommandBuffers();
+        void recordCapture(VkCommandBuffer command_buffer);
+        void writeCapture(int frame_index);
 
         uint32_t m_current_image_index = 0;
         int      m_current_frame_index = 0;
         bool     m_is_frame_started    = false;
+        uint64_t m_upload_wait_value   = 0;
+        uint64_t m_frame_number        = 0;
 
         NexWindow&                    m_window;
         NexDevice&                    m_device;
+        VkCommandPool                 m_command_pools[NexSwapChain::max_frames_in_flight] = {};  // one primary each, reset as a whole when the frame comes around
         std::vector<VkCommandBuffer>  m_command_buffers;
         std::unique_ptr<NexSwapChain> m_swap_chain;
+
+        std::unique_ptr<NexBuffer> m_capture_buffers[NexSwapChain::max_frames_in_flight] = {};  // host visible copies of the resolved image
+        std::string                m_capture_paths[NexSwapChain::max_frames_in_flight]   = {};  // set while a frame slot's copy is in flight
+        VkExtent2D                 m_capture_extents[NexSwapChain::max_frames_in_flight] = {};
+        std::string                m_pending_capture                                     = {};  // asked for the frame being recorded
     };
 }  // namespace nex
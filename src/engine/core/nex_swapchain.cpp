@@ -7,6 +7,8 @@
 #include <limits>
 #include <stdexcept>
 
+#include "nex_trace.hpp"
+
 namespace nex {
 
     NexSwapChain::NexSwapChain(NexDevice& deviceRef, VkExtent2D extent) : m_device{deviceRef}, m_window_extent{extent} {
@@ -20,8 +22,17 @@ namespace nex {
     }
 
     void NexSwapChain::init() {
-        createSwapChain();
+        if (m_device.isHeadless()) {
+            createOffscreenImages();
+        } else {
+            createSwapChain();
+        }
         createImageViews();
+
+        // the depth is only kept past the render pass when something can sample it
+        VkSampleCountFlags depth_sample_counts = m_device.m_properties.limits.sampledImageDepthSampleCounts;
+        m_depth_sampled = (depth_sample_counts & m_device.getMaxUsableSamples()) != 0 && m_device.isFormatSupported(findDepthFormat(), VK_IMAGE_TILING_OPTIMAL, VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT);
+
         createRenderPass();
         createColorResources();
         createDepthResources();
@@ -31,7 +42,7 @@ namespace nex {
 
     NexSwapChain::~NexSwapChain() {
         for (auto image_view : m_swap_chain_image_views) {
-            vkDestroyImageView(m_device.device(), image_view, nullptr);
+            m_device.destroyImageView(image_view);
         }
         m_swap_chain_image_views.clear();
 
@@ -40,16 +51,18 @@ namespace nex {
             m_swap_chain = nullptr;
         }
 
+        for (size_t i = 0; i < m_offscreen_image_memorys.size(); i++) {
+            m_device.destroyImage(m_swap_chain_images[i], m_offscreen_image_memorys[i]);
+        }
+
         for (int i = 0; i < m_depth_images.size(); i++) {
-            vkDestroyImageView(m_device.device(), m_depth_image_views[i], nullptr);
-            vkDestroyImage(m_device.device(), m_depth_images[i], nullptr);
-            vkFreeMemory(m_device.device(), m_depth_image_memorys[i], nullptr);
+            m_device.destroyImageView(m_depth_image_views[i]);
+            m_device.destroyImage(m_depth_images[i], m_depth_image_memorys[i]);
         }
 
         for (int i = 0; i < m_color_images.size(); i++) {
-            vkDestroyImageView(m_device.device(), m_color_image_views[i], nullptr);
-            vkDestroyImage(m_device.device(), m_color_images[i], nullptr);
-            vkFreeMemory(m_device.device(), m_color_image_memorys[i], nullptr);
+            m_device.destroyImageView(m_color_image_views[i]);
+            m_device.destroyImage(m_color_images[i], m_color_image_memorys[i]);
         }
 
         for (auto framebuffer : m_swap_chain_framebuffers) {
@@ -67,8 +80,19 @@ namespace nex {
     }
 
     VkResult NexSwapChain::acquireNextImage(uint32_t* imageIndex) {
-        vkWaitForFences(m_device.device(), 1, &m_in_flight_fences[m_current_frame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+        {
+            NEX_TRACE_SCOPE("wait for frame fence");
+            vkWaitForFences(m_device.device(), 1, &m_in_flight_fences[m_current_frame], VK_TRUE, std::numeric_limits<uint64_t>::max());
+        }
 
+        // nothing to wait on for our own images, submitCommandBuffers() waits for the frame that last rendered into the one we hand out
+        if (m_device.isHeadless()) {
+            *imageIndex  = m_next_image;
+            m_next_image = (m_next_image + 1) % static_cast<uint32_t>(imageCount());
+            return VK_SUCCESS;
+        }
+
+        NEX_TRACE_SCOPE("acquire image");
         VkResult result = vkAcquireNextImageKHR(m_device.device(), m_swap_chain, std::numeric_limits<uint64_t>::max(),
                                                 m_image_available_semaphores[m_current_frame],  // must be a not signaled semaphore
                                                 VK_NULL_HANDLE, imageIndex);
@@ -76,8 +100,9 @@ namespace nex {
         return result;
     }
 
-    VkResult NexSwapChain::submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex) {
+    VkResult NexSwapChain::submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex, VkSemaphore uploadSemaphore, uint64_t uploadValue) {
         if (m_images_in_flight[*imageIndex] != VK_NULL_HANDLE) {
+            NEX_TRACE_SCOPE("wait for image fence");
             vkWaitForFences(m_device.device(), 1, &m_images_in_flight[*imageIndex], VK_TRUE, UINT64_MAX);
         }
         m_images_in_flight[*imageIndex] = m_in_flight_fences[m_current_frame];
@@ -85,22 +110,44 @@ namespace nex {
         VkSubmitInfo submit_info = {};
         submit_info.sType        = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-        VkSemaphore          wait_semaphores[] = {m_image_available_semaphores[m_current_frame]};
-        VkPipelineStageFlags wait_stages[]     = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT};
-        submit_info.waitSemaphoreCount         = 1;
-        submit_info.pWaitSemaphores            = wait_semaphores;
-        submit_info.pWaitDstStageMask          = wait_stages;
+        // the upload timeline semaphore is only waited on once uploads have landed, it makes their writes visible to this frame.
+        // Headless there is no acquire to wait on and no present to signal
+        bool                 headless          = m_device.isHeadless();
+        VkSemaphore          wait_semaphores[] = {m_image_available_semaphores[m_current_frame], uploadSemaphore};
+        VkPipelineStageFlags wait_stages[]     = {VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT};
+        uint64_t             wait_values[]     = {0, uploadValue};
+        uint64_t             signal_values[]   = {0};
+        uint32_t             first_wait        = headless ? 1 : 0;
+        submit_info.waitSemaphoreCount         = (uploadValue > 0 ? 2 : 1) - first_wait;
+        submit_info.pWaitSemaphores            = wait_semaphores + first_wait;
+        submit_info.pWaitDstStageMask          = wait_stages + first_wait;
+
+        VkTimelineSemaphoreSubmitInfo timeline_info = {};
+        timeline_info.sType                         = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timeline_info.waitSemaphoreValueCount       = submit_info.waitSemaphoreCount;
+        timeline_info.pWaitSemaphoreValues          = wait_values + first_wait;
+        timeline_info.signalSemaphoreValueCount     = headless ? 0 : 1;
+        timeline_info.pSignalSemaphoreValues        = signal_values;
+        submit_info.pNext                           = &timeline_info;
 
         submit_info.commandBufferCount = 1;
         submit_info.pCommandBuffers    = buffers;
 
         VkSemaphore signal_semaphores[]  = {m_render_finished_semaphores[m_current_frame]};
-        submit_info.signalSemaphoreCount = 1;
+        submit_info.signalSemaphoreCount = headless ? 0 : 1;
         submit_info.pSignalSemaphores    = signal_semaphores;
 
         vkResetFences(m_device.device(), 1, &m_in_flight_fences[m_current_frame]);
-        if (vkQueueSubmit(m_device.graphicsQueue(), 1, &submit_info, m_in_flight_fences[m_current_frame]) != VK_SUCCESS) {
-            throw std::runtime_error("failed to submit draw command buffer!");
+        {
+            NEX_TRACE_SCOPE("queue submit");
+            if (vkQueueSubmit(m_device.graphicsQueue(), 1, &submit_info, m_in_flight_fences[m_current_frame]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to submit draw command buffer!");
+            }
+        }
+
+        if (headless) {
+            m_current_frame = (m_current_frame + 1) % max_frames_in_flight;
+            return VK_SUCCESS;
         }
 
         VkPresentInfoKHR present_info = {};
@@ -115,7 +162,11 @@ namespace nex {
 
         present_info.pImageIndices = imageIndex;
 
-        auto result = vkQueuePresentKHR(m_device.presentQueue(), &present_info);
+        VkResult result;
+        {
+            NEX_TRACE_SCOPE("present");
+            result = vkQueuePresentKHR(m_device.presentQueue(), &present_info);
+        }
 
         m_current_frame = (m_current_frame + 1) % max_frames_in_flight;
 
@@ -182,6 +233,36 @@ namespace nex {
         m_swap_chain_extent       = extent;
     }
 
+    void NexSwapChain::createOffscreenImages() {
+        // the format a desktop surface usually picks, so both paths run the same pipelines
+        m_swap_chain_image_format = m_device.findSupportedFormat({VK_FORMAT_B8G8R8A8_SRGB, VK_FORMAT_R8G8B8A8_SRGB}, VK_IMAGE_TILING_OPTIMAL,
+                                                                 VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT | VK_FORMAT_FEATURE_TRANSFER_SRC_BIT);
+        m_swap_chain_extent       = m_window_extent;
+
+        m_swap_chain_images.resize(offscreen_image_count);
+        m_offscreen_image_memorys.resize(offscreen_image_count);
+
+        for (int i = 0; i < offscreen_image_count; i++) {
+            VkImageCreateInfo image_info{};
+            image_info.sType         = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            image_info.imageType     = VK_IMAGE_TYPE_2D;
+            image_info.extent.width  = m_swap_chain_extent.width;
+            image_info.extent.height = m_swap_chain_extent.height;
+            image_info.extent.depth  = 1;
+            image_info.mipLevels     = 1;
+            image_info.arrayLayers   = 1;
+            image_info.format        = m_swap_chain_image_format;
+            image_info.tiling        = VK_IMAGE_TILING_OPTIMAL;
+            image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            image_info.usage         = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+            image_info.samples       = VK_SAMPLE_COUNT_1_BIT;
+            image_info.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
+            image_info.flags         = 0;
+
+            m_device.createImageWithInfo(image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_swap_chain_images[i], m_offscreen_image_memorys[i]);
+        }
+    }
+
     void NexSwapChain::createImageViews() {
         m_swap_chain_image_views.resize(m_swap_chain_images.size());
         for (size_t i = 0; i < m_swap_chain_images.size(); i++) {
@@ -217,7 +298,7 @@ namespace nex {
         depth_attachment.format         = findDepthFormat();
         depth_attachment.samples        = m_device.getMaxUsableSamples();
         depth_attachment.loadOp         = VK_ATTACHMENT_LOAD_OP_CLEAR;
-        depth_attachment.storeOp        = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        depth_attachment.storeOp        = m_depth_sampled ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
         depth_attachment.stencilLoadOp  = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         depth_attachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         depth_attachment.initialLayout  = VK_IMAGE_LAYOUT_UNDEFINED;
@@ -231,7 +312,7 @@ namespace nex {
         color_attachment_resolve.stencilLoadOp           = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
         color_attachment_resolve.stencilStoreOp          = VK_ATTACHMENT_STORE_OP_DONT_CARE;
         color_attachment_resolve.initialLayout           = VK_IMAGE_LAYOUT_UNDEFINED;
-        color_attachment_resolve.finalLayout             = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+        color_attachment_resolve.finalLayout             = m_device.isHeadless() ? VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
 
         VkAttachmentReference color_attachment_ref = {};
         color_attachment_ref.attachment            = 0;
@@ -260,6 +341,22 @@ namespace nex {
         dependency.dstStageMask        = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
         dependency.dstAccessMask       = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
+        // a sampled depth may still be read by the depth pyramid build of an earlier frame
+        if (m_depth_sampled) {
+            dependency.srcStageMask |= VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+        }
+
+        // headless frames may be copied out of the resolved image right after the pass
+        VkSubpassDependency readback_dependency = {};
+        readback_dependency.srcSubpass          = 0;
+        readback_dependency.srcStageMask        = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+        readback_dependency.srcAccessMask       = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        readback_dependency.dstSubpass          = VK_SUBPASS_EXTERNAL;
+        readback_dependency.dstStageMask        = VK_PIPELINE_STAGE_TRANSFER_BIT;
+        readback_dependency.dstAccessMask       = VK_ACCESS_TRANSFER_READ_BIT;
+
+        std::array<VkSubpassDependency, 2> dependencies = {dependency, readback_dependency};
+
         std::array<VkAttachmentDescription, 3> attachments      = {color_attachment, depth_attachment, color_attachment_resolve};
         VkRenderPassCreateInfo                 render_pass_info = {};
         render_pass_info.sType                                  = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
@@ -267,8 +364,8 @@ namespace nex {
         render_pass_info.pAttachments                           = attachments.data();
         render_pass_info.subpassCount                           = 1;
         render_pass_info.pSubpasses                             = &subpass;
-        render_pass_info.dependencyCount                        = 1;
-        render_pass_info.pDependencies                          = &dependency;
+        render_pass_info.dependencyCount                        = m_device.isHeadless() ? 2 : 1;
+        render_pass_info.pDependencies                          = dependencies.data();
 
         if (vkCreateRenderPass(m_device.device(), &render_pass_info, nullptr, &m_render_pass) != VK_SUCCESS) {
             throw std::runtime_error("failed to create render pass!");
@@ -361,7 +458,7 @@ namespace nex {
             image_info.format        = depth_format;
             image_info.tiling        = VK_IMAGE_TILING_OPTIMAL;
             image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            image_info.usage         = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+            image_info.usage         = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | (m_depth_sampled ? VK_IMAGE_USAGE_SAMPLED_BIT : 0);
             image_info.samples       = m_device.getMaxUsableSamples();
             image_info.sharingMode   = VK_SHARING_MODE_EXCLUSIVE;
             image_info.flags         = 0;
@@ -11,7 +11,8 @@ namespace nex {
 
     class NexSwapChain {
       public:
-        static constexpr int max_frames_in_flight = 2;
+        static constexpr int max_frames_in_flight  = 2;
+        static constexpr int offscreen_image_count = 3;  // images a headless device renders into in turn
 
         NexSwapChain(NexDevice& deviceRef, VkExtent2D windowExtent);
         NexSwapChain(NexDevice& deviceRef, VkExtent2D windowExtent, std::shared_ptr<NexSwapChain> oldSwapChain);
@@ -29,6 +30,23 @@ namespace nex {
         VkImageView getImageView(int index) {
             return m_swap_chain_image_views[index];
         }
+        // on a headless device the resolved color ends up in TRANSFER_SRC_OPTIMAL, ready to be copied out
+        VkImage getImage(int index) {
+            return m_swap_chain_images[index];
+        }
+        bool isHeadless() const {
+            return m_device.isHeadless();
+        }
+        // only readable after the render pass when isDepthSampled(), it then ends up in DEPTH_STENCIL_ATTACHMENT_OPTIMAL with its contents stored
+        VkImage getDepthImage(int index) {
+            return m_depth_images[index];
+        }
+        VkImageView getDepthImageView(int index) {
+            return m_depth_image_views[index];
+        }
+        bool isDepthSampled() const {
+            return m_depth_sampled;
+        }
         size_t imageCount() {
             return m_swap_chain_images.size();
         }
@@ -51,7 +69,7 @@ namespace nex {
         VkFormat findDepthFormat();
 
         VkResult acquireNextImage(uint32_t* imageIndex);
-        VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex);
+        VkResult submitCommandBuffers(const VkCommandBuffer* buffers, uint32_t* imageIndex, VkSemaphore uploadSemaphore = VK_NULL_HANDLE, uint64_t uploadValue = 0);
 
         bool compareSwapFormats(const NexSwapChain& swapChain) const {
             return swapChain.m_swap_chain_image_format == m_swap_chain_image_format && swapChain.m_swap_chain_depth_format == m_swap_chain_depth_format;
@@ -60,6 +78,7 @@ namespace nex {
       private:
         void init();
         void createSwapChain();
+        void createOffscreenImages();
         void createImageViews();
         void createColorResources();
         void createDepthResources();
@@ -74,26 +93,28 @@ namespace nex {
 
         VkFormat   m_swap_chain_image_format;
         VkFormat   m_swap_chain_depth_format;
+        bool       m_depth_sampled = false;
         VkExtent2D m_swap_chain_extent;
 
         std::vector<VkFramebuffer> m_swap_chain_framebuffers;
         VkRenderPass               m_render_pass;
 
-        std::vector<VkImage>        m_depth_images;
-        std::vector<VkDeviceMemory> m_depth_image_memorys;
-        std::vector<VkImageView>    m_depth_image_views;
+        std::vector<VkImage>       m_depth_images;
+        std::vector<NexAllocation> m_depth_image_memorys;
+        std::vector<VkImageView>   m_depth_image_views;
 
-        std::vector<VkImage>        m_color_images;
-        std::vector<VkDeviceMemory> m_color_image_memorys;
-        std::vector<VkImageView>    m_color_image_views;
+        std::vector<VkImage>       m_color_images;
+        std::vector<NexAllocation> m_color_image_memorys;
+        std::vector<VkImageView>   m_color_image_views;
 
-        std::vector<VkImage>     m_swap_chain_images;
-        std::vector<VkImageView> m_swap_chain_image_views;
+        std::vector<VkImage>       m_swap_chain_images;
+        std::vector<VkImageView>   m_swap_chain_image_views;
+        std::vector<NexAllocation> m_offscreen_image_memorys;  // the swapchain images are our own when headless
 
         NexDevice& m_device;
         VkExtent2D m_window_extent;
 
-        VkSwapchainKHR                m_swap_chain;
+        VkSwapchainKHR                m_swap_chain = VK_NULL_HANDLE;
         std::shared_ptr<NexSwapChain> m_old_swap_chain;
 
         std::vector<VkSemaphore> m_image_available_semaphores;
@@ -101,6 +122,7 @@ namespace nex {
         std::vector<VkFence>     m_in_flight_fences;
         std::vector<VkFence>     m_images_in_flight;
         size_t                   m_current_frame = 0;
+        uint32_t                 m_next_image    = 0;  // headless images are handed out round robin
     };
 
 }  // namespace nex
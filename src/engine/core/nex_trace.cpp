@@ -0,0 +1,128 @@
+#include "nex_trace.hpp"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+namespace nex {
+    namespace {
+        struct ThreadBuffer {
+            std::unique_ptr<NexTraceEvent[]> m_events    = std::make_unique<NexTraceEvent[]>(NexTrace::events_per_thread);
+            std::atomic<uint64_t>            m_written   = 0;  // events ever recorded, the slot is this modulo the capacity
+            uint32_t                         m_thread_id = 0;
+            std::string                      m_name      = {};
+        };
+
+        // buffers outlive their threads so the exporter still sees the workers that already exited
+        struct TraceRegistry {
+            std::mutex                                 m_mutex;
+            std::vector<std::unique_ptr<ThreadBuffer>> m_buffers  = {};
+            uint64_t                                   m_start_ns = 0;
+        };
+
+        TraceRegistry& registry() {
+            static TraceRegistry trace_registry;
+            return trace_registry;
+        }
+
+        thread_local ThreadBuffer* t_buffer      = nullptr;
+        thread_local std::string   t_thread_name = {};
+
+        ThreadBuffer& threadBuffer() {
+            if (t_buffer == nullptr) {
+                TraceRegistry&              trace_registry = registry();
+                std::lock_guard<std::mutex> lock(trace_registry.m_mutex);
+
+                auto buffer         = std::make_unique<ThreadBuffer>();
+                buffer->m_thread_id = static_cast<uint32_t>(trace_registry.m_buffers.size()) + 1;
+                buffer->m_name      = t_thread_name;
+                t_buffer            = buffer.get();
+                trace_registry.m_buffers.push_back(std::move(buffer));
+            }
+            return *t_buffer;
+        }
+    }  // namespace
+
+    void NexTrace::setEnabled(bool enabled) {
+        if (enabled && !isEnabled()) {
+            std::lock_guard<std::mutex> lock(registry().m_mutex);
+            registry().m_start_ns = now();
+        }
+        s_enabled.store(enabled, std::memory_order_relaxed);
+    }
+
+    void NexTrace::record(const char* name, uint64_t begin_ns, uint64_t end_ns) {
+        ThreadBuffer& buffer = threadBuffer();
+        uint64_t      index  = buffer.m_written.load(std::memory_order_relaxed);
+
+        buffer.m_events[index & (events_per_thread - 1)] = {name, begin_ns, end_ns};
+        buffer.m_written.store(index + 1, std::memory_order_release);
+    }
+
+    void NexTrace::setThreadName(const std::string& name) {
+        t_thread_name = name;
+        if (t_buffer != nullptr) {
+            std::lock_guard<std::mutex> lock(registry().m_mutex);
+            t_buffer->m_name = name;
+        }
+    }
+
+    // zone names are literals from our own code, only quotes and backslashes would need escaping
+    static void writeJsonString(std::ofstream& file, const char* text) {
+        file << '"';
+        for (const char* c = text; *c != '\0'; ++c) {
+            if (*c == '"' || *c == '\\') {
+                file << '\\';
+            }
+            file << *c;
+        }
+        file << '"';
+    }
+
+    void NexTrace::writeChromeTrace(const std::string& filepath) {
+        std::ofstream file(filepath);
+        if (!file) {
+            throw std::runtime_error("Failed to open " + filepath + " for writing!");
+        }
+
+        TraceRegistry&              trace_registry = registry();
+        std::lock_guard<std::mutex> lock(trace_registry.m_mutex);
+
+        file << std::fixed << std::setprecision(3);
+        file << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+        bool     first  = true;
+        uint64_t events = 0;
+        for (const auto& buffer : trace_registry.m_buffers) {
+            if (!buffer->m_name.empty()) {
+                file << (first ? "" : ",\n") << "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": " << buffer->m_thread_id << ", \"args\": {\"name\": ";
+                writeJsonString(file, buffer->m_name.c_str());
+                file << "}}";
+                first = false;
+            }
+
+            // the ring only holds the newest events_per_thread zones
+            uint64_t written = buffer->m_written.load(std::memory_order_acquire);
+            uint64_t begin   = written > events_per_thread ? written - events_per_thread : 0;
+            for (uint64_t i = begin; i < written; ++i) {
+                const NexTraceEvent& event = buffer->m_events[i & (events_per_thread - 1)];
+                if (event.m_begin_ns < trace_registry.m_start_ns) {
+                    continue;
+                }
+
+                file << (first ? "" : ",\n") << "{\"name\": ";
+                writeJsonString(file, event.m_name);
+                file << ", \"ph\": \"X\", \"pid\": 1, \"tid\": " << buffer->m_thread_id << ", \"ts\": " << static_cast<double>(event.m_begin_ns - trace_registry.m_start_ns) / 1000.0
+                     << ", \"dur\": " << static_cast<double>(event.m_end_ns - event.m_begin_ns) / 1000.0 << "}";
+                first = false;
+                events++;
+            }
+        }
+        file << "\n]}\n";
+
+        std::cout << "trace of " << events << " zones on " << trace_registry.m_buffers.size() << " threads written to " << filepath << std::endl;
+    }
+}  // namespace nex
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// set by the NEX_ENABLE_TRACING cmake option, zones compile to nothing when 0
+#ifndef NEX_ENABLE_TRACING
+#define NEX_ENABLE_TRACING 1
+#endif
+
+namespace nex {
+    struct NexTraceEvent {
+        const char* m_name     = nullptr;  // a string literal, only the pointer is stored
+        uint64_t    m_begin_ns = 0;
+        uint64_t    m_end_ns   = 0;
+    };
+
+    // Cpu zones recorded into a ring buffer per thread. The thread that owns a buffer is its only writer, so recording is a store and a
+    // release of the write counter, no locks. A buffer is allocated the first time its thread records while tracing is enabled and keeps
+    // the last events_per_thread zones. Export once the threads are quiet, e.g. after the frame loop, an exporter racing a writer may
+    // see that writer's oldest events being overwritten.
+    class NexTrace {
+      public:
+        static constexpr uint32_t events_per_thread = 1u << 16;  // a power of two
+
+        static void setEnabled(bool enabled);
+
+        static bool isEnabled() {
+            return s_enabled.load(std::memory_order_relaxed);
+        }
+
+        static uint64_t now() {
+            return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+
+        static void record(const char* name, uint64_t begin_ns, uint64_t end_ns);
+
+        // shown as the thread's track name, cheap enough to call from threads that never record
+        static void setThreadName(const std::string& name);
+
+        // chrome://tracing and Perfetto json, complete events in microseconds since tracing was enabled
+        static void writeChromeTrace(const std::string& filepath);
+
+      private:
+        static inline std::atomic<bool> s_enabled = false;
+    };
+
+    class NexTraceScope {
+      public:
+        explicit NexTraceScope(const char* name) : m_name{NexTrace::isEnabled() ? name : nullptr}, m_begin_ns{m_name ? NexTrace::now() : 0} {}
+
+        ~NexTraceScope() {
+            if (m_name) {
+                NexTrace::record(m_name, m_begin_ns, NexTrace::now());
+            }
+        }
+
+        NexTraceScope(const NexTraceScope&)            = delete;
+        NexTraceScope& operator=(const NexTraceScope&) = delete;
+
+      private:
+        const char* m_name;
+        uint64_t    m_begin_ns;
+    };
+}  // namespace nex
+
+#if NEX_ENABLE_TRACING
+#define NEX_TRACE_CONCAT_INNER(a, b) a##b
+#define NEX_TRACE_CONCAT(a, b)       NEX_TRACE_CONCAT_INNER(a, b)
+#define NEX_TRACE_SCOPE(name)        ::nex::NexTraceScope NEX_TRACE_CONCAT(nex_trace_scope_, __LINE__)(name)
+#else
+#define NEX_TRACE_SCOPE(name) ((void)0)
+#endif
@@ -0,0 +1,376 @@
+#include "nex_upload_queue.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+#include "nex_trace.hpp"
+
+namespace nex {
+    static VkDeviceSize alignStaging(VkDeviceSize value) {
+        return (value + NexUploadQueue::staging_alignment - 1) & ~(NexUploadQueue::staging_alignment - 1);
+    }
+
+    NexUploadQueue::NexUploadQueue(VkDevice device, NexAllocator& allocator, VkQueue queue, uint32_t queue_family, uint32_t graphics_family)
+        : m_device{device}
+        , m_allocator{allocator}
+        , m_queue{queue}
+        , m_queue_family{queue_family}
+        , m_graphics_family{graphics_family} {
+        VkCommandPoolCreateInfo pool_info = {};
+        pool_info.sType                   = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_info.queueFamilyIndex        = m_queue_family;
+        pool_info.flags                   = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+        if (vkCreateCommandPool(m_device, &pool_info, nullptr, &m_command_pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload command pool!");
+        }
+
+        VkSemaphoreTypeCreateInfo type_info = {};
+        type_info.sType                     = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        type_info.semaphoreType             = VK_SEMAPHORE_TYPE_TIMELINE;
+        type_info.initialValue              = 0;
+
+        VkSemaphoreCreateInfo semaphore_info = {};
+        semaphore_info.sType                 = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphore_info.pNext                 = &type_info;
+
+        if (vkCreateSemaphore(m_device, &semaphore_info, nullptr, &m_timeline_semaphore) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create upload timeline semaphore!");
+        }
+
+        createStagingBuffer();
+    }
+
+    NexUploadQueue::~NexUploadQueue() {
+        waitIdle();
+
+        if (m_recording.m_command_buffer != VK_NULL_HANDLE) {
+            vkFreeCommandBuffers(m_device, m_command_pool, 1, &m_recording.m_command_buffer);
+        }
+        for (auto& [buffer, allocation] : m_recording.m_overflow_buffers) {
+            vkDestroyBuffer(m_device, buffer, nullptr);
+            m_allocator.free(allocation);
+        }
+
+        vkDestroyBuffer(m_device, m_staging_buffer, nullptr);
+        m_allocator.free(m_staging_allocation);
+        vkDestroySemaphore(m_device, m_timeline_semaphore, nullptr);
+        vkDestroyCommandPool(m_device, m_command_pool, nullptr);
+    }
+
+    void NexUploadQueue::createStagingBuffer() {
+        VkBufferCreateInfo buffer_info = {};
+        buffer_info.sType              = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+        buffer_info.size               = staging_capacity;
+        buffer_info.usage              = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+        buffer_info.sharingMode        = VK_SHARING_MODE_EXCLUSIVE;
+
+        if (vkCreateBuffer(m_device, &buffer_info, nullptr, &m_staging_buffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create staging buffer!");
+        }
+
+        VkMemoryRequirements mem_requirements;
+        vkGetBufferMemoryRequirements(m_device, m_staging_buffer, &mem_requirements);
+
+        m_staging_allocation = m_allocator.allocate(mem_requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true);
+        vkBindBufferMemory(m_device, m_staging_buffer, m_staging_allocation.m_memory, m_staging_allocation.m_offset);
+    }
+
+    void NexUploadQueue::beginRecording() {
+        if (m_recording.m_command_buffer != VK_NULL_HANDLE) {
+            return;
+        }
+
+        VkCommandBufferAllocateInfo alloc_info = {};
+        alloc_info.sType                       = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        alloc_info.level                       = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        alloc_info.commandPool                 = m_command_pool;
+        alloc_info.commandBufferCount          = 1;
+
+        if (vkAllocateCommandBuffers(m_device, &alloc_info, &m_recording.m_command_buffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to allocate upload command buffer!");
+        }
+
+        VkCommandBufferBeginInfo begin_info = {};
+        begin_info.sType                    = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags                    = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+        vkBeginCommandBuffer(m_recording.m_command_buffer, &begin_info);
+        m_recording.m_value = m_submitted_value + 1;
+    }
+
+    bool NexUploadQueue::tryAllocateRing(VkDeviceSize size, VkDeviceSize& offset) {
+        // an empty ring starts over at 0, unless a batch still holds an end offset that retiring it would move the tail to
+        bool ring_referenced = m_recording.m_uses_ring || std::any_of(m_in_flight.begin(), m_in_flight.end(), [](const Batch& batch) { return batch.m_uses_ring; });
+        if (m_staging_used == 0 && !ring_referenced) {
+            m_staging_head = 0;
+            m_staging_tail = 0;
+        }
+
+        VkDeviceSize aligned = alignStaging(m_staging_head);
+
+        // head == tail is ambiguous, used tells an empty ring from a full one
+        if (m_staging_head > m_staging_tail || m_staging_used == 0) {
+            if (aligned + size <= staging_capacity) {
+                offset = aligned;
+                m_staging_used += aligned + size - m_staging_head;
+                m_staging_head = aligned + size;
+                return true;
+            }
+            if (size <= m_staging_tail) {
+                // wrap around, the skipped tail end of the ring is released together with this batch
+                offset = 0;
+                m_staging_used += staging_capacity - m_staging_head + size;
+                m_staging_head = size;
+                return true;
+            }
+            return false;
+        }
+
+        if (aligned + size <= m_staging_tail) {
+            offset = aligned;
+            m_staging_used += aligned + size - m_staging_head;
+            m_staging_head = aligned + size;
+            return true;
+        }
+        return false;
+    }
+
+    void* NexUploadQueue::allocateStaging(VkDeviceSize size, VkBuffer& buffer, VkDeviceSize& offset) {
+        if (size > staging_capacity) {
+            // too big for the ring, give it a throwaway buffer that is released with its batch
+            VkBufferCreateInfo buffer_info = {};
+            buffer_info.sType              = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            buffer_info.size               = size;
+            buffer_info.usage              = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+            buffer_info.sharingMode        = VK_SHARING_MODE_EXCLUSIVE;
+
+            if (vkCreateBuffer(m_device, &buffer_info, nullptr, &buffer) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create staging buffer!");
+            }
+
+            VkMemoryRequirements mem_requirements;
+            vkGetBufferMemoryRequirements(m_device, buffer, &mem_requirements);
+
+            NexAllocation allocation = m_allocator.allocate(mem_requirements, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, true, NexAllocationStrategy::linear);
+            vkBindBufferMemory(m_device, buffer, allocation.m_memory, allocation.m_offset);
+
+            m_recording.m_overflow_buffers.emplace_back(buffer, allocation);
+            offset = 0;
+            return allocation.m_mapped;
+        }
+
+        while (!tryAllocateRing(size, offset)) {
+            // the ring is full of data the GPU hasn't consumed yet, push what we have and wait for the oldest batch
+            submit();
+            if (m_in_flight.empty()) {
+                throw std::runtime_error("staging ring exhausted with no uploads in flight!");
+            }
+
+            VkSemaphoreWaitInfo wait_info = {};
+            wait_info.sType               = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+            wait_info.semaphoreCount      = 1;
+            wait_info.pSemaphores         = &m_timeline_semaphore;
+            wait_info.pValues             = &m_in_flight.front().m_value;
+            vkWaitSemaphores(m_device, &wait_info, std::numeric_limits<uint64_t>::max());
+            collect();
+        }
+
+        m_recording.m_uses_ring = true;
+        buffer                  = m_staging_buffer;
+        return static_cast<char*>(m_staging_allocation.m_mapped) + offset;
+    }
+
+    NexUploadHandle NexUploadQueue::uploadBuffer(VkBuffer buffer, const void* data, VkDeviceSize size, VkDeviceSize dst_offset, VkPipelineStageFlags dst_stage,
+                                                 VkAccessFlags dst_access) {
+        VkBuffer     staging_buffer;
+        VkDeviceSize staging_offset;
+        void*        staging = allocateStaging(size, staging_buffer, staging_offset);
+        memcpy(staging, data, size);
+
+        beginRecording();
+
+        VkBufferCopy copy_region = {};
+        copy_region.srcOffset    = staging_offset;
+        copy_region.dstOffset    = dst_offset;
+        copy_region.size         = size;
+        vkCmdCopyBuffer(m_recording.m_command_buffer, staging_buffer, buffer, 1, &copy_region);
+
+        if (hasDedicatedQueue()) {
+            // queue family ownership transfer: release here, the matching acquire is recorded on the graphics queue
+            VkBufferMemoryBarrier barrier = {};
+            barrier.sType                 = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            barrier.srcAccessMask         = VK_ACCESS_TRANSFER_WRITE_BIT;
+            barrier.dstAccessMask         = 0;
+            barrier.srcQueueFamilyIndex   = m_queue_family;
+            barrier.dstQueueFamilyIndex   = m_graphics_family;
+            barrier.buffer                = buffer;
+            barrier.offset                = dst_offset;
+            barrier.size                  = size;
+            vkCmdPipelineBarrier(m_recording.m_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = dst_access;
+            m_recording.m_buffer_acquires.push_back(barrier);
+            m_recording.m_acquire_stages |= dst_stage;
+        }
+
+        return {m_recording.m_value};
+    }
+
+    NexUploadHandle NexUploadQueue::uploadImage(VkImage image, const void* data, VkDeviceSize size, VkExtent3D extent, uint32_t mip_levels, uint32_t layer_count) {
+        VkBuffer     staging_buffer;
+        VkDeviceSize staging_offset;
+        void*        staging = allocateStaging(size, staging_buffer, staging_offset);
+        memcpy(staging, data, size);
+
+        beginRecording();
+
+        VkImageMemoryBarrier barrier            = {};
+        barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout                       = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout                       = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcAccessMask                   = 0;
+        barrier.dstAccessMask                   = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image                           = image;
+        barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel   = 0;
+        barrier.subresourceRange.levelCount     = mip_levels;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount     = layer_count;
+        vkCmdPipelineBarrier(m_recording.m_command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        VkBufferImageCopy region               = {};
+        region.bufferOffset                    = staging_offset;
+        region.bufferRowLength                 = 0;
+        region.bufferImageHeight               = 0;
+        region.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel       = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount     = layer_count;
+        region.imageOffset                     = {0, 0, 0};
+        region.imageExtent                     = extent;
+        vkCmdCopyBufferToImage(m_recording.m_command_buffer, staging_buffer, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &region);
+
+        barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+
+        if (hasDedicatedQueue()) {
+            // the layout transition happens as part of the ownership transfer, release and acquire must match
+            barrier.dstAccessMask       = 0;
+            barrier.srcQueueFamilyIndex = m_queue_family;
+            barrier.dstQueueFamilyIndex = m_graphics_family;
+            vkCmdPipelineBarrier(m_recording.m_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+            barrier.srcAccessMask = 0;
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            m_recording.m_image_acquires.push_back(barrier);
+            m_recording.m_acquire_stages |= VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+        } else {
+            barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+            vkCmdPipelineBarrier(m_recording.m_command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        }
+
+        return {m_recording.m_value};
+    }
+
+    void NexUploadQueue::submit() {
+        NEX_TRACE_SCOPE("upload submit");
+        if (m_recording.m_command_buffer == VK_NULL_HANDLE) {
+            return;
+        }
+
+        if (vkEndCommandBuffer(m_recording.m_command_buffer) != VK_SUCCESS) {
+            throw std::runtime_error("failed to record upload command buffer!");
+        }
+
+        m_submitted_value = m_recording.m_value;
+
+        VkTimelineSemaphoreSubmitInfo timeline_info = {};
+        timeline_info.sType                         = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+        timeline_info.signalSemaphoreValueCount     = 1;
+        timeline_info.pSignalSemaphoreValues        = &m_submitted_value;
+
+        VkSubmitInfo submit_info         = {};
+        submit_info.sType                = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.pNext                = &timeline_info;
+        submit_info.commandBufferCount   = 1;
+        submit_info.pCommandBuffers      = &m_recording.m_command_buffer;
+        submit_info.signalSemaphoreCount = 1;
+        submit_info.pSignalSemaphores    = &m_timeline_semaphore;
+
+        if (vkQueueSubmit(m_queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS) {
+            throw std::runtime_error("failed to submit upload command buffer!");
+        }
+
+        m_recording.m_staging_end = m_staging_head;
+        m_in_flight.push_back(std::move(m_recording));
+        m_recording = {};
+    }
+
+    void NexUploadQueue::retire(Batch& batch) {
+        vkFreeCommandBuffers(m_device, m_command_pool, 1, &batch.m_command_buffer);
+        for (auto& [buffer, allocation] : batch.m_overflow_buffers) {
+            vkDestroyBuffer(m_device, buffer, nullptr);
+            m_allocator.free(allocation);
+        }
+
+        // a batch of overflow buffers only never took ring space, its end offset may predate a rewind
+        if (batch.m_uses_ring) {
+            VkDeviceSize released = batch.m_staging_end >= m_staging_tail ? batch.m_staging_end - m_staging_tail : staging_capacity - m_staging_tail + batch.m_staging_end;
+            m_staging_used -= std::min(released, m_staging_used);
+            m_staging_tail = batch.m_staging_end;
+        }
+
+        m_pending_buffer_acquires.insert(m_pending_buffer_acquires.end(), batch.m_buffer_acquires.begin(), batch.m_buffer_acquires.end());
+        m_pending_image_acquires.insert(m_pending_image_acquires.end(), batch.m_image_acquires.begin(), batch.m_image_acquires.end());
+        m_pending_acquire_stages |= batch.m_acquire_stages;
+        m_completed_value = batch.m_value;
+    }
+
+    void NexUploadQueue::collect() {
+        uint64_t value = 0;
+        vkGetSemaphoreCounterValue(m_device, m_timeline_semaphore, &value);
+
+        while (!m_in_flight.empty() && m_in_flight.front().m_value <= value) {
+            retire(m_in_flight.front());
+            m_in_flight.pop_front();
+        }
+    }
+
+    uint64_t NexUploadQueue::recordAcquireBarriers(VkCommandBuffer command_buffer) {
+        collect();
+
+        if (!m_pending_buffer_acquires.empty() || !m_pending_image_acquires.empty()) {
+            vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, m_pending_acquire_stages, 0, 0, nullptr, static_cast<uint32_t>(m_pending_buffer_acquires.size()),
+                                 m_pending_buffer_acquires.data(), static_cast<uint32_t>(m_pending_image_acquires.size()), m_pending_image_acquires.data());
+            m_pending_buffer_acquires.clear();
+            m_pending_image_acquires.clear();
+            m_pending_acquire_stages = 0;
+        }
+
+        // the frame waits on this value, which has already been reached, purely for the memory dependency
+        m_acquired_value = m_completed_value;
+        return m_completed_value;
+    }
+
+    void NexUploadQueue::waitIdle() {
+        submit();
+        if (m_in_flight.empty()) {
+            return;
+        }
+
+        VkSemaphoreWaitInfo wait_info = {};
+        wait_info.sType               = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        wait_info.semaphoreCount      = 1;
+        wait_info.pSemaphores         = &m_timeline_semaphore;
+        wait_info.pValues             = &m_submitted_value;
+        vkWaitSemaphores(m_device, &wait_info, std::numeric_limits<uint64_t>::max());
+        collect();
+    }
+}  // namespace nex
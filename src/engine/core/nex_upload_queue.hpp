@@ -0,0 +1,92 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <deque>
+#include <vector>
+
+#include "nex_allocator.hpp"
+
+namespace nex {
+    // The timeline value of the batch an upload was recorded into, 0 means there is nothing to wait for
+    struct NexUploadHandle {
+        uint64_t m_value = 0;
+    };
+
+    class NexUploadQueue {
+      public:
+        static constexpr VkDeviceSize staging_capacity  = 32ull * 1024 * 1024;
+        static constexpr VkDeviceSize staging_alignment = 16;
+
+        NexUploadQueue(VkDevice device, NexAllocator& allocator, VkQueue queue, uint32_t queue_family, uint32_t graphics_family);
+        ~NexUploadQueue();
+
+        NexUploadQueue(const NexUploadQueue&)            = delete;
+        NexUploadQueue& operator=(const NexUploadQueue&) = delete;
+
+        NexUploadHandle uploadBuffer(VkBuffer buffer, const void* data, VkDeviceSize size, VkDeviceSize dst_offset, VkPipelineStageFlags dst_stage, VkAccessFlags dst_access);
+        NexUploadHandle uploadImage(VkImage image, const void* data, VkDeviceSize size, VkExtent3D extent, uint32_t mip_levels = 1, uint32_t layer_count = 1);
+
+        void     submit();
+        uint64_t recordAcquireBarriers(VkCommandBuffer command_buffer);
+        void     waitIdle();
+
+        // resident once the batch finished and a frame command buffer acquired it, which is when renderers may use it
+        bool isResident(NexUploadHandle handle) const {
+            return handle.m_value <= m_acquired_value;
+        }
+
+        VkSemaphore getTimelineSemaphore() const {
+            return m_timeline_semaphore;
+        }
+
+        bool hasDedicatedQueue() const {
+            return m_queue_family != m_graphics_family;
+        }
+
+      private:
+        struct Batch {
+            uint64_t                                        m_value          = 0;
+            VkCommandBuffer                                 m_command_buffer = VK_NULL_HANDLE;
+            VkDeviceSize                                    m_staging_end    = 0;      // only meaningful when m_uses_ring
+            bool                                            m_uses_ring      = false;  // false when everything went to overflow buffers
+            std::vector<std::pair<VkBuffer, NexAllocation>> m_overflow_buffers;
+            std::vector<VkBufferMemoryBarrier>              m_buffer_acquires;
+            std::vector<VkImageMemoryBarrier>               m_image_acquires;
+            VkPipelineStageFlags                            m_acquire_stages = 0;
+        };
+
+        void  createStagingBuffer();
+        void  beginRecording();
+        void* allocateStaging(VkDeviceSize size, VkBuffer& buffer, VkDeviceSize& offset);
+        bool  tryAllocateRing(VkDeviceSize size, VkDeviceSize& offset);
+        void  collect();
+        void  retire(Batch& batch);
+
+        VkDevice      m_device;
+        NexAllocator& m_allocator;
+        VkQueue       m_queue;
+        uint32_t      m_queue_family;
+        uint32_t      m_graphics_family;
+
+        VkCommandPool m_command_pool       = VK_NULL_HANDLE;
+        VkSemaphore   m_timeline_semaphore = VK_NULL_HANDLE;
+
+        VkBuffer      m_staging_buffer     = VK_NULL_HANDLE;
+        NexAllocation m_staging_allocation = {};
+        VkDeviceSize  m_staging_head       = 0;
+        VkDeviceSize  m_staging_tail       = 0;
+        VkDeviceSize  m_staging_used       = 0;
+
+        Batch             m_recording = {};
+        std::deque<Batch> m_in_flight;
+
+        std::vector<VkBufferMemoryBarrier> m_pending_buffer_acquires;
+        std::vector<VkImageMemoryBarrier>  m_pending_image_acquires;
+        VkPipelineStageFlags               m_pending_acquire_stages = 0;
+
+        uint64_t m_submitted_value = 0;
+        uint64_t m_completed_value = 0;
+        uint64_t m_acquired_value  = 0;
+    };
+}  // namespace nex
@@ -2,6 +2,8 @@
 
 #include <stdexcept>
 
+#include "nex_trace.hpp"
+
 namespace nex {
 
     static void keyCallback(GLFWwindow* window, int key, int scancode, int action, int mods) {
@@ -10,15 +12,24 @@ namespace nex {
         }
     }
 
-    NexWindow::NexWindow(const std::string& name, int width, int height) : m_width(width), m_height(height), m_window_name(name) {
-        initWindow();
+    NexWindow::NexWindow(const std::string& name, int width, int height, bool headless) : m_width(width), m_height(height), m_window_name(name) {
+        if (!headless) {
+            initWindow();
+        }
     }
 
     NexWindow::~NexWindow() {
         if (m_window) {
             glfwDestroyWindow(m_window);
+            glfwTerminate();
+        }
+    }
+
+    void NexWindow::pollEvents() {
+        NEX_TRACE_SCOPE("poll events");
+        if (m_window) {
+            glfwPollEvents();
         }
-        glfwTerminate();
     }
 
     void NexWindow::initWindow() {
@@ -38,6 +49,12 @@ namespace nex {
         glfwSetFramebufferSizeCallback(m_window, framebufferResizeCallback);
     }
 
+    void NexWindow::setTitle(const std::string& title) {
+        if (m_window) {
+            glfwSetWindowTitle(m_window, title.c_str());
+        }
+    }
+
     void NexWindow::createWindowSurface(VkInstance instance, VkSurfaceKHR* surface) {
         if (glfwCreateWindowSurface(instance, m_window, nullptr, surface) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create window surface");
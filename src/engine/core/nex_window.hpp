@@ -8,16 +8,28 @@
 namespace nex {
     class NexWindow {
       public:
-        NexWindow(const std::string& name, int width, int height);
+        // a headless window never initializes glfw, it only carries the extent the offscreen targets are created with
+        NexWindow(const std::string& name, int width, int height, bool headless = false);
         ~NexWindow();
 
         NexWindow(const NexWindow&)            = delete;
         NexWindow& operator=(const NexWindow&) = delete;
 
         bool shouldClose() const {
-            return glfwWindowShouldClose(m_window);
+            return m_window ? glfwWindowShouldClose(m_window) : m_close_requested;
         }
 
+        void requestClose() {
+            m_close_requested = true;
+        }
+
+        bool isHeadless() const {
+            return m_window == nullptr;
+        }
+
+        void pollEvents();
+        void setTitle(const std::string& title);
+
         VkExtent2D getExtent() const {
             return {static_cast<uint32_t>(m_width), static_cast<uint32_t>(m_height)};
         }
@@ -44,8 +56,9 @@ namespace nex {
         int  m_width;
         int  m_height;
         bool m_framebuffer_resized = false;
+        bool m_close_requested     = false;
 
         std::string m_window_name;
-        GLFWwindow* m_window;
+        GLFWwindow* m_window = nullptr;
     };
 }  // namespace nex
@@ -29,7 +29,7 @@ namespace nex {
     }
 
     NexBuffer::NexBuffer(NexDevice& device, VkDeviceSize instanceSize, uint32_t instanceCount, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags,
-                         VkDeviceSize minOffsetAlignment)
+                         VkDeviceSize minOffsetAlignment, NexAllocationStrategy allocationStrategy)
         : m_device{device}
         , m_instance_count{instanceCount}
         , m_instance_size{instanceSize}
@@ -37,39 +37,42 @@ namespace nex {
         , m_memory_property_flags{memoryPropertyFlags} {
         m_alignment_size = getAlignment(instanceSize, minOffsetAlignment);
         m_buffer_size    = m_alignment_size * instanceCount;
-        device.createBuffer(m_buffer_size, usageFlags, memoryPropertyFlags, m_buffer, m_memory);
+        device.createBuffer(m_buffer_size, usageFlags, memoryPropertyFlags, m_buffer, m_allocation, allocationStrategy);
     }
 
     NexBuffer::~NexBuffer() {
         unmap();
-        vkDestroyBuffer(m_device.device(), m_buffer, nullptr);
-        vkFreeMemory(m_device.device(), m_memory, nullptr);
+        m_device.destroyBuffer(m_buffer, m_allocation);
     }
 
     /**
      * Map a memory range of this buffer. If successful, mapped points to the specified buffer range.
      *
-     * @param size (Optional) Size of the memory range to map. Pass VK_WHOLE_SIZE to map the complete
-     * buffer range.
+     * @note Host visible memory blocks are persistently mapped by the allocator, so this only hands out
+     * a pointer into the block and never calls vkMapMemory
+     *
+     * @param size Unused, the whole allocation is always mapped. Kept so callers can still pass the range
+     * they write to.
      * @param offset (Optional) Byte offset from beginning
      *
      * @return VkResult of the buffer mapping call
      */
-    VkResult NexBuffer::map(VkDeviceSize size, VkDeviceSize offset) {
-        assert(m_buffer && m_memory && "Called map on buffer before create");
-        return vkMapMemory(m_device.device(), m_memory, offset, size, 0, &m_mapped);
+    VkResult NexBuffer::map([[maybe_unused]] VkDeviceSize size, VkDeviceSize offset) {
+        assert(m_buffer && m_allocation.m_memory && "Called map on buffer before create");
+        if (m_allocation.m_mapped == nullptr) {
+            return VK_ERROR_MEMORY_MAP_FAILED;
+        }
+        m_mapped = static_cast<char*>(m_allocation.m_mapped) + offset;
+        return VK_SUCCESS;
     }
 
     /**
      * Unmap a mapped memory range
      *
-     * @note Does not return a result as vkUnmapMemory can't fail
+     * @note The underlying block stays mapped until the allocator releases it
      */
     void NexBuffer::unmap() {
-        if (m_mapped) {
-            vkUnmapMemory(m_device.device(), m_memory);
-            m_mapped = nullptr;
-        }
+        m_mapped = nullptr;
     }
 
     /**
@@ -105,12 +108,7 @@ namespace nex {
      * @return VkResult of the flush call
      */
     VkResult NexBuffer::flush(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mapped_range = {};
-        mapped_range.sType               = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mapped_range.memory              = m_memory;
-        mapped_range.offset              = offset;
-        mapped_range.size                = size;
-        return vkFlushMappedMemoryRanges(m_device.device(), 1, &mapped_range);
+        return m_device.allocator().flush(m_allocation, size, offset);
     }
 
     /**
@@ -125,12 +123,7 @@ namespace nex {
      * @return VkResult of the invalidate call
      */
     VkResult NexBuffer::invalidate(VkDeviceSize size, VkDeviceSize offset) {
-        VkMappedMemoryRange mapped_range = {};
-        mapped_range.sType               = VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE;
-        mapped_range.memory              = m_memory;
-        mapped_range.offset              = offset;
-        mapped_range.size                = size;
-        return vkInvalidateMappedMemoryRanges(m_device.device(), 1, &mapped_range);
+        return m_device.allocator().invalidate(m_allocation, size, offset);
     }
 
     /**
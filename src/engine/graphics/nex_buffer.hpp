@@ -5,7 +5,8 @@
 namespace nex {
     class NexBuffer {
       public:
-        NexBuffer(NexDevice& device, VkDeviceSize instanceSize, uint32_t instanceCount, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize minOffsetAlignment = 1);
+        NexBuffer(NexDevice& device, VkDeviceSize instanceSize, uint32_t instanceCount, VkBufferUsageFlags usageFlags, VkMemoryPropertyFlags memoryPropertyFlags, VkDeviceSize minOffsetAlignment = 1,
+                  NexAllocationStrategy allocationStrategy = NexAllocationStrategy::buddy);
         ~NexBuffer();
 
         NexBuffer(const NexBuffer&)            = delete;
@@ -56,13 +57,17 @@ namespace nex {
             return m_buffer_size;
         }
 
+        const NexAllocation& getAllocation() const {
+            return m_allocation;
+        }
+
       private:
         static VkDeviceSize getAlignment(VkDeviceSize instanceSize, VkDeviceSize minOffsetAlignment);
 
-        NexDevice&     m_device;
-        void*          m_mapped = nullptr;
-        VkBuffer       m_buffer = VK_NULL_HANDLE;
-        VkDeviceMemory m_memory = VK_NULL_HANDLE;
+        NexDevice&    m_device;
+        void*         m_mapped     = nullptr;
+        VkBuffer      m_buffer     = VK_NULL_HANDLE;
+        NexAllocation m_allocation = {};
 
         VkDeviceSize          m_buffer_size;
         uint32_t              m_instance_count;
@@ -0,0 +1,255 @@
+#include "nex_depth_pyramid.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <stdexcept>
+
+namespace nex {
+    // 16 levels cover a 65536 pixel wide depth
+    static constexpr uint32_t max_levels = 16;
+    static constexpr uint32_t group_size = 8;
+
+    struct DepthPyramidPushConstantsData {
+        int32_t m_source_size[2]      = {};
+        int32_t m_destination_size[2] = {};
+    };
+
+    NexDepthPyramid::NexDepthPyramid(NexDevice& device) : m_device{device} {
+        m_set_layout = NexDescriptorSetLayout::Builder(m_device)
+                           .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+                           .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, VK_SHADER_STAGE_COMPUTE_BIT)
+                           .build();
+        m_descriptor_pool = NexDescriptorPool::Builder(m_device)
+                                .setMaxSets(NexSwapChain::max_frames_in_flight + max_levels)
+                                .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, NexSwapChain::max_frames_in_flight + max_levels)
+                                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, NexSwapChain::max_frames_in_flight + max_levels)
+                                .build();
+
+        VkSamplerCreateInfo sampler_info = {};
+        sampler_info.sType               = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+        sampler_info.magFilter           = VK_FILTER_NEAREST;
+        sampler_info.minFilter           = VK_FILTER_NEAREST;
+        sampler_info.mipmapMode          = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+        sampler_info.addressModeU        = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        sampler_info.addressModeV        = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        sampler_info.addressModeW        = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+        sampler_info.minLod              = 0.0f;
+        sampler_info.maxLod              = VK_LOD_CLAMP_NONE;
+
+        if (vkCreateSampler(m_device.device(), &sampler_info, nullptr, &m_sampler) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create depth pyramid sampler!");
+        }
+
+        createPipelines();
+    }
+
+    NexDepthPyramid::~NexDepthPyramid() {
+        destroyImage();
+        vkDestroyPipelineLayout(m_device.device(), m_pipeline_layout, nullptr);
+        m_device.destroySampler(m_sampler);
+    }
+
+    void NexDepthPyramid::createPipelines() {
+        VkPushConstantRange push_constant_range = {};
+        push_constant_range.stageFlags          = VK_SHADER_STAGE_COMPUTE_BIT;
+        push_constant_range.offset              = 0;
+        push_constant_range.size                = sizeof(DepthPyramidPushConstantsData);
+
+        VkDescriptorSetLayout set_layout = m_set_layout->getDescriptorSetLayout();
+
+        VkPipelineLayoutCreateInfo pipeline_layout_info = {};
+        pipeline_layout_info.sType                      = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipeline_layout_info.setLayoutCount             = 1;
+        pipeline_layout_info.pSetLayouts                = &set_layout;
+        pipeline_layout_info.pushConstantRangeCount     = 1;
+        pipeline_layout_info.pPushConstantRanges        = &push_constant_range;
+
+        if (vkCreatePipelineLayout(m_device.device(), &pipeline_layout_info, nullptr, &m_pipeline_layout) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create pipeline layout!");
+        }
+
+        m_resolve_pipeline = std::make_unique<NexComputePipeline>(m_device, "./shaders_compiled/depth_pyramid_resolve.comp.spv", m_pipeline_layout);
+        m_reduce_pipeline  = std::make_unique<NexComputePipeline>(m_device, "./shaders_compiled/depth_pyramid_reduce.comp.spv", m_pipeline_layout);
+    }
+
+    void NexDepthPyramid::createImage(VkExtent2D depth_extent) {
+        m_depth_extent = depth_extent;
+
+        VkExtent2D extent = {std::max(depth_extent.width / 2, 1u), std::max(depth_extent.height / 2, 1u)};
+        uint32_t   levels = std::min(static_cast<uint32_t>(std::bit_width(std::max(extent.width, extent.height))), max_levels);
+
+        VkImageCreateInfo image_info = {};
+        image_info.sType             = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        image_info.imageType         = VK_IMAGE_TYPE_2D;
+        image_info.extent.width      = extent.width;
+        image_info.extent.height     = extent.height;
+        image_info.extent.depth      = 1;
+        image_info.mipLevels         = levels;
+        image_info.arrayLayers       = 1;
+        image_info.format            = VK_FORMAT_R32_SFLOAT;
+        image_info.tiling            = VK_IMAGE_TILING_OPTIMAL;
+        image_info.initialLayout     = VK_IMAGE_LAYOUT_UNDEFINED;
+        image_info.usage             = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+        image_info.samples           = VK_SAMPLE_COUNT_1_BIT;
+        image_info.sharingMode       = VK_SHARING_MODE_EXCLUSIVE;
+
+        m_device.createImageWithInfo(image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_image, m_allocation);
+
+        VkImageViewCreateInfo view_info           = {};
+        view_info.sType                           = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        view_info.image                           = m_image;
+        view_info.viewType                        = VK_IMAGE_VIEW_TYPE_2D;
+        view_info.format                          = VK_FORMAT_R32_SFLOAT;
+        view_info.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        view_info.subresourceRange.baseMipLevel   = 0;
+        view_info.subresourceRange.levelCount     = levels;
+        view_info.subresourceRange.baseArrayLayer = 0;
+        view_info.subresourceRange.layerCount     = 1;
+
+        if (vkCreateImageView(m_device.device(), &view_info, nullptr, &m_view) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create depth pyramid view!");
+        }
+
+        m_level_views.resize(levels);
+        m_level_extents.resize(levels);
+        for (uint32_t level = 0; level < levels; ++level) {
+            view_info.subresourceRange.baseMipLevel = level;
+            view_info.subresourceRange.levelCount   = 1;
+            if (vkCreateImageView(m_device.device(), &view_info, nullptr, &m_level_views[level]) != VK_SUCCESS) {
+                throw std::runtime_error("failed to create depth pyramid view!");
+            }
+            m_level_extents[level] = {std::max(extent.width >> level, 1u), std::max(extent.height >> level, 1u)};
+        }
+
+        // the level sets never change, the depth sets are written by every build
+        m_level_sets.resize(levels - 1);
+        for (uint32_t level = 0; level + 1 < levels; ++level) {
+            VkDescriptorImageInfo source      = {m_sampler, m_level_views[level], VK_IMAGE_LAYOUT_GENERAL};
+            VkDescriptorImageInfo destination = {VK_NULL_HANDLE, m_level_views[level + 1], VK_IMAGE_LAYOUT_GENERAL};
+            NexDescriptorWriter(*m_set_layout, *m_descriptor_pool).writeImage(0, &source).writeImage(1, &destination).build(m_level_sets[level]);
+        }
+        for (auto& set : m_depth_sets) {
+            m_descriptor_pool->allocateDescriptor(m_set_layout->getDescriptorSetLayout(), set);
+        }
+
+        // GENERAL from here on, so the culling pass can bind the pyramid before the first build
+        VkCommandBuffer command_buffer = m_device.beginSingleTimeCommands();
+
+        VkImageMemoryBarrier barrier            = {};
+        barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        barrier.oldLayout                       = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout                       = VK_IMAGE_LAYOUT_GENERAL;
+        barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image                           = m_image;
+        barrier.subresourceRange.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
+        barrier.subresourceRange.baseMipLevel   = 0;
+        barrier.subresourceRange.levelCount     = levels;
+        barrier.subresourceRange.baseArrayLayer = 0;
+        barrier.subresourceRange.layerCount     = 1;
+        barrier.srcAccessMask                   = 0;
+        barrier.dstAccessMask                   = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+        m_device.endSingleTimeCommands(command_buffer);
+    }
+
+    void NexDepthPyramid::destroyImage() {
+        if (m_image == VK_NULL_HANDLE) {
+            return;
+        }
+
+        m_descriptor_pool->resetPool();
+        m_level_sets.clear();
+        std::fill(std::begin(m_depth_sets), std::end(m_depth_sets), VK_NULL_HANDLE);
+
+        for (auto view : m_level_views) {
+            m_device.destroyImageView(view);
+        }
+        m_level_views.clear();
+        m_level_extents.clear();
+
+        m_device.destroyImageView(m_view);
+        m_device.destroyImage(m_image, m_allocation);
+        m_view  = VK_NULL_HANDLE;
+        m_image = VK_NULL_HANDLE;
+    }
+
+    void NexDepthPyramid::resize(VkExtent2D depth_extent) {
+        if (m_image != VK_NULL_HANDLE && depth_extent.width == m_depth_extent.width && depth_extent.height == m_depth_extent.height) {
+            return;
+        }
+
+        // a resize is rare, the old pyramid may still be read by the frames in flight
+        vkDeviceWaitIdle(m_device.device());
+        destroyImage();
+        createImage(depth_extent);
+        m_valid = false;
+    }
+
+    void NexDepthPyramid::build(VkCommandBuffer command_buffer, int frame_index, VkImage depth_image, VkImageView depth_view, VkFormat depth_format, VkExtent2D extent) {
+        assert(extent.width == m_depth_extent.width && extent.height == m_depth_extent.height && "resize() the pyramid before the frame references it");
+
+        VkDescriptorImageInfo depth_info       = {m_sampler, depth_view, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+        VkDescriptorImageInfo destination_info = {VK_NULL_HANDLE, m_level_views[0], VK_IMAGE_LAYOUT_GENERAL};
+        NexDescriptorWriter(*m_set_layout, *m_descriptor_pool).writeImage(0, &depth_info).writeImage(1, &destination_info).overwrite(m_depth_sets[frame_index]);
+
+        // the depth has to be written before it is read, and the culling pass has to be done reading the previous pyramid
+        VkImageMemoryBarrier depth_barrier            = {};
+        depth_barrier.sType                           = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        depth_barrier.oldLayout                       = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+        depth_barrier.newLayout                       = VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        depth_barrier.srcQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        depth_barrier.dstQueueFamilyIndex             = VK_QUEUE_FAMILY_IGNORED;
+        depth_barrier.image                           = depth_image;
+        depth_barrier.subresourceRange.aspectMask     = depth_format == VK_FORMAT_D32_SFLOAT ? VK_IMAGE_ASPECT_DEPTH_BIT : VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT;
+        depth_barrier.subresourceRange.baseMipLevel   = 0;
+        depth_barrier.subresourceRange.levelCount     = 1;
+        depth_barrier.subresourceRange.baseArrayLayer = 0;
+        depth_barrier.subresourceRange.layerCount     = 1;
+        depth_barrier.srcAccessMask                   = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+        depth_barrier.dstAccessMask                   = VK_ACCESS_SHADER_READ_BIT;
+
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                             VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &depth_barrier);
+
+        VkMemoryBarrier level_barrier = {};
+        level_barrier.sType           = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        level_barrier.srcAccessMask   = VK_ACCESS_SHADER_WRITE_BIT;
+        level_barrier.dstAccessMask   = VK_ACCESS_SHADER_READ_BIT;
+
+        DepthPyramidPushConstantsData push = {};
+
+        // a single sampled depth reduces like any other level
+        bool multisampled = m_device.getMaxUsableSamples() != VK_SAMPLE_COUNT_1_BIT;
+        (multisampled ? m_resolve_pipeline : m_reduce_pipeline)->bind(command_buffer);
+
+        VkExtent2D source = extent;
+        for (uint32_t level = 0; level < getLevelCount(); ++level) {
+            if (level == 1 && multisampled) {
+                m_reduce_pipeline->bind(command_buffer);
+            }
+
+            VkExtent2D destination     = m_level_extents[level];
+            push.m_source_size[0]      = static_cast<int32_t>(source.width);
+            push.m_source_size[1]      = static_cast<int32_t>(source.height);
+            push.m_destination_size[0] = static_cast<int32_t>(destination.width);
+            push.m_destination_size[1] = static_cast<int32_t>(destination.height);
+
+            VkDescriptorSet set = level == 0 ? m_depth_sets[frame_index] : m_level_sets[level - 1];
+            vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline_layout, 0, 1, &set, 0, nullptr);
+            vkCmdPushConstants(command_buffer, m_pipeline_layout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(DepthPyramidPushConstantsData), &push);
+            vkCmdDispatch(command_buffer, (destination.width + group_size - 1) / group_size, (destination.height + group_size - 1) / group_size, 1);
+
+            vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &level_barrier, 0, nullptr, 0, nullptr);
+            source = destination;
+        }
+
+        m_valid = true;
+    }
+
+    VkDescriptorImageInfo NexDepthPyramid::getDescriptorInfo() const {
+        return {m_sampler, m_view, VK_IMAGE_LAYOUT_GENERAL};
+    }
+}  // namespace nex
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "../core/nex_device.hpp"
+#include "../core/nex_swapchain.hpp"
+#include "nex_descriptors.hpp"
+#include "nex_pipeline.hpp"
+
+namespace nex {
+    // Hierarchical z buffer of a frame's depth. Every texel holds the farthest depth of the texels it covers, level 0 is half
+    // the depth resolution and the last column and row of odd sized levels fold into their neighbours, so reading a texel is
+    // always conservative. The image stays in VK_IMAGE_LAYOUT_GENERAL and is only read with texelFetch.
+    class NexDepthPyramid {
+      public:
+        explicit NexDepthPyramid(NexDevice& device);
+        ~NexDepthPyramid();
+
+        NexDepthPyramid(const NexDepthPyramid&)            = delete;
+        NexDepthPyramid& operator=(const NexDepthPyramid&) = delete;
+
+        // (re)creates the pyramid for a depth of this size, waiting for the device when it already existed at another size.
+        // Call it before the frame's command buffer references the pyramid, a resize destroys the image it points at
+        void resize(VkExtent2D depth_extent);
+
+        // records the reduction of the depth just rendered, which has to match the size of the last resize(). The depth is expected
+        // in DEPTH_STENCIL_ATTACHMENT_OPTIMAL right after its render pass and is left in DEPTH_STENCIL_READ_ONLY_OPTIMAL.
+        void build(VkCommandBuffer command_buffer, int frame_index, VkImage depth_image, VkImageView depth_view, VkFormat depth_format, VkExtent2D extent);
+
+        // false until build() ran at the current size
+        bool isValid() const {
+            return m_valid;
+        }
+
+        // size of the depth the pyramid was built from, a texel of level l covers 2^(l + 1) depth pixels per axis
+        VkExtent2D getDepthExtent() const {
+            return m_depth_extent;
+        }
+
+        uint32_t getLevelCount() const {
+            return static_cast<uint32_t>(m_level_views.size());
+        }
+
+        VkDescriptorImageInfo getDescriptorInfo() const;
+
+      private:
+        void createImage(VkExtent2D depth_extent);
+        void destroyImage();
+        void createPipelines();
+
+        NexDevice& m_device;
+
+        VkImage                  m_image      = VK_NULL_HANDLE;
+        NexAllocation            m_allocation = {};
+        VkImageView              m_view       = VK_NULL_HANDLE;  // every level, for sampling
+        std::vector<VkImageView> m_level_views;                  // one level each, for storing
+        std::vector<VkExtent2D>  m_level_extents;
+        VkSampler                m_sampler = VK_NULL_HANDLE;
+
+        std::unique_ptr<NexDescriptorSetLayout> m_set_layout;
+        std::unique_ptr<NexDescriptorPool>      m_descriptor_pool;
+        VkDescriptorSet                         m_depth_sets[NexSwapChain::max_frames_in_flight] = {};  // the depth being read changes with the swapchain image
+        std::vector<VkDescriptorSet>            m_level_sets;                                           // level i + 1 from level i
+
+        VkPipelineLayout                    m_pipeline_layout = VK_NULL_HANDLE;
+        std::unique_ptr<NexComputePipeline> m_resolve_pipeline;  // level 0 from a multisampled depth
+        std::unique_ptr<NexComputePipeline> m_reduce_pipeline;
+
+        VkExtent2D m_depth_extent = {0, 0};
+        bool       m_valid        = false;
+    };
+}  // namespace nex
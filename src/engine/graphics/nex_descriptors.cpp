@@ -1,12 +1,17 @@
 
 #include "nex_descriptors.hpp"
 
+#include <algorithm>
 #include <cassert>
+#include <iostream>
 #include <stdexcept>
 
+#include "../core/nex_utils.hpp"
+
 namespace nex {
 
-    NexDescriptorSetLayout::Builder& NexDescriptorSetLayout::Builder::addBinding(uint32_t binding, VkDescriptorType descriptorType, VkShaderStageFlags stageFlags, uint32_t count) {
+    NexDescriptorSetLayout::Builder& NexDescriptorSetLayout::Builder::addBinding(uint32_t binding, VkDescriptorType descriptorType, VkShaderStageFlags stageFlags, uint32_t count,
+                                                                                 VkDescriptorBindingFlags bindingFlags) {
         assert(m_bindings.count(binding) == 0 && "Binding already in use");
         VkDescriptorSetLayoutBinding layout_binding{};
         layout_binding.binding         = binding;
@@ -14,23 +19,45 @@ namespace nex {
         layout_binding.descriptorCount = count;
         layout_binding.stageFlags      = stageFlags;
         m_bindings[binding]            = layout_binding;
+        if (bindingFlags != 0) {
+            m_binding_flags[binding] = bindingFlags;
+        }
         return *this;
     }
 
     std::unique_ptr<NexDescriptorSetLayout> NexDescriptorSetLayout::Builder::build() const {
-        return std::make_unique<NexDescriptorSetLayout>(m_device, m_bindings);
+        return std::make_unique<NexDescriptorSetLayout>(m_device, m_bindings, m_binding_flags);
     }
 
-    NexDescriptorSetLayout::NexDescriptorSetLayout(NexDevice& device, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings) : m_device{device}, m_bindings{bindings} {
+    NexDescriptorSetLayout::NexDescriptorSetLayout(NexDevice& device, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+                                                   const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags)
+        : m_device{device}, m_bindings{bindings} {
         std::vector<VkDescriptorSetLayoutBinding> set_layout_bindings{};
+        std::vector<VkDescriptorBindingFlags>     set_layout_binding_flags{};
+        bool                                      update_after_bind = false;
         for (auto kv : bindings) {
             set_layout_bindings.push_back(kv.second);
+
+            auto flags = bindingFlags.find(kv.first);
+            set_layout_binding_flags.push_back(flags != bindingFlags.end() ? flags->second : 0);
+            update_after_bind |= (set_layout_binding_flags.back() & VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT) != 0;
         }
 
+        VkDescriptorSetLayoutBindingFlagsCreateInfo binding_flags_info{};
+        binding_flags_info.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+        binding_flags_info.bindingCount  = static_cast<uint32_t>(set_layout_binding_flags.size());
+        binding_flags_info.pBindingFlags = set_layout_binding_flags.data();
+
         VkDescriptorSetLayoutCreateInfo descriptor_set_layout_info{};
         descriptor_set_layout_info.sType        = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
         descriptor_set_layout_info.bindingCount = static_cast<uint32_t>(set_layout_bindings.size());
         descriptor_set_layout_info.pBindings    = set_layout_bindings.data();
+        if (!bindingFlags.empty()) {
+            descriptor_set_layout_info.pNext = &binding_flags_info;
+        }
+        if (update_after_bind) {
+            descriptor_set_layout_info.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+        }
 
         if (vkCreateDescriptorSetLayout(device.device(), &descriptor_set_layout_info, nullptr, &m_descriptor_set_layout) != VK_SUCCESS) {
             throw std::runtime_error("failed to create descriptor set layout!");
@@ -76,14 +103,22 @@ namespace nex {
         vkDestroyDescriptorPool(m_device.device(), m_descriptor_pool, nullptr);
     }
 
-    bool NexDescriptorPool::allocateDescriptor(const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor) const {
+    bool NexDescriptorPool::allocateDescriptor(const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor, uint32_t variableDescriptorCount) const {
+        VkDescriptorSetVariableDescriptorCountAllocateInfo variable_count_info{};
+        variable_count_info.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+        variable_count_info.descriptorSetCount = 1;
+        variable_count_info.pDescriptorCounts  = &variableDescriptorCount;
+
         VkDescriptorSetAllocateInfo alloc_info{};
         alloc_info.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
         alloc_info.descriptorPool     = m_descriptor_pool;
         alloc_info.pSetLayouts        = &descriptorSetLayout;
         alloc_info.descriptorSetCount = 1;
+        if (variableDescriptorCount > 0) {
+            alloc_info.pNext = &variable_count_info;
+        }
 
-        // Might want to create a "DescriptorPoolManager" class that handles this case, and builds a new pool whenever an old pool fills up
+        // fixed size, NexDescriptorAllocator chains pools for the cases where the count is not known up front
         if (vkAllocateDescriptorSets(m_device.device(), &alloc_info, &descriptor) != VK_SUCCESS) {
             return false;
         }
@@ -98,7 +133,232 @@ namespace nex {
         vkResetDescriptorPool(m_device.device(), m_descriptor_pool, 0);
     }
 
-    NexDescriptorWriter::NexDescriptorWriter(NexDescriptorSetLayout& setLayout, NexDescriptorPool& pool) : m_set_layout{setLayout}, m_pool{pool} {}
+    NexDescriptorAllocator::NexDescriptorAllocator(NexDevice& device, std::vector<PoolSizeRatio> ratios, uint32_t initialSets)
+        : m_device{device}, m_ratios{std::move(ratios)}, m_next_pool_sets{initialSets}, m_destroyed_cursor{device.destroyedHandleCount()} {}
+
+    NexDescriptorAllocator::~NexDescriptorAllocator() {
+        // destroying the pools frees their sets
+        for (VkDescriptorPool pool : m_pools) {
+            vkDestroyDescriptorPool(m_device.device(), pool, nullptr);
+        }
+    }
+
+    VkDescriptorPool NexDescriptorAllocator::createPool(uint32_t setCount) {
+        std::vector<VkDescriptorPoolSize> pool_sizes;
+        for (const auto& ratio : m_ratios) {
+            pool_sizes.push_back({ratio.m_type, std::max(1u, static_cast<uint32_t>(ratio.m_ratio * static_cast<float>(setCount)))});
+        }
+
+        // sets are freed one by one once no frame asks for them anymore
+        VkDescriptorPoolCreateInfo descriptor_pool_info{};
+        descriptor_pool_info.sType         = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+        descriptor_pool_info.poolSizeCount = static_cast<uint32_t>(pool_sizes.size());
+        descriptor_pool_info.pPoolSizes    = pool_sizes.data();
+        descriptor_pool_info.maxSets       = setCount;
+        descriptor_pool_info.flags         = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT;
+
+        VkDescriptorPool pool;
+        if (vkCreateDescriptorPool(m_device.device(), &descriptor_pool_info, nullptr, &pool) != VK_SUCCESS) {
+            throw std::runtime_error("failed to create descriptor pool!");
+        }
+        return pool;
+    }
+
+    VkDescriptorPool NexDescriptorAllocator::allocateFromChain(VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor, uint32_t variableDescriptorCount) {
+        VkDescriptorSetVariableDescriptorCountAllocateInfo variable_count_info{};
+        variable_count_info.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+        variable_count_info.descriptorSetCount = 1;
+        variable_count_info.pDescriptorCounts  = &variableDescriptorCount;
+
+        VkDescriptorSetAllocateInfo alloc_info{};
+        alloc_info.sType              = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+        alloc_info.pSetLayouts        = &descriptorSetLayout;
+        alloc_info.descriptorSetCount = 1;
+        if (variableDescriptorCount > 0) {
+            alloc_info.pNext = &variable_count_info;
+        }
+
+        // the current pool first, then the others since freed sets may have made room in them
+        for (size_t attempt = 0; attempt < m_pools.size(); ++attempt) {
+            uint32_t index            = static_cast<uint32_t>((m_current + attempt) % m_pools.size());
+            alloc_info.descriptorPool = m_pools[index];
+
+            VkResult result = vkAllocateDescriptorSets(m_device.device(), &alloc_info, &descriptor);
+            if (result == VK_SUCCESS) {
+                m_current = index;
+                return m_pools[index];
+            }
+            if (result != VK_ERROR_OUT_OF_POOL_MEMORY && result != VK_ERROR_FRAGMENTED_POOL) {
+                return VK_NULL_HANDLE;
+            }
+        }
+
+        m_pools.push_back(createPool(m_next_pool_sets));
+        m_current        = static_cast<uint32_t>(m_pools.size() - 1);
+        m_next_pool_sets = std::min(m_next_pool_sets * 2, max_sets_per_pool);
+
+        alloc_info.descriptorPool = m_pools.back();
+        if (vkAllocateDescriptorSets(m_device.device(), &alloc_info, &descriptor) != VK_SUCCESS) {
+            return VK_NULL_HANDLE;
+        }
+        return m_pools.back();
+    }
+
+    bool NexDescriptorAllocator::allocate(VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor, uint32_t variableDescriptorCount) {
+        VkDescriptorPool pool = allocateFromChain(descriptorSetLayout, descriptor, variableDescriptorCount);
+        if (pool == VK_NULL_HANDLE) {
+            return false;
+        }
+        m_transient.push_back({descriptor, pool});
+        return true;
+    }
+
+    void NexDescriptorAllocator::appendKeys(const std::vector<VkWriteDescriptorSet>& writes, std::vector<WriteKey>& keys) {
+        for (const auto& write : writes) {
+            for (uint32_t i = 0; i < write.descriptorCount; ++i) {
+                WriteKey key        = {};
+                key.m_binding       = write.dstBinding;
+                key.m_array_element = write.dstArrayElement + i;
+                key.m_type          = write.descriptorType;
+                if (write.pBufferInfo != nullptr) {
+                    key.m_handle = (uint64_t)write.pBufferInfo[i].buffer;
+                    key.m_offset = write.pBufferInfo[i].offset;
+                    key.m_range  = write.pBufferInfo[i].range;
+                } else if (write.pImageInfo != nullptr) {
+                    key.m_handle  = (uint64_t)write.pImageInfo[i].imageView;
+                    key.m_sampler = (uint64_t)write.pImageInfo[i].sampler;
+                    key.m_offset  = write.pImageInfo[i].imageLayout;
+                }
+                keys.push_back(key);
+            }
+        }
+    }
+
+    size_t NexDescriptorAllocator::hashKeys(VkDescriptorSetLayout descriptorSetLayout, const std::vector<WriteKey>& keys) {
+        size_t seed = 0;
+        hashCombine(seed, (uint64_t)descriptorSetLayout);
+        for (const auto& key : keys) {
+            hashCombine(seed, key.m_binding, key.m_array_element, static_cast<uint32_t>(key.m_type), key.m_handle, key.m_sampler, key.m_offset, key.m_range);
+        }
+        return seed;
+    }
+
+    bool NexDescriptorAllocator::build(const NexDescriptorSetLayout& setLayout, std::vector<VkWriteDescriptorSet>& writes, VkDescriptorSet& descriptor) {
+        VkDescriptorSetLayout layout = setLayout.getDescriptorSetLayout();
+
+        m_scratch.clear();
+        appendKeys(writes, m_scratch);
+        size_t hash = hashKeys(layout, m_scratch);
+
+        evictDestroyed();
+        auto it = m_cache.find(hash);
+        if (it != m_cache.end()) {
+            CachedSet& cached = it->second;
+            if (cached.m_layout == layout && cached.m_key == m_scratch) {
+                cached.m_last_frame = m_frame;
+                descriptor          = cached.m_set;
+                m_cache_hits++;
+                return true;
+            }
+
+            // a collision, the frame may already have bound the old set so it goes with the frame's transient ones
+            m_transient.push_back({cached.m_set, cached.m_pool});
+            m_cache.erase(it);
+        }
+
+        m_cache_misses++;
+        VkDescriptorPool pool = allocateFromChain(layout, descriptor, 0);
+        if (pool == VK_NULL_HANDLE) {
+            return false;
+        }
+
+        for (auto& write : writes) {
+            write.dstSet = descriptor;
+        }
+        vkUpdateDescriptorSets(m_device.device(), static_cast<uint32_t>(writes.size()), writes.data(), 0, nullptr);
+
+        m_cache.emplace(hash, CachedSet{layout, m_scratch, descriptor, pool, m_frame});
+        return true;
+    }
+
+    void NexDescriptorAllocator::evictDestroyed() {
+        m_destroyed_handles.clear();
+        bool complete = m_device.destroyedHandlesSince(m_destroyed_cursor, m_destroyed_handles);
+        if (complete && m_destroyed_handles.empty()) {
+            return;
+        }
+        std::sort(m_destroyed_handles.begin(), m_destroyed_handles.end());
+
+        // a frame may already have bound an evicted set, so it goes with the frame's transient ones
+        for (auto it = m_cache.begin(); it != m_cache.end();) {
+            bool stale = !complete || std::any_of(it->second.m_key.begin(), it->second.m_key.end(), [&](const WriteKey& key) {
+                return std::binary_search(m_destroyed_handles.begin(), m_destroyed_handles.end(), key.m_handle) ||
+                       (key.m_sampler != 0 && std::binary_search(m_destroyed_handles.begin(), m_destroyed_handles.end(), key.m_sampler));
+            });
+            if (stale) {
+                m_transient.push_back({it->second.m_set, it->second.m_pool});
+                it = m_cache.erase(it);
+            } else {
+                ++it;
+            }
+        }
+    }
+
+    void NexDescriptorAllocator::freeSets(std::vector<LiveSet>& sets) {
+        // one call per pool
+        std::sort(sets.begin(), sets.end(), [](const LiveSet& a, const LiveSet& b) {
+            return a.m_pool < b.m_pool;
+        });
+
+        std::vector<VkDescriptorSet> pool_sets;
+        for (size_t begin = 0; begin < sets.size();) {
+            size_t end = begin;
+            pool_sets.clear();
+            while (end < sets.size() && sets[end].m_pool == sets[begin].m_pool) {
+                pool_sets.push_back(sets[end++].m_set);
+            }
+            vkFreeDescriptorSets(m_device.device(), sets[begin].m_pool, static_cast<uint32_t>(pool_sets.size()), pool_sets.data());
+            begin = end;
+        }
+
+        m_freed_sets += sets.size();
+        sets.clear();
+    }
+
+    void NexDescriptorAllocator::nextFrame() {
+        for (auto it = m_cache.begin(); it != m_cache.end();) {
+            if (it->second.m_last_frame != m_frame) {
+                m_transient.push_back({it->second.m_set, it->second.m_pool});
+                it = m_cache.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        freeSets(m_transient);
+        m_frame++;
+    }
+
+    NexDescriptorAllocatorStats NexDescriptorAllocator::getStats() const {
+        NexDescriptorAllocatorStats stats = {};
+        stats.m_pool_count                = static_cast<uint32_t>(m_pools.size());
+        stats.m_live_sets                 = static_cast<uint32_t>(m_cache.size() + m_transient.size());
+        stats.m_cache_hits                = m_cache_hits;
+        stats.m_cache_misses              = m_cache_misses;
+        stats.m_freed_sets                = m_freed_sets;
+        return stats;
+    }
+
+    void NexDescriptorAllocator::printStats(const char* name) const {
+        NexDescriptorAllocatorStats stats   = getStats();
+        uint64_t                    lookups = stats.m_cache_hits + stats.m_cache_misses;
+
+        std::cout << name << " descriptor sets: " << stats.m_live_sets << " live in " << stats.m_pool_count << " pools, " << stats.m_cache_hits << "/" << lookups << " cache hits ("
+                  << (lookups > 0 ? 100 * stats.m_cache_hits / lookups : 0) << "%), " << stats.m_freed_sets << " freed" << std::endl;
+    }
+
+    NexDescriptorWriter::NexDescriptorWriter(NexDescriptorSetLayout& setLayout, NexDescriptorPool& pool) : m_set_layout{setLayout}, m_pool{&pool} {}
+
+    NexDescriptorWriter::NexDescriptorWriter(NexDescriptorSetLayout& setLayout, NexDescriptorAllocator& allocator) : m_set_layout{setLayout}, m_allocator{&allocator} {}
 
     NexDescriptorWriter& NexDescriptorWriter::writeBuffer(uint32_t binding, VkDescriptorBufferInfo* bufferInfo) {
         assert(m_set_layout.m_bindings.count(binding) == 1 && "Layout does not contain specified binding");
@@ -137,7 +397,11 @@ namespace nex {
     }
 
     bool NexDescriptorWriter::build(VkDescriptorSet& set) {
-        bool success = m_pool.allocateDescriptor(m_set_layout.getDescriptorSetLayout(), set);
+        if (m_allocator != nullptr) {
+            return m_allocator->build(m_set_layout, m_writes, set);
+        }
+
+        bool success = m_pool->allocateDescriptor(m_set_layout.getDescriptorSetLayout(), set);
         if (!success) {
             return false;
         }
@@ -149,7 +413,7 @@ namespace nex {
         for (auto& write : m_writes) {
             write.dstSet = set;
         }
-        vkUpdateDescriptorSets(m_pool.m_device.device(), m_writes.size(), m_writes.data(), 0, nullptr);
+        vkUpdateDescriptorSets(m_set_layout.m_device.device(), m_writes.size(), m_writes.data(), 0, nullptr);
     }
 
 }  // namespace nex
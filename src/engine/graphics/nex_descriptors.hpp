@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <memory>
 #include <unordered_map>
 #include <vector>
@@ -13,15 +14,19 @@ namespace nex {
           public:
             Builder(NexDevice& device) : m_device{device} {}
 
-            Builder&                                addBinding(uint32_t binding, VkDescriptorType descriptorType, VkShaderStageFlags stageFlags, uint32_t count = 1);
+            // with update after bind in the flags the layout is created for an update after bind pool
+            Builder&                                addBinding(uint32_t binding, VkDescriptorType descriptorType, VkShaderStageFlags stageFlags, uint32_t count = 1,
+                                                               VkDescriptorBindingFlags bindingFlags = 0);
             std::unique_ptr<NexDescriptorSetLayout> build() const;
 
           private:
             NexDevice&                                                 m_device;
-            std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> m_bindings = {};
+            std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> m_bindings      = {};
+            std::unordered_map<uint32_t, VkDescriptorBindingFlags>     m_binding_flags = {};
         };
 
-        NexDescriptorSetLayout(NexDevice& device, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings);
+        NexDescriptorSetLayout(NexDevice& device, std::unordered_map<uint32_t, VkDescriptorSetLayoutBinding> bindings,
+                               const std::unordered_map<uint32_t, VkDescriptorBindingFlags>& bindingFlags = {});
         ~NexDescriptorSetLayout();
         NexDescriptorSetLayout(const NexDescriptorSetLayout&)            = delete;
         NexDescriptorSetLayout& operator=(const NexDescriptorSetLayout&) = delete;
@@ -61,7 +66,8 @@ namespace nex {
         NexDescriptorPool(const NexDescriptorPool&)            = delete;
         NexDescriptorPool& operator=(const NexDescriptorPool&) = delete;
 
-        bool allocateDescriptor(const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor) const;
+        // a variable descriptor count sizes the layout's variable count binding, zero for layouts without one
+        bool allocateDescriptor(const VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor, uint32_t variableDescriptorCount = 0) const;
 
         void freeDescriptors(std::vector<VkDescriptorSet>& descriptors) const;
 
@@ -74,9 +80,114 @@ namespace nex {
         friend class NexDescriptorWriter;
     };
 
+    struct NexDescriptorAllocatorStats {
+        uint32_t m_pool_count   = 0;
+        uint32_t m_live_sets    = 0;
+        uint64_t m_cache_hits   = 0;
+        uint64_t m_cache_misses = 0;
+        uint64_t m_freed_sets   = 0;
+    };
+
+    // Allocates from a chain of pools, creating the next one (twice as large, up to max_sets_per_pool) when the current one
+    // is exhausted or fragmented. Sets built through a NexDescriptorWriter are cached by their layout and write contents, so
+    // building an identical set again returns the existing one without touching the pool or writing descriptors.
+    // The handles in the key may be reused once their resource is destroyed, so the entries referencing a handle the device
+    // logged as destroyed are dropped before the next lookup.
+    // nextFrame() frees every set not asked for since the previous call, an allocator that is used by one frame in flight
+    // and advanced after that frame's fence keeps the sets the frame keeps asking for and recycles the rest.
+    class NexDescriptorAllocator {
+      public:
+        struct PoolSizeRatio {
+            VkDescriptorType m_type  = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+            float            m_ratio = 1.0f;  // descriptors of the type per set
+        };
+
+        static constexpr uint32_t max_sets_per_pool = 4096;
+
+        // what the engine's passes ask for on average, pools chain anyway when one type runs out first
+        static inline const std::vector<PoolSizeRatio> default_ratios = {
+            {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f},
+            {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1.0f},
+            {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f},
+        };
+
+        explicit NexDescriptorAllocator(NexDevice& device, std::vector<PoolSizeRatio> ratios = default_ratios, uint32_t initialSets = 64);
+        ~NexDescriptorAllocator();
+
+        NexDescriptorAllocator(const NexDescriptorAllocator&)            = delete;
+        NexDescriptorAllocator& operator=(const NexDescriptorAllocator&) = delete;
+
+        // uncached, the set lives until the next nextFrame()
+        bool allocate(VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor, uint32_t variableDescriptorCount = 0);
+
+        // the cached set with exactly these writes, allocated and written on a miss. dstSet of the writes is filled in
+        bool build(const NexDescriptorSetLayout& setLayout, std::vector<VkWriteDescriptorSet>& writes, VkDescriptorSet& descriptor);
+
+        void nextFrame();
+
+        NexDescriptorAllocatorStats getStats() const;
+        void                        printStats(const char* name) const;
+
+      private:
+        // what a write points at, compared on a hash hit so a collision is a miss rather than a wrong set
+        struct WriteKey {
+            uint32_t         m_binding       = 0;
+            uint32_t         m_array_element = 0;
+            VkDescriptorType m_type          = VK_DESCRIPTOR_TYPE_MAX_ENUM;
+            uint64_t         m_handle        = 0;  // buffer or image view
+            uint64_t         m_sampler       = 0;
+            uint64_t         m_offset        = 0;  // or the image layout
+            uint64_t         m_range         = 0;
+
+            bool operator==(const WriteKey& other) const = default;
+        };
+
+        struct CachedSet {
+            VkDescriptorSetLayout m_layout     = VK_NULL_HANDLE;
+            std::vector<WriteKey> m_key        = {};
+            VkDescriptorSet       m_set        = VK_NULL_HANDLE;
+            VkDescriptorPool      m_pool       = VK_NULL_HANDLE;
+            uint64_t              m_last_frame = 0;
+        };
+
+        struct LiveSet {
+            VkDescriptorSet  m_set  = VK_NULL_HANDLE;
+            VkDescriptorPool m_pool = VK_NULL_HANDLE;
+        };
+
+        VkDescriptorPool allocateFromChain(VkDescriptorSetLayout descriptorSetLayout, VkDescriptorSet& descriptor, uint32_t variableDescriptorCount);
+        VkDescriptorPool createPool(uint32_t setCount);
+        void             freeSets(std::vector<LiveSet>& sets);
+        void             evictDestroyed();
+
+        static void   appendKeys(const std::vector<VkWriteDescriptorSet>& writes, std::vector<WriteKey>& keys);
+        static size_t hashKeys(VkDescriptorSetLayout descriptorSetLayout, const std::vector<WriteKey>& keys);
+
+        NexDevice&                 m_device;
+        std::vector<PoolSizeRatio> m_ratios;
+        uint32_t                   m_next_pool_sets;
+
+        std::vector<VkDescriptorPool> m_pools   = {};  // the last one is allocated from first
+        uint32_t                      m_current = 0;
+
+        uint64_t                              m_frame     = 0;
+        std::unordered_map<size_t, CachedSet> m_cache     = {};
+        std::vector<LiveSet>                  m_transient = {};  // uncached sets of the current frame
+        std::vector<WriteKey>                 m_scratch   = {};
+
+        uint64_t              m_destroyed_cursor  = 0;  // into the device's log of destroyed handles
+        std::vector<uint64_t> m_destroyed_handles = {};
+
+        uint64_t m_cache_hits   = 0;
+        uint64_t m_cache_misses = 0;
+        uint64_t m_freed_sets   = 0;
+    };
+
     class NexDescriptorWriter {
       public:
         NexDescriptorWriter(NexDescriptorSetLayout& setLayout, NexDescriptorPool& pool);
+        // build() goes through the allocator's set cache
+        NexDescriptorWriter(NexDescriptorSetLayout& setLayout, NexDescriptorAllocator& allocator);
 
         NexDescriptorWriter& writeBuffer(uint32_t binding, VkDescriptorBufferInfo* bufferInfo);
         NexDescriptorWriter& writeImage(uint32_t binding, VkDescriptorImageInfo* imageInfo);
@@ -86,7 +197,8 @@ namespace nex {
 
       private:
         NexDescriptorSetLayout&           m_set_layout;
-        NexDescriptorPool&                m_pool;
+        NexDescriptorPool*                m_pool      = nullptr;
+        NexDescriptorAllocator*           m_allocator = nullptr;
         std::vector<VkWriteDescriptorSet> m_writes;
     };
 }  // namespace nex
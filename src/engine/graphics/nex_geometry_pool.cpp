@@ -0,0 +1,220 @@
+#include "nex_geometry_pool.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <stdexcept>
+
+#include "../core/nex_swapchain.hpp"
+#include "nex_buffer.hpp"
+
+namespace nex {
+    // One shared buffer, sub-allocated in elements with a first fit free list. Lower offsets are preferred, so the
+    // live ranges stay packed towards the front of the buffer.
+    class NexGeometryArena {
+      public:
+        NexGeometryArena(NexDevice& device, bool index, uint32_t element_size, uint32_t capacity) : m_index{index}, m_element_size{element_size} {
+            VkBufferUsageFlags usage = m_index ? VK_BUFFER_USAGE_INDEX_BUFFER_BIT : VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+            m_buffer                 = std::make_unique<NexBuffer>(device, element_size, capacity, usage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+            m_free_ranges.emplace(0, capacity);
+        }
+
+        NexGeometryArena(const NexGeometryArena&)            = delete;
+        NexGeometryArena& operator=(const NexGeometryArena&) = delete;
+
+        bool allocate(uint32_t count, uint32_t& offset) {
+            auto it = std::find_if(m_free_ranges.begin(), m_free_ranges.end(), [&](const auto& range) {
+                return range.second >= count;
+            });
+            if (it == m_free_ranges.end()) {
+                return false;
+            }
+
+            offset             = it->first;
+            uint32_t remaining = it->second - count;
+            m_free_ranges.erase(it);
+            if (remaining > 0) {
+                m_free_ranges.emplace(offset + count, remaining);
+            }
+
+            m_used += count;
+            m_allocation_count++;
+            return true;
+        }
+
+        void free(uint32_t offset, uint32_t count) {
+            assert(m_allocation_count > 0 && "Freeing from an empty geometry arena");
+            m_used -= count;
+            m_allocation_count--;
+
+            // merge with the free neighbours on either side
+            auto next = m_free_ranges.lower_bound(offset);
+            if (next != m_free_ranges.end() && offset + count == next->first) {
+                count += next->second;
+                next = m_free_ranges.erase(next);
+            }
+            if (next != m_free_ranges.begin()) {
+                auto previous = std::prev(next);
+                if (previous->first + previous->second == offset) {
+                    previous->second += count;
+                    return;
+                }
+            }
+            m_free_ranges.emplace(offset, count);
+        }
+
+        void accumulateStats(NexGeometryPoolStats& stats) const {
+            stats.m_bytes_reserved += m_buffer->getBufferSize();
+            stats.m_bytes_used += static_cast<uint64_t>(m_used) * m_element_size;
+            stats.m_allocation_count += m_allocation_count;
+            stats.m_free_range_count += static_cast<uint32_t>(m_free_ranges.size());
+
+            for (const auto& [offset, count] : m_free_ranges) {
+                stats.m_largest_free = std::max(stats.m_largest_free, static_cast<uint64_t>(count) * m_element_size);
+            }
+        }
+
+        VkBuffer buffer() const {
+            return m_buffer->getBuffer();
+        }
+        VkAccessFlags readAccess() const {
+            return m_index ? VK_ACCESS_INDEX_READ_BIT : VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT;
+        }
+        uint32_t allocationCount() const {
+            return m_allocation_count;
+        }
+
+      private:
+        std::unique_ptr<NexBuffer> m_buffer;
+        bool                       m_index;
+        uint32_t                   m_element_size;
+
+        std::map<uint32_t, uint32_t> m_free_ranges      = {};  // offset -> count
+        uint32_t                     m_used             = 0;
+        uint32_t                     m_allocation_count = 0;
+    };
+
+    void NexGeometryBindings::bindVertices(VkCommandBuffer command_buffer, VkBuffer buffer) {
+        if (buffer == m_vertex_buffer) {
+            return;
+        }
+
+        VkDeviceSize offset = 0;
+        vkCmdBindVertexBuffers(command_buffer, 0, 1, &buffer, &offset);
+        m_vertex_buffer = buffer;
+    }
+
+    void NexGeometryBindings::bindIndices(VkCommandBuffer command_buffer, VkBuffer buffer, VkIndexType index_type) {
+        if (buffer == m_index_buffer && index_type == m_index_type) {
+            return;
+        }
+
+        vkCmdBindIndexBuffer(command_buffer, buffer, 0, index_type);
+        m_index_buffer = buffer;
+        m_index_type   = index_type;
+    }
+
+    NexGeometryPool::NexGeometryPool(NexDevice& device) : m_device{device} {}
+
+    NexGeometryPool::~NexGeometryPool() {
+        // the device is idle by now, whatever is still retired can go without waiting for its frame
+        for (auto& [frame, allocation] : m_retired) {
+            allocation.m_arena->free(allocation.m_offset, allocation.m_count);
+        }
+
+        for (const auto* arenas : {&m_vertex_arenas, &m_index_arenas}) {
+            for (const auto& [element_size, arena] : *arenas) {
+                if (arena->allocationCount() > 0) {
+                    std::cerr << "geometry pool: " << arena->allocationCount() << " range(s) leaked in the " << element_size << " byte arena" << std::endl;
+                }
+            }
+        }
+    }
+
+    NexGeometryAllocation NexGeometryPool::allocate(std::map<uint32_t, std::unique_ptr<NexGeometryArena>>& arenas, bool index, uint32_t element_size, uint32_t count) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto& arena = arenas[element_size];
+        if (!arena) {
+            VkDeviceSize size = index ? index_arena_size : vertex_arena_size;
+            arena             = std::make_unique<NexGeometryArena>(m_device, index, element_size, static_cast<uint32_t>(size / element_size));
+        }
+
+        NexGeometryAllocation allocation = {};
+        if (!arena->allocate(count, allocation.m_offset)) {
+            throw std::runtime_error("failed to allocate from the geometry pool!");
+        }
+
+        allocation.m_buffer       = arena->buffer();
+        allocation.m_count        = count;
+        allocation.m_element_size = element_size;
+        allocation.m_arena        = arena.get();
+        return allocation;
+    }
+
+    NexGeometryAllocation NexGeometryPool::allocateVertices(uint32_t vertex_size, uint32_t vertex_count) {
+        return allocate(m_vertex_arenas, false, vertex_size, vertex_count);
+    }
+
+    NexGeometryAllocation NexGeometryPool::allocateIndices(uint32_t index_size, uint32_t index_count) {
+        return allocate(m_index_arenas, true, index_size, index_count);
+    }
+
+    void NexGeometryPool::free(NexGeometryAllocation& allocation) {
+        if (!allocation) {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_retired.emplace_back(m_frame, allocation);
+        allocation = {};
+    }
+
+    NexUploadHandle NexGeometryPool::upload(const NexGeometryAllocation& allocation, const void* data) {
+        VkDeviceSize size   = static_cast<VkDeviceSize>(allocation.m_count) * allocation.m_element_size;
+        VkDeviceSize offset = static_cast<VkDeviceSize>(allocation.m_offset) * allocation.m_element_size;
+
+        return m_device.uploadQueue().uploadBuffer(allocation.m_buffer, data, size, offset, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, allocation.m_arena->readAccess());
+    }
+
+    void NexGeometryPool::nextFrame() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_frame++;
+
+        // a range freed while frame n was recorded may be read until frame n + max_frames_in_flight starts
+        auto released = std::partition(m_retired.begin(), m_retired.end(), [&](const auto& retired) {
+            return retired.first + NexSwapChain::max_frames_in_flight > m_frame;
+        });
+        for (auto it = released; it != m_retired.end(); ++it) {
+            it->second.m_arena->free(it->second.m_offset, it->second.m_count);
+        }
+        m_retired.erase(released, m_retired.end());
+    }
+
+    NexGeometryPoolStats NexGeometryPool::getStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        NexGeometryPoolStats stats = {};
+        for (const auto* arenas : {&m_vertex_arenas, &m_index_arenas}) {
+            for (const auto& [element_size, arena] : *arenas) {
+                arena->accumulateStats(stats);
+            }
+        }
+        return stats;
+    }
+
+    void NexGeometryPool::printStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        for (const auto* arenas : {&m_vertex_arenas, &m_index_arenas}) {
+            for (const auto& [element_size, arena] : *arenas) {
+                NexGeometryPoolStats stats = {};
+                arena->accumulateStats(stats);
+
+                std::cout << "geometry pool, " << (arenas == &m_vertex_arenas ? "vertices" : "indices") << " of " << element_size << " bytes: " << stats.m_bytes_used / 1024
+                          << " KiB used / " << stats.m_bytes_reserved / 1024 << " KiB, " << stats.m_allocation_count << " ranges, " << stats.m_free_range_count
+                          << " free ranges, largest free " << stats.m_largest_free / 1024 << " KiB" << std::endl;
+            }
+        }
+    }
+}  // namespace nex
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "../core/nex_upload_queue.hpp"
+
+namespace nex {
+    class NexDevice;
+    class NexGeometryArena;
+
+    // A range of one of the pool's buffers, offsets and counts are in elements so they can go straight into vertexOffset and firstIndex
+    struct NexGeometryAllocation {
+        VkBuffer          m_buffer       = VK_NULL_HANDLE;
+        uint32_t          m_offset       = 0;
+        uint32_t          m_count        = 0;
+        uint32_t          m_element_size = 0;
+        NexGeometryArena* m_arena        = nullptr;
+
+        explicit operator bool() const {
+            return m_arena != nullptr;
+        }
+    };
+
+    // What a command buffer currently has bound, so a pass only rebinds when the next mesh lives in another buffer
+    struct NexGeometryBindings {
+        VkBuffer    m_vertex_buffer = VK_NULL_HANDLE;
+        VkBuffer    m_index_buffer  = VK_NULL_HANDLE;
+        VkIndexType m_index_type    = VK_INDEX_TYPE_MAX_ENUM;
+
+        void bindVertices(VkCommandBuffer command_buffer, VkBuffer buffer);
+        void bindIndices(VkCommandBuffer command_buffer, VkBuffer buffer, VkIndexType index_type);
+    };
+
+    struct NexGeometryPoolStats {
+        uint64_t m_bytes_reserved   = 0;
+        uint64_t m_bytes_used       = 0;
+        uint64_t m_largest_free     = 0;
+        uint32_t m_allocation_count = 0;
+        uint32_t m_free_range_count = 0;
+    };
+
+    // Shared device local vertex and index buffers that meshes are sub-allocated from. There is one arena per usage and
+    // element size (so every vertex format and index type), with a first fit free list that coalesces on free.
+    // Frees are deferred until the frames that may still draw the range have finished.
+    class NexGeometryPool {
+      public:
+        static constexpr VkDeviceSize vertex_arena_size = 32ull * 1024 * 1024;
+        static constexpr VkDeviceSize index_arena_size  = 16ull * 1024 * 1024;
+
+        explicit NexGeometryPool(NexDevice& device);
+        ~NexGeometryPool();
+
+        NexGeometryPool(const NexGeometryPool&)            = delete;
+        NexGeometryPool& operator=(const NexGeometryPool&) = delete;
+
+        NexGeometryAllocation allocateVertices(uint32_t vertex_size, uint32_t vertex_count);
+        NexGeometryAllocation allocateIndices(uint32_t index_size, uint32_t index_count);
+        void                  free(NexGeometryAllocation& allocation);
+
+        NexUploadHandle upload(const NexGeometryAllocation& allocation, const void* data);
+
+        // called once the fence of the frame about to be recorded has been waited on, releases the ranges no frame in flight can use anymore
+        void nextFrame();
+
+        NexGeometryPoolStats getStats() const;
+        void                 printStats() const;
+
+      private:
+        NexGeometryAllocation allocate(std::map<uint32_t, std::unique_ptr<NexGeometryArena>>& arenas, bool index, uint32_t element_size, uint32_t count);
+
+        NexDevice& m_device;
+
+        // keyed by element size
+        std::map<uint32_t, std::unique_ptr<NexGeometryArena>> m_vertex_arenas;
+        std::map<uint32_t, std::unique_ptr<NexGeometryArena>> m_index_arenas;
+
+        uint64_t                                                m_frame   = 0;
+        std::vector<std::pair<uint64_t, NexGeometryAllocation>> m_retired = {};
+
+        mutable std::mutex m_mutex;
+    };
+}  // namespace nex
@@ -0,0 +1,109 @@
+#include "nex_image_writer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+namespace nex {
+    static constexpr uint32_t max_stored_block = 65535;
+
+    static uint32_t crc32(const uint8_t* data, size_t size, uint32_t crc = 0) {
+        static const std::array<uint32_t, 256> table = [] {
+            std::array<uint32_t, 256> entries = {};
+            for (uint32_t i = 0; i < 256; i++) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; k++) {
+                    c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                }
+                entries[i] = c;
+            }
+            return entries;
+        }();
+
+        crc = ~crc;
+        for (size_t i = 0; i < size; i++) {
+            crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+        }
+        return ~crc;
+    }
+
+    static void appendBigEndian(std::vector<uint8_t>& out, uint32_t value) {
+        out.push_back(static_cast<uint8_t>(value >> 24));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    static void writeChunk(std::ofstream& file, const char* type, const std::vector<uint8_t>& data) {
+        std::vector<uint8_t> chunk = {};
+        chunk.reserve(data.size() + 12);
+        appendBigEndian(chunk, static_cast<uint32_t>(data.size()));
+        chunk.insert(chunk.end(), type, type + 4);
+        chunk.insert(chunk.end(), data.begin(), data.end());
+
+        // the crc covers the type and the data, not the length
+        appendBigEndian(chunk, crc32(chunk.data() + 4, chunk.size() - 4));
+        file.write(reinterpret_cast<const char*>(chunk.data()), static_cast<std::streamsize>(chunk.size()));
+    }
+
+    void writePng(const std::string& filepath, uint32_t width, uint32_t height, const uint8_t* rgba) {
+        std::ofstream file(filepath, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Failed to open " + filepath + " for writing!");
+        }
+
+        static constexpr uint8_t signature[] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+        file.write(reinterpret_cast<const char*>(signature), sizeof(signature));
+
+        std::vector<uint8_t> header = {};
+        appendBigEndian(header, width);
+        appendBigEndian(header, height);
+        header.insert(header.end(), {8, 6, 0, 0, 0});  // 8 bit rgba, deflate, adaptive filtering, no interlace
+        writeChunk(file, "IHDR", header);
+
+        // every row starts with its filter type, none here
+        size_t               row_size = static_cast<size_t>(width) * 4;
+        std::vector<uint8_t> scanlines(static_cast<size_t>(height) * (row_size + 1));
+        for (uint32_t y = 0; y < height; y++) {
+            scanlines[y * (row_size + 1)] = 0;
+            std::copy_n(rgba + y * row_size, row_size, scanlines.begin() + y * (row_size + 1) + 1);
+        }
+
+        // a zlib stream of uncompressed blocks, followed by the adler32 of the scanlines
+        std::vector<uint8_t> data = {0x78, 0x01};
+        data.reserve(scanlines.size() + scanlines.size() / max_stored_block * 5 + 16);
+        size_t offset = 0;
+        do {
+            uint32_t block = static_cast<uint32_t>(std::min<size_t>(max_stored_block, scanlines.size() - offset));
+            bool     last  = offset + block == scanlines.size();
+            data.push_back(last ? 1 : 0);
+            data.push_back(static_cast<uint8_t>(block));
+            data.push_back(static_cast<uint8_t>(block >> 8));
+            data.push_back(static_cast<uint8_t>(~block));
+            data.push_back(static_cast<uint8_t>(~block >> 8));
+            data.insert(data.end(), scanlines.begin() + offset, scanlines.begin() + offset + block);
+            offset += block;
+        } while (offset < scanlines.size());
+
+        uint32_t a = 1;
+        uint32_t b = 0;
+        for (uint8_t byte : scanlines) {
+            a = (a + byte) % 65521;
+            b = (b + a) % 65521;
+        }
+        appendBigEndian(data, (b << 16) | a);
+
+        writeChunk(file, "IDAT", data);
+        writeChunk(file, "IEND", {});
+    }
+
+    void writeRaw(const std::string& filepath, uint32_t width, uint32_t height, const uint8_t* rgba) {
+        std::ofstream file(filepath, std::ios::binary);
+        if (!file) {
+            throw std::runtime_error("Failed to open " + filepath + " for writing!");
+        }
+        file.write(reinterpret_cast<const char*>(rgba), static_cast<std::streamsize>(static_cast<size_t>(width) * height * 4));
+    }
+}  // namespace nex
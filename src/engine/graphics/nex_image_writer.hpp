@@ -0,0 +1,13 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace nex {
+    // 8 bit rgba rows, tightly packed and top row first. The png is written with stored deflate blocks, which is quick and
+    // lossless but about as large as the raw pixels, so captures don't need an image library
+    void writePng(const std::string& filepath, uint32_t width, uint32_t height, const uint8_t* rgba);
+
+    // just the pixels, the size and layout are left to whoever reads them back
+    void writeRaw(const std::string& filepath, uint32_t width, uint32_t height, const uint8_t* rgba);
+}  // namespace nex
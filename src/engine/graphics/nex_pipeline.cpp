@@ -1,11 +1,10 @@
 #include "nex_pipeline.hpp"
 
 #include <cassert>
+#include <chrono>
 #include <fstream>
 #include <iostream>
 
-#include "../scene/nex_mesh.hpp"
-
 namespace nex {
     NexPipeline::NexPipeline(NexDevice& device, const std::string& vert_shader_path, const std::string& frag_shader_path, const PipelineConfigInfo& config_info) : m_device{device} {
         createGraphicsPipeline(vert_shader_path, frag_shader_path, config_info);
@@ -90,9 +89,11 @@ namespace nex {
         pipeline_info.basePipelineIndex  = -1;
         pipeline_info.basePipelineHandle = VK_NULL_HANDLE;
 
-        if (vkCreateGraphicsPipelines(m_device.device(), VK_NULL_HANDLE, 1, &pipeline_info, nullptr, &m_graphics_pipeline) != VK_SUCCESS) {
+        auto create_start = std::chrono::steady_clock::now();
+        if (vkCreateGraphicsPipelines(m_device.device(), m_device.pipelineCache().getCache(), 1, &pipeline_info, nullptr, &m_graphics_pipeline) != VK_SUCCESS) {
             throw std::runtime_error("Failed to create graphics pipeline");
         }
+        m_device.pipelineCache().addPipelineCreation(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - create_start).count());
     }
 
     void NexPipeline::createShaderModule(const std::vector<char>& code, VkShaderModule* shader_module) {
@@ -177,8 +178,7 @@ namespace nex {
         config_info.m_dynamic_state_info.dynamicStateCount = static_cast<uint32_t>(config_info.m_dynamic_states.size());
         config_info.m_dynamic_state_info.flags             = 0;
 
-        config_info.m_binding_descriptions   = NexMesh::Vertex::getBindingDescriptions();
-        config_info.m_attribute_descriptions = NexMesh::Vertex::getAttributesDescriptions();
+        setVertexFormat(config_info, NexMesh::VertexFormat::Full);
     }
 
     void NexPipeline::enableAlphaBlending(PipelineConfigInfo& config_info) {
@@ -192,4 +192,59 @@ namespace nex {
         config_info.m_color_blend_attachment.alphaBlendOp        = VK_BLEND_OP_ADD;
     }
 
+    void NexPipeline::setVertexFormat(PipelineConfigInfo& config_info, NexMesh::VertexFormat format) {
+        if (format == NexMesh::VertexFormat::Compact) {
+            config_info.m_binding_descriptions   = NexMesh::CompactVertex::getBindingDescriptions();
+            config_info.m_attribute_descriptions = NexMesh::CompactVertex::getAttributesDescriptions();
+        } else {
+            config_info.m_binding_descriptions   = NexMesh::Vertex::getBindingDescriptions();
+            config_info.m_attribute_descriptions = NexMesh::Vertex::getAttributesDescriptions();
+        }
+    }
+
+    void NexPipeline::setShadowVertexFormat(PipelineConfigInfo& config_info, NexMesh::VertexFormat format) {
+        config_info.m_binding_descriptions   = NexMesh::getShadowBindingDescriptions(format);
+        config_info.m_attribute_descriptions = NexMesh::getShadowAttributesDescriptions(format);
+    }
+
+    NexComputePipeline::NexComputePipeline(NexDevice& device, const std::string& comp_shader_path, VkPipelineLayout pipeline_layout) : m_device{device} {
+        assert(pipeline_layout != nullptr && "Cannot create compute pipeline: no pipeline layout provided");
+
+        auto comp_shader_code = NexPipeline::readFile(comp_shader_path);
+
+        VkShaderModuleCreateInfo module_info = {};
+        module_info.sType                    = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+        module_info.codeSize                 = comp_shader_code.size();
+        module_info.pCode                    = reinterpret_cast<const uint32_t*>(comp_shader_code.data());
+
+        if (vkCreateShaderModule(m_device.device(), &module_info, nullptr, &m_comp_shader_module) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create shader module");
+        }
+
+        VkComputePipelineCreateInfo pipeline_info = {};
+        pipeline_info.sType                       = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipeline_info.stage.sType                 = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipeline_info.stage.stage                 = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipeline_info.stage.module                = m_comp_shader_module;
+        pipeline_info.stage.pName                 = "main";
+        pipeline_info.layout                      = pipeline_layout;
+        pipeline_info.basePipelineIndex           = -1;
+        pipeline_info.basePipelineHandle          = VK_NULL_HANDLE;
+
+        auto create_start = std::chrono::steady_clock::now();
+        if (vkCreateComputePipelines(m_device.device(), m_device.pipelineCache().getCache(), 1, &pipeline_info, nullptr, &m_compute_pipeline) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create compute pipeline");
+        }
+        m_device.pipelineCache().addPipelineCreation(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - create_start).count());
+    }
+
+    NexComputePipeline::~NexComputePipeline() {
+        vkDestroyShaderModule(m_device.device(), m_comp_shader_module, nullptr);
+        vkDestroyPipeline(m_device.device(), m_compute_pipeline, nullptr);
+    }
+
+    void NexComputePipeline::bind(VkCommandBuffer command_buffer) {
+        vkCmdBindPipeline(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_compute_pipeline);
+    }
+
 }  // namespace nex
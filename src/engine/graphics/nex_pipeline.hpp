@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "../core/nex_device.hpp"
+#include "../scene/nex_mesh.hpp"
 
 namespace nex {
 
@@ -39,10 +40,13 @@ namespace nex {
         void        bind(VkCommandBuffer command_buffer);
         static void defaultPipelineConfigInfo(PipelineConfigInfo& config_info);
         static void enableAlphaBlending(PipelineConfigInfo& config_info);
+        static void setVertexFormat(PipelineConfigInfo& config_info, NexMesh::VertexFormat format);
+        static void setShadowVertexFormat(PipelineConfigInfo& config_info, NexMesh::VertexFormat format);
 
-      private:
         static std::vector<char> readFile(const std::string& filepath);
 
+      private:
+
         void createGraphicsPipeline(const std::string& vert_shader_path, const std::string& frag_shader_path, const PipelineConfigInfo& config_info);
         void createShaderModule(const std::vector<char>& code, VkShaderModule* shader_module);
 
@@ -52,4 +56,20 @@ namespace nex {
         VkShaderModule m_frag_shader_module;
     };
 
+    class NexComputePipeline {
+      public:
+        NexComputePipeline(NexDevice& device, const std::string& comp_shader_path, VkPipelineLayout pipeline_layout);
+        ~NexComputePipeline();
+
+        NexComputePipeline(const NexComputePipeline&)            = delete;
+        NexComputePipeline& operator=(const NexComputePipeline&) = delete;
+
+        void bind(VkCommandBuffer command_buffer);
+
+      private:
+        NexDevice&     m_device;
+        VkPipeline     m_compute_pipeline;
+        VkShaderModule m_comp_shader_module;
+    };
+
 }  // namespace nex
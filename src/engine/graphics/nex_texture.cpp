@@ -2,29 +2,42 @@
 
 #include <stdexcept>
 
-#include "nex_buffer.hpp"
-
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.hpp"
 
 namespace nex {
     NexTexture::NexTexture(NexDevice& device, const std::string& filepath) : m_device(device) {
-        createTextureImage(filepath);
+        Builder builder;
+        builder.loadImage(filepath);
+
+        createTextureImage(builder);
+        createTextureImageView();
+        createTextureSampler();
+    }
+
+    NexTexture::NexTexture(NexDevice& device, const Builder& builder) : m_device(device) {
+        createTextureImage(builder);
         createTextureImageView();
         createTextureSampler();
     }
 
     NexTexture::~NexTexture() {
-        vkDestroySampler(m_device.device(), m_texture_sampler, nullptr);
-        vkDestroyImageView(m_device.device(), m_texture_image_view, nullptr);
-        vkDestroyImage(m_device.device(), m_texture_image, nullptr);
-        vkFreeMemory(m_device.device(), m_texture_image_memory, nullptr);
+        if (m_bindless_index != NexTextureTable::no_texture) {
+            m_device.textureTable().remove(m_bindless_index);
+        }
+        m_device.destroySampler(m_texture_sampler);
+        m_device.destroyImageView(m_texture_image_view);
+        m_device.destroyImage(m_texture_image, m_texture_image_memory);
     }
 
     void NexTexture::updateDescriptor() {
         m_descriptor.sampler     = m_texture_sampler;
         m_descriptor.imageView   = m_texture_image_view;
         m_descriptor.imageLayout = m_texture_image_layout;
+
+        if (m_bindless_index == NexTextureTable::no_texture) {
+            m_bindless_index = m_device.textureTable().add(m_descriptor);
+        }
     }
 
     void NexTexture::transitionLayout(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout) {
@@ -94,31 +107,35 @@ namespace nex {
         vkCmdPipelineBarrier(commandBuffer, source_stage, destination_stage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
     }
 
-    void NexTexture::createTextureImage(const std::string& filepath) {
-        int          width, height, channels;
-        stbi_uc*     pixels     = stbi_load(filepath.c_str(), &width, &height, &channels, STBI_rgb_alpha);
-        VkDeviceSize image_size = width * height * 4;
+    void NexTexture::Builder::PixelDeleter::operator()(unsigned char* pixels) const {
+        stbi_image_free(pixels);
+    }
+
+    void NexTexture::Builder::loadImage(const std::string& filepath) {
+        int width, height, channels;
+        m_pixels.reset(stbi_load(filepath.c_str(), &width, &height, &channels, STBI_rgb_alpha));
 
-        if (!pixels) {
+        if (!m_pixels) {
             throw std::runtime_error("failed to load texture image!");
         }
 
-        // m_mipmap_levels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
-        m_mipmap_levels = 1;
+        m_width  = static_cast<uint32_t>(width);
+        m_height = static_cast<uint32_t>(height);
+    }
 
-        NexBuffer staging_buffer(m_device, image_size, 1, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
-        staging_buffer.map();
-        staging_buffer.writeToBuffer(pixels, width * height * 4);
+    void NexTexture::createTextureImage(const Builder& builder) {
+        VkDeviceSize image_size = static_cast<VkDeviceSize>(builder.m_width) * builder.m_height * 4;
 
-        stbi_image_free(pixels);
+        // m_mipmap_levels = static_cast<uint32_t>(std::floor(std::log2(std::max(width, height)))) + 1;
+        m_mipmap_levels = 1;
 
         m_texture_format = VK_FORMAT_R8G8B8A8_SRGB;
 
         VkImageCreateInfo image_info = {};
         image_info.sType             = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
         image_info.imageType         = VK_IMAGE_TYPE_2D;
-        image_info.extent.width      = width;
-        image_info.extent.height     = height;
+        image_info.extent.width      = builder.m_width;
+        image_info.extent.height     = builder.m_height;
         image_info.extent.depth      = 1;
         image_info.mipLevels         = m_mipmap_levels;
         image_info.arrayLayers       = 1;
@@ -130,9 +147,9 @@ namespace nex {
         image_info.sharingMode       = VK_SHARING_MODE_EXCLUSIVE;
 
         m_device.createImageWithInfo(image_info, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_texture_image, m_texture_image_memory);
-        m_device.transitionImageLayout(m_texture_image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-        m_device.copyBufferToImage(staging_buffer.getBuffer(), m_texture_image, static_cast<uint32_t>(width), static_cast<uint32_t>(height), 1);
-        m_device.transitionImageLayout(m_texture_image, VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, m_mipmap_levels, m_layer_count);
+
+        // pixels are copied into the staging ring right away, the transfer and layout transitions run asynchronously
+        m_upload_handle = m_device.uploadQueue().uploadImage(m_texture_image, builder.m_pixels.get(), image_size, {builder.m_width, builder.m_height, 1}, m_mipmap_levels, m_layer_count);
 
         m_texture_image_layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
     }
@@ -6,11 +6,26 @@
 #include <string>
 
 #include "../core/nex_device.hpp"
+#include "nex_texture_table.hpp"
 
 namespace nex {
     class NexTexture {
       public:
+        // decoded pixels, safe to fill on any thread before the gpu image is created
+        struct Builder {
+            struct PixelDeleter {
+                void operator()(unsigned char* pixels) const;
+            };
+
+            std::unique_ptr<unsigned char, PixelDeleter> m_pixels = {};
+            uint32_t                                     m_width  = 0;
+            uint32_t                                     m_height = 0;
+
+            void loadImage(const std::string& filepath);
+        };
+
         NexTexture(NexDevice& device, const std::string& filepath);
+        NexTexture(NexDevice& device, const Builder& builder);
         ~NexTexture();
 
         NexTexture(const NexTexture&)            = delete;
@@ -20,7 +35,17 @@ namespace nex {
             return m_descriptor;
         }
 
+        // also takes the texture's slot in the device's texture table on the first call
         void updateDescriptor();
+
+        uint32_t getBindlessIndex() const {
+            return m_bindless_index;
+        }
+
+        bool isResident() const {
+            return m_device.uploadQueue().isResident(m_upload_handle);
+        }
+
         void transitionLayout(VkCommandBuffer commandBuffer, VkImageLayout oldLayout, VkImageLayout newLayout);
 
         static std::shared_ptr<NexTexture> createTextureFromFile(NexDevice& device, const std::string& filepath) {
@@ -28,7 +53,7 @@ namespace nex {
         }
 
       private:
-        void createTextureImage(const std::string& filepath);
+        void createTextureImage(const Builder& builder);
         void createTextureImageView();
         void createTextureSampler();
 
@@ -37,7 +62,7 @@ namespace nex {
         NexDevice& m_device;
 
         VkImage        m_texture_image        = nullptr;
-        VkDeviceMemory m_texture_image_memory = nullptr;
+        NexAllocation  m_texture_image_memory = {};
         VkImageView    m_texture_image_view   = nullptr;
         VkSampler      m_texture_sampler      = nullptr;
         VkFormat       m_texture_format;
@@ -45,5 +70,8 @@ namespace nex {
 
         uint32_t m_mipmap_levels = 1;
         uint32_t m_layer_count   = 1;
+
+        NexUploadHandle m_upload_handle  = {};
+        uint32_t        m_bindless_index = NexTextureTable::no_texture;
     };
 }  // namespace nex
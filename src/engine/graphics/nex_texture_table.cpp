@@ -0,0 +1,83 @@
+#include "nex_texture_table.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+#include "../core/nex_device.hpp"
+#include "../core/nex_swapchain.hpp"
+
+namespace nex {
+    NexTextureTable::NexTextureTable(NexDevice& device) : m_device{device} {
+        m_capacity = std::min(max_textures, m_device.m_max_bindless_textures);
+
+        // partially bound so the slots nothing was written to, or whose texture is gone, are fine as long as no draw samples them
+        m_set_layout = NexDescriptorSetLayout::Builder(m_device)
+                           .addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT, m_capacity,
+                                       VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                                           VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT)
+                           .build();
+
+        m_pool = NexDescriptorPool::Builder(m_device)
+                     .setMaxSets(1)
+                     .setPoolFlags(VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT)
+                     .addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, m_capacity)
+                     .build();
+
+        if (!m_pool->allocateDescriptor(m_set_layout->getDescriptorSetLayout(), m_set, m_capacity)) {
+            throw std::runtime_error("Failed to allocate the texture table!");
+        }
+    }
+
+    NexTextureTable::~NexTextureTable() = default;
+
+    uint32_t NexTextureTable::add(const VkDescriptorImageInfo& image_info) {
+        std::lock_guard lock(m_mutex);
+
+        uint32_t index;
+        if (!m_free_indices.empty()) {
+            index = m_free_indices.back();
+            m_free_indices.pop_back();
+        } else if (m_next_index < m_capacity) {
+            index = m_next_index++;
+        } else {
+            throw std::runtime_error("Texture table is full!");
+        }
+
+        // update after bind, so the frames in flight that have the set bound do not mind. The mutex covers the set's host access
+        VkWriteDescriptorSet write = {};
+        write.sType                = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        write.dstSet               = m_set;
+        write.dstBinding           = 0;
+        write.dstArrayElement      = index;
+        write.descriptorType       = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        write.descriptorCount      = 1;
+        write.pImageInfo           = &image_info;
+        vkUpdateDescriptorSets(m_device.device(), 1, &write, 0, nullptr);
+
+        return index;
+    }
+
+    void NexTextureTable::remove(uint32_t index) {
+        std::lock_guard lock(m_mutex);
+        m_retired.emplace_back(m_frame, index);
+    }
+
+    void NexTextureTable::nextFrame() {
+        std::lock_guard lock(m_mutex);
+        m_frame++;
+
+        // a slot freed while frame n was recorded may be sampled until frame n + max_frames_in_flight starts
+        auto released = std::partition(m_retired.begin(), m_retired.end(), [&](const auto& retired) {
+            return retired.first + NexSwapChain::max_frames_in_flight > m_frame;
+        });
+        for (auto it = released; it != m_retired.end(); ++it) {
+            m_free_indices.push_back(it->second);
+        }
+        m_retired.erase(released, m_retired.end());
+    }
+
+    uint32_t NexTextureTable::getCount() const {
+        std::lock_guard lock(m_mutex);
+        return m_next_index - static_cast<uint32_t>(m_free_indices.size() + m_retired.size());
+    }
+}  // namespace nex
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "nex_descriptors.hpp"
+
+namespace nex {
+    class NexDevice;
+
+    // One update after bind set holding a variable count array of every texture's combined image sampler. A texture takes a slot
+    // once and keeps it, so the passes bind the set once per command buffer and hand the index to the shaders in the per draw data.
+    // Freed slots are reused once the frames that may still sample them have finished.
+    class NexTextureTable {
+      public:
+        static constexpr uint32_t max_textures = 4096;
+        static constexpr uint32_t no_texture   = UINT32_MAX;
+
+        explicit NexTextureTable(NexDevice& device);
+        ~NexTextureTable();
+
+        NexTextureTable(const NexTextureTable&)            = delete;
+        NexTextureTable& operator=(const NexTextureTable&) = delete;
+
+        // thread safe, throws once every slot is taken
+        uint32_t add(const VkDescriptorImageInfo& image_info);
+        void     remove(uint32_t index);
+
+        // called once the fence of the frame about to be recorded has been waited on, returns the slots no frame in flight can sample anymore
+        void nextFrame();
+
+        VkDescriptorSetLayout getSetLayout() const {
+            return m_set_layout->getDescriptorSetLayout();
+        }
+
+        VkDescriptorSet getSet() const {
+            return m_set;
+        }
+
+        uint32_t getCapacity() const {
+            return m_capacity;
+        }
+
+        uint32_t getCount() const;
+
+      private:
+        NexDevice& m_device;
+
+        std::unique_ptr<NexDescriptorSetLayout> m_set_layout;
+        std::unique_ptr<NexDescriptorPool>      m_pool;
+        VkDescriptorSet                         m_set      = VK_NULL_HANDLE;
+        uint32_t                                m_capacity = 0;
+
+        uint32_t                                   m_next_index   = 0;  // slots below it were handed out at least once
+        std::vector<uint32_t>                      m_free_indices = {};
+        uint64_t                                   m_frame        = 0;
+        std::vector<std::pair<uint64_t, uint32_t>> m_retired      = {};
+
+        mutable std::mutex m_mutex;
+    };
+}  // namespace nex
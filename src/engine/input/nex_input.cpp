@@ -1,7 +1,7 @@
 #include "nex_input.hpp"
 
 namespace nex {
-    void Input::moveInPlaneXZ(GLFWwindow* window, float dt, NexEntity& entity) {
+    void Input::moveInPlaneXZ(GLFWwindow* window, float dt, TransformComponent& transform) {
         glm::vec3 rotate(0.0f);
 
         if (glfwGetKey(window, m_keys.m_look_right) == GLFW_PRESS) {
@@ -18,13 +18,14 @@ namespace nex {
         }
 
         if (glm::length(rotate) > std::numeric_limits<float>::epsilon()) {
-            entity.m_transform.m_rotation += glm::normalize(rotate) * dt * m_look_speed;
+            transform.m_rotation += glm::normalize(rotate) * dt * m_look_speed;
+            transform.markDirty();
         }
 
-        entity.m_transform.m_rotation.x = glm::clamp(entity.m_transform.m_rotation.x, -1.5f, 1.5f);
-        entity.m_transform.m_rotation.y = glm::mod(entity.m_transform.m_rotation.y, glm::two_pi<float>());
+        transform.m_rotation.x = glm::clamp(transform.m_rotation.x, -1.5f, 1.5f);
+        transform.m_rotation.y = glm::mod(transform.m_rotation.y, glm::two_pi<float>());
 
-        float           yaw               = entity.m_transform.m_rotation.y;
+        float           yaw               = transform.m_rotation.y;
         const glm::vec3 forward_direction = {glm::sin(yaw), 0.0f, glm::cos(yaw)};
         const glm::vec3 right_direction   = {forward_direction.z, 0.0f, -forward_direction.x};
         const glm::vec3 up_direction      = {0.0f, -1.0f, 0.0f};
@@ -50,7 +51,8 @@ namespace nex {
         }
 
         if (glm::length(move_direction) > std::numeric_limits<float>::epsilon()) {
-            entity.m_transform.m_translation += glm::normalize(move_direction) * dt * m_move_speed;
+            transform.m_translation += glm::normalize(move_direction) * dt * m_move_speed;
+            transform.markDirty();
         }
     }
 };  // namespace nex
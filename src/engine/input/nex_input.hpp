@@ -20,7 +20,7 @@ namespace nex {
             int m_look_down     = GLFW_KEY_DOWN;
         };
 
-        void moveInPlaneXZ(GLFWwindow* window, float dt, NexEntity& entity);
+        void moveInPlaneXZ(GLFWwindow* window, float dt, TransformComponent& transform);
 
         KeyMappings m_keys       = {};
         float       m_move_speed = 3.0f;
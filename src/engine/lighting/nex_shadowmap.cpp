@@ -13,10 +13,9 @@ namespace nex {
     }
 
     NexShadowMap::~NexShadowMap() {
-        vkDestroySampler(m_device.device(), m_shadow_sampler, nullptr);
-        vkDestroyImageView(m_device.device(), m_depth_image_view, nullptr);
-        vkDestroyImage(m_device.device(), m_depth_image, nullptr);
-        vkFreeMemory(m_device.device(), m_depth_image_memory, nullptr);
+        m_device.destroySampler(m_shadow_sampler);
+        m_device.destroyImageView(m_depth_image_view);
+        m_device.destroyImage(m_depth_image, m_depth_image_memory);
         vkDestroyFramebuffer(m_device.device(), m_framebuffer, nullptr);
         vkDestroyRenderPass(m_device.device(), m_render_pass, nullptr);
     }
@@ -38,7 +38,7 @@ namespace nex {
         uint32_t   m_shadow_map_height;
 
         VkImage        m_depth_image;
-        VkDeviceMemory m_depth_image_memory;
+        NexAllocation  m_depth_image_memory;
         VkImageView    m_depth_image_view;
         VkSampler      m_shadow_sampler;
         VkRenderPass   m_render_pass;
@@ -0,0 +1,165 @@
+#include "nex_asset_loader.hpp"
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <type_traits>
+
+#include "../core/nex_trace.hpp"
+
+namespace nex {
+    static double millisecondsBetween(std::chrono::steady_clock::time_point begin, std::chrono::steady_clock::time_point end) {
+        return std::chrono::duration<double, std::milli>(end - begin).count();
+    }
+
+    static std::string meshDetails(const NexMesh::Builder& builder) {
+        std::ostringstream details;
+        details << std::fixed << std::setprecision(3) << ", " << builder.indexCount() / 3 << " triangles, " << builder.vertexCount() << " vertices ("
+                << builder.vertexCount() * NexMesh::vertexSize(builder.m_vertex_format) / 1024 << " KiB), " << builder.indexSize() * 8 << " bit indices";
+
+        if (builder.submeshes().size() > 1) {
+            details << " in " << builder.submeshes().size() << " submeshes";
+        }
+        details << ", acmr ";
+
+        // a mesh from the cache was optimized when it was stored, only its current order is known
+        if (builder.m_cache_stats_before.m_acmr > 0.0f) {
+            details << builder.m_cache_stats_before.m_acmr << " -> " << builder.m_cache_stats_after.m_acmr << ", atvr " << builder.m_cache_stats_before.m_atvr << " -> "
+                    << builder.m_cache_stats_after.m_atvr;
+        } else {
+            details << builder.m_cache_stats_after.m_acmr << ", atvr " << builder.m_cache_stats_after.m_atvr;
+        }
+        return details.str();
+    }
+
+    NexAssetLoader::NexAssetLoader(NexDevice& device, NexJobSystem& job_system) : m_device{device}, m_job_system{job_system} {}
+
+    NexAssetLoader::~NexAssetLoader() {
+        // jobs still write their timings into the assets, let them finish first
+        for (auto& [path, asset] : m_meshes) {
+            if (asset->m_builder.valid()) {
+                asset->m_builder.wait();
+            }
+        }
+        for (auto& [path, asset] : m_textures) {
+            if (asset->m_builder.valid()) {
+                asset->m_builder.wait();
+            }
+        }
+    }
+
+    void NexAssetLoader::load(const std::string& mesh_path, const std::string& texture_path, OnLoaded on_loaded) {
+        if (m_meshes.empty() && m_textures.empty()) {
+            m_first_request = Clock::now();
+        }
+
+        Request request     = {};
+        request.m_mesh      = this->request(m_meshes, mesh_path);
+        request.m_texture   = texture_path.empty() ? nullptr : this->request(m_textures, texture_path);
+        request.m_on_loaded = std::move(on_loaded);
+        m_requests.push_back(std::move(request));
+    }
+
+    template <typename Resource>
+    NexAssetLoader::Asset<Resource>* NexAssetLoader::request(std::unordered_map<std::string, std::unique_ptr<Asset<Resource>>>& assets, const std::string& path) {
+        auto found = assets.find(path);
+        if (found != assets.end()) {
+            return found->second.get();
+        }
+
+        auto asset      = std::make_unique<Asset<Resource>>();
+        asset->m_path   = path;
+        asset->m_queued = Clock::now();
+
+        // the asset lives in a unique_ptr, so the worker can write its timings through a stable pointer
+        Asset<Resource>* target = asset.get();
+        asset->m_builder        = m_job_system.submit([target, &job_system = m_job_system]() {
+            target->m_decode_begin = Clock::now();
+
+            typename Resource::Builder builder;
+            if constexpr (std::is_same_v<Resource, NexMesh>) {
+                builder.loadModel(target->m_path, true, &job_system);
+            } else {
+                builder.loadImage(target->m_path);
+            }
+
+            target->m_decode_end = Clock::now();
+            return builder;
+        });
+
+        ++m_unreported;
+        return assets.emplace(path, std::move(asset)).first->second.get();
+    }
+
+    template <typename Resource>
+    bool NexAssetLoader::finalize(Asset<Resource>* asset) {
+        if (asset->m_resource) {
+            return true;
+        }
+
+        if (asset->m_builder.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+            return false;
+        }
+
+        // rethrows whatever the worker failed with
+        auto builder = asset->m_builder.get();
+
+        auto create_begin = Clock::now();
+        asset->m_resource = std::make_shared<Resource>(m_device, builder);
+        if constexpr (std::is_same_v<Resource, NexTexture>) {
+            asset->m_resource->updateDescriptor();
+        } else {
+            asset->m_details = meshDetails(builder);
+        }
+        asset->m_created   = Clock::now();
+        asset->m_create_ms = millisecondsBetween(create_begin, asset->m_created);
+        return true;
+    }
+
+    template <typename Resource>
+    void NexAssetLoader::report(Asset<Resource>& asset, const char* kind) {
+        if (asset.m_reported || !asset.m_resource || !asset.m_resource->isResident()) {
+            return;
+        }
+
+        auto now         = Clock::now();
+        asset.m_reported = true;
+        --m_unreported;
+
+        std::cout << kind << " " << asset.m_path << ": queued " << millisecondsBetween(asset.m_queued, asset.m_decode_begin) << " ms, decode "
+                  << millisecondsBetween(asset.m_decode_begin, asset.m_decode_end) << " ms, create " << asset.m_create_ms << " ms, resident after "
+                  << millisecondsBetween(asset.m_queued, now) << " ms" << asset.m_details << std::endl;
+
+        if (m_unreported == 0) {
+            std::cout << "all assets resident after " << millisecondsBetween(m_first_request, now) << " ms" << std::endl;
+        }
+    }
+
+    void NexAssetLoader::update() {
+        NEX_TRACE_SCOPE("asset loader update");
+        for (auto it = m_requests.begin(); it != m_requests.end();) {
+            // finalize both halves even if one is still decoding, so its upload joins this frame's batch
+            bool mesh_ready    = finalize(it->m_mesh);
+            bool texture_ready = it->m_texture == nullptr || finalize(it->m_texture);
+
+            if (!mesh_ready || !texture_ready) {
+                ++it;
+                continue;
+            }
+
+            it->m_on_loaded(it->m_mesh->m_resource, it->m_texture ? it->m_texture->m_resource : nullptr);
+            it = m_requests.erase(it);
+        }
+
+        if (m_unreported == 0) {
+            return;
+        }
+
+        for (auto& [path, asset] : m_meshes) {
+            report(*asset, "mesh");
+        }
+        for (auto& [path, asset] : m_textures) {
+            report(*asset, "texture");
+        }
+    }
+}  // namespace nex
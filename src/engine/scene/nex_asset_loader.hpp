@@ -0,0 +1,82 @@
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "../core/nex_job_system.hpp"
+#include "../graphics/nex_texture.hpp"
+#include "nex_mesh.hpp"
+
+namespace nex {
+    // Parses meshes and decodes images on the job system, then creates the gpu objects on the thread calling update().
+    // Their uploads land in the upload queue's current batch, so everything finished in one update goes out in one submit.
+    class NexAssetLoader {
+      public:
+        using OnLoaded = std::function<void(std::shared_ptr<NexMesh> mesh, std::shared_ptr<NexTexture> texture)>;
+
+        NexAssetLoader(NexDevice& device, NexJobSystem& job_system);
+        ~NexAssetLoader();
+
+        NexAssetLoader(const NexAssetLoader&)            = delete;
+        NexAssetLoader& operator=(const NexAssetLoader&) = delete;
+
+        // texture_path may be empty, files requested more than once are only loaded once
+        void load(const std::string& mesh_path, const std::string& texture_path, OnLoaded on_loaded);
+
+        // finalizes finished cpu work, runs the callbacks and reports per asset timings once the gpu copy is resident
+        void update();
+
+        bool isIdle() const {
+            return m_requests.empty() && m_unreported == 0;
+        }
+
+      private:
+        using Clock = std::chrono::steady_clock;
+
+        template <typename Resource>
+        struct Asset {
+            std::string                             m_path;
+            std::future<typename Resource::Builder> m_builder;
+            std::shared_ptr<Resource>               m_resource = {};
+
+            Clock::time_point m_queued       = {};
+            Clock::time_point m_decode_begin = {};
+            Clock::time_point m_decode_end   = {};
+            Clock::time_point m_created      = {};
+            double            m_create_ms    = 0.0;
+            bool              m_reported     = false;
+
+            std::string m_details = {};  // resource specific part of the report
+        };
+
+        struct Request {
+            Asset<NexMesh>*    m_mesh    = nullptr;
+            Asset<NexTexture>* m_texture = nullptr;
+            OnLoaded           m_on_loaded;
+        };
+
+        template <typename Resource>
+        Asset<Resource>* request(std::unordered_map<std::string, std::unique_ptr<Asset<Resource>>>& assets, const std::string& path);
+
+        template <typename Resource>
+        bool finalize(Asset<Resource>* asset);
+
+        template <typename Resource>
+        void report(Asset<Resource>& asset, const char* kind);
+
+        NexDevice&    m_device;
+        NexJobSystem& m_job_system;
+
+        std::unordered_map<std::string, std::unique_ptr<Asset<NexMesh>>>    m_meshes;
+        std::unordered_map<std::string, std::unique_ptr<Asset<NexTexture>>> m_textures;
+        std::vector<Request>                                                m_requests;
+
+        Clock::time_point m_first_request = {};
+        uint32_t          m_unreported    = 0;
+    };
+}  // namespace nex
@@ -0,0 +1,134 @@
+#include "nex_camera_path.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+#include <glm/gtc/constants.hpp>
+
+namespace nex {
+    // the rotation a camera at position needs to look at target, with -y up like the rest of the engine
+    static glm::vec3 lookAtRotation(const glm::vec3& position, const glm::vec3& target) {
+        glm::vec3 direction = glm::normalize(target - position);
+        return {std::asin(-direction.y), std::atan2(direction.x, direction.z), 0.0f};
+    }
+
+    bool NexCameraPath::isScripted(const std::string& name) {
+        return name == "orbit" || name == "dolly";
+    }
+
+    NexCameraPath NexCameraPath::scripted(const std::string& name) {
+        NexCameraPath path = {};
+
+        if (name == "orbit") {
+            // one turn around the origin in twelve seconds, slightly above the floor
+            constexpr int   steps  = 48;
+            constexpr float radius = 3.5f;
+            for (int i = 0; i <= steps; ++i) {
+                float     angle    = glm::two_pi<float>() * static_cast<float>(i) / steps;
+                glm::vec3 position = {-radius * std::sin(angle), -1.2f, -radius * std::cos(angle)};
+
+                // unwrapped so the yaw keeps turning the same way across the seam
+                glm::vec3 rotation = lookAtRotation(position, {0.0f, 0.0f, 0.0f});
+                rotation.y         = angle;
+                path.addKey({12.0f * static_cast<float>(i) / steps, position, rotation});
+            }
+        } else if (name == "dolly") {
+            // from far enough to see the whole stress grid down to the viking room and back out
+            glm::vec3 target = {0.0f, 0.0f, 0.0f};
+            glm::vec3 near   = {0.0f, -0.6f, -1.5f};
+            glm::vec3 far    = {0.0f, -4.0f, -12.0f};
+            path.addKey({0.0f, far, lookAtRotation(far, target)});
+            path.addKey({5.0f, near, lookAtRotation(near, target)});
+            path.addKey({10.0f, far, lookAtRotation(far, target)});
+        } else {
+            throw std::runtime_error("Unknown camera path " + name + "!");
+        }
+
+        return path;
+    }
+
+    NexCameraPath NexCameraPath::load(const std::string& filepath) {
+        std::ifstream file(filepath);
+        if (!file) {
+            throw std::runtime_error("Failed to open camera path " + filepath + "!");
+        }
+
+        NexCameraPath path = {};
+        std::string   line;
+        while (std::getline(file, line)) {
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+
+            std::istringstream stream(line);
+            NexCameraKey       key = {};
+            stream >> key.m_time >> key.m_translation.x >> key.m_translation.y >> key.m_translation.z >> key.m_rotation.x >> key.m_rotation.y >> key.m_rotation.z;
+            if (!stream) {
+                throw std::runtime_error("Malformed key in camera path " + filepath + ": " + line);
+            }
+            path.addKey(key);
+        }
+
+        if (path.isEmpty()) {
+            throw std::runtime_error("Camera path " + filepath + " has no keys!");
+        }
+        return path;
+    }
+
+    void NexCameraPath::save(const std::string& filepath) const {
+        std::ofstream file(filepath);
+        if (!file) {
+            throw std::runtime_error("Failed to open " + filepath + " for writing!");
+        }
+
+        file << "# time tx ty tz rx ry rz\n";
+        for (const auto& key : m_keys) {
+            file << key.m_time << ' ' << key.m_translation.x << ' ' << key.m_translation.y << ' ' << key.m_translation.z << ' ' << key.m_rotation.x << ' '
+                 << key.m_rotation.y << ' ' << key.m_rotation.z << '\n';
+        }
+    }
+
+    void NexCameraPath::addKey(const NexCameraKey& key) {
+        // keys arrive in order, one that goes back in time would make the search below ambiguous
+        if (!m_keys.empty() && key.m_time < m_keys.back().m_time) {
+            throw std::runtime_error("Camera keys must be added in time order!");
+        }
+        m_keys.push_back(key);
+    }
+
+    void NexCameraPath::sample(float time, TransformComponent& transform) const {
+        if (m_keys.empty()) {
+            return;
+        }
+
+        float duration = getDuration();
+        if (duration > 0.0f) {
+            time = std::fmod(time, duration);
+        }
+
+        // the first key after time, and the one before it
+        auto next = std::upper_bound(m_keys.begin(), m_keys.end(), time, [](float t, const NexCameraKey& key) { return t < key.m_time; });
+        if (next == m_keys.begin() || next == m_keys.end()) {
+            const NexCameraKey& key = next == m_keys.end() ? m_keys.back() : m_keys.front();
+            transform.m_translation = key.m_translation;
+            transform.m_rotation    = key.m_rotation;
+            transform.markDirty();
+            return;
+        }
+
+        const NexCameraKey& previous = *(next - 1);
+        float               span     = next->m_time - previous.m_time;
+        float               t        = span > 0.0f ? (time - previous.m_time) / span : 1.0f;
+
+        // recorded yaws are wrapped to [0, 2pi), turn the short way across the wrap
+        glm::vec3 turn = next->m_rotation - previous.m_rotation;
+        turn           = glm::mod(turn + glm::pi<float>(), glm::two_pi<float>()) - glm::pi<float>();
+
+        transform.m_translation = glm::mix(previous.m_translation, next->m_translation, t);
+        transform.m_rotation    = previous.m_rotation + turn * t;
+        transform.markDirty();
+    }
+}  // namespace nex
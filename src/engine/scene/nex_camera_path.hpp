@@ -0,0 +1,41 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "nex_entity.hpp"
+
+namespace nex {
+    struct NexCameraKey {
+        float     m_time        = 0.0f;  // seconds from the start of the path
+        glm::vec3 m_translation = {};
+        glm::vec3 m_rotation    = {};    // the yxz euler angles NexCamera::setViewYXZ() takes
+    };
+
+    // Keyframed viewer transform, interpolated linearly and looped once the last key has passed, so a benchmark can replay
+    // the same view for any number of frames. Paths are either scripted or recorded from a keyboard driven run.
+    class NexCameraPath {
+      public:
+        // "orbit" circles the scene, "dolly" flies toward it and back
+        static bool          isScripted(const std::string& name);
+        static NexCameraPath scripted(const std::string& name);
+
+        // one "time tx ty tz rx ry rz" key per line, lines starting with # are skipped
+        static NexCameraPath load(const std::string& filepath);
+        void                 save(const std::string& filepath) const;
+
+        void addKey(const NexCameraKey& key);
+        void sample(float time, TransformComponent& transform) const;
+
+        float getDuration() const {
+            return m_keys.empty() ? 0.0f : m_keys.back().m_time;
+        }
+
+        bool isEmpty() const {
+            return m_keys.empty();
+        }
+
+      private:
+        std::vector<NexCameraKey> m_keys = {};
+    };
+}  // namespace nex
@@ -0,0 +1,27 @@
+#include "nex_draw_buckets.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace nex {
+    bool reserveDrawBuffer(NexDevice& device, std::unique_ptr<NexBuffer>& buffer, uint32_t& capacity, uint32_t count, VkDeviceSize element_size, VkBufferUsageFlags usage) {
+        if (count <= capacity && buffer) {
+            return false;
+        }
+
+        capacity = std::bit_ceil(std::max(count, 1u));
+        buffer   = std::make_unique<NexBuffer>(device, element_size, capacity, usage, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+        buffer->map();
+        return true;
+    }
+
+    void writeDrawBufferSet(NexDescriptorSetLayout& layout, NexDescriptorPool& pool, NexBuffer& buffer, VkDescriptorSet& set) {
+        auto buffer_info = buffer.descriptorInfo();
+        auto writer      = NexDescriptorWriter(layout, pool).writeBuffer(0, &buffer_info);
+        if (set == VK_NULL_HANDLE) {
+            writer.build(set);
+        } else {
+            writer.overwrite(set);
+        }
+    }
+}  // namespace nex
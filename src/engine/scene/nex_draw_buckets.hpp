@@ -0,0 +1,86 @@
+#pragma once
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+#include "../core/nex_device.hpp"
+#include "../graphics/nex_buffer.hpp"
+#include "../graphics/nex_descriptors.hpp"
+
+namespace nex {
+    // Groups a frame's draws by the state they share, the gpu scene keys on pipeline and geometry buffers, the instancer on the mesh.
+    // Buckets keep their item vectors between frames, so steady state updates do not allocate.
+    template <typename Key, typename Item, typename Same = std::equal_to<Key>>
+    class NexDrawBuckets {
+      public:
+        // call once per frame before the first find()
+        void clear() {
+            // buckets that stayed empty for a whole frame belong to geometry that is gone
+            std::erase_if(m_buckets, [](const Bucket& bucket) {
+                return bucket.m_items.empty();
+            });
+            for (auto& bucket : m_buckets) {
+                bucket.m_items.clear();
+            }
+            m_last = 0;
+        }
+
+        std::vector<Item>& find(const Key& key) {
+            // entities sharing a mesh tend to come in runs, so the previous hit is checked first
+            if (m_last < m_buckets.size() && Same{}(m_buckets[m_last].m_key, key)) {
+                return m_buckets[m_last].m_items;
+            }
+
+            for (m_last = 0; m_last < m_buckets.size(); ++m_last) {
+                if (Same{}(m_buckets[m_last].m_key, key)) {
+                    return m_buckets[m_last].m_items;
+                }
+            }
+
+            m_buckets.push_back({key, {}});
+            return m_buckets.back().m_items;
+        }
+
+        uint32_t size() const {
+            return static_cast<uint32_t>(m_buckets.size());
+        }
+
+        uint32_t itemCount() const {
+            size_t count = 0;
+            for (const auto& bucket : m_buckets) {
+                count += bucket.m_items.size();
+            }
+            return static_cast<uint32_t>(count);
+        }
+
+        // calls emit(key, items, first) for every bucket with items, first being where its items start once flattened into one buffer
+        template <typename Emit>
+        void flatten(uint32_t& offset, Emit&& emit) const {
+            for (const auto& bucket : m_buckets) {
+                if (bucket.m_items.empty()) {
+                    continue;
+                }
+
+                emit(bucket.m_key, bucket.m_items, offset);
+                offset += static_cast<uint32_t>(bucket.m_items.size());
+            }
+        }
+
+      private:
+        struct Bucket {
+            Key               m_key   = {};
+            std::vector<Item> m_items = {};
+        };
+
+        std::vector<Bucket> m_buckets = {};
+        size_t              m_last    = 0;
+    };
+
+    // Grows a per frame host visible draw buffer to the next power of two and maps it, returns whether it was replaced.
+    // The frame's fence has been waited on, so its previous buffer is no longer read and can go right away
+    bool reserveDrawBuffer(NexDevice& device, std::unique_ptr<NexBuffer>& buffer, uint32_t& capacity, uint32_t count, VkDeviceSize element_size, VkBufferUsageFlags usage);
+
+    // points binding 0 of the set at the whole buffer, allocating the set the first time
+    void writeDrawBufferSet(NexDescriptorSetLayout& layout, NexDescriptorPool& pool, NexBuffer& buffer, VkDescriptorSet& set);
+}  // namespace nex
@@ -1,7 +1,7 @@
 #include "nex_entity.hpp"
 
 namespace nex {
-    glm::mat4 TransformComponent::mat4() {
+    glm::mat4 TransformComponent::localMatrix() const {
         const float c3 = glm::cos(m_rotation.z);
         const float s3 = glm::sin(m_rotation.z);
         const float c2 = glm::cos(m_rotation.x);
@@ -30,7 +30,7 @@ namespace nex {
                          {m_translation.x, m_translation.y, m_translation.z, 1.0f}};
     }
 
-    glm::mat3 TransformComponent::normalMatrix() {
+    glm::mat3 TransformComponent::localNormalMatrix() const {
         const float c3 = glm::cos(m_rotation.z);
         const float s3 = glm::sin(m_rotation.z);
         const float c2 = glm::cos(m_rotation.x);
@@ -59,12 +59,15 @@ namespace nex {
         };
     }
 
-    NexEntity NexEntity::makePointLight(float intesity, float radius, glm::vec3 color) {
-        NexEntity entity                  = NexEntity::create();
-        entity.m_color                    = color;
-        entity.m_transform.m_scale.x      = radius;
-        entity.m_point_light              = std::make_unique<PointLightComponent>();
-        entity.m_point_light->m_intensity = intesity;
+    NexEntity makePointLight(NexRegistry& registry, float intensity, float radius, glm::vec3 color) {
+        NexEntity entity = registry.create();
+
+        auto& transform     = registry.emplace<TransformComponent>(entity);
+        transform.m_scale.x = radius;
+
+        auto& light       = registry.emplace<PointLightComponent>(entity);
+        light.m_intensity = intensity;
+        light.m_color     = color;
         return entity;
     }
 
@@ -1,57 +1,66 @@
 #pragma once
 
 #include <memory>
-#include <unordered_map>
 
 #include "nex_mesh.hpp"
+#include "nex_registry.hpp"
 #include "../graphics/nex_texture.hpp"
 
 namespace nex {
+    // Local translation, scale and rotation, plus the world and normal matrices NexSceneGraph caches from them. Call markDirty()
+    // after changing a transform that was already updated once, mat4() and normalMatrix() lag behind until the next update
     struct TransformComponent {
         glm::vec3 m_translation = {};
         glm::vec3 m_scale       = {1.0f, 1.0f, 1.0f};
         glm::vec3 m_rotation    = {};
 
-        glm::mat4 mat4();
-        glm::mat3 normalMatrix();
-    };
-
-    struct PointLightComponent {
-        float m_intensity = 1.0f;
-    };
+        glm::mat4 m_local_matrix  = {1.0f};  // relative to the parent, if any
+        glm::mat4 m_world_matrix  = {1.0f};
+        glm::mat3 m_normal_matrix = {1.0f};
+        bool      m_dirty         = true;
 
-    class NexEntity {
-      public:
-        using id_t = unsigned int;
-        using Map  = std::unordered_map<id_t, NexEntity>;
+        void markDirty() {
+            m_dirty = true;
+        }
 
-        static NexEntity create() {
-            static id_t current_id = 0;
-            return NexEntity(current_id++);
+        const glm::mat4& mat4() const {
+            return m_world_matrix;
         }
 
-        static NexEntity makePointLight(float intesity = 10.f, float radius = 0.1f, glm::vec3 color = {1.0f, 1.0f, 1.0f});
+        const glm::mat3& normalMatrix() const {
+            return m_normal_matrix;
+        }
 
-        NexEntity(const NexEntity&)            = delete;
-        NexEntity& operator=(const NexEntity&) = delete;
-        NexEntity(NexEntity&&)                 = default;
-        NexEntity& operator=(NexEntity&&)      = default;
+        // computed from the local fields on every call
+        glm::mat4 localMatrix() const;
+        glm::mat3 localNormalMatrix() const;
+    };
 
-        id_t getId() const {
-            return m_id;
-        }
+    // Links an entity into the scene graph, children are chained through their siblings. Only change it through
+    // NexSceneGraph::setParent(), which keeps both ends of the links in sync
+    struct HierarchyComponent {
+        NexEntity m_parent       = null_entity;
+        NexEntity m_first_child  = null_entity;
+        NexEntity m_next_sibling = null_entity;
+        NexEntity m_prev_sibling = null_entity;
+    };
 
-        int                m_material_index;
-        glm::vec3          m_color;
-        TransformComponent m_transform;
+    // the mesh is attached once the asset loader is done with it, until then the entity is skipped by every pass
+    struct MeshComponent {
+        std::shared_ptr<NexMesh> m_mesh           = {};
+        int                      m_material_index = 0;
+    };
 
-        // Optional components
-        std::shared_ptr<NexMesh>             m_model       = {};
-        std::unique_ptr<PointLightComponent> m_point_light = {};
-        std::shared_ptr<NexTexture>          m_texture     = {};
+    // entities with a mesh but without a texture are drawn with the renderer's default one
+    struct TextureComponent {
+        std::shared_ptr<NexTexture> m_texture = {};
+    };
 
-      private:
-        NexEntity(id_t id) : m_id(id) {}
-        id_t m_id;
+    // the light's radius is the x scale of its transform
+    struct PointLightComponent {
+        float     m_intensity = 1.0f;
+        glm::vec3 m_color     = {1.0f, 1.0f, 1.0f};
     };
+
+    NexEntity makePointLight(NexRegistry& registry, float intensity = 10.f, float radius = 0.1f, glm::vec3 color = {1.0f, 1.0f, 1.0f});
 };  // namespace nex
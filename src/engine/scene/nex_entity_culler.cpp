@@ -0,0 +1,132 @@
+#include "nex_entity_culler.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+
+#include "../core/nex_trace.hpp"
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace nex {
+#if defined(__AVX__)
+    static constexpr size_t cull_lanes = 8;
+#elif defined(__SSE2__) || defined(_M_X64)
+    static constexpr size_t cull_lanes = 4;
+#else
+    static constexpr size_t cull_lanes = 1;
+#endif
+
+    void NexEntityCuller::gather(NexRegistry& registry) {
+        NEX_TRACE_SCOPE("entity gather");
+        m_entities.clear();
+        m_center_x.clear();
+        m_center_y.clear();
+        m_center_z.clear();
+        m_radius.clear();
+
+        registry.view<TransformComponent, MeshComponent>().each([&](NexEntity entity, TransformComponent& transform, MeshComponent& mesh) {
+            if (mesh.m_mesh == nullptr || !mesh.m_mesh->isResident()) {
+                return;
+            }
+
+            // the sphere is scaled by the largest world axis so it still encloses the mesh under non uniform scale
+            const glm::vec4& sphere = mesh.m_mesh->getBoundingSphere();
+            const glm::mat4& world  = transform.mat4();
+            glm::vec3        center = glm::vec3(world * glm::vec4{glm::vec3(sphere), 1.0f});
+            glm::vec3        scale  = {glm::length(glm::vec3(world[0])), glm::length(glm::vec3(world[1])), glm::length(glm::vec3(world[2]))};
+
+            m_entities.push_back(entity);
+            m_center_x.push_back(center.x);
+            m_center_y.push_back(center.y);
+            m_center_z.push_back(center.z);
+            m_radius.push_back(sphere.w * std::max({scale.x, scale.y, scale.z}));
+        });
+
+        // an infinitely negative radius fails every plane
+        size_t padded = (m_entities.size() + cull_lanes - 1) / cull_lanes * cull_lanes;
+        m_center_x.resize(padded, 0.0f);
+        m_center_y.resize(padded, 0.0f);
+        m_center_z.resize(padded, 0.0f);
+        m_radius.resize(padded, -std::numeric_limits<float>::infinity());
+    }
+
+    void NexEntityCuller::cull(const NexFrustum& frustum, std::vector<NexEntity>& visible) const {
+        NEX_TRACE_SCOPE("entity cull");
+        visible.clear();
+
+#if defined(__AVX__)
+        __m256 plane_x[NexFrustum::plane_count];
+        __m256 plane_y[NexFrustum::plane_count];
+        __m256 plane_z[NexFrustum::plane_count];
+        __m256 plane_w[NexFrustum::plane_count];
+        for (int p = 0; p < NexFrustum::plane_count; ++p) {
+            plane_x[p] = _mm256_set1_ps(frustum.m_planes[p].x);
+            plane_y[p] = _mm256_set1_ps(frustum.m_planes[p].y);
+            plane_z[p] = _mm256_set1_ps(frustum.m_planes[p].z);
+            plane_w[p] = _mm256_set1_ps(frustum.m_planes[p].w);
+        }
+
+        for (size_t i = 0; i < m_radius.size(); i += cull_lanes) {
+            __m256 x          = _mm256_loadu_ps(&m_center_x[i]);
+            __m256 y          = _mm256_loadu_ps(&m_center_y[i]);
+            __m256 z          = _mm256_loadu_ps(&m_center_z[i]);
+            __m256 neg_radius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&m_radius[i]));
+
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (int p = 0; p < NexFrustum::plane_count; ++p) {
+                __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(plane_x[p], x), _mm256_mul_ps(plane_y[p], y)), _mm256_add_ps(_mm256_mul_ps(plane_z[p], z), plane_w[p]));
+                inside          = _mm256_and_ps(inside, _mm256_cmp_ps(distance, neg_radius, _CMP_GE_OQ));
+            }
+
+            for (int mask = _mm256_movemask_ps(inside); mask != 0; mask &= mask - 1) {
+                visible.push_back(m_entities[i + std::countr_zero(static_cast<unsigned>(mask))]);
+            }
+        }
+#elif defined(__SSE2__) || defined(_M_X64)
+        __m128 plane_x[NexFrustum::plane_count];
+        __m128 plane_y[NexFrustum::plane_count];
+        __m128 plane_z[NexFrustum::plane_count];
+        __m128 plane_w[NexFrustum::plane_count];
+        for (int p = 0; p < NexFrustum::plane_count; ++p) {
+            plane_x[p] = _mm_set1_ps(frustum.m_planes[p].x);
+            plane_y[p] = _mm_set1_ps(frustum.m_planes[p].y);
+            plane_z[p] = _mm_set1_ps(frustum.m_planes[p].z);
+            plane_w[p] = _mm_set1_ps(frustum.m_planes[p].w);
+        }
+
+        for (size_t i = 0; i < m_radius.size(); i += cull_lanes) {
+            __m128 x          = _mm_loadu_ps(&m_center_x[i]);
+            __m128 y          = _mm_loadu_ps(&m_center_y[i]);
+            __m128 z          = _mm_loadu_ps(&m_center_z[i]);
+            __m128 neg_radius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&m_radius[i]));
+
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (int p = 0; p < NexFrustum::plane_count; ++p) {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(plane_x[p], x), _mm_mul_ps(plane_y[p], y)), _mm_add_ps(_mm_mul_ps(plane_z[p], z), plane_w[p]));
+                inside          = _mm_and_ps(inside, _mm_cmpge_ps(distance, neg_radius));
+            }
+
+            for (int mask = _mm_movemask_ps(inside); mask != 0; mask &= mask - 1) {
+                visible.push_back(m_entities[i + std::countr_zero(static_cast<unsigned>(mask))]);
+            }
+        }
+#else
+        cullScalar(frustum, visible);
+#endif
+    }
+
+    void NexEntityCuller::cullScalar(const NexFrustum& frustum, std::vector<NexEntity>& visible) const {
+        visible.clear();
+
+        for (size_t i = 0; i < m_entities.size(); ++i) {
+            if (frustum.intersectsSphere({m_center_x[i], m_center_y[i], m_center_z[i]}, m_radius[i])) {
+                visible.push_back(m_entities[i]);
+            }
+        }
+    }
+}  // namespace nex
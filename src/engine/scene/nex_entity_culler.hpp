@@ -0,0 +1,41 @@
+#pragma once
+
+#include <vector>
+
+#include "nex_entity.hpp"
+#include "nex_frustum.hpp"
+
+namespace nex {
+    // entities that passed the frustum test of each pass, in no particular order
+    struct NexVisibleEntities {
+        std::vector<NexEntity> m_camera;  // main pass
+        std::vector<NexEntity> m_light;   // shadow pass
+    };
+
+    // Frustum culling on the cpu, for the passes drawing entity by entity. The world space bounding spheres of every drawable entity
+    // are gathered into structure of arrays once per frame and tested a full register at a time, 8 spheres with AVX, 4 with SSE.
+    class NexEntityCuller {
+      public:
+        // collects the spheres of the entities with a resident mesh
+        void gather(NexRegistry& registry);
+
+        // appends the gathered entities intersecting the frustum to visible, which is cleared first
+        void cull(const NexFrustum& frustum, std::vector<NexEntity>& visible) const;
+
+        // same test one sphere at a time, kept for comparison
+        void cullScalar(const NexFrustum& frustum, std::vector<NexEntity>& visible) const;
+
+        size_t getEntityCount() const {
+            return m_entities.size();
+        }
+
+      private:
+        std::vector<NexEntity> m_entities;
+
+        // padded to a whole register with spheres that are never visible
+        std::vector<float> m_center_x;
+        std::vector<float> m_center_y;
+        std::vector<float> m_center_z;
+        std::vector<float> m_radius;
+    };
+}  // namespace nex
@@ -6,7 +6,12 @@
 #include "nex_entity.hpp"
 
 namespace nex {
-    class NexDescriptorPool;
+    class NexDescriptorAllocator;
+    class NexGpuProfiler;
+    class NexGpuScene;
+    class NexInstancer;
+    class NexParallelRecorder;
+    struct NexVisibleEntities;
 
 #define MAX_LIGHTS 10
 
@@ -25,13 +30,18 @@ namespace nex {
     };
 
     struct NexFrameInfo {
-        int                m_frame_index;
-        float              m_frame_time;
-        VkCommandBuffer    m_command_buffer;
-        NexCamera&         m_camera;
-        VkDescriptorSet    m_global_descriptor_set;
-        NexDescriptorPool& m_frame_descriptor_pool;
-        NexEntity::Map&    m_entities;
+        int                     m_frame_index;
+        float                   m_frame_time;
+        VkCommandBuffer         m_command_buffer;
+        NexCamera&              m_camera;
+        VkDescriptorSet         m_global_descriptor_set;
+        NexDescriptorAllocator& m_frame_descriptor_allocator;  // sets built through it are cached for as long as every frame keeps building them
+        NexRegistry&            m_registry;
+        NexGpuScene*            m_gpu_scene         = nullptr;  // set when the passes draw indirectly from the gpu scene
+        NexVisibleEntities*     m_visible_entities  = nullptr;  // set when the entities were frustum culled, the passes then only draw those
+        NexInstancer*           m_instancer         = nullptr;  // set when the per entity passes draw instanced, already updated with the visible entities
+        NexParallelRecorder*    m_parallel_recorder = nullptr;  // set when the per entity passes record on the job system, their render passes then only take secondaries
+        NexGpuProfiler*         m_gpu_profiler      = nullptr;  // set when the frame is timed, passes that time themselves open their scopes on it
     };
 
 }  // namespace nex
@@ -0,0 +1,44 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+namespace nex {
+    // The six planes of a view projection, pointing inwards and normalized so a point's distance is dot(plane.xyz, p) + plane.w
+    struct NexFrustum {
+        enum Plane { Left, Right, Bottom, Top, Near, Far, plane_count };
+
+        glm::vec4 m_planes[plane_count] = {};
+
+        // Gribb and Hartmann, with the 0 to 1 clip depth of GLM_FORCE_DEPTH_ZERO_TO_ONE
+        static NexFrustum fromMatrix(const glm::mat4& view_projection) {
+            glm::vec4 row0 = {view_projection[0][0], view_projection[1][0], view_projection[2][0], view_projection[3][0]};
+            glm::vec4 row1 = {view_projection[0][1], view_projection[1][1], view_projection[2][1], view_projection[3][1]};
+            glm::vec4 row2 = {view_projection[0][2], view_projection[1][2], view_projection[2][2], view_projection[3][2]};
+            glm::vec4 row3 = {view_projection[0][3], view_projection[1][3], view_projection[2][3], view_projection[3][3]};
+
+            NexFrustum frustum       = {};
+            frustum.m_planes[Left]   = row3 + row0;
+            frustum.m_planes[Right]  = row3 - row0;
+            frustum.m_planes[Bottom] = row3 + row1;
+            frustum.m_planes[Top]    = row3 - row1;
+            frustum.m_planes[Near]   = row2;
+            frustum.m_planes[Far]    = row3 - row2;
+
+            for (auto& plane : frustum.m_planes) {
+                plane /= glm::length(glm::vec3(plane));
+            }
+            return frustum;
+        }
+
+        bool intersectsSphere(const glm::vec3& center, float radius) const {
+            for (const auto& plane : m_planes) {
+                if (glm::dot(glm::vec3(plane), center) + plane.w < -radius) {
+                    return false;
+                }
+            }
+            return true;
+        }
+    };
+}  // namespace nex
@@ -0,0 +1,176 @@
+#include "nex_gpu_scene.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+
+#include "../core/nex_trace.hpp"
+
+namespace nex {
+    NexGpuScene::NexGpuScene(NexDevice& device) : m_device{device} {
+        // drawIndirectCount reads up to a batch's worth of commands per call, so it needs multiDrawIndirect as well
+        m_compacting = m_device.m_draw_indirect_count && m_device.m_enabled_features.multiDrawIndirect;
+
+        m_object_set_layout = NexDescriptorSetLayout::Builder(m_device).addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT).build();
+        m_descriptor_pool   = NexDescriptorPool::Builder(m_device)
+                                .setMaxSets(NexSwapChain::max_frames_in_flight)
+                                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, NexSwapChain::max_frames_in_flight)
+                                .build();
+
+        for (auto& frame : m_frames) {
+            reserve(frame, initial_capacity, initial_capacity);
+        }
+    }
+
+    NexGpuScene::~NexGpuScene() {}
+
+    void NexGpuScene::reserve(FrameResources& frame, uint32_t object_count, uint32_t command_count) {
+        if (reserveDrawBuffer(m_device, frame.m_objects, frame.m_object_capacity, object_count, sizeof(NexObjectData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)) {
+            writeDrawBufferSet(*m_object_set_layout, *m_descriptor_pool, *frame.m_objects, frame.m_object_set);
+        }
+
+        // also read by the culling pass
+        reserveDrawBuffer(m_device, frame.m_commands, frame.m_command_capacity, command_count, sizeof(VkDrawIndexedIndirectCommand),
+                          VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    }
+
+    void NexGpuScene::reserveCulling(FrameResources& frame, uint32_t command_count, uint32_t batch_count) {
+        // the culled commands are only written by the culling pass and share the records' capacity
+        if (reserveDrawBuffer(m_device, frame.m_cull_records, frame.m_cull_capacity, command_count, sizeof(NexCullRecord), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)) {
+            frame.m_culled_commands = std::make_unique<NexBuffer>(m_device, sizeof(VkDrawIndexedIndirectCommand), frame.m_cull_capacity,
+                                                                  VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        }
+
+        if (batch_count > frame.m_batch_capacity || !frame.m_draw_counts) {
+            frame.m_batch_capacity = std::bit_ceil(std::max(batch_count, 1u));
+            frame.m_draw_counts    = std::make_unique<NexBuffer>(m_device, sizeof(uint32_t), sizeof(NexCullingStats) / sizeof(uint32_t) + frame.m_batch_capacity,
+                                                                 VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                                                                 VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+            frame.m_draw_counts->map();
+        }
+    }
+
+    void NexGpuScene::update(int frame_index, NexRegistry& registry) {
+        NEX_TRACE_SCOPE("gpu scene update");
+        m_buckets.clear();
+        m_shadow_buckets.clear();
+
+        // objects are written straight into the mapped buffer, sized for the case where every entity is drawn
+        FrameResources& frame = m_frames[frame_index];
+        auto drawables = registry.view<TransformComponent, MeshComponent>();
+        reserve(frame, static_cast<uint32_t>(drawables.sizeHint()), 0);
+
+        auto*    objects      = static_cast<NexObjectData*>(frame.m_objects->getMappedMemory());
+        uint32_t object_count = 0;
+
+        drawables.each([&](NexEntity entity, TransformComponent& transform_component, MeshComponent& mesh_component) {
+            // meshes without indices are left to the per entity path
+            if (!mesh_component.m_mesh || !mesh_component.m_mesh->isResident() || !mesh_component.m_mesh->getIndices()) {
+                return;
+            }
+
+            const NexMesh& mesh   = *mesh_component.m_mesh;
+            uint32_t       object = object_count++;
+
+            const glm::mat4& transform = transform_component.mat4();
+            glm::vec4        sphere    = mesh.getBoundingSphere();
+            float            scale     = std::max({glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))});
+
+            NexObjectData& data    = objects[object];
+            data.m_model_matrix    = transform * mesh.getDequantizeMatrix();
+            data.m_normal_matrix   = transform_component.normalMatrix();
+            data.m_bounding_sphere = glm::vec4{glm::vec3(transform * glm::vec4{glm::vec3(sphere), 1.0f}), sphere.w * scale};
+            data.m_material_index  = mesh_component.m_material_index;
+
+            // an entity whose texture is still streaming in already casts its shadow
+            TextureComponent* texture = registry.tryGet<TextureComponent>(entity);
+            if (texture == nullptr || texture->m_texture == nullptr || texture->m_texture->isResident()) {
+                data.m_texture_index = texture != nullptr && texture->m_texture != nullptr ? texture->m_texture->getBindlessIndex() : NexTextureTable::no_texture;
+
+                NexIndirectBatch state = {};
+                state.m_vertex_format  = mesh.getVertexFormat();
+                state.m_vertex_buffer  = mesh.getVertices().m_buffer;
+                state.m_index_buffer   = mesh.getIndices().m_buffer;
+                state.m_index_type     = mesh.getIndexType();
+
+                mesh.appendDrawCommands(m_buckets.find(state), object);
+            }
+
+            NexIndirectBatch shadow_state  = {};
+            shadow_state.m_vertex_format   = mesh.getVertexFormat();
+            shadow_state.m_position_stream = mesh.hasShadowStream();
+            shadow_state.m_vertex_buffer   = shadow_state.m_position_stream ? mesh.getShadowVertices().m_buffer : mesh.getVertices().m_buffer;
+            shadow_state.m_index_buffer    = shadow_state.m_position_stream ? mesh.getShadowIndices().m_buffer : mesh.getIndices().m_buffer;
+            shadow_state.m_index_type      = mesh.getIndexType();
+
+            auto& shadow_commands = m_shadow_buckets.find(shadow_state);
+            if (shadow_state.m_position_stream) {
+                mesh.appendShadowDrawCommands(shadow_commands, object);
+            } else {
+                mesh.appendDrawCommands(shadow_commands, object);
+            }
+        });
+
+        uint32_t command_count = m_buckets.itemCount() + m_shadow_buckets.itemCount();
+        reserve(frame, 0, command_count);
+        if (m_culling) {
+            reserveCulling(frame, command_count, m_buckets.size() + m_shadow_buckets.size());
+        }
+
+        auto*    commands       = static_cast<VkDrawIndexedIndirectCommand*>(frame.m_commands->getMappedMemory());
+        auto*    records        = m_culling ? static_cast<NexCullRecord*>(frame.m_cull_records->getMappedMemory()) : nullptr;
+        uint32_t command_offset = 0;
+        uint32_t batch_index    = 0;
+        flattenBuckets(m_buckets, m_batches, commands, records, command_offset, batch_index);
+        m_draw_count = command_offset;
+        flattenBuckets(m_shadow_buckets, m_shadow_batches, commands, records, command_offset, batch_index);
+
+        m_object_count  = object_count;
+        m_command_count = command_offset;
+        if (m_object_count > 0) {
+            frame.m_objects->flush(m_object_count * sizeof(NexObjectData));
+            frame.m_commands->flush(command_offset * sizeof(VkDrawIndexedIndirectCommand));
+            if (m_culling) {
+                frame.m_cull_records->flush(command_offset * sizeof(NexCullRecord));
+            }
+        }
+    }
+
+    void NexGpuScene::flattenBuckets(const Buckets& buckets, std::vector<NexIndirectBatch>& batches, VkDrawIndexedIndirectCommand* commands, NexCullRecord* records,
+                                     uint32_t& command_offset, uint32_t& batch_index) {
+        batches.clear();
+        buckets.flatten(command_offset, [&](const NexIndirectBatch& state, const std::vector<VkDrawIndexedIndirectCommand>& bucket_commands, uint32_t first_command) {
+            NexIndirectBatch& batch = batches.emplace_back(state);
+            batch.m_first_command   = first_command;
+            batch.m_command_count   = static_cast<uint32_t>(bucket_commands.size());
+            batch.m_batch_index     = batch_index++;
+
+            std::memcpy(commands + first_command, bucket_commands.data(), bucket_commands.size() * sizeof(VkDrawIndexedIndirectCommand));
+            if (records != nullptr) {
+                std::fill_n(records + first_command, batch.m_command_count, NexCullRecord{batch.m_batch_index, first_command});
+            }
+        });
+    }
+
+    void NexGpuScene::drawBatch(VkCommandBuffer command_buffer, int frame_index, const NexIndirectBatch& batch) const {
+        const FrameResources& frame    = m_frames[frame_index];
+        VkBuffer              commands = m_culling ? frame.m_culled_commands->getBuffer() : frame.m_commands->getBuffer();
+        constexpr uint32_t    stride   = sizeof(VkDrawIndexedIndirectCommand);
+
+        // the culled commands of a batch are packed at its start, followed by stale ones the count leaves out
+        if (m_culling && m_compacting) {
+            VkDeviceSize count_offset = sizeof(NexCullingStats) + VkDeviceSize{batch.m_batch_index} * sizeof(uint32_t);
+            vkCmdDrawIndexedIndirectCount(command_buffer, commands, VkDeviceSize{batch.m_first_command} * stride, frame.m_draw_counts->getBuffer(), count_offset, batch.m_command_count,
+                                          stride);
+            return;
+        }
+
+        // without multiDrawIndirect every draw call may only read a single command
+        uint32_t max_draw_count = m_device.m_enabled_features.multiDrawIndirect ? m_device.m_properties.limits.maxDrawIndirectCount : 1;
+
+        for (uint32_t first = 0; first < batch.m_command_count; first += max_draw_count) {
+            uint32_t draw_count = std::min(max_draw_count, batch.m_command_count - first);
+            vkCmdDrawIndexedIndirect(command_buffer, commands, VkDeviceSize{batch.m_first_command + first} * stride, draw_count, stride);
+        }
+    }
+}  // namespace nex
@@ -0,0 +1,190 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "../core/nex_device.hpp"
+#include "../core/nex_swapchain.hpp"
+#include "../graphics/nex_buffer.hpp"
+#include "../graphics/nex_descriptors.hpp"
+#include "nex_draw_buckets.hpp"
+#include "nex_entity.hpp"
+
+namespace nex {
+    // std430 layout of the per object storage buffer, indexed with gl_InstanceIndex
+    struct NexObjectData {
+        glm::mat4 m_model_matrix    = {1.0f};  // includes the mesh's dequantization
+        glm::mat4 m_normal_matrix   = {1.0f};
+        glm::vec4 m_bounding_sphere = {};  // world space center and radius, for the culling pass
+        int       m_material_index  = 0;
+        uint32_t  m_texture_index   = NexTextureTable::no_texture;  // into the device's texture table, no_texture for the renderer's default texture
+        int       m_padding[2]      = {};
+    };
+
+    // What the culling pass needs next to each indirect command to compact it into its batch
+    struct NexCullRecord {
+        uint32_t m_batch         = 0;
+        uint32_t m_first_command = 0;  // of the batch, the compacted commands are written from here on
+    };
+
+    // Head of the draw count buffer, the per batch draw counts follow it. Written by the culling pass, read back once the frame is done
+    struct NexCullingStats {
+        uint32_t m_tested           = 0;
+        uint32_t m_visible          = 0;
+        uint32_t m_frustum_culled   = 0;
+        uint32_t m_occlusion_culled = 0;
+        uint32_t m_shadow_tested    = 0;
+        uint32_t m_shadow_visible   = 0;
+        uint32_t m_padding[2]       = {};
+    };
+
+    // A run of indirect commands that share a pipeline and geometry buffers, drawn with one multi draw call. Textures come from the texture table
+    struct NexIndirectBatch {
+        NexMesh::VertexFormat m_vertex_format   = NexMesh::VertexFormat::Full;
+        bool                  m_position_stream = false;  // shadow batches only
+        VkBuffer              m_vertex_buffer   = VK_NULL_HANDLE;
+        VkBuffer              m_index_buffer    = VK_NULL_HANDLE;
+        VkIndexType           m_index_type      = VK_INDEX_TYPE_UINT32;
+        uint32_t              m_first_command   = 0;
+        uint32_t              m_command_count   = 0;
+        uint32_t              m_batch_index     = 0;  // main batches first, then the shadow batches
+
+        bool sameState(const NexIndirectBatch& other) const {
+            return m_vertex_format == other.m_vertex_format && m_position_stream == other.m_position_stream && m_vertex_buffer == other.m_vertex_buffer &&
+                   m_index_buffer == other.m_index_buffer && m_index_type == other.m_index_type;
+        }
+    };
+
+    // Per frame storage buffer of object transforms plus the indirect commands of the main and shadow passes, so both can draw
+    // the whole scene with a few vkCmdDrawIndexedIndirect calls instead of a push constant and a draw per entity.
+    class NexGpuScene {
+      public:
+        static constexpr uint32_t initial_capacity = 1024;
+
+        explicit NexGpuScene(NexDevice& device);
+        ~NexGpuScene();
+
+        NexGpuScene(const NexGpuScene&)            = delete;
+        NexGpuScene& operator=(const NexGpuScene&) = delete;
+
+        // collects every resident entity, call once per frame before any pass draws from the scene
+        void update(int frame_index, NexRegistry& registry);
+
+        // draws the batch's commands from this frame's indirect buffer, the caller binds the pipeline, sets and geometry.
+        // With culling the commands come from the culling pass' output instead
+        void drawBatch(VkCommandBuffer command_buffer, int frame_index, const NexIndirectBatch& batch) const;
+
+        // set before update() when a CullingSystem runs between update() and the passes
+        void setCulling(bool culling) {
+            m_culling = culling;
+        }
+
+        bool isCulling() const {
+            return m_culling;
+        }
+
+        // with drawIndirectCount the culling pass compacts every batch and writes its draw count, otherwise it zeroes instanceCount in place
+        bool isCompacting() const {
+            return m_compacting;
+        }
+
+        const std::vector<NexIndirectBatch>& getBatches() const {
+            return m_batches;
+        }
+
+        const std::vector<NexIndirectBatch>& getShadowBatches() const {
+            return m_shadow_batches;
+        }
+
+        VkDescriptorSetLayout getObjectSetLayout() const {
+            return m_object_set_layout->getDescriptorSetLayout();
+        }
+
+        VkDescriptorSet getObjectSet(int frame_index) const {
+            return m_frames[frame_index].m_object_set;
+        }
+
+        uint32_t getObjectCount() const {
+            return m_object_count;
+        }
+
+        uint32_t getDrawCount() const {
+            return m_draw_count;
+        }
+
+        uint32_t getCommandCount() const {
+            return m_command_count;
+        }
+
+        uint32_t getBatchCount() const {
+            return static_cast<uint32_t>(m_batches.size() + m_shadow_batches.size());
+        }
+
+        // the culling pass' view of a frame
+        NexBuffer& getObjectBuffer(int frame_index) const {
+            return *m_frames[frame_index].m_objects;
+        }
+
+        NexBuffer& getCommandBuffer(int frame_index) const {
+            return *m_frames[frame_index].m_commands;
+        }
+
+        NexBuffer& getCullRecordBuffer(int frame_index) const {
+            return *m_frames[frame_index].m_cull_records;
+        }
+
+        NexBuffer& getCulledCommandBuffer(int frame_index) const {
+            return *m_frames[frame_index].m_culled_commands;
+        }
+
+        NexBuffer& getDrawCountBuffer(int frame_index) const {
+            return *m_frames[frame_index].m_draw_counts;
+        }
+
+      private:
+        struct SameState {
+            bool operator()(const NexIndirectBatch& a, const NexIndirectBatch& b) const {
+                return a.sameState(b);
+            }
+        };
+
+        using Buckets = NexDrawBuckets<NexIndirectBatch, VkDrawIndexedIndirectCommand, SameState>;
+
+        struct FrameResources {
+            std::unique_ptr<NexBuffer> m_objects          = {};
+            std::unique_ptr<NexBuffer> m_commands         = {};
+            VkDescriptorSet            m_object_set       = VK_NULL_HANDLE;
+            uint32_t                   m_object_capacity  = 0;
+            uint32_t                   m_command_capacity = 0;
+
+            // only created with culling
+            std::unique_ptr<NexBuffer> m_cull_records    = {};
+            std::unique_ptr<NexBuffer> m_culled_commands = {};
+            std::unique_ptr<NexBuffer> m_draw_counts     = {};  // NexCullingStats followed by a count per batch
+            uint32_t                   m_cull_capacity   = 0;
+            uint32_t                   m_batch_capacity  = 0;
+        };
+
+        void reserve(FrameResources& frame, uint32_t object_count, uint32_t command_count);
+        void reserveCulling(FrameResources& frame, uint32_t command_count, uint32_t batch_count);
+        void flattenBuckets(const Buckets& buckets, std::vector<NexIndirectBatch>& batches, VkDrawIndexedIndirectCommand* commands, NexCullRecord* records, uint32_t& command_offset,
+                            uint32_t& batch_index);
+
+        NexDevice& m_device;
+
+        std::unique_ptr<NexDescriptorSetLayout> m_object_set_layout;
+        std::unique_ptr<NexDescriptorPool>      m_descriptor_pool;
+        FrameResources                          m_frames[NexSwapChain::max_frames_in_flight];
+
+        Buckets                       m_buckets        = {};
+        Buckets                       m_shadow_buckets = {};
+        std::vector<NexIndirectBatch> m_batches        = {};
+        std::vector<NexIndirectBatch> m_shadow_batches = {};
+
+        uint32_t m_object_count  = 0;
+        uint32_t m_draw_count    = 0;
+        uint32_t m_command_count = 0;
+        bool     m_culling       = false;
+        bool     m_compacting    = false;
+    };
+}  // namespace nex
@@ -0,0 +1,99 @@
+#include "nex_instancer.hpp"
+
+#include "../core/nex_trace.hpp"
+#include "nex_entity_culler.hpp"
+
+namespace nex {
+    NexInstancer::NexInstancer(NexDevice& device) : m_device{device} {
+        m_instance_set_layout = NexDescriptorSetLayout::Builder(m_device).addBinding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_VERTEX_BIT).build();
+        m_descriptor_pool     = NexDescriptorPool::Builder(m_device)
+                                .setMaxSets(NexSwapChain::max_frames_in_flight)
+                                .addPoolSize(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, NexSwapChain::max_frames_in_flight)
+                                .build();
+
+        for (auto& frame : m_frames) {
+            reserve(frame, initial_capacity);
+        }
+    }
+
+    NexInstancer::~NexInstancer() {}
+
+    void NexInstancer::reserve(FrameResources& frame, uint32_t instance_count) {
+        if (reserveDrawBuffer(m_device, frame.m_instances, frame.m_capacity, instance_count, sizeof(NexObjectData), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)) {
+            writeDrawBufferSet(*m_instance_set_layout, *m_descriptor_pool, *frame.m_instances, frame.m_instance_set);
+        }
+    }
+
+    void NexInstancer::addEntity(NexRegistry& registry, NexEntity entity, bool main_pass, bool shadow_pass) {
+        MeshComponent* mesh = registry.tryGet<MeshComponent>(entity);
+        if (mesh == nullptr || !mesh->m_mesh || !mesh->m_mesh->isResident() || !registry.has<TransformComponent>(entity)) {
+            return;
+        }
+
+        // an entity whose texture is still streaming in already casts its shadow
+        TextureComponent* texture = registry.tryGet<TextureComponent>(entity);
+        NexTexture*       image   = texture != nullptr ? texture->m_texture.get() : nullptr;
+        if (main_pass && (image == nullptr || image->isResident())) {
+            m_buckets.find(mesh->m_mesh.get()).push_back(entity);
+        }
+        if (shadow_pass) {
+            m_shadow_buckets.find(mesh->m_mesh.get()).push_back(entity);
+        }
+    }
+
+    void NexInstancer::update(int frame_index, NexRegistry& registry, const NexVisibleEntities* visible_entities) {
+        NEX_TRACE_SCOPE("instancer update");
+        m_buckets.clear();
+        m_shadow_buckets.clear();
+
+        if (visible_entities != nullptr) {
+            for (NexEntity entity : visible_entities->m_camera) {
+                addEntity(registry, entity, true, false);
+            }
+            for (NexEntity entity : visible_entities->m_light) {
+                addEntity(registry, entity, false, true);
+            }
+        } else {
+            for (NexEntity entity : registry.pool<MeshComponent>().entities()) {
+                addEntity(registry, entity, true, true);
+            }
+        }
+
+        FrameResources& frame = m_frames[frame_index];
+        reserve(frame, m_buckets.itemCount() + m_shadow_buckets.itemCount());
+
+        auto*    instances       = static_cast<NexObjectData*>(frame.m_instances->getMappedMemory());
+        uint32_t instance_offset = 0;
+        flattenBuckets(registry, m_buckets, m_groups, instances, instance_offset);
+        flattenBuckets(registry, m_shadow_buckets, m_shadow_groups, instances, instance_offset);
+
+        m_instance_count = instance_offset;
+        if (m_instance_count > 0) {
+            frame.m_instances->flush(m_instance_count * sizeof(NexObjectData));
+        }
+    }
+
+    void NexInstancer::flattenBuckets(NexRegistry& registry, const Buckets& buckets, std::vector<NexInstanceGroup>& groups, NexObjectData* instances, uint32_t& instance_offset) {
+        auto& transforms = registry.pool<TransformComponent>();
+        auto& meshes     = registry.pool<MeshComponent>();
+        auto& textures   = registry.pool<TextureComponent>();
+
+        groups.clear();
+        buckets.flatten(instance_offset, [&](NexMesh* mesh, const std::vector<NexEntity>& entities, uint32_t first_instance) {
+            groups.push_back({mesh, first_instance, static_cast<uint32_t>(entities.size())});
+
+            const glm::mat4& dequantize = mesh->getDequantizeMatrix();
+            NexObjectData*   data       = instances + first_instance;
+            for (NexEntity entity : entities) {
+                TransformComponent& transform = transforms.get(entity);
+                data->m_model_matrix          = transform.mat4() * dequantize;
+                data->m_normal_matrix         = transform.normalMatrix();
+                data->m_material_index        = meshes.get(entity).m_material_index;
+
+                TextureComponent* texture = textures.tryGet(entity);
+                data->m_texture_index     = texture != nullptr && texture->m_texture != nullptr ? texture->m_texture->getBindlessIndex() : NexTextureTable::no_texture;
+                ++data;
+            }
+        });
+    }
+}  // namespace nex
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "../core/nex_device.hpp"
+#include "../core/nex_swapchain.hpp"
+#include "../graphics/nex_buffer.hpp"
+#include "../graphics/nex_descriptors.hpp"
+#include "nex_draw_buckets.hpp"
+#include "nex_entity.hpp"
+#include "nex_gpu_scene.hpp"
+
+namespace nex {
+    struct NexVisibleEntities;
+
+    // Entities sharing a mesh drawn with one instanced draw per submesh, each instance carries its own texture table index
+    struct NexInstanceGroup {
+        NexMesh* m_mesh           = nullptr;
+        uint32_t m_first_instance = 0;  // into the instance buffer
+        uint32_t m_instance_count = 0;
+    };
+
+    // Per frame storage buffer of instance transforms for the passes drawing entity by entity. The instances are laid out in
+    // NexObjectData so the pipelines of the gpu scene can draw them, a group is one vkCmdDrawIndexed with its instance range.
+    class NexInstancer {
+      public:
+        static constexpr uint32_t initial_capacity = 1024;
+
+        explicit NexInstancer(NexDevice& device);
+        ~NexInstancer();
+
+        NexInstancer(const NexInstancer&)            = delete;
+        NexInstancer& operator=(const NexInstancer&) = delete;
+
+        // groups every resident entity, or only the visible ones when they were culled. Call once per frame before any pass draws
+        void update(int frame_index, NexRegistry& registry, const NexVisibleEntities* visible_entities = nullptr);
+
+        const std::vector<NexInstanceGroup>& getGroups() const {
+            return m_groups;
+        }
+
+        const std::vector<NexInstanceGroup>& getShadowGroups() const {
+            return m_shadow_groups;
+        }
+
+        // same bindings as NexGpuScene::getObjectSetLayout(), so pipelines created for one draw from either
+        VkDescriptorSetLayout getInstanceSetLayout() const {
+            return m_instance_set_layout->getDescriptorSetLayout();
+        }
+
+        VkDescriptorSet getInstanceSet(int frame_index) const {
+            return m_frames[frame_index].m_instance_set;
+        }
+
+        uint32_t getInstanceCount() const {
+            return m_instance_count;
+        }
+
+      private:
+        using Buckets = NexDrawBuckets<NexMesh*, NexEntity>;
+
+        struct FrameResources {
+            std::unique_ptr<NexBuffer> m_instances    = {};
+            VkDescriptorSet            m_instance_set = VK_NULL_HANDLE;
+            uint32_t                   m_capacity     = 0;
+        };
+
+        void addEntity(NexRegistry& registry, NexEntity entity, bool main_pass, bool shadow_pass);
+        void reserve(FrameResources& frame, uint32_t instance_count);
+        void flattenBuckets(NexRegistry& registry, const Buckets& buckets, std::vector<NexInstanceGroup>& groups, NexObjectData* instances, uint32_t& instance_offset);
+
+        NexDevice& m_device;
+
+        std::unique_ptr<NexDescriptorSetLayout> m_instance_set_layout;
+        std::unique_ptr<NexDescriptorPool>      m_descriptor_pool;
+        FrameResources                          m_frames[NexSwapChain::max_frames_in_flight];
+
+        Buckets                       m_buckets        = {};
+        Buckets                       m_shadow_buckets = {};
+        std::vector<NexInstanceGroup> m_groups         = {};
+        std::vector<NexInstanceGroup> m_shadow_groups  = {};
+
+        uint32_t m_instance_count = 0;
+    };
+}  // namespace nex
@@ -1,34 +1,55 @@
 #include "nex_mesh.hpp"
 
+#include <algorithm>
+#include <cmath>
 #include <cstring>
-#include <unordered_map>
+#include <glm/gtc/packing.hpp>
+#include <limits>
 
-#include "../core/nex_utils.hpp"
+#include "../core/nex_job_system.hpp"
+#include "../graphics/nex_geometry_pool.hpp"
+#include "nex_mesh_cache.hpp"
+#include "nex_vertex_dedup.hpp"
 
 #define TINYOBJLOADER_IMPLEMENTATION
 #include "tiny_obj_loader.hpp"
 
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/hash.hpp>
+namespace nex {
+    // quantized positions span the full unsigned 16 bit range across the mesh bounds
+    static constexpr float position_quantization = 65535.0f;
+
+    NexMesh::NexMesh(NexDevice& nex_device, const Builder& builder)
+        : m_device(nex_device), m_vertex_format{builder.m_vertex_format}, m_bounds_min{builder.m_bounds_min}, m_bounds_max{builder.m_bounds_max} {
+        // the sphere around the box is looser than a fitted one, but costs nothing and holds for any rotation of the box
+        m_bounding_sphere = glm::vec4{0.5f * (m_bounds_min + m_bounds_max), 0.5f * glm::length(m_bounds_max - m_bounds_min)};
+
+        if (m_vertex_format == VertexFormat::Compact) {
+            glm::vec3 scale     = (builder.m_bounds_max - builder.m_bounds_min) / position_quantization;
+            m_dequantize_matrix = glm::mat4{{scale.x, 0.0f, 0.0f, 0.0f}, {0.0f, scale.y, 0.0f, 0.0f}, {0.0f, 0.0f, scale.z, 0.0f}, {builder.m_bounds_min, 1.0f}};
 
-namespace std {
-    template <>
-    struct hash<nex::NexMesh::Vertex> {
-        size_t operator()(const nex::NexMesh::Vertex& vertex) const {
-            size_t seed = 0;
-            nex::hashCombine(seed, vertex.m_position, vertex.m_color, vertex.m_normal, vertex.m_uv);
-            return seed;
+            auto vertices = builder.compactVertices();
+            createVertexBuffer(vertices.data(), sizeof(CompactVertex), static_cast<uint32_t>(vertices.size()));
+        } else {
+            auto vertices = builder.vertices();
+            createVertexBuffer(vertices.data(), sizeof(Vertex), static_cast<uint32_t>(vertices.size()));
         }
-    };
-};  // namespace std
 
-namespace nex {
-    NexMesh::NexMesh(NexDevice& nex_device, const Builder& builder) : m_device(nex_device) {
-        createVertexBuffer(builder.m_vertices);
-        createIndexBuffer(builder.m_indices);
+        m_index_type = builder.m_index_type;
+        m_submeshes.assign(builder.submeshes().begin(), builder.submeshes().end());
+        createIndexBuffer(builder.indexBytes());
+
+        if (!builder.shadowVertices().empty()) {
+            createShadowBuffers(builder.shadowVertices(), builder.shadowIndexBytes());
+        }
     }
 
-    NexMesh::~NexMesh() {}
+    NexMesh::~NexMesh() {
+        auto& pool = m_device.geometryPool();
+        pool.free(m_vertices);
+        pool.free(m_indices);
+        pool.free(m_shadow_vertices);
+        pool.free(m_shadow_indices);
+    }
 
     std::unique_ptr<NexMesh> NexMesh::createModelFromFile(NexDevice& device, const std::string& filepath) {
         Builder builder;
@@ -36,60 +57,92 @@ namespace nex {
         return std::make_unique<NexMesh>(device, builder);
     }
 
-    void NexMesh::createVertexBuffer(const std::vector<Vertex>& vertices) {
-        m_vertex_count = static_cast<uint32_t>(vertices.size());
-        assert(m_vertex_count >= 3 && "Vertex count must be at least 3");
+    void NexMesh::createVertexBuffer(const void* vertices, uint32_t vertex_size, uint32_t vertex_count) {
+        assert(vertex_count >= 3 && "Vertex count must be at least 3");
 
-        VkDeviceSize buffer_size = sizeof(vertices[0]) * m_vertex_count;
-        uint32_t     vertex_size = static_cast<uint32_t>(sizeof(vertices[0]));
+        m_vertices = m_device.geometryPool().allocateVertices(vertex_size, vertex_count);
+        trackUpload(m_device.geometryPool().upload(m_vertices, vertices));
+    }
 
-        NexBuffer staging_buffer(m_device, vertex_size, m_vertex_count, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    void NexMesh::createIndexBuffer(std::span<const std::byte> indices) {
+        uint32_t index_size  = m_index_type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+        uint32_t index_count = static_cast<uint32_t>(indices.size() / index_size);
 
-        staging_buffer.map();
-        staging_buffer.writeToBuffer((void*)vertices.data(), buffer_size);
+        if (index_count == 0) {
+            return;
+        }
 
-        m_vertex_buffer = std::make_unique<NexBuffer>(m_device, vertex_size, m_vertex_count, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+        // meshes that were built without submeshes draw their whole index buffer
+        if (m_submeshes.empty()) {
+            m_submeshes.push_back({0, index_count, 0, 0});
+        }
 
-        m_device.copyBuffer(staging_buffer.getBuffer(), m_vertex_buffer->getBuffer(), buffer_size);
+        m_indices = m_device.geometryPool().allocateIndices(index_size, index_count);
+        trackUpload(m_device.geometryPool().upload(m_indices, indices.data()));
     }
 
-    void NexMesh::createIndexBuffer(const std::vector<uint32_t>& indices) {
-        m_index_count      = static_cast<uint32_t>(indices.size());
-        m_has_index_buffer = m_index_count > 0;
+    void NexMesh::createShadowBuffers(std::span<const std::byte> vertices, std::span<const std::byte> indices) {
+        uint32_t vertex_size = shadowVertexSize(m_vertex_format);
+        uint32_t index_size  = m_index_type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
 
-        if (!m_has_index_buffer) {
-            return;
-        }
+        m_shadow_vertices = m_device.geometryPool().allocateVertices(vertex_size, static_cast<uint32_t>(vertices.size() / vertex_size));
+        m_shadow_indices  = m_device.geometryPool().allocateIndices(index_size, static_cast<uint32_t>(indices.size() / index_size));
 
-        VkDeviceSize buffer_size = sizeof(indices[0]) * m_index_count;
-        uint32_t     index_size  = static_cast<uint32_t>(sizeof(indices[0]));
+        trackUpload(m_device.geometryPool().upload(m_shadow_vertices, vertices.data()));
+        trackUpload(m_device.geometryPool().upload(m_shadow_indices, indices.data()));
+    }
 
-        NexBuffer staging_buffer(m_device, index_size, m_index_count, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+    void NexMesh::trackUpload(NexUploadHandle handle) {
+        m_upload_handle.m_value = std::max(m_upload_handle.m_value, handle.m_value);
+    }
 
-        staging_buffer.map();
-        staging_buffer.writeToBuffer((void*)indices.data(), buffer_size);
+    bool NexMesh::isResident() const {
+        return m_device.uploadQueue().isResident(m_upload_handle);
+    }
 
-        m_index_buffer = std::make_unique<NexBuffer>(m_device, index_size, m_index_count, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    void NexMesh::bind(VkCommandBuffer command_buffer, NexGeometryBindings& bindings) const {
+        bindings.bindVertices(command_buffer, m_vertices.m_buffer);
 
-        m_device.copyBuffer(staging_buffer.getBuffer(), m_index_buffer->getBuffer(), buffer_size);
+        if (m_indices) {
+            bindings.bindIndices(command_buffer, m_indices.m_buffer, m_index_type);
+        }
+    }
+
+    void NexMesh::draw(VkCommandBuffer command_buffer, uint32_t instance_count, uint32_t first_instance) const {
+        if (m_indices) {
+            int32_t vertex_offset = static_cast<int32_t>(m_vertices.m_offset);
+            for (const auto& submesh : m_submeshes) {
+                vkCmdDrawIndexed(command_buffer, submesh.m_index_count, instance_count, m_indices.m_offset + submesh.m_first_index, vertex_offset + submesh.m_vertex_offset, first_instance);
+            }
+        } else {
+            vkCmdDraw(command_buffer, m_vertices.m_count, instance_count, m_vertices.m_offset, first_instance);
+        }
     }
 
-    void NexMesh::bind(VkCommandBuffer command_buffer, uint32_t first_vertex) const {
-        VkBuffer     vertex_buffers[] = {m_vertex_buffer->getBuffer()};
-        VkDeviceSize offsets[]        = {0};
+    void NexMesh::bindShadow(VkCommandBuffer command_buffer, NexGeometryBindings& bindings) const {
+        bindings.bindVertices(command_buffer, m_shadow_vertices.m_buffer);
+        bindings.bindIndices(command_buffer, m_shadow_indices.m_buffer, m_index_type);
+    }
 
-        vkCmdBindVertexBuffers(command_buffer, 0, 1, vertex_buffers, offsets);
+    void NexMesh::drawShadow(VkCommandBuffer command_buffer, uint32_t instance_count, uint32_t first_instance) const {
+        int32_t vertex_offset = static_cast<int32_t>(m_shadow_vertices.m_offset);
+        for (const auto& submesh : m_submeshes) {
+            vkCmdDrawIndexed(command_buffer, submesh.m_index_count, instance_count, m_shadow_indices.m_offset + submesh.m_first_index, vertex_offset + submesh.m_shadow_vertex_offset,
+                             first_instance);
+        }
+    }
 
-        if (m_has_index_buffer) {
-            vkCmdBindIndexBuffer(command_buffer, m_index_buffer->getBuffer(), 0, VK_INDEX_TYPE_UINT32);
+    void NexMesh::appendDrawCommands(std::vector<VkDrawIndexedIndirectCommand>& commands, uint32_t first_instance, uint32_t instance_count) const {
+        int32_t vertex_offset = static_cast<int32_t>(m_vertices.m_offset);
+        for (const auto& submesh : m_submeshes) {
+            commands.push_back({submesh.m_index_count, instance_count, m_indices.m_offset + submesh.m_first_index, vertex_offset + submesh.m_vertex_offset, first_instance});
         }
     }
 
-    void NexMesh::draw(VkCommandBuffer command_buffer, uint32_t first_vertex) const {
-        if (m_has_index_buffer) {
-            vkCmdDrawIndexed(command_buffer, m_index_count, 1, 0, 0, 0);
-        } else {
-            vkCmdDraw(command_buffer, m_vertex_count, 1, 0, 0);
+    void NexMesh::appendShadowDrawCommands(std::vector<VkDrawIndexedIndirectCommand>& commands, uint32_t first_instance, uint32_t instance_count) const {
+        int32_t vertex_offset = static_cast<int32_t>(m_shadow_vertices.m_offset);
+        for (const auto& submesh : m_submeshes) {
+            commands.push_back({submesh.m_index_count, instance_count, m_shadow_indices.m_offset + submesh.m_first_index, vertex_offset + submesh.m_shadow_vertex_offset, first_instance});
         }
     }
 
@@ -106,7 +159,387 @@ namespace nex {
         };
     }
 
-    void NexMesh::Builder::loadModel(const std::string& filepath) {
+    std::vector<VkVertexInputBindingDescription> NexMesh::CompactVertex::getBindingDescriptions() {
+        return {{0, sizeof(CompactVertex), VK_VERTEX_INPUT_RATE_VERTEX}};
+    }
+
+    std::vector<VkVertexInputAttributeDescription> NexMesh::CompactVertex::getAttributesDescriptions() {
+        return {
+            {0, 0, VK_FORMAT_R16G16B16A16_UINT, offsetof(CompactVertex, m_position)},
+            {1, 0, VK_FORMAT_R16G16_SNORM, offsetof(CompactVertex, m_normal)},
+            {2, 0, VK_FORMAT_R16G16_SFLOAT, offsetof(CompactVertex, m_uv)},
+        };
+    }
+
+    uint32_t NexMesh::vertexSize(VertexFormat format) {
+        return format == VertexFormat::Compact ? sizeof(CompactVertex) : sizeof(Vertex);
+    }
+
+    uint32_t NexMesh::shadowVertexSize(VertexFormat format) {
+        // compact positions keep their fourth lane so the attribute stays 8 byte aligned, it is zero instead of the color
+        return format == VertexFormat::Compact ? sizeof(CompactVertex::m_position) : sizeof(glm::vec3);
+    }
+
+    std::vector<VkVertexInputBindingDescription> NexMesh::getShadowBindingDescriptions(VertexFormat format) {
+        return {{0, shadowVertexSize(format), VK_VERTEX_INPUT_RATE_VERTEX}};
+    }
+
+    std::vector<VkVertexInputAttributeDescription> NexMesh::getShadowAttributesDescriptions(VertexFormat format) {
+        // same location and format as the position of the interleaved layout, so the shadow vertex shaders work with either stream
+        return {{0, 0, format == VertexFormat::Compact ? VK_FORMAT_R16G16B16A16_UINT : VK_FORMAT_R32G32B32_SFLOAT, 0}};
+    }
+
+    void NexMesh::Builder::loadModel(const std::string& filepath, bool use_cache, NexJobSystem* job_system) {
+        bool     compact = m_vertex_format == VertexFormat::Compact;
+        uint32_t flags   = (m_optimize ? NexMeshCache::flag_optimized : 0) | (compact ? NexMeshCache::flag_compact : 0) | (m_shadow_stream ? NexMeshCache::flag_shadow_stream : 0) |
+                         (m_split_submeshes ? NexMeshCache::flag_split : 0);
+
+        if (use_cache) {
+            NexMeshCacheData cached = {};
+            m_mapping               = NexMeshCache::load(filepath, vertexSize(m_vertex_format), flags, cached);
+
+            if (m_mapping && cached.m_submesh_stride != sizeof(Submesh)) {
+                m_mapping.reset();
+            }
+
+            if (m_mapping) {
+                if (compact) {
+                    m_mapped_compact_vertices = {static_cast<const CompactVertex*>(cached.m_vertices), cached.m_vertex_count};
+                } else {
+                    m_mapped_vertices = {static_cast<const Vertex*>(cached.m_vertices), cached.m_vertex_count};
+                }
+
+                m_index_type = cached.m_index_size == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+                if (m_index_type == VK_INDEX_TYPE_UINT16) {
+                    m_mapped_indices16        = {static_cast<const uint16_t*>(cached.m_indices), cached.m_index_count};
+                    m_mapped_shadow_indices16 = {static_cast<const uint16_t*>(cached.m_shadow_indices), cached.m_shadow_index_count};
+                } else {
+                    m_mapped_indices        = {static_cast<const uint32_t*>(cached.m_indices), cached.m_index_count};
+                    m_mapped_shadow_indices = {static_cast<const uint32_t*>(cached.m_shadow_indices), cached.m_shadow_index_count};
+                }
+
+                m_mapped_shadow_vertices = {static_cast<const std::byte*>(cached.m_shadow_vertices), size_t{cached.m_shadow_vertex_count} * cached.m_shadow_vertex_stride};
+                m_mapped_submeshes       = {static_cast<const Submesh*>(cached.m_submeshes), cached.m_submesh_count};
+                m_bounds_min             = cached.m_bounds_min;
+                m_bounds_max             = cached.m_bounds_max;
+
+                // indices of split meshes are local to their submesh, so the few reuses that alias across a boundary are counted as hits
+                m_cache_stats_after = m_index_type == VK_INDEX_TYPE_UINT16 ? NexMeshOptimizer::analyzeVertexCache(m_mapped_indices16, cached.m_vertex_count)
+                                                                           : NexMeshOptimizer::analyzeVertexCache(m_mapped_indices, cached.m_vertex_count);
+                return;
+            }
+        }
+
+        loadObj(filepath, job_system);
+        if (m_optimize) {
+            optimize();
+        } else {
+            m_cache_stats_after = NexMeshOptimizer::analyzeVertexCache(m_indices, m_vertices.size());
+        }
+
+        buildSubmeshes();
+        computeBounds();
+
+        if (compact) {
+            compress();
+        }
+
+        if (m_shadow_stream) {
+            buildShadowStream();
+        }
+
+        packIndices();
+
+        if (use_cache) {
+            auto index_bytes        = indexBytes();
+            auto shadow_index_bytes = shadowIndexBytes();
+
+            NexMeshCacheData data = {};
+            data.m_vertices       = compact ? static_cast<const void*>(m_compact_vertices.data()) : static_cast<const void*>(m_vertices.data());
+            data.m_vertex_stride  = vertexSize(m_vertex_format);
+            data.m_vertex_count   = static_cast<uint32_t>(vertexCount());
+            data.m_indices        = index_bytes.data();
+            data.m_index_size     = indexSize();
+            data.m_index_count    = static_cast<uint32_t>(indexCount());
+            data.m_flags          = flags;
+            data.m_bounds_min     = m_bounds_min;
+            data.m_bounds_max     = m_bounds_max;
+
+            data.m_shadow_vertices      = m_shadow_vertices.data();
+            data.m_shadow_vertex_stride = shadowVertexSize(m_vertex_format);
+            data.m_shadow_vertex_count  = static_cast<uint32_t>(m_shadow_vertices.size() / data.m_shadow_vertex_stride);
+            data.m_shadow_indices       = shadow_index_bytes.data();
+            data.m_shadow_index_count   = static_cast<uint32_t>(shadow_index_bytes.size() / data.m_index_size);
+            data.m_submeshes            = m_submeshes.data();
+            data.m_submesh_stride       = sizeof(Submesh);
+            data.m_submesh_count        = static_cast<uint32_t>(m_submeshes.size());
+
+            // a read only models directory just means we parse the obj every time
+            NexMeshCache::store(filepath, data);
+        }
+    }
+
+    void NexMesh::Builder::optimize() {
+        m_cache_stats_before = NexMeshOptimizer::analyzeVertexCache(m_indices, m_vertices.size());
+        m_cache_stats_after  = m_cache_stats_before;
+
+        if (m_indices.empty()) {
+            return;
+        }
+
+        NexMeshOptimizer::optimizeVertexCache(m_indices, m_vertices.size());
+        NexMeshOptimizer::optimizeOverdraw(m_indices, &m_vertices[0].m_position.x, m_vertices.size(), sizeof(Vertex));
+
+        std::vector<uint32_t> remap;
+        size_t                used_count = NexMeshOptimizer::buildFetchRemap(m_indices, m_vertices.size(), remap);
+        NexMeshOptimizer::remapVertices(m_vertices, remap, used_count);
+
+        m_cache_stats_after = NexMeshOptimizer::analyzeVertexCache(m_indices, m_vertices.size());
+    }
+
+    void NexMesh::Builder::buildSubmeshes() {
+        m_submeshes.clear();
+
+        if (!m_split_submeshes || m_vertices.size() <= max_submesh_vertices) {
+            m_submeshes.push_back({0, static_cast<uint32_t>(m_indices.size()), 0, 0});
+            return;
+        }
+
+        // greedy in triangle order, so the optimized order is kept and only the vertices shared across a cut are duplicated
+        std::vector<Vertex>   vertices;
+        std::vector<uint32_t> local(m_vertices.size(), NexVertexDedupTable::empty);
+        std::vector<uint32_t> touched;
+
+        Submesh submesh = {};
+
+        auto finish = [&](uint32_t end_index) {
+            submesh.m_index_count = end_index - submesh.m_first_index;
+            m_submeshes.push_back(submesh);
+
+            for (uint32_t vertex : touched) {
+                local[vertex] = NexVertexDedupTable::empty;
+            }
+            touched.clear();
+
+            submesh                 = {};
+            submesh.m_first_index   = end_index;
+            submesh.m_vertex_offset = static_cast<int32_t>(vertices.size());
+        };
+
+        for (uint32_t first = 0; first < m_indices.size(); first += 3) {
+            const uint32_t* triangle  = &m_indices[first];
+            uint32_t        new_count = 0;
+            for (int corner = 0; corner < 3; ++corner) {
+                bool repeated = (corner > 0 && triangle[corner] == triangle[0]) || (corner > 1 && triangle[corner] == triangle[1]);
+                new_count += local[triangle[corner]] == NexVertexDedupTable::empty && !repeated;
+            }
+
+            if (touched.size() + new_count > max_submesh_vertices) {
+                finish(first);
+            }
+
+            for (int corner = 0; corner < 3; ++corner) {
+                uint32_t vertex = m_indices[first + corner];
+
+                if (local[vertex] == NexVertexDedupTable::empty) {
+                    local[vertex] = static_cast<uint32_t>(touched.size());
+                    touched.push_back(vertex);
+                    vertices.push_back(m_vertices[vertex]);
+                }
+                m_indices[first + corner] = local[vertex];
+            }
+        }
+        finish(static_cast<uint32_t>(m_indices.size()));
+
+        m_vertices = std::move(vertices);
+    }
+
+    void NexMesh::Builder::computeBounds() {
+        m_bounds_min = glm::vec3{std::numeric_limits<float>::max()};
+        m_bounds_max = glm::vec3{std::numeric_limits<float>::lowest()};
+
+        for (const auto& vertex : m_vertices) {
+            m_bounds_min = glm::min(m_bounds_min, vertex.m_position);
+            m_bounds_max = glm::max(m_bounds_max, vertex.m_position);
+        }
+
+        if (m_vertices.empty()) {
+            m_bounds_min = m_bounds_max = glm::vec3{0.0f};
+        }
+    }
+
+    // folds the sphere onto the octahedron |x| + |y| + |z| = 1 and unfolds the lower half over the corners
+    static glm::vec2 octahedralEncode(const glm::vec3& normal) {
+        float l1 = std::abs(normal.x) + std::abs(normal.y) + std::abs(normal.z);
+        if (l1 == 0.0f) {
+            return glm::vec2{0.0f};
+        }
+
+        glm::vec3 n = normal / l1;
+        if (n.z >= 0.0f) {
+            return {n.x, n.y};
+        }
+
+        return {(1.0f - std::abs(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f), (1.0f - std::abs(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f)};
+    }
+
+    static uint16_t packColor565(const glm::vec3& color) {
+        auto channel = [](float value, float max) { return static_cast<uint16_t>(std::lround(std::clamp(value, 0.0f, 1.0f) * max)); };
+        return static_cast<uint16_t>(channel(color.x, 31.0f) << 11 | channel(color.y, 63.0f) << 5 | channel(color.z, 31.0f));
+    }
+
+    void NexMesh::Builder::compress() {
+        glm::vec3 extent = m_bounds_max - m_bounds_min;
+
+        m_compact_vertices.resize(m_vertices.size());
+        for (size_t i = 0; i < m_vertices.size(); ++i) {
+            const Vertex&  vertex  = m_vertices[i];
+            CompactVertex& compact = m_compact_vertices[i];
+
+            for (int k = 0; k < 3; ++k) {
+                float t               = extent[k] > 0.0f ? (vertex.m_position[k] - m_bounds_min[k]) / extent[k] : 0.0f;
+                compact.m_position[k] = static_cast<uint16_t>(std::lround(std::clamp(t, 0.0f, 1.0f) * position_quantization));
+            }
+            compact.m_position[3] = packColor565(vertex.m_color);
+
+            glm::vec2 normal    = octahedralEncode(vertex.m_normal);
+            compact.m_normal[0] = static_cast<int16_t>(std::lround(std::clamp(normal.x, -1.0f, 1.0f) * 32767.0f));
+            compact.m_normal[1] = static_cast<int16_t>(std::lround(std::clamp(normal.y, -1.0f, 1.0f) * 32767.0f));
+
+            compact.m_uv[0] = static_cast<uint16_t>(glm::packHalf1x16(vertex.m_uv.x));
+            compact.m_uv[1] = static_cast<uint16_t>(glm::packHalf1x16(vertex.m_uv.y));
+        }
+
+        m_vertices.clear();
+        m_vertices.shrink_to_fit();
+    }
+
+    void NexMesh::Builder::buildShadowStream() {
+        bool     compact      = m_vertex_format == VertexFormat::Compact;
+        uint32_t vertex_size  = shadowVertexSize(m_vertex_format);
+        size_t   vertex_count = vertexCount();
+
+        m_shadow_vertices.clear();
+        m_shadow_indices.resize(m_indices.size());
+
+        std::vector<uint32_t> remap(vertex_count, NexVertexDedupTable::empty);
+
+        // each submesh gets its own table, so its shadow indices stay local like the main ones
+        for (auto& submesh : m_submeshes) {
+            // the dedup table compares three ints, which works just as well for quantized positions or float bit patterns
+            NexVertexDedupTable table(vertex_count);
+            uint32_t            next = 0;
+
+            submesh.m_shadow_vertex_offset = static_cast<int32_t>(m_shadow_vertices.size() / vertex_size);
+
+            // walking the indices keeps the shadow vertices in first use order, like the fetch remap of the main stream
+            for (size_t i = submesh.m_first_index; i < submesh.m_first_index + submesh.m_index_count; ++i) {
+                uint32_t vertex = m_indices[i] + submesh.m_vertex_offset;
+
+                if (remap[vertex] == NexVertexDedupTable::empty) {
+                    int32_t  key[3];
+                    uint16_t quantized[4] = {};
+
+                    if (compact) {
+                        std::copy_n(m_compact_vertices[vertex].m_position, 3, quantized);
+                        std::copy_n(quantized, 3, key);
+                    } else {
+                        std::memcpy(key, &m_vertices[vertex].m_position, sizeof(key));
+                    }
+
+                    bool inserted;
+                    remap[vertex] = table.findOrInsert(key[0], key[1], key[2], next, inserted);
+
+                    if (inserted) {
+                        const void* position = compact ? static_cast<const void*>(quantized) : static_cast<const void*>(&m_vertices[vertex].m_position);
+                        m_shadow_vertices.resize(m_shadow_vertices.size() + vertex_size);
+                        std::memcpy(m_shadow_vertices.data() + m_shadow_vertices.size() - vertex_size, position, vertex_size);
+                        ++next;
+                    }
+                }
+
+                m_shadow_indices[i] = remap[vertex];
+            }
+        }
+    }
+
+    void NexMesh::Builder::packIndices() {
+        // after a split every index is local to a submesh of at most max_submesh_vertices
+        if (m_submeshes.size() <= 1 && vertexCount() > max_submesh_vertices) {
+            return;
+        }
+
+        m_indices16.assign(m_indices.begin(), m_indices.end());
+        m_shadow_indices16.assign(m_shadow_indices.begin(), m_shadow_indices.end());
+        m_index_type = VK_INDEX_TYPE_UINT16;
+
+        m_indices.clear();
+        m_indices.shrink_to_fit();
+        m_shadow_indices.clear();
+        m_shadow_indices.shrink_to_fit();
+    }
+
+    static NexMesh::Vertex makeVertex(const tinyobj::attrib_t& attrib, const tinyobj::index_t& index) {
+        NexMesh::Vertex vertex = {};
+
+        if (index.vertex_index >= 0) {
+            vertex.m_position = {
+                attrib.vertices[3 * index.vertex_index + 0],
+                attrib.vertices[3 * index.vertex_index + 1],
+                attrib.vertices[3 * index.vertex_index + 2],
+            };
+
+            vertex.m_color = {
+                attrib.colors[3 * index.vertex_index + 0],
+                attrib.colors[3 * index.vertex_index + 1],
+                attrib.colors[3 * index.vertex_index + 2],
+            };
+        }
+
+        if (index.normal_index >= 0) {
+            vertex.m_normal = {
+                attrib.normals[3 * index.normal_index + 0],
+                attrib.normals[3 * index.normal_index + 1],
+                attrib.normals[3 * index.normal_index + 2],
+            };
+        }
+
+        if (index.texcoord_index >= 0) {
+            vertex.m_uv = {
+                attrib.texcoords[2 * index.texcoord_index + 0],
+                1.0f - attrib.texcoords[2 * index.texcoord_index + 1],  // we flipped it, to match Vulkan's coordinate system
+            };
+        }
+
+        return vertex;
+    }
+
+    // appends the unique vertices of shapes to vertices, indices refer to them starting at 0
+    static void deduplicateShapes(const tinyobj::attrib_t& attrib, std::span<const tinyobj::shape_t> shapes, std::vector<NexMesh::Vertex>& vertices, std::vector<uint32_t>& indices) {
+        size_t corner_count = 0;
+        for (const auto& shape : shapes) {
+            corner_count += shape.mesh.indices.size();
+        }
+
+        NexVertexDedupTable table(corner_count);
+        indices.reserve(corner_count);
+
+        for (const auto& shape : shapes) {
+            for (const auto& index : shape.mesh.indices) {
+                bool     inserted;
+                uint32_t vertex_index = table.findOrInsert(index.vertex_index, index.normal_index, index.texcoord_index, static_cast<uint32_t>(vertices.size()), inserted);
+
+                if (inserted) {
+                    vertices.push_back(makeVertex(attrib, index));
+                }
+                indices.push_back(vertex_index);
+            }
+        }
+    }
+
+    void NexMesh::Builder::loadObj(const std::string& filepath, NexJobSystem* job_system) {
+        m_mapping.reset();
+
         tinyobj::attrib_t                attrib;
         std::vector<tinyobj::shape_t>    shapes;
         std::vector<tinyobj::material_t> materials;
@@ -116,49 +549,42 @@ namespace nex {
             throw std::runtime_error("Failed to load model: " + warn + err);
         }
 
+        deduplicate(attrib, shapes, job_system);
+    }
+
+    void NexMesh::Builder::deduplicate(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes, NexJobSystem* job_system) {
         m_vertices.clear();
         m_indices.clear();
 
-        std::unordered_map<Vertex, uint32_t> unique_vertices = {};
+        if (job_system == nullptr || shapes.size() < 2) {
+            deduplicateShapes(attrib, shapes, m_vertices, m_indices);
+            return;
+        }
 
-        for (const auto& shape : shapes) {
-            for (const auto& index : shape.mesh.indices) {
-                Vertex vertex = {};
-
-                if (index.vertex_index >= 0) {
-                    vertex.m_position = {
-                        attrib.vertices[3 * index.vertex_index + 0],
-                        attrib.vertices[3 * index.vertex_index + 1],
-                        attrib.vertices[3 * index.vertex_index + 2],
-                    };
-
-                    vertex.m_color = {
-                        attrib.colors[3 * index.vertex_index + 0],
-                        attrib.colors[3 * index.vertex_index + 1],
-                        attrib.colors[3 * index.vertex_index + 2],
-                    };
-                }
+        // every shape gets its own table, a triplet shared by two shapes ends up as one vertex per shape
+        std::vector<std::vector<Vertex>>   shape_vertices(shapes.size());
+        std::vector<std::vector<uint32_t>> shape_indices(shapes.size());
 
-                if (index.normal_index >= 0) {
-                    vertex.m_normal = {
-                        attrib.normals[3 * index.normal_index + 0],
-                        attrib.normals[3 * index.normal_index + 1],
-                        attrib.normals[3 * index.normal_index + 2],
-                    };
-                }
+        job_system->parallelFor(static_cast<uint32_t>(shapes.size()), [&](uint32_t i) {
+            deduplicateShapes(attrib, std::span<const tinyobj::shape_t>(&shapes[i], 1), shape_vertices[i], shape_indices[i]);
+        });
 
-                if (index.texcoord_index >= 0) {
-                    vertex.m_uv = {
-                        attrib.texcoords[2 * index.texcoord_index + 0],
-                        1.0f - attrib.texcoords[2 * index.texcoord_index + 1],  // we flipped it, to match Vulkan's coordinate system
-                    };
-                }
+        size_t vertex_count = 0;
+        size_t index_count  = 0;
+        for (size_t i = 0; i < shapes.size(); ++i) {
+            vertex_count += shape_vertices[i].size();
+            index_count += shape_indices[i].size();
+        }
 
-                if (unique_vertices.count(vertex) == 0) {
-                    unique_vertices[vertex] = static_cast<uint32_t>(m_vertices.size());
-                    m_vertices.push_back(vertex);
-                }
-                m_indices.push_back(unique_vertices[vertex]);
+        m_vertices.reserve(vertex_count);
+        m_indices.reserve(index_count);
+
+        for (size_t i = 0; i < shapes.size(); ++i) {
+            uint32_t base = static_cast<uint32_t>(m_vertices.size());
+
+            m_vertices.insert(m_vertices.end(), shape_vertices[i].begin(), shape_vertices[i].end());
+            for (uint32_t index : shape_indices[i]) {
+                m_indices.push_back(base + index);
             }
         }
     }
@@ -4,13 +4,30 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <memory>
+#include <span>
 
-#include "../graphics/nex_buffer.hpp"
 #include "../core/nex_device.hpp"
+#include "../graphics/nex_geometry_pool.hpp"
+#include "../core/nex_mapped_file.hpp"
+#include "nex_mesh_optimizer.hpp"
+
+namespace tinyobj {
+    struct attrib_t;
+    struct shape_t;
+}  // namespace tinyobj
 
 namespace nex {
+    class NexJobSystem;
+
     class NexMesh {
       public:
+        enum class VertexFormat : uint32_t {
+            Full,     // Vertex, 44 bytes of floats
+            Compact,  // CompactVertex, 16 bytes decoded in the vertex shader
+        };
+
+        static constexpr uint32_t vertex_format_count = 2;
+
         struct Vertex {
             glm::vec3 m_position = {};
             glm::vec3 m_color    = {};
@@ -25,11 +42,128 @@ namespace nex {
             }
         };
 
+        // positions are quantized to the mesh bounds, getDequantizeMatrix() maps them back and is folded into the model matrix
+        struct CompactVertex {
+            uint16_t m_position[4] = {};  // xyz, w holds the vertex color as rgb565
+            int16_t  m_normal[2]   = {};  // octahedral encoding, snorm
+            uint16_t m_uv[2]       = {};  // half floats
+
+            static std::vector<VkVertexInputBindingDescription>   getBindingDescriptions();
+            static std::vector<VkVertexInputAttributeDescription> getAttributesDescriptions();
+        };
+
+        // a range of the index buffer drawn with its own vertex offset, meshes over max_submesh_vertices can be split so every part fits 16 bit indices
+        struct Submesh {
+            uint32_t m_first_index          = 0;
+            uint32_t m_index_count          = 0;
+            int32_t  m_vertex_offset        = 0;
+            int32_t  m_shadow_vertex_offset = 0;  // shadow indices share the main index range but address their own vertices
+        };
+
+        static constexpr uint32_t max_submesh_vertices = 65535;
+
         struct Builder {
-            std::vector<Vertex>   m_vertices = {};
-            std::vector<uint32_t> m_indices  = {};
+            std::vector<Vertex>   m_vertices   = {};
+            std::vector<uint32_t> m_indices    = {};
+            glm::vec3             m_bounds_min = {};
+            glm::vec3             m_bounds_max = {};
+
+            // reorders the parsed mesh for the vertex cache, overdraw and fetch locality before it is cached and uploaded
+            bool                m_optimize           = true;
+            VertexFormat        m_vertex_format      = VertexFormat::Compact;
+            NexVertexCacheStats m_cache_stats_before = {};  // only filled in when the obj was parsed and optimized here
+            NexVertexCacheStats m_cache_stats_after  = {};
+
+            // set when the mesh came from a .nexmesh cache, vertices() and indices() then point into the mapping
+            std::shared_ptr<NexMappedFile> m_mapping         = {};
+            std::span<const Vertex>        m_mapped_vertices = {};
+            std::span<const uint32_t>      m_mapped_indices  = {};
+
+            // filled in by compress(), which also releases m_vertices
+            std::vector<CompactVertex>     m_compact_vertices        = {};
+            std::span<const CompactVertex> m_mapped_compact_vertices = {};
 
-            void loadModel(const std::string& filepath);
+            // position only copy for depth passes with its own index buffer, vertices that only differ in normal, uv or color are merged.
+            // the layout follows m_vertex_format, see shadowVertexSize()
+            bool                       m_shadow_stream          = true;
+            bool                       m_split_submeshes        = false;  // only meshes with more than max_submesh_vertices are split
+            std::vector<std::byte>     m_shadow_vertices        = {};
+            std::vector<uint32_t>      m_shadow_indices         = {};
+            std::span<const std::byte> m_mapped_shadow_vertices = {};
+            std::span<const uint32_t>  m_mapped_shadow_indices  = {};
+
+            // packIndices() moves the indices here when every submesh fits 16 bit indices
+            VkIndexType               m_index_type              = VK_INDEX_TYPE_UINT32;
+            std::vector<uint16_t>     m_indices16               = {};
+            std::vector<uint16_t>     m_shadow_indices16        = {};
+            std::span<const uint16_t> m_mapped_indices16        = {};
+            std::span<const uint16_t> m_mapped_shadow_indices16 = {};
+            std::vector<Submesh>      m_submeshes               = {};
+            std::span<const Submesh>  m_mapped_submeshes        = {};
+
+            std::span<const Vertex> vertices() const {
+                return m_mapping ? m_mapped_vertices : std::span<const Vertex>(m_vertices);
+            }
+
+            std::span<const CompactVertex> compactVertices() const {
+                return m_mapping ? m_mapped_compact_vertices : std::span<const CompactVertex>(m_compact_vertices);
+            }
+
+            size_t vertexCount() const {
+                return m_vertex_format == VertexFormat::Compact ? compactVertices().size() : vertices().size();
+            }
+
+            std::span<const uint32_t> indices() const {
+                return m_mapping ? m_mapped_indices : std::span<const uint32_t>(m_indices);
+            }
+
+            std::span<const std::byte> shadowVertices() const {
+                return m_mapping ? m_mapped_shadow_vertices : std::span<const std::byte>(m_shadow_vertices);
+            }
+
+            std::span<const uint32_t> shadowIndices() const {
+                return m_mapping ? m_mapped_shadow_indices : std::span<const uint32_t>(m_shadow_indices);
+            }
+
+            std::span<const uint16_t> indices16() const {
+                return m_mapping ? m_mapped_indices16 : std::span<const uint16_t>(m_indices16);
+            }
+
+            std::span<const uint16_t> shadowIndices16() const {
+                return m_mapping ? m_mapped_shadow_indices16 : std::span<const uint16_t>(m_shadow_indices16);
+            }
+
+            std::span<const Submesh> submeshes() const {
+                return m_mapping ? m_mapped_submeshes : std::span<const Submesh>(m_submeshes);
+            }
+
+            uint32_t indexSize() const {
+                return m_index_type == VK_INDEX_TYPE_UINT16 ? sizeof(uint16_t) : sizeof(uint32_t);
+            }
+
+            size_t indexCount() const {
+                return m_index_type == VK_INDEX_TYPE_UINT16 ? indices16().size() : indices().size();
+            }
+
+            std::span<const std::byte> indexBytes() const {
+                return m_index_type == VK_INDEX_TYPE_UINT16 ? std::as_bytes(indices16()) : std::as_bytes(indices());
+            }
+
+            std::span<const std::byte> shadowIndexBytes() const {
+                return m_index_type == VK_INDEX_TYPE_UINT16 ? std::as_bytes(shadowIndices16()) : std::as_bytes(shadowIndices());
+            }
+
+            // uses the binary cache next to the source when it is up to date, otherwise parses the obj and refreshes the cache,
+            // with a job system the shapes of the obj are deduplicated in parallel
+            void loadModel(const std::string& filepath, bool use_cache = true, NexJobSystem* job_system = nullptr);
+            void loadObj(const std::string& filepath, NexJobSystem* job_system = nullptr);
+            void deduplicate(const tinyobj::attrib_t& attrib, const std::vector<tinyobj::shape_t>& shapes, NexJobSystem* job_system = nullptr);
+            void optimize();
+            void computeBounds();
+            void buildSubmeshes();
+            void compress();
+            void buildShadowStream();
+            void packIndices();
         };
 
         NexMesh(NexDevice& nex_device, const Builder& builder);
@@ -40,20 +174,97 @@ namespace nex {
 
         static std::unique_ptr<NexMesh> createModelFromFile(NexDevice& device, const std::string& filepath);
 
-        void bind(VkCommandBuffer command_buffer, uint32_t first_vertex) const;
-        void draw(VkCommandBuffer command_buffer, uint32_t first_vertex) const;
+        // the geometry lives in the device's geometry pool, so consecutive meshes of the same format share their bindings
+        // instanced pipelines index their per instance data with gl_InstanceIndex, which starts at first_instance
+        void bind(VkCommandBuffer command_buffer, NexGeometryBindings& bindings) const;
+        void draw(VkCommandBuffer command_buffer, uint32_t instance_count = 1, uint32_t first_instance = 0) const;
+
+        // position only stream for depth passes, pipelines drawing it use getShadowBindingDescriptions()
+        bool hasShadowStream() const {
+            return static_cast<bool>(m_shadow_vertices);
+        }
+
+        void bindShadow(VkCommandBuffer command_buffer, NexGeometryBindings& bindings) const;
+        void drawShadow(VkCommandBuffer command_buffer, uint32_t instance_count = 1, uint32_t first_instance = 0) const;
+
+        // one command per submesh, for drawing the mesh from an indirect buffer with the buffers of getVertices() and getIndices() bound.
+        // first_instance is the instance's index into the per object storage buffer
+        void appendDrawCommands(std::vector<VkDrawIndexedIndirectCommand>& commands, uint32_t first_instance, uint32_t instance_count = 1) const;
+        void appendShadowDrawCommands(std::vector<VkDrawIndexedIndirectCommand>& commands, uint32_t first_instance, uint32_t instance_count = 1) const;
+
+        const NexGeometryAllocation& getVertices() const {
+            return m_vertices;
+        }
+
+        const NexGeometryAllocation& getIndices() const {
+            return m_indices;
+        }
+
+        const NexGeometryAllocation& getShadowVertices() const {
+            return m_shadow_vertices;
+        }
+
+        const NexGeometryAllocation& getShadowIndices() const {
+            return m_shadow_indices;
+        }
+
+        VkIndexType getIndexType() const {
+            return m_index_type;
+        }
+
+        // false until the vertex and index uploads have landed, renderers skip the mesh until then
+        bool isResident() const;
+
+        VertexFormat getVertexFormat() const {
+            return m_vertex_format;
+        }
+
+        // maps the stored positions to model space, identity unless the mesh is compact
+        const glm::mat4& getDequantizeMatrix() const {
+            return m_dequantize_matrix;
+        }
+
+        // model space bounds, before the model matrix and after dequantization
+        const glm::vec3& getBoundsMin() const {
+            return m_bounds_min;
+        }
+
+        const glm::vec3& getBoundsMax() const {
+            return m_bounds_max;
+        }
+
+        // xyz is the center, w the radius
+        const glm::vec4& getBoundingSphere() const {
+            return m_bounding_sphere;
+        }
+
+        static uint32_t vertexSize(VertexFormat format);
+        static uint32_t shadowVertexSize(VertexFormat format);
+
+        static std::vector<VkVertexInputBindingDescription>   getShadowBindingDescriptions(VertexFormat format);
+        static std::vector<VkVertexInputAttributeDescription> getShadowAttributesDescriptions(VertexFormat format);
 
       private:
-        void createVertexBuffer(const std::vector<Vertex>& vertices);
-        void createIndexBuffer(const std::vector<uint32_t>& indices);
+        void createVertexBuffer(const void* vertices, uint32_t vertex_size, uint32_t vertex_count);
+        void createIndexBuffer(std::span<const std::byte> indices);
+        void createShadowBuffers(std::span<const std::byte> vertices, std::span<const std::byte> indices);
+        void trackUpload(NexUploadHandle handle);
 
         NexDevice& m_device;
 
-        std::unique_ptr<NexBuffer> m_vertex_buffer;
-        uint32_t                   m_vertex_count;
+        VertexFormat m_vertex_format     = VertexFormat::Full;
+        glm::mat4    m_dequantize_matrix = {1.0f};
+        glm::vec3    m_bounds_min        = {};
+        glm::vec3    m_bounds_max        = {};
+        glm::vec4    m_bounding_sphere   = {};
+
+        NexGeometryAllocation m_vertices        = {};
+        NexGeometryAllocation m_indices         = {};  // empty for meshes drawn without indices
+        NexGeometryAllocation m_shadow_vertices = {};
+        NexGeometryAllocation m_shadow_indices  = {};
+        VkIndexType           m_index_type      = VK_INDEX_TYPE_UINT32;
+        std::vector<Submesh>  m_submeshes       = {};
 
-        bool                       m_has_index_buffer = false;
-        std::unique_ptr<NexBuffer> m_index_buffer;
-        uint32_t                   m_index_count;
+        NexUploadHandle m_upload_handle = {};
     };
 };  // namespace nex
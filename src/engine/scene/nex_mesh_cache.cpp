@@ -0,0 +1,182 @@
+#include "nex_mesh_cache.hpp"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <thread>
+
+namespace nex {
+    static constexpr uint64_t blob_alignment = 16;
+
+    static uint64_t alignBlob(uint64_t value) {
+        return (value + blob_alignment - 1) & ~(blob_alignment - 1);
+    }
+
+    static bool statSource(const std::string& source_path, int64_t& mtime, uint64_t& size) {
+        struct stat info = {};
+        if (stat(source_path.c_str(), &info) != 0) {
+            return false;
+        }
+
+        mtime = static_cast<int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+        size  = static_cast<uint64_t>(info.st_size);
+        return true;
+    }
+
+    std::string NexMeshCache::cachePath(const std::string& source_path) {
+        return source_path + ".nexmesh";
+    }
+
+    uint64_t NexMeshCache::hashFile(const std::string& filepath) {
+        NexMappedFile file(filepath);
+
+        // 64 bit FNV-1a, only needs to tell edited sources apart
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < file.size(); ++i) {
+            hash ^= static_cast<uint64_t>(file.data()[i]);
+            hash *= 0x100000001b3ull;
+        }
+        return hash;
+    }
+
+    std::shared_ptr<NexMappedFile> NexMeshCache::load(const std::string& source_path, uint32_t vertex_stride, uint32_t flags, NexMeshCacheData& data) {
+        int64_t  source_mtime;
+        uint64_t source_size;
+        if (!statSource(source_path, source_mtime, source_size)) {
+            return nullptr;
+        }
+
+        std::string cache_path = cachePath(source_path);
+        auto        file       = std::make_shared<NexMappedFile>(cache_path);
+        if (!file->isValid() || file->size() < sizeof(NexMeshCacheHeader)) {
+            return nullptr;
+        }
+
+        NexMeshCacheHeader header;
+        std::memcpy(&header, file->data(), sizeof(header));
+
+        if (std::memcmp(header.m_magic, NexMeshCacheHeader{}.m_magic, sizeof(header.m_magic)) != 0 || header.m_version != version || header.m_vertex_stride != vertex_stride ||
+            (header.m_index_size != sizeof(uint16_t) && header.m_index_size != sizeof(uint32_t)) || header.m_flags != flags) {
+            return nullptr;
+        }
+
+        auto blobInFile = [&](uint64_t offset, uint64_t bytes) { return offset % blob_alignment == 0 && offset + bytes <= file->size(); };
+
+        if (!blobInFile(header.m_vertex_offset, static_cast<uint64_t>(header.m_vertex_count) * header.m_vertex_stride) ||
+            !blobInFile(header.m_index_offset, static_cast<uint64_t>(header.m_index_count) * header.m_index_size) ||
+            !blobInFile(header.m_shadow_vertex_offset, static_cast<uint64_t>(header.m_shadow_vertex_count) * header.m_shadow_vertex_stride) ||
+            !blobInFile(header.m_shadow_index_offset, static_cast<uint64_t>(header.m_shadow_index_count) * header.m_index_size) ||
+            !blobInFile(header.m_submesh_offset, static_cast<uint64_t>(header.m_submesh_count) * header.m_submesh_stride)) {
+            return nullptr;
+        }
+
+        if (header.m_source_size != source_size) {
+            return nullptr;
+        }
+
+        // a touched but unchanged source (fresh checkout, copy) only costs a hash, after which the cache records the new mtime
+        if (header.m_source_mtime != source_mtime) {
+            if (hashFile(source_path) != header.m_source_hash) {
+                return nullptr;
+            }
+
+            // best effort, if this fails we simply hash again on the next launch
+            int fd = open(cache_path.c_str(), O_WRONLY);
+            if (fd >= 0) {
+                [[maybe_unused]] ssize_t written = pwrite(fd, &source_mtime, sizeof(source_mtime), offsetof(NexMeshCacheHeader, m_source_mtime));
+                close(fd);
+            }
+        }
+
+        data.m_vertices      = file->data() + header.m_vertex_offset;
+        data.m_vertex_stride = header.m_vertex_stride;
+        data.m_vertex_count  = header.m_vertex_count;
+        data.m_indices       = file->data() + header.m_index_offset;
+        data.m_index_size    = header.m_index_size;
+        data.m_index_count   = header.m_index_count;
+        data.m_flags         = header.m_flags;
+        data.m_bounds_min    = {header.m_bounds_min[0], header.m_bounds_min[1], header.m_bounds_min[2]};
+        data.m_bounds_max    = {header.m_bounds_max[0], header.m_bounds_max[1], header.m_bounds_max[2]};
+
+        data.m_shadow_vertices      = file->data() + header.m_shadow_vertex_offset;
+        data.m_shadow_vertex_stride = header.m_shadow_vertex_stride;
+        data.m_shadow_vertex_count  = header.m_shadow_vertex_count;
+        data.m_shadow_indices       = file->data() + header.m_shadow_index_offset;
+        data.m_shadow_index_count   = header.m_shadow_index_count;
+        data.m_submeshes            = file->data() + header.m_submesh_offset;
+        data.m_submesh_stride       = header.m_submesh_stride;
+        data.m_submesh_count        = header.m_submesh_count;
+        return file;
+    }
+
+    bool NexMeshCache::store(const std::string& source_path, const NexMeshCacheData& data) {
+        NexMeshCacheHeader header = {};
+        if (!statSource(source_path, header.m_source_mtime, header.m_source_size)) {
+            return false;
+        }
+
+        uint64_t vertex_bytes        = static_cast<uint64_t>(data.m_vertex_count) * data.m_vertex_stride;
+        uint64_t index_bytes         = static_cast<uint64_t>(data.m_index_count) * data.m_index_size;
+        uint64_t shadow_vertex_bytes = static_cast<uint64_t>(data.m_shadow_vertex_count) * data.m_shadow_vertex_stride;
+        uint64_t shadow_index_bytes  = static_cast<uint64_t>(data.m_shadow_index_count) * data.m_index_size;
+        uint64_t submesh_bytes       = static_cast<uint64_t>(data.m_submesh_count) * data.m_submesh_stride;
+
+        header.m_version              = version;
+        header.m_source_hash          = hashFile(source_path);
+        header.m_vertex_stride        = data.m_vertex_stride;
+        header.m_vertex_count         = data.m_vertex_count;
+        header.m_index_size           = data.m_index_size;
+        header.m_index_count          = data.m_index_count;
+        header.m_flags                = data.m_flags;
+        header.m_shadow_vertex_stride = data.m_shadow_vertex_stride;
+        header.m_shadow_vertex_count  = data.m_shadow_vertex_count;
+        header.m_shadow_index_count   = data.m_shadow_index_count;
+        header.m_submesh_stride       = data.m_submesh_stride;
+        header.m_submesh_count        = data.m_submesh_count;
+        header.m_vertex_offset        = alignBlob(sizeof(header));
+        header.m_index_offset         = alignBlob(header.m_vertex_offset + vertex_bytes);
+        header.m_shadow_vertex_offset = alignBlob(header.m_index_offset + index_bytes);
+        header.m_shadow_index_offset  = alignBlob(header.m_shadow_vertex_offset + shadow_vertex_bytes);
+        header.m_submesh_offset       = alignBlob(header.m_shadow_index_offset + shadow_index_bytes);
+        std::memcpy(header.m_bounds_min, &data.m_bounds_min[0], sizeof(header.m_bounds_min));
+        std::memcpy(header.m_bounds_max, &data.m_bounds_max[0], sizeof(header.m_bounds_max));
+
+        std::string cache_path = cachePath(source_path);
+        std::string temp_path  = cache_path + ".tmp" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+
+        {
+            std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+            if (!file) {
+                return false;
+            }
+
+            const char padding[blob_alignment] = {};
+
+            // pads up to the blob's offset, blobs are written in offset order
+            auto writeBlob = [&](uint64_t offset, const void* blob, uint64_t bytes) {
+                file.write(padding, static_cast<std::streamsize>(offset - static_cast<uint64_t>(file.tellp())));
+                file.write(static_cast<const char*>(blob), static_cast<std::streamsize>(bytes));
+            };
+
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            writeBlob(header.m_vertex_offset, data.m_vertices, vertex_bytes);
+            writeBlob(header.m_index_offset, data.m_indices, index_bytes);
+            writeBlob(header.m_shadow_vertex_offset, data.m_shadow_vertices, shadow_vertex_bytes);
+            writeBlob(header.m_shadow_index_offset, data.m_shadow_indices, shadow_index_bytes);
+            writeBlob(header.m_submesh_offset, data.m_submeshes, submesh_bytes);
+
+            if (!file) {
+                file.close();
+                std::remove(temp_path.c_str());
+                return false;
+            }
+        }
+
+        return std::rename(temp_path.c_str(), cache_path.c_str()) == 0;
+    }
+}  // namespace nex
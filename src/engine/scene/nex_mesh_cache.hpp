@@ -0,0 +1,81 @@
+#pragma once
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+
+#include "../core/nex_mapped_file.hpp"
+
+namespace nex {
+    // on disk layout of a .nexmesh file, the vertex and index blobs follow at 16 byte aligned offsets
+    struct NexMeshCacheHeader {
+        char     m_magic[4]             = {'N', 'X', 'M', 'C'};
+        uint32_t m_version              = 0;
+        uint64_t m_source_hash          = 0;
+        int64_t  m_source_mtime         = 0;  // nanoseconds since the epoch
+        uint64_t m_source_size          = 0;
+        float    m_bounds_min[3]        = {};
+        float    m_bounds_max[3]        = {};
+        uint32_t m_vertex_stride        = 0;
+        uint32_t m_vertex_count         = 0;
+        uint32_t m_index_size           = 0;
+        uint32_t m_index_count          = 0;
+        uint32_t m_flags                = 0;
+        uint32_t m_shadow_vertex_stride = 0;
+        uint32_t m_shadow_vertex_count  = 0;
+        uint32_t m_shadow_index_count   = 0;  // shadow indices use m_index_size as well
+        uint32_t m_submesh_stride       = 0;
+        uint32_t m_submesh_count        = 0;
+        uint64_t m_vertex_offset        = 0;
+        uint64_t m_index_offset         = 0;
+        uint64_t m_shadow_vertex_offset = 0;
+        uint64_t m_shadow_index_offset  = 0;
+        uint64_t m_submesh_offset       = 0;
+    };
+
+    // vertex and index data laid out exactly as it is uploaded
+    struct NexMeshCacheData {
+        const void* m_vertices             = nullptr;
+        uint32_t    m_vertex_stride        = 0;
+        uint32_t    m_vertex_count         = 0;
+        const void* m_indices              = nullptr;
+        uint32_t    m_index_size           = 0;
+        uint32_t    m_index_count          = 0;
+        uint32_t    m_flags                = 0;
+        glm::vec3   m_bounds_min           = {};
+        glm::vec3   m_bounds_max           = {};
+        const void* m_shadow_vertices      = nullptr;  // optional position only stream, see NexMeshCache::flag_shadow_stream
+        uint32_t    m_shadow_vertex_stride = 0;
+        uint32_t    m_shadow_vertex_count  = 0;
+        const void* m_shadow_indices       = nullptr;
+        uint32_t    m_shadow_index_count   = 0;
+        const void* m_submeshes            = nullptr;
+        uint32_t    m_submesh_stride       = 0;
+        uint32_t    m_submesh_count        = 0;
+    };
+
+    class NexMeshCache {
+      public:
+        // bump whenever the vertex layout or the processing done before storing changes
+        static constexpr uint32_t version = 5;
+
+        // processing applied before storing, a cache is only used when its flags match the requested ones
+        static constexpr uint32_t flag_optimized     = 1u << 0;
+        static constexpr uint32_t flag_compact       = 1u << 1;
+        static constexpr uint32_t flag_shadow_stream = 1u << 2;
+        static constexpr uint32_t flag_split         = 1u << 3;
+
+        static std::string cachePath(const std::string& source_path);
+
+        // maps the cache of source_path and points data into it, null when there is no cache, it is stale or was built with other flags.
+        // the index size is whatever was stored, 2 or 4 bytes
+        static std::shared_ptr<NexMappedFile> load(const std::string& source_path, uint32_t vertex_stride, uint32_t flags, NexMeshCacheData& data);
+
+        // writes to a temporary file first and renames it, so a crashed or concurrent writer never leaves a torn cache behind
+        static bool store(const std::string& source_path, const NexMeshCacheData& data);
+
+        static uint64_t hashFile(const std::string& filepath);
+    };
+}  // namespace nex
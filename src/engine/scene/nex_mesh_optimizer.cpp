@@ -0,0 +1,355 @@
+#include "nex_mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+
+namespace nex {
+    // tuning constants from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation"
+    static constexpr int   forsyth_cache_size          = 32;
+    static constexpr float forsyth_cache_decay_power   = 1.5f;
+    static constexpr float forsyth_last_triangle_score = 0.75f;
+    static constexpr float forsyth_valence_boost_scale = 2.0f;
+    static constexpr float forsyth_valence_boost_power = 0.5f;
+    static constexpr int   forsyth_valence_table_size  = 64;
+
+    struct ForsythTables {
+        std::array<float, forsyth_cache_size>         m_cache   = {};
+        std::array<float, forsyth_valence_table_size> m_valence = {};
+
+        ForsythTables() {
+            for (int i = 0; i < forsyth_cache_size; ++i) {
+                // the three vertices of the last triangle get a fixed score so the next pick does not favour one of its edges
+                m_cache[i] = i < 3 ? forsyth_last_triangle_score
+                                   : std::pow(1.0f - static_cast<float>(i - 3) / static_cast<float>(forsyth_cache_size - 3), forsyth_cache_decay_power);
+            }
+            for (int i = 1; i < forsyth_valence_table_size; ++i) {
+                m_valence[i] = forsyth_valence_boost_scale * std::pow(static_cast<float>(i), -forsyth_valence_boost_power);
+            }
+        }
+
+        float score(int cache_position, uint32_t remaining) const {
+            if (remaining == 0) {
+                return -1.0f;
+            }
+
+            float valence = remaining < forsyth_valence_table_size ? m_valence[remaining] : forsyth_valence_boost_scale * std::pow(static_cast<float>(remaining), -forsyth_valence_boost_power);
+            return (cache_position < 0 ? 0.0f : m_cache[cache_position]) + valence;
+        }
+    };
+
+    // fifo cache simulated with timestamps, a vertex is cached while fewer than cache_size misses happened since it was loaded
+    class FifoCache {
+      public:
+        FifoCache(size_t vertex_count, uint32_t cache_size) : m_timestamps(vertex_count, 0), m_cache_size{cache_size}, m_timestamp{cache_size + 1} {}
+
+        uint32_t access(uint32_t vertex) {
+            if (m_timestamp - m_timestamps[vertex] > m_cache_size) {
+                m_timestamps[vertex] = m_timestamp++;
+                return 1;
+            }
+            return 0;
+        }
+
+        uint32_t accessTriangle(const uint32_t* triangle) {
+            return access(triangle[0]) + access(triangle[1]) + access(triangle[2]);
+        }
+
+        void flush() {
+            m_timestamp += m_cache_size + 1;
+        }
+
+      private:
+        std::vector<uint32_t> m_timestamps;
+        uint32_t              m_cache_size;
+        uint32_t              m_timestamp;
+    };
+
+    void NexMeshOptimizer::optimizeVertexCache(std::span<uint32_t> indices, size_t vertex_count) {
+        assert(indices.size() % 3 == 0);
+
+        static const ForsythTables tables;
+
+        size_t triangle_count = indices.size() / 3;
+        if (triangle_count == 0) {
+            return;
+        }
+
+        // triangles adjacent to each vertex in one flat array, the live ones of vertex v are the first remaining[v] after offsets[v]
+        std::vector<uint32_t> remaining(vertex_count, 0);
+        for (uint32_t index : indices) {
+            ++remaining[index];
+        }
+
+        std::vector<uint32_t> offsets(vertex_count + 1, 0);
+        for (size_t v = 0; v < vertex_count; ++v) {
+            offsets[v + 1] = offsets[v] + remaining[v];
+        }
+
+        std::vector<uint32_t> adjacency(indices.size());
+        std::vector<uint32_t> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < indices.size(); ++i) {
+            adjacency[fill[indices[i]]++] = static_cast<uint32_t>(i / 3);
+        }
+
+        std::vector<int>   cache_position(vertex_count, -1);
+        std::vector<float> vertex_score(vertex_count);
+        for (size_t v = 0; v < vertex_count; ++v) {
+            vertex_score[v] = tables.score(-1, remaining[v]);
+        }
+
+        std::vector<float> triangle_score(triangle_count);
+        std::vector<bool>  emitted(triangle_count, false);
+        for (size_t t = 0; t < triangle_count; ++t) {
+            triangle_score[t] = vertex_score[indices[t * 3 + 0]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+        }
+
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+
+        std::vector<uint32_t> cache;
+        std::vector<uint32_t> next_cache;
+        cache.reserve(forsyth_cache_size + 3);
+        next_cache.reserve(forsyth_cache_size + 3);
+
+        size_t  input_cursor = 0;
+        int64_t best         = std::max_element(triangle_score.begin(), triangle_score.end()) - triangle_score.begin();
+
+        for (size_t emitted_count = 0; emitted_count < triangle_count; ++emitted_count) {
+            // nothing in the cache has live triangles left, continue with the next triangle in input order
+            if (best < 0) {
+                while (emitted[input_cursor]) {
+                    ++input_cursor;
+                }
+                best = static_cast<int64_t>(input_cursor);
+            }
+
+            const uint32_t* triangle = &indices[best * 3];
+            output.insert(output.end(), triangle, triangle + 3);
+            emitted[best] = true;
+
+            for (int corner = 0; corner < 3; ++corner) {
+                uint32_t  vertex = triangle[corner];
+                uint32_t* begin  = &adjacency[offsets[vertex]];
+                uint32_t* end    = begin + remaining[vertex];
+                uint32_t* found  = std::find(begin, end, static_cast<uint32_t>(best));
+
+                *found = *(end - 1);
+                --remaining[vertex];
+            }
+
+            // the triangle's vertices move to the front, everything else shifts back and may fall out
+            next_cache.assign(triangle, triangle + 3);
+            for (uint32_t vertex : cache) {
+                if (vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2]) {
+                    next_cache.push_back(vertex);
+                }
+            }
+
+            for (size_t i = forsyth_cache_size; i < next_cache.size(); ++i) {
+                cache_position[next_cache[i]] = -1;
+                vertex_score[next_cache[i]]   = tables.score(-1, remaining[next_cache[i]]);
+            }
+
+            size_t cached = std::min<size_t>(next_cache.size(), forsyth_cache_size);
+            for (size_t i = 0; i < cached; ++i) {
+                cache_position[next_cache[i]] = static_cast<int>(i);
+                vertex_score[next_cache[i]]   = tables.score(static_cast<int>(i), remaining[next_cache[i]]);
+            }
+
+            // rescore the live triangles around every vertex whose score changed and pick the best one touching the cache
+            best             = -1;
+            float best_score = -1.0f;
+
+            for (size_t i = 0; i < next_cache.size(); ++i) {
+                uint32_t vertex = next_cache[i];
+                for (uint32_t a = offsets[vertex]; a < offsets[vertex] + remaining[vertex]; ++a) {
+                    uint32_t t        = adjacency[a];
+                    triangle_score[t] = vertex_score[indices[t * 3 + 0]] + vertex_score[indices[t * 3 + 1]] + vertex_score[indices[t * 3 + 2]];
+
+                    if (i < cached && triangle_score[t] > best_score) {
+                        best       = t;
+                        best_score = triangle_score[t];
+                    }
+                }
+            }
+
+            next_cache.resize(cached);
+            std::swap(cache, next_cache);
+        }
+
+        std::copy(output.begin(), output.end(), indices.begin());
+    }
+
+    void NexMeshOptimizer::optimizeOverdraw(std::span<uint32_t> indices, const float* positions, size_t vertex_count, size_t position_stride, float threshold) {
+        assert(indices.size() % 3 == 0);
+
+        size_t triangle_count = indices.size() / 3;
+        if (triangle_count == 0) {
+            return;
+        }
+
+        FifoCache cache(vertex_count, analysis_cache_size);
+
+        // hard boundaries where the cache starts from scratch anyway, i.e. all three vertices miss
+        std::vector<size_t> hard_boundaries;
+        for (size_t t = 0; t < triangle_count; ++t) {
+            if (cache.accessTriangle(&indices[t * 3]) == 3 || t == 0) {
+                hard_boundaries.push_back(t);
+            }
+        }
+        hard_boundaries.push_back(triangle_count);
+
+        // soft boundaries split a hard cluster as soon as the part since the last split is within threshold of the cluster's own acmr,
+        // so drawing the pieces in any order costs at most that much extra vertex work
+        std::vector<size_t> clusters;
+        for (size_t c = 0; c + 1 < hard_boundaries.size(); ++c) {
+            size_t begin = hard_boundaries[c];
+            size_t end   = hard_boundaries[c + 1];
+
+            cache.flush();
+            uint32_t cluster_misses = 0;
+            for (size_t t = begin; t < end; ++t) {
+                cluster_misses += cache.accessTriangle(&indices[t * 3]);
+            }
+
+            float cluster_threshold = threshold * static_cast<float>(cluster_misses) / static_cast<float>(end - begin);
+
+            cache.flush();
+            clusters.push_back(begin);
+
+            uint32_t misses = 0;
+            size_t   start  = begin;
+            for (size_t t = begin; t < end; ++t) {
+                misses += cache.accessTriangle(&indices[t * 3]);
+
+                if (t + 1 < end && static_cast<float>(misses) / static_cast<float>(t - start + 1) <= cluster_threshold) {
+                    clusters.push_back(t + 1);
+                    start  = t + 1;
+                    misses = 0;
+                    cache.flush();
+                }
+            }
+        }
+        clusters.push_back(triangle_count);
+
+        auto position = [&](uint32_t vertex) {
+            const float* p = reinterpret_cast<const float*>(reinterpret_cast<const char*>(positions) + vertex * position_stride);
+            return std::array<float, 3>{p[0], p[1], p[2]};
+        };
+
+        struct Cluster {
+            size_t m_begin       = 0;
+            size_t m_end         = 0;
+            float  m_centroid[3] = {};
+            float  m_normal[3]   = {};
+            float  m_area        = 0.0f;
+            float  m_sort_key    = 0.0f;
+        };
+
+        std::vector<Cluster> sorted(clusters.size() - 1);
+        float                mesh_centroid[3] = {};
+        float                mesh_area        = 0.0f;
+
+        for (size_t c = 0; c < sorted.size(); ++c) {
+            Cluster& cluster = sorted[c];
+            cluster.m_begin  = clusters[c];
+            cluster.m_end    = clusters[c + 1];
+
+            for (size_t t = cluster.m_begin; t < cluster.m_end; ++t) {
+                auto a = position(indices[t * 3 + 0]);
+                auto b = position(indices[t * 3 + 1]);
+                auto d = position(indices[t * 3 + 2]);
+
+                float ab[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+                float ad[3] = {d[0] - a[0], d[1] - a[1], d[2] - a[2]};
+                float n[3]  = {ab[1] * ad[2] - ab[2] * ad[1], ab[2] * ad[0] - ab[0] * ad[2], ab[0] * ad[1] - ab[1] * ad[0]};
+                float area  = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+                for (int k = 0; k < 3; ++k) {
+                    cluster.m_centroid[k] += (a[k] + b[k] + d[k]) / 3.0f * area;
+                    cluster.m_normal[k] += n[k];
+                }
+                cluster.m_area += area;
+            }
+
+            for (int k = 0; k < 3; ++k) {
+                mesh_centroid[k] += cluster.m_centroid[k];
+                cluster.m_centroid[k] /= std::max(cluster.m_area, 1e-20f);
+            }
+            mesh_area += cluster.m_area;
+        }
+
+        for (float& component : mesh_centroid) {
+            component /= std::max(mesh_area, 1e-20f);
+        }
+
+        // clusters far out along their own normal are likely to occlude the rest, so they go first
+        for (auto& cluster : sorted) {
+            float length = std::sqrt(cluster.m_normal[0] * cluster.m_normal[0] + cluster.m_normal[1] * cluster.m_normal[1] + cluster.m_normal[2] * cluster.m_normal[2]);
+            float scale  = length > 0.0f ? 1.0f / length : 0.0f;
+
+            for (int k = 0; k < 3; ++k) {
+                cluster.m_sort_key += (cluster.m_centroid[k] - mesh_centroid[k]) * cluster.m_normal[k] * scale;
+            }
+        }
+
+        std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) { return a.m_sort_key > b.m_sort_key; });
+
+        std::vector<uint32_t> output;
+        output.reserve(indices.size());
+        for (const auto& cluster : sorted) {
+            output.insert(output.end(), indices.begin() + cluster.m_begin * 3, indices.begin() + cluster.m_end * 3);
+        }
+
+        std::copy(output.begin(), output.end(), indices.begin());
+    }
+
+    size_t NexMeshOptimizer::buildFetchRemap(std::span<uint32_t> indices, size_t vertex_count, std::vector<uint32_t>& remap) {
+        remap.assign(vertex_count, ~0u);
+
+        uint32_t next = 0;
+        for (uint32_t& index : indices) {
+            if (remap[index] == ~0u) {
+                remap[index] = next++;
+            }
+            index = remap[index];
+        }
+        return next;
+    }
+
+    template <typename Index>
+    static NexVertexCacheStats analyze(std::span<const Index> indices, size_t vertex_count, uint32_t cache_size) {
+        NexVertexCacheStats stats = {};
+        if (indices.empty()) {
+            return stats;
+        }
+
+        FifoCache         cache(vertex_count, cache_size);
+        std::vector<bool> referenced(vertex_count, false);
+
+        uint32_t misses           = 0;
+        size_t   referenced_count = 0;
+        for (uint32_t index : indices) {
+            misses += cache.access(index);
+
+            if (!referenced[index]) {
+                referenced[index] = true;
+                ++referenced_count;
+            }
+        }
+
+        stats.m_acmr = static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+        stats.m_atvr = static_cast<float>(misses) / static_cast<float>(referenced_count);
+        return stats;
+    }
+
+    NexVertexCacheStats NexMeshOptimizer::analyzeVertexCache(std::span<const uint32_t> indices, size_t vertex_count, uint32_t cache_size) {
+        return analyze(indices, vertex_count, cache_size);
+    }
+
+    NexVertexCacheStats NexMeshOptimizer::analyzeVertexCache(std::span<const uint16_t> indices, size_t vertex_count, uint32_t cache_size) {
+        return analyze(indices, vertex_count, cache_size);
+    }
+}  // namespace nex
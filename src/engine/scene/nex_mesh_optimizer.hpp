@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+namespace nex {
+    struct NexVertexCacheStats {
+        float m_acmr = 0.0f;  // average cache miss ratio, transformed vertices per triangle (0.5 is the practical floor, 3 is no reuse)
+        float m_atvr = 0.0f;  // average transformed to vertex ratio, 1 means every vertex is shaded exactly once
+    };
+
+    // Index buffer reordering passes, run in this order: vertex cache, overdraw, then the fetch remap.
+    class NexMeshOptimizer {
+      public:
+        // size of the fifo used to report stats, close to what current gpus reuse after the post transform cache went away
+        static constexpr uint32_t analysis_cache_size = 16;
+
+        // reorders triangles for post transform cache locality, Forsyth's linear speed algorithm
+        static void optimizeVertexCache(std::span<uint32_t> indices, size_t vertex_count);
+
+        // splits the cache optimized order into clusters and sorts them outside in, so front most geometry tends to draw first.
+        // threshold bounds how much the acmr may grow from the split (1.05 allows 5%)
+        static void optimizeOverdraw(std::span<uint32_t> indices, const float* positions, size_t vertex_count, size_t position_stride, float threshold = 1.05f);
+
+        // renumbers vertices in first use order, remap[old] is the new index or ~0u for unreferenced vertices, returns the used vertex count
+        static size_t buildFetchRemap(std::span<uint32_t> indices, size_t vertex_count, std::vector<uint32_t>& remap);
+
+        // remaps the vertex array with the table from buildFetchRemap, dropping unreferenced vertices
+        template <typename Vertex>
+        static void remapVertices(std::vector<Vertex>& vertices, const std::vector<uint32_t>& remap, size_t used_count) {
+            std::vector<Vertex> remapped(used_count);
+            for (size_t i = 0; i < vertices.size(); ++i) {
+                if (remap[i] != ~0u) {
+                    remapped[remap[i]] = vertices[i];
+                }
+            }
+            vertices = std::move(remapped);
+        }
+
+        static NexVertexCacheStats analyzeVertexCache(std::span<const uint32_t> indices, size_t vertex_count, uint32_t cache_size = analysis_cache_size);
+        static NexVertexCacheStats analyzeVertexCache(std::span<const uint16_t> indices, size_t vertex_count, uint32_t cache_size = analysis_cache_size);
+    };
+}  // namespace nex
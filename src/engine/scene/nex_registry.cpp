@@ -0,0 +1,29 @@
+#include "nex_registry.hpp"
+
+#include <stdexcept>
+
+namespace nex {
+    NexEntity NexRegistry::create() {
+        if (m_alive.size() == null_entity) {
+            throw std::runtime_error("Ran out of entity ids!");
+        }
+
+        m_alive.push_back(true);
+        ++m_entity_count;
+        return static_cast<NexEntity>(m_alive.size() - 1);
+    }
+
+    void NexRegistry::destroy(NexEntity entity) {
+        if (!isAlive(entity)) {
+            return;
+        }
+
+        for (auto& pool : m_pools) {
+            if (pool) {
+                pool->remove(entity);
+            }
+        }
+        m_alive[entity] = false;
+        --m_entity_count;
+    }
+}  // namespace nex
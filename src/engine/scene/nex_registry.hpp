@@ -0,0 +1,215 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace nex {
+    // Entities are plain ids, their components live in the NexRegistry that created them
+    using NexEntity                        = uint32_t;
+    inline constexpr NexEntity null_entity = std::numeric_limits<NexEntity>::max();
+
+    class NexComponentPoolBase {
+      public:
+        virtual ~NexComponentPoolBase() = default;
+
+        virtual void remove(NexEntity entity) = 0;
+
+        bool contains(NexEntity entity) const {
+            return entity < m_sparse.size() && m_sparse[entity] != invalid_index;
+        }
+
+        size_t size() const {
+            return m_dense.size();
+        }
+
+        // owners of the components, in the order they are packed in
+        const std::vector<NexEntity>& entities() const {
+            return m_dense;
+        }
+
+      protected:
+        static constexpr uint32_t invalid_index = std::numeric_limits<uint32_t>::max();
+
+        std::vector<uint32_t>  m_sparse = {};  // entity to packed index
+        std::vector<NexEntity> m_dense  = {};  // packed index to entity
+    };
+
+    // Sparse set of one component type. The components are packed in one array without holes, removing one moves the last
+    // into its slot, so references into the pool stay valid only until the next emplace() or remove()
+    template <typename T>
+    class NexComponentPool : public NexComponentPoolBase {
+      public:
+        template <typename... Args>
+        T& emplace(NexEntity entity, Args&&... args) {
+            assert(!contains(entity) && "Entity already has this component!");
+
+            if (entity >= m_sparse.size()) {
+                m_sparse.resize(entity + 1, invalid_index);
+            }
+            m_sparse[entity] = static_cast<uint32_t>(m_dense.size());
+            m_dense.push_back(entity);
+            return m_components.emplace_back(std::forward<Args>(args)...);
+        }
+
+        void remove(NexEntity entity) override {
+            if (!contains(entity)) {
+                return;
+            }
+
+            uint32_t index = m_sparse[entity];
+            uint32_t last  = static_cast<uint32_t>(m_dense.size() - 1);
+            if (index != last) {
+                m_components[index]      = std::move(m_components[last]);
+                m_dense[index]           = m_dense[last];
+                m_sparse[m_dense[index]] = index;
+            }
+
+            m_components.pop_back();
+            m_dense.pop_back();
+            m_sparse[entity] = invalid_index;
+        }
+
+        T& get(NexEntity entity) {
+            assert(contains(entity) && "Entity does not have this component!");
+            return m_components[m_sparse[entity]];
+        }
+
+        T* tryGet(NexEntity entity) {
+            return contains(entity) ? &m_components[m_sparse[entity]] : nullptr;
+        }
+
+        // packed in the same order as entities()
+        std::vector<T>& components() {
+            return m_components;
+        }
+
+      private:
+        std::vector<T> m_components = {};
+    };
+
+    // Entities having all of Ts. Iteration walks the smallest pool and looks the entity up in the others,
+    // a single component view walks its packed array directly
+    template <typename... Ts>
+    class NexView {
+      public:
+        explicit NexView(NexComponentPool<Ts>&... pools) : m_pools{&pools...} {}
+
+        // calls fn(entity, Ts&...), fn must not add or remove any of Ts
+        template <typename F>
+        void each(F&& fn) {
+            if constexpr (sizeof...(Ts) == 1) {
+                auto& pool       = *std::get<0>(m_pools);
+                auto& components = pool.components();
+                auto& entities   = pool.entities();
+                for (size_t i = 0; i < components.size(); ++i) {
+                    fn(entities[i], components[i]);
+                }
+            } else {
+                for (NexEntity entity : lead().entities()) {
+                    if ((std::get<NexComponentPool<Ts>*>(m_pools)->contains(entity) && ...)) {
+                        fn(entity, std::get<NexComponentPool<Ts>*>(m_pools)->get(entity)...);
+                    }
+                }
+            }
+        }
+
+        // upper bound of the entities each() visits
+        size_t sizeHint() const {
+            return lead().size();
+        }
+
+      private:
+        const NexComponentPoolBase& lead() const {
+            const NexComponentPoolBase* smallest = std::get<0>(m_pools);
+            ((smallest = std::get<NexComponentPool<Ts>*>(m_pools)->size() < smallest->size() ? std::get<NexComponentPool<Ts>*>(m_pools) : smallest), ...);
+            return *smallest;
+        }
+
+        std::tuple<NexComponentPool<Ts>*...> m_pools;
+    };
+
+    // Owns the entities and one NexComponentPool per component type. Ids are never reused, so an id held past destroy() simply
+    // stops having components
+    class NexRegistry {
+      public:
+        NexRegistry() = default;
+
+        NexRegistry(const NexRegistry&)            = delete;
+        NexRegistry& operator=(const NexRegistry&) = delete;
+
+        NexEntity create();
+        void      destroy(NexEntity entity);
+
+        bool isAlive(NexEntity entity) const {
+            return entity < m_alive.size() && m_alive[entity];
+        }
+
+        size_t getEntityCount() const {
+            return m_entity_count;
+        }
+
+        template <typename T, typename... Args>
+        T& emplace(NexEntity entity, Args&&... args) {
+            return pool<T>().emplace(entity, std::forward<Args>(args)...);
+        }
+
+        template <typename T>
+        void remove(NexEntity entity) {
+            pool<T>().remove(entity);
+        }
+
+        template <typename T>
+        bool has(NexEntity entity) const {
+            uint32_t type = typeId<T>();
+            return type < m_pools.size() && m_pools[type] && m_pools[type]->contains(entity);
+        }
+
+        template <typename T>
+        T& get(NexEntity entity) {
+            return pool<T>().get(entity);
+        }
+
+        template <typename T>
+        T* tryGet(NexEntity entity) {
+            return pool<T>().tryGet(entity);
+        }
+
+        template <typename... Ts>
+        NexView<Ts...> view() {
+            return NexView<Ts...>(pool<Ts>()...);
+        }
+
+        template <typename T>
+        NexComponentPool<T>& pool() {
+            uint32_t type = typeId<T>();
+            if (type >= m_pools.size()) {
+                m_pools.resize(type + 1);
+            }
+            if (!m_pools[type]) {
+                m_pools[type] = std::make_unique<NexComponentPool<T>>();
+            }
+            return static_cast<NexComponentPool<T>&>(*m_pools[type]);
+        }
+
+      private:
+        static uint32_t nextTypeId() {
+            static uint32_t next = 0;
+            return next++;
+        }
+
+        template <typename T>
+        static uint32_t typeId() {
+            static const uint32_t id = nextTypeId();
+            return id;
+        }
+
+        std::vector<std::unique_ptr<NexComponentPoolBase>> m_pools        = {};  // indexed by typeId()
+        std::vector<bool>                                  m_alive        = {};  // indexed by entity
+        size_t                                             m_entity_count = 0;
+    };
+}  // namespace nex
@@ -0,0 +1,291 @@
+#include "nex_scene_graph.hpp"
+
+#include <stdexcept>
+
+#include "../core/nex_trace.hpp"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+namespace nex {
+#if defined(__SSE2__) || defined(_M_X64)
+    static constexpr size_t transform_lanes = 4;
+
+    // sine and cosine of four angles. x is reduced to k * pi/2 + r with r in [-pi/4, pi/4], pi/2 is split in three parts so the
+    // reduction stays exact for the angles transforms use, and r goes through the taylor series up to the terms below 1e-8
+    static void sinCos(__m128 x, __m128& s, __m128& c) {
+        __m128i k  = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(0.636619772f)));
+        __m128  kf = _mm_cvtepi32_ps(k);
+        __m128  r  = _mm_sub_ps(x, _mm_mul_ps(kf, _mm_set1_ps(1.5703125f)));
+        r          = _mm_sub_ps(r, _mm_mul_ps(kf, _mm_set1_ps(4.837512969970703125e-4f)));
+        r          = _mm_sub_ps(r, _mm_mul_ps(kf, _mm_set1_ps(7.54978995489188216e-8f)));
+        __m128 r2  = _mm_mul_ps(r, r);
+
+        __m128 sin_r = _mm_add_ps(_mm_set1_ps(-1.0f / 5040.0f), _mm_mul_ps(r2, _mm_set1_ps(1.0f / 362880.0f)));
+        sin_r        = _mm_add_ps(_mm_set1_ps(1.0f / 120.0f), _mm_mul_ps(r2, sin_r));
+        sin_r        = _mm_add_ps(_mm_set1_ps(-1.0f / 6.0f), _mm_mul_ps(r2, sin_r));
+        sin_r        = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, r2), sin_r));
+
+        __m128 cos_r = _mm_add_ps(_mm_set1_ps(1.0f / 40320.0f), _mm_mul_ps(r2, _mm_set1_ps(-1.0f / 3628800.0f)));
+        cos_r        = _mm_add_ps(_mm_set1_ps(-1.0f / 720.0f), _mm_mul_ps(r2, cos_r));
+        cos_r        = _mm_add_ps(_mm_set1_ps(1.0f / 24.0f), _mm_mul_ps(r2, cos_r));
+        cos_r        = _mm_add_ps(_mm_set1_ps(-0.5f), _mm_mul_ps(r2, cos_r));
+        cos_r        = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(r2, cos_r));
+
+        // odd quadrants swap sine and cosine, the second bit of the quadrant flips the sign of each
+        const __m128i one    = _mm_set1_epi32(1);
+        const __m128i two    = _mm_set1_epi32(2);
+        __m128        swap   = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(k, one), one));
+        __m128        sign_s = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(k, two), 30));
+        __m128        sign_c = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(k, one), two), 30));
+
+        s = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, cos_r), _mm_andnot_ps(swap, sin_r)), sign_s);
+        c = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, sin_r), _mm_andnot_ps(swap, cos_r)), sign_c);
+    }
+#else
+    static constexpr size_t transform_lanes = 1;
+#endif
+
+    void NexSceneGraph::setParent(NexRegistry& registry, NexEntity child, NexEntity parent) {
+        auto& hierarchy = registry.pool<HierarchyComponent>();
+
+        for (NexEntity ancestor = parent; ancestor != null_entity; ancestor = hierarchy.get(ancestor).m_parent) {
+            if (ancestor == child) {
+                throw std::runtime_error("Cannot parent an entity to itself or its descendant!");
+            }
+            if (!hierarchy.contains(ancestor)) {
+                break;
+            }
+        }
+
+        // both ends get their component first, emplacing may move the others
+        if (!hierarchy.contains(child)) {
+            hierarchy.emplace(child);
+        }
+        if (parent != null_entity && !hierarchy.contains(parent)) {
+            hierarchy.emplace(parent);
+        }
+
+        unlink(hierarchy, child);
+        if (parent != null_entity) {
+            HierarchyComponent& parent_node = hierarchy.get(parent);
+            HierarchyComponent& child_node  = hierarchy.get(child);
+            child_node.m_parent             = parent;
+            child_node.m_next_sibling       = parent_node.m_first_child;
+            if (parent_node.m_first_child != null_entity) {
+                hierarchy.get(parent_node.m_first_child).m_prev_sibling = child;
+            }
+            parent_node.m_first_child = child;
+        }
+
+        if (TransformComponent* transform = registry.tryGet<TransformComponent>(child)) {
+            transform->markDirty();
+        }
+    }
+
+    void NexSceneGraph::detach(NexRegistry& registry, NexEntity entity) {
+        auto& hierarchy = registry.pool<HierarchyComponent>();
+        if (!hierarchy.contains(entity)) {
+            return;
+        }
+
+        unlink(hierarchy, entity);
+        if (TransformComponent* transform = registry.tryGet<TransformComponent>(entity)) {
+            transform->markDirty();
+        }
+
+        NexEntity child = hierarchy.get(entity).m_first_child;
+        while (child != null_entity) {
+            HierarchyComponent& child_node = hierarchy.get(child);
+            NexEntity           next       = child_node.m_next_sibling;
+            child_node.m_parent            = null_entity;
+            child_node.m_next_sibling      = null_entity;
+            child_node.m_prev_sibling      = null_entity;
+
+            if (TransformComponent* transform = registry.tryGet<TransformComponent>(child)) {
+                transform->markDirty();
+            }
+            child = next;
+        }
+
+        hierarchy.remove(entity);
+    }
+
+    void NexSceneGraph::unlink(NexComponentPool<HierarchyComponent>& hierarchy, NexEntity entity) {
+        HierarchyComponent& node = hierarchy.get(entity);
+        if (node.m_prev_sibling != null_entity) {
+            hierarchy.get(node.m_prev_sibling).m_next_sibling = node.m_next_sibling;
+        } else if (node.m_parent != null_entity) {
+            hierarchy.get(node.m_parent).m_first_child = node.m_next_sibling;
+        }
+        if (node.m_next_sibling != null_entity) {
+            hierarchy.get(node.m_next_sibling).m_prev_sibling = node.m_prev_sibling;
+        }
+
+        node.m_parent       = null_entity;
+        node.m_next_sibling = null_entity;
+        node.m_prev_sibling = null_entity;
+    }
+
+    void NexSceneGraph::update(NexRegistry& registry) {
+        NEX_TRACE_SCOPE("scene graph update");
+        auto& transforms = registry.pool<TransformComponent>();
+        auto& hierarchy  = registry.pool<HierarchyComponent>();
+
+        m_dirty.clear();
+        auto& components = transforms.components();
+        for (size_t i = 0; i < components.size(); ++i) {
+            if (components[i].m_dirty) {
+                m_dirty.push_back(static_cast<uint32_t>(i));
+            }
+        }
+
+        m_updated_count   = m_dirty.size();
+        m_hierarchy_dirty = false;
+        buildLocalMatrices(transforms, hierarchy);
+        if (m_hierarchy_dirty) {
+            propagate(transforms, hierarchy);
+        }
+    }
+
+    void NexSceneGraph::buildLocalMatrices(NexComponentPool<TransformComponent>& transforms, NexComponentPool<HierarchyComponent>& hierarchy) {
+        auto&       components = transforms.components();
+        const auto& entities   = transforms.entities();
+
+        // roots are done here, linked transforms keep their dirty flag for propagate()
+        auto finish = [&](uint32_t index, const glm::mat3& local_normal) {
+            TransformComponent& transform = components[index];
+            HierarchyComponent* node      = hierarchy.tryGet(entities[index]);
+            if (node == nullptr || node->m_parent == null_entity) {
+                transform.m_world_matrix  = transform.m_local_matrix;
+                transform.m_normal_matrix = local_normal;
+            }
+            if (node == nullptr) {
+                transform.m_dirty = false;
+            } else {
+                m_hierarchy_dirty = true;
+            }
+        };
+
+        size_t batched = m_dirty.size() / transform_lanes * transform_lanes;
+
+#if defined(__SSE2__) || defined(_M_X64)
+        alignas(16) float in[9][transform_lanes];
+        alignas(16) float out[18][transform_lanes];
+        for (size_t i = 0; i < batched; i += transform_lanes) {
+            for (size_t lane = 0; lane < transform_lanes; ++lane) {
+                const TransformComponent& transform = components[m_dirty[i + lane]];
+                for (int axis = 0; axis < 3; ++axis) {
+                    in[axis][lane]     = transform.m_rotation[axis];
+                    in[3 + axis][lane] = transform.m_scale[axis];
+                    in[6 + axis][lane] = 1.0f / transform.m_scale[axis];
+                }
+            }
+
+            __m128 s1, c1, s2, c2, s3, c3;
+            sinCos(_mm_load_ps(in[1]), s1, c1);
+            sinCos(_mm_load_ps(in[0]), s2, c2);
+            sinCos(_mm_load_ps(in[2]), s3, c3);
+
+            // same rotation as TransformComponent::localMatrix(), column by column
+            __m128 s2s3        = _mm_mul_ps(s2, s3);
+            __m128 c3s2        = _mm_mul_ps(c3, s2);
+            __m128 rotation[9] = {
+                _mm_add_ps(_mm_mul_ps(c1, c3), _mm_mul_ps(s1, s2s3)),
+                _mm_mul_ps(c2, s3),
+                _mm_sub_ps(_mm_mul_ps(c1, s2s3), _mm_mul_ps(c3, s1)),
+                _mm_sub_ps(_mm_mul_ps(s1, c3s2), _mm_mul_ps(c1, s3)),
+                _mm_mul_ps(c2, c3),
+                _mm_add_ps(_mm_mul_ps(c1, c3s2), _mm_mul_ps(s1, s3)),
+                _mm_mul_ps(c2, s1),
+                _mm_sub_ps(_mm_setzero_ps(), s2),
+                _mm_mul_ps(c1, c2),
+            };
+
+            for (int column = 0; column < 3; ++column) {
+                __m128 scale     = _mm_load_ps(in[3 + column]);
+                __m128 inv_scale = _mm_load_ps(in[6 + column]);
+                for (int row = 0; row < 3; ++row) {
+                    _mm_store_ps(out[column * 3 + row], _mm_mul_ps(rotation[column * 3 + row], scale));
+                    _mm_store_ps(out[9 + column * 3 + row], _mm_mul_ps(rotation[column * 3 + row], inv_scale));
+                }
+            }
+
+            for (size_t lane = 0; lane < transform_lanes; ++lane) {
+                TransformComponent& transform = components[m_dirty[i + lane]];
+                glm::mat3           local_normal;
+                for (int column = 0; column < 3; ++column) {
+                    for (int row = 0; row < 3; ++row) {
+                        transform.m_local_matrix[column][row] = out[column * 3 + row][lane];
+                        local_normal[column][row]             = out[9 + column * 3 + row][lane];
+                    }
+                    transform.m_local_matrix[column][3] = 0.0f;
+                }
+                transform.m_local_matrix[3] = glm::vec4{transform.m_translation, 1.0f};
+                finish(m_dirty[i + lane], local_normal);
+            }
+        }
+#endif
+
+        for (size_t i = batched; i < m_dirty.size(); ++i) {
+            TransformComponent& transform = components[m_dirty[i]];
+            transform.m_local_matrix      = transform.localMatrix();
+            finish(m_dirty[i], transform.localNormalMatrix());
+        }
+    }
+
+    void NexSceneGraph::propagate(NexComponentPool<TransformComponent>& transforms, NexComponentPool<HierarchyComponent>& hierarchy) {
+        auto&       nodes    = hierarchy.components();
+        const auto& entities = hierarchy.entities();
+
+        for (size_t i = 0; i < nodes.size(); ++i) {
+            if (nodes[i].m_parent != null_entity) {
+                continue;
+            }
+
+            TransformComponent* root         = transforms.tryGet(entities[i]);
+            bool                root_changed = root != nullptr && root->m_dirty;
+            if (root != nullptr) {
+                root->m_dirty = false;
+            }
+
+            m_stack.clear();
+            for (NexEntity child = nodes[i].m_first_child; child != null_entity; child = hierarchy.get(child).m_next_sibling) {
+                m_stack.push_back({child, root_changed});
+            }
+
+            while (!m_stack.empty()) {
+                auto [entity, parent_changed] = m_stack.back();
+                m_stack.pop_back();
+
+                TransformComponent* transform = transforms.tryGet(entity);
+                bool                changed   = parent_changed || (transform != nullptr && transform->m_dirty);
+                if (transform != nullptr && changed) {
+                    if (!transform->m_dirty) {
+                        ++m_updated_count;
+                    }
+
+                    // the columns of the local matrix are the rotation's times the scale, dividing them by their squared length
+                    // leaves the rotation over the scale, which is the local normal matrix
+                    glm::mat3 local_normal;
+                    for (int column = 0; column < 3; ++column) {
+                        glm::vec3 axis       = glm::vec3(transform->m_local_matrix[column]);
+                        local_normal[column] = axis / glm::dot(axis, axis);
+                    }
+
+                    // a parent without a transform is treated as the identity
+                    const HierarchyComponent& node   = hierarchy.get(entity);
+                    TransformComponent*       parent = transforms.tryGet(node.m_parent);
+                    transform->m_world_matrix        = parent != nullptr ? parent->m_world_matrix * transform->m_local_matrix : transform->m_local_matrix;
+                    transform->m_normal_matrix       = parent != nullptr ? parent->m_normal_matrix * local_normal : local_normal;
+                    transform->m_dirty               = false;
+                }
+
+                for (NexEntity child = hierarchy.get(entity).m_first_child; child != null_entity; child = hierarchy.get(child).m_next_sibling) {
+                    m_stack.push_back({child, changed});
+                }
+            }
+        }
+    }
+}  // namespace nex
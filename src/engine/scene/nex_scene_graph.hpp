@@ -0,0 +1,41 @@
+#pragma once
+
+#include <utility>
+#include <vector>
+
+#include "nex_entity.hpp"
+
+namespace nex {
+    // Keeps the cached matrices of every TransformComponent up to date. Once per frame the dirty transforms are gathered and
+    // their local matrices rebuilt four at a time with SSE, then the changes are pushed down the parent/child links, so a
+    // child is only rebuilt when it or one of its ancestors moved. Transforms that did not change cost a flag test.
+    class NexSceneGraph {
+      public:
+        // links child under parent, or makes it a root again for null_entity. The child keeps its local transform, so it
+        // follows its new parent from the next update on
+        static void setParent(NexRegistry& registry, NexEntity child, NexEntity parent);
+
+        // unlinks the entity from its parent and turns its children into roots, call it before destroying a linked entity
+        static void detach(NexRegistry& registry, NexEntity entity);
+
+        // call once per frame after the transforms were changed and before anything reads mat4() or normalMatrix()
+        void update(NexRegistry& registry);
+
+        // transforms whose matrices were rebuilt by the last update
+        size_t getUpdatedCount() const {
+            return m_updated_count;
+        }
+
+      private:
+        void buildLocalMatrices(NexComponentPool<TransformComponent>& transforms, NexComponentPool<HierarchyComponent>& hierarchy);
+        void propagate(NexComponentPool<TransformComponent>& transforms, NexComponentPool<HierarchyComponent>& hierarchy);
+
+        static void unlink(NexComponentPool<HierarchyComponent>& hierarchy, NexEntity entity);
+
+        // kept between frames so steady state updates do not allocate
+        std::vector<uint32_t>                   m_dirty           = {};  // packed indices into the transform pool
+        std::vector<std::pair<NexEntity, bool>> m_stack           = {};  // entity, whether one of its ancestors changed
+        size_t                                  m_updated_count   = 0;
+        bool                                    m_hierarchy_dirty = false;
+    };
+}  // namespace nex
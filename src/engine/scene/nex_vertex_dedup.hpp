@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace nex {
+    // Flat open addressing table from obj index triplets (position/normal/texcoord) to output vertex indices.
+    // Two corners that reference the same triplet build the same vertex, so comparing three ints replaces hashing and comparing eleven floats.
+    // Sized once up front for the worst case of every corner being unique, so it never rehashes.
+    class NexVertexDedupTable {
+      public:
+        static constexpr uint32_t empty = std::numeric_limits<uint32_t>::max();
+
+        explicit NexVertexDedupTable(size_t max_entries) {
+            // at most half full keeps linear probe sequences short
+            size_t capacity = std::bit_ceil(std::max<size_t>(max_entries * 2, 16));
+            m_mask          = capacity - 1;
+            m_entries.resize(capacity);
+        }
+
+        // returns the vertex index stored for the triplet, inserting `next` if the triplet is new
+        uint32_t findOrInsert(int vertex, int normal, int texcoord, uint32_t next, bool& inserted) {
+            size_t slot = hash(vertex, normal, texcoord) & m_mask;
+
+            while (true) {
+                Entry& entry = m_entries[slot];
+
+                if (entry.m_value == empty) {
+                    entry    = {vertex, normal, texcoord, next};
+                    inserted = true;
+                    return next;
+                }
+
+                if (entry.m_vertex == vertex && entry.m_normal == normal && entry.m_texcoord == texcoord) {
+                    inserted = false;
+                    return entry.m_value;
+                }
+
+                slot = (slot + 1) & m_mask;
+            }
+        }
+
+      private:
+        struct Entry {
+            int32_t  m_vertex   = 0;
+            int32_t  m_normal   = 0;
+            int32_t  m_texcoord = 0;
+            uint32_t m_value    = empty;
+        };
+
+        static size_t hash(int vertex, int normal, int texcoord) {
+            uint64_t h = static_cast<uint32_t>(vertex) * 0x9e3779b97f4a7c15ull;
+            h ^= static_cast<uint32_t>(normal) * 0xc2b2ae3d27d4eb4full;
+            h ^= static_cast<uint32_t>(texcoord) * 0x165667b19e3779f9ull;
+
+            // murmur3 finalizer, spreads the mostly sequential obj indices over the whole table
+            h ^= h >> 33;
+            h *= 0xff51afd7ed558ccdull;
+            h ^= h >> 33;
+            return static_cast<size_t>(h);
+        }
+
+        std::vector<Entry> m_entries;
+        size_t             m_mask = 0;
+    };
+}  // namespace nex
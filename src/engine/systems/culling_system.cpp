@@ -0,0 +1,170 @@
+#include "culling_system.hpp"
+
+#include <cstring>
+
+#include "../core/nex_trace.hpp"
+#include "../scene/nex_frustum.hpp"
+
+namespace nex {
+    static constexpr uint32_t cull_group_size = 64;
+
+    // std140 layout of the CullUbo in draw_cull.comp.glsl
+    struct CullUniformData {
+        glm::vec4 m_camera_planes[NexFrustum::plane_count] = {};
+        glm::vec4 m_light_planes[NexFrustum::plane_count]  = {};
+        glm::mat4 m_occlusion_view_projection              = {1.0f};
+        glm::vec2 m_depth_size                             = {};
+        uint32_t  m_pyramid_levels                         = 0;
+        uint32_t  m_command_count                          = 0;
+        uint32_t  m_main_command_count                     = 0;
+        uint32_t  m_occlusion                              = 0;
+        uint32_t  m_compact                                = 0;
+    };
+
+    CullingSystem::CullingSystem(NexDevice& device, VkExtent2D depth_extent, bool occlusion) : m_device{device}, m_occlusion{occlusion} {
+        createDescriptorSetLayout();
+        createPipelineLayout();
+        m_pipeline = std::make_unique<NexComputePipeline>(m_device, "./shaders_compiled/draw_cull.comp.spv", m_pipeline_layout);
+
+        for (auto& buffer : m_uniform_buffers) {
+            buffer = std::make_unique<NexBuffer>(m_device, sizeof(CullUniformData), 1, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT);
+            buffer->map();
+        }
+
+        // created even without occlusion, the culling shader always binds it
+        m_depth_pyramid = std::make_unique<NexDepthPyramid>(m_device);
+        m_depth_pyramid->resize(depth_extent);
+    }
+
+    CullingSystem::~CullingSystem() {
+        vkDestroyPipelineLayout(m_device.device(), m_pipeline_layout, nullptr);
+    }
+
+    void CullingSystem::createDescriptorSetLayout() {
+        m_set_layout = NexDescriptorSetLayout::Builder(m_device)
+                           .addBinding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                           .addBinding(1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                           .addBinding(2, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                           .addBinding(3, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                           .addBinding(4, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                           .addBinding(5, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_SHADER_STAGE_COMPUTE_BIT)
+                           .addBinding(6, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_COMPUTE_BIT)
+                           .build();
+    }
+
+    void CullingSystem::createPipelineLayout() {
+        VkDescriptorSetLayout set_layout = m_set_layout->getDescriptorSetLayout();
+
+        VkPipelineLayoutCreateInfo pipeline_layout_info = {};
+        pipeline_layout_info.sType                      = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipeline_layout_info.setLayoutCount             = 1;
+        pipeline_layout_info.pSetLayouts                = &set_layout;
+        pipeline_layout_info.pushConstantRangeCount     = 0;
+        pipeline_layout_info.pPushConstantRanges        = nullptr;
+
+        if (vkCreatePipelineLayout(m_device.device(), &pipeline_layout_info, nullptr, &m_pipeline_layout) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create pipeline layout!");
+        }
+    }
+
+    void CullingSystem::readStats(NexGpuScene& scene, int frame_index) {
+        // the frame's fence has been waited on, so the counters it wrote last time are final
+        if (!m_stats_written[frame_index]) {
+            return;
+        }
+        m_stats_written[frame_index] = false;
+
+        NexBuffer& draw_counts = scene.getDrawCountBuffer(frame_index);
+        draw_counts.invalidate(sizeof(NexCullingStats));
+        std::memcpy(&m_stats, draw_counts.getMappedMemory(), sizeof(NexCullingStats));
+    }
+
+    void CullingSystem::cull(NexFrameInfo& frame_info, VkExtent2D depth_extent, const glm::mat4& view_projection, const glm::mat4& light_space_matrix) {
+        NEX_TRACE_SCOPE("record culling");
+        // a resized window recreates the pyramid here, before this frame's command buffer points at it
+        m_depth_pyramid->resize(depth_extent);
+
+        NexGpuScene&    scene          = *frame_info.m_gpu_scene;
+        VkCommandBuffer command_buffer = frame_info.m_command_buffer;
+        int             frame_index    = frame_info.m_frame_index;
+
+        readStats(scene, frame_index);
+        if (scene.getCommandCount() == 0) {
+            m_stats = {};
+            return;
+        }
+
+        NexFrustum camera_frustum = NexFrustum::fromMatrix(view_projection);
+        NexFrustum light_frustum  = NexFrustum::fromMatrix(light_space_matrix);
+
+        CullUniformData uniforms             = {};
+        uniforms.m_occlusion_view_projection = m_pyramid_view_projection;
+        uniforms.m_depth_size                = {static_cast<float>(depth_extent.width), static_cast<float>(depth_extent.height)};
+        uniforms.m_pyramid_levels            = m_depth_pyramid->getLevelCount();
+        uniforms.m_command_count             = scene.getCommandCount();
+        uniforms.m_main_command_count        = scene.getDrawCount();
+        uniforms.m_occlusion                 = m_occlusion && m_depth_pyramid->isValid();
+        uniforms.m_compact                   = scene.isCompacting();
+        std::copy(std::begin(camera_frustum.m_planes), std::end(camera_frustum.m_planes), uniforms.m_camera_planes);
+        std::copy(std::begin(light_frustum.m_planes), std::end(light_frustum.m_planes), uniforms.m_light_planes);
+
+        m_uniform_buffers[frame_index]->writeToBuffer(&uniforms);
+        m_uniform_buffers[frame_index]->flush();
+
+        // the scene's buffers may have been reallocated by update(), the frame's allocator only writes a new set when they were
+        auto uniform_info  = m_uniform_buffers[frame_index]->descriptorInfo();
+        auto object_info   = scene.getObjectBuffer(frame_index).descriptorInfo();
+        auto command_info  = scene.getCommandBuffer(frame_index).descriptorInfo();
+        auto record_info   = scene.getCullRecordBuffer(frame_index).descriptorInfo();
+        auto culled_info   = scene.getCulledCommandBuffer(frame_index).descriptorInfo();
+        auto count_info    = scene.getDrawCountBuffer(frame_index).descriptorInfo();
+        auto pyramid_info  = m_depth_pyramid->getDescriptorInfo();
+
+        VkDescriptorSet cull_set;
+        NexDescriptorWriter(*m_set_layout, frame_info.m_frame_descriptor_allocator)
+            .writeBuffer(0, &uniform_info)
+            .writeBuffer(1, &object_info)
+            .writeBuffer(2, &command_info)
+            .writeBuffer(3, &record_info)
+            .writeBuffer(4, &culled_info)
+            .writeBuffer(5, &count_info)
+            .writeImage(6, &pyramid_info)
+            .build(cull_set);
+
+        // the draw counts and statistics are accumulated with atomics from zero
+        vkCmdFillBuffer(command_buffer, scene.getDrawCountBuffer(frame_index).getBuffer(), 0, VK_WHOLE_SIZE, 0);
+
+        VkMemoryBarrier clear_barrier = {};
+        clear_barrier.sType           = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        clear_barrier.srcAccessMask   = VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        clear_barrier.dstAccessMask   = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+        // also orders the read of the pyramid after the previous frame's build
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &clear_barrier, 0, nullptr, 0,
+                             nullptr);
+
+        m_pipeline->bind(command_buffer);
+        vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_pipeline_layout, 0, 1, &cull_set, 0, nullptr);
+        vkCmdDispatch(command_buffer, (scene.getCommandCount() + cull_group_size - 1) / cull_group_size, 1, 1);
+
+        VkMemoryBarrier cull_barrier = {};
+        cull_barrier.sType           = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        cull_barrier.srcAccessMask   = VK_ACCESS_SHADER_WRITE_BIT;
+        cull_barrier.dstAccessMask   = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+
+        vkCmdPipelineBarrier(command_buffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &cull_barrier, 0, nullptr, 0, nullptr);
+
+        m_stats_written[frame_index] = true;
+    }
+
+    void CullingSystem::buildDepthPyramid(NexFrameInfo& frame_info, VkImage depth_image, VkImageView depth_view, VkFormat depth_format, VkExtent2D extent,
+                                          const glm::mat4& view_projection) {
+        NEX_TRACE_SCOPE("record depth pyramid");
+        if (!m_occlusion) {
+            return;
+        }
+
+        m_depth_pyramid->build(frame_info.m_command_buffer, frame_info.m_frame_index, depth_image, depth_view, depth_format, extent);
+        m_pyramid_view_projection = view_projection;
+    }
+}  // namespace nex
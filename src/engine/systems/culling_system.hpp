@@ -0,0 +1,58 @@
+#pragma once
+
+#include <memory>
+
+#include "../core/nex_device.hpp"
+#include "../core/nex_swapchain.hpp"
+#include "../graphics/nex_buffer.hpp"
+#include "../graphics/nex_depth_pyramid.hpp"
+#include "../graphics/nex_descriptors.hpp"
+#include "../graphics/nex_pipeline.hpp"
+#include "../scene/nex_frame_info.hpp"
+#include "../scene/nex_gpu_scene.hpp"
+
+namespace nex {
+    // Compute pass between NexGpuScene::update() and the passes drawing the scene. Every command is tested against the camera
+    // frustum (main pass) or the light frustum (shadow pass), main pass commands that survive are then tested against a depth
+    // pyramid of last frame. What is left is compacted into the scene's culled command buffer.
+    class CullingSystem {
+      public:
+        // occlusion needs a sampled scene depth, see NexSwapChain::isDepthSampled()
+        CullingSystem(NexDevice& device, VkExtent2D depth_extent, bool occlusion = true);
+        ~CullingSystem();
+
+        CullingSystem(const CullingSystem&)            = delete;
+        CullingSystem& operator=(const CullingSystem&) = delete;
+
+        // records the culling of frame_info.m_gpu_scene, outside of any render pass. depth_extent is the size of this frame's
+        // depth, the pyramid is resized to it before the frame's cull set references it
+        void cull(NexFrameInfo& frame_info, VkExtent2D depth_extent, const glm::mat4& view_projection, const glm::mat4& light_space_matrix);
+
+        // records the reduction of the main pass' depth, right after its render pass, for the next frame to test against
+        void buildDepthPyramid(NexFrameInfo& frame_info, VkImage depth_image, VkImageView depth_view, VkFormat depth_format, VkExtent2D extent, const glm::mat4& view_projection);
+
+        // counters of the latest frame the gpu has finished
+        const NexCullingStats& getStats() const {
+            return m_stats;
+        }
+
+      private:
+        void createDescriptorSetLayout();
+        void createPipelineLayout();
+        void readStats(NexGpuScene& scene, int frame_index);
+
+        NexDevice& m_device;
+        bool       m_occlusion;
+
+        std::unique_ptr<NexDescriptorSetLayout> m_set_layout;
+        VkPipelineLayout                        m_pipeline_layout;
+        std::unique_ptr<NexComputePipeline>     m_pipeline;
+        std::unique_ptr<NexBuffer>              m_uniform_buffers[NexSwapChain::max_frames_in_flight];
+
+        std::unique_ptr<NexDepthPyramid> m_depth_pyramid;
+        glm::mat4                        m_pyramid_view_projection = {1.0f};
+
+        bool            m_stats_written[NexSwapChain::max_frames_in_flight] = {};
+        NexCullingStats m_stats                                             = {};
+    };
+}  // namespace nex
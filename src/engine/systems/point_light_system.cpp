@@ -10,6 +10,9 @@
 #include <glm/gtc/constants.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "../core/nex_parallel_recorder.hpp"
+#include "../core/nex_trace.hpp"
+
 namespace nex {
     struct PointLightPushConstants {
         glm::vec4 m_poisition = {};
@@ -63,47 +66,54 @@ namespace nex {
         // auto rotation_angle = glm::rotate(glm::mat4{1.0f}, frame_info.m_frame_time, glm::vec3{0.0f, -1.0f, 0.0f});
 
         int light_index = 0;
-        for (auto& [id, entity] : frame_info.m_entities) {
-            if (!entity.m_point_light) {
-                continue;
-            }
-
+        frame_info.m_registry.view<TransformComponent, PointLightComponent>().each([&](NexEntity, TransformComponent& transform, PointLightComponent& point_light) {
             assert(light_index < MAX_LIGHTS && "Too many point lights!");
 
-            // entity.m_transform.m_translation = glm::vec3{rotation_angle * glm::vec4{entity.m_transform.m_translation, 1.0f}};
+            // transform.m_translation = glm::vec3{rotation_angle * glm::vec4{transform.m_translation, 1.0f}};
 
             PointLight& light = ubo.m_point_lights[light_index];
-            light.m_position  = glm::vec4(entity.m_transform.m_translation, 1.0f);
-            light.m_color     = glm::vec4(entity.m_color, entity.m_point_light->m_intensity);
+            light.m_position  = transform.mat4()[3];
+            light.m_color     = glm::vec4(point_light.m_color, point_light.m_intensity);
             light_index++;
-        }
+        });
         ubo.m_light_count = light_index;
     }
 
     void PointLightSystem::render(NexFrameInfo& frame_info) {
-        std::map<float, NexEntity::id_t> sorted_lights;
+        NEX_TRACE_SCOPE("record point lights");
+        // a pass recorded in parallel only takes secondaries, the handful of lights fit in one
+        if (frame_info.m_parallel_recorder != nullptr) {
+            frame_info.m_parallel_recorder->record(frame_info, 1, [this](NexFrameInfo& chunk_info, size_t, size_t) {
+                renderLights(chunk_info);
+            });
+            return;
+        }
 
-        for (auto& [id, entity] : frame_info.m_entities) {
-            if (!entity.m_point_light) {
-                continue;
-            }
+        renderLights(frame_info);
+    }
+
+    void PointLightSystem::renderLights(NexFrameInfo& frame_info) {
+        NexRegistry&               registry      = frame_info.m_registry;
+        std::map<float, NexEntity> sorted_lights = {};
 
-            auto  offset            = entity.m_transform.m_translation - frame_info.m_camera.getPosition();
+        registry.view<TransformComponent, PointLightComponent>().each([&](NexEntity entity, TransformComponent& transform, PointLightComponent&) {
+            auto  offset            = glm::vec3(transform.mat4()[3]) - frame_info.m_camera.getPosition();
             float distance          = glm::dot(offset, offset);
-            sorted_lights[distance] = id;
-        }
+            sorted_lights[distance] = entity;
+        });
 
         m_pipeline->bind(frame_info.m_command_buffer);
 
         vkCmdBindDescriptorSets(frame_info.m_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout, 0, 1, &frame_info.m_global_descriptor_set, 0, nullptr);
 
         for (auto it = sorted_lights.rbegin(); it != sorted_lights.rend(); ++it) {
-            auto& entity = frame_info.m_entities.at(it->second);
+            auto& transform   = registry.get<TransformComponent>(it->second);
+            auto& point_light = registry.get<PointLightComponent>(it->second);
 
             PointLightPushConstants push = {};
-            push.m_poisition             = glm::vec4(entity.m_transform.m_translation, 1.0f);
-            push.m_color                 = glm::vec4(entity.m_color, entity.m_point_light->m_intensity);
-            push.m_radius                = entity.m_transform.m_scale.x;
+            push.m_poisition             = transform.mat4()[3];
+            push.m_color                 = glm::vec4(point_light.m_color, point_light.m_intensity);
+            push.m_radius                = transform.m_scale.x;
 
             vkCmdPushConstants(frame_info.m_command_buffer, m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PointLightPushConstants), &push);
             vkCmdDraw(frame_info.m_command_buffer, 6, 1, 0, 0);
@@ -21,6 +21,7 @@ namespace nex {
       private:
         void createPipelineLayout(VkDescriptorSetLayout global_set_layout);
         void createPipeline(VkRenderPass render_pass);
+        void renderLights(NexFrameInfo& frame_info);
 
         NexDevice& m_device;
 
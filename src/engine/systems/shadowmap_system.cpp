@@ -4,19 +4,45 @@
 #define GLM_FORCE_DEPTH_ZERO_TO_ONE
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
+#include <iomanip>
+#include <iostream>
+
+#include "../core/nex_gpu_profiler.hpp"
+#include "../core/nex_parallel_recorder.hpp"
+#include "../core/nex_trace.hpp"
+#include "../scene/nex_entity_culler.hpp"
+#include "../scene/nex_gpu_scene.hpp"
+#include "../scene/nex_instancer.hpp"
 
 namespace nex {
-    ShadowSystem::ShadowSystem(NexDevice& device) : m_device(device) {
+    ShadowSystem::ShadowSystem(NexDevice& device, bool benchmark, VkDescriptorSetLayout object_set_layout) : m_device(device), m_benchmark{benchmark} {
         m_shadow_map = std::make_unique<NexShadowMap>(device, 4096, 4096);
         createPipelineLayout();
         createPipeline();
+
+        if (object_set_layout != VK_NULL_HANDLE) {
+            createIndirectPipelineLayout(object_set_layout);
+            createIndirectPipeline();
+        }
     }
 
     ShadowSystem::~ShadowSystem() {
+        if (m_indirect_pipeline_layout != VK_NULL_HANDLE) {
+            vkDestroyPipelineLayout(m_device.device(), m_indirect_pipeline_layout, nullptr);
+        }
         vkDestroyPipelineLayout(m_device.device(), m_pipeline_layout, nullptr);
     }
 
+    void ShadowSystem::updateLightSpaceMatrix() {
+        glm::vec3 light_pos        = {2.0f, -2.0f, -2.0f};
+        glm::vec3 scene_center     = {0.0f, 0.0f, 0.0f};
+        glm::mat4 light_view       = glm::lookAt(light_pos, scene_center, glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::mat4 light_projection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 0.1f, 7.5f);
+        m_light_space_matrix       = light_projection * light_view;
+    }
+
     void ShadowSystem::renderShadowMap(NexFrameInfo& frame_info) {
+        NEX_TRACE_SCOPE("record shadow map");
         VkClearValue clear_value = {};
         clear_value.depthStencil = {1.0f, 0};
 
@@ -29,47 +55,194 @@ namespace nex {
         render_pass_info.clearValueCount       = 1;
         render_pass_info.pClearValues          = &clear_value;
 
-        vkCmdBeginRenderPass(frame_info.m_command_buffer, &render_pass_info, VK_SUBPASS_CONTENTS_INLINE);
+        // the profiler has read back this frame slot's previous frame, samples recorded just before a switch still belong to the previous stream
+        if (m_benchmark && frame_info.m_gpu_profiler != nullptr) {
+            double milliseconds = frame_info.m_gpu_profiler->getMilliseconds("shadow");
+            if (milliseconds >= 0.0 && m_slot_position[frame_info.m_frame_index] == m_use_position_stream) {
+                m_window_ms += milliseconds;
+                ++m_window_samples;
+            }
+        }
 
-        VkViewport viewport = {};
-        viewport.x          = 0.0f;
-        viewport.y          = 0.0f;
-        viewport.width      = static_cast<float>(m_shadow_map->getWidth());
-        viewport.height     = static_cast<float>(m_shadow_map->getHeight());
-        viewport.minDepth   = 0.0f;
-        viewport.maxDepth   = 1.0f;
-        VkRect2D scissor    = {{0, 0}, {m_shadow_map->getWidth(), m_shadow_map->getHeight()}};
+        bool indirect  = frame_info.m_gpu_scene != nullptr && m_indirect_pipeline_layout != VK_NULL_HANDLE;
+        bool instanced = frame_info.m_instancer != nullptr && m_indirect_pipeline_layout != VK_NULL_HANDLE;
+        bool parallel  = frame_info.m_parallel_recorder != nullptr && !indirect && !instanced;
 
-        vkCmdSetViewport(frame_info.m_command_buffer, 0, 1, &viewport);
-        vkCmdSetScissor(frame_info.m_command_buffer, 0, 1, &scissor);
+        // a pass that executes secondaries can't have a statistics query active
+        NexGpuProfiler::Scope scope(frame_info.m_gpu_profiler, frame_info.m_command_buffer, "shadow", !parallel);
+        vkCmdBeginRenderPass(frame_info.m_command_buffer, &render_pass_info, parallel ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
 
-        vkCmdSetDepthBias(frame_info.m_command_buffer, 1.25f, 0.0f, 1.75f);
+        if (parallel) {
+            frame_info.m_parallel_recorder->beginPass(m_shadow_map->getRenderPass(), m_shadow_map->getFrameBuffer(), render_pass_info.renderArea.extent);
+        } else {
+            VkViewport viewport = {};
+            viewport.x          = 0.0f;
+            viewport.y          = 0.0f;
+            viewport.width      = static_cast<float>(m_shadow_map->getWidth());
+            viewport.height     = static_cast<float>(m_shadow_map->getHeight());
+            viewport.minDepth   = 0.0f;
+            viewport.maxDepth   = 1.0f;
+            VkRect2D scissor    = {{0, 0}, {m_shadow_map->getWidth(), m_shadow_map->getHeight()}};
 
-        m_shadow_pipeline->bind(frame_info.m_command_buffer);
+            vkCmdSetViewport(frame_info.m_command_buffer, 0, 1, &viewport);
+            vkCmdSetScissor(frame_info.m_command_buffer, 0, 1, &scissor);
 
-        glm::vec3 light_pos        = {2.0f, -2.0f, -2.0f};
-        glm::vec3 scene_center     = {0.0f, 0.0f, 0.0f};
-        glm::mat4 light_view       = glm::lookAt(light_pos, scene_center, glm::vec3(0.0f, 1.0f, 0.0f));
-        glm::mat4 light_projection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, 0.1f, 7.5f);
-        m_light_space_matrix       = light_projection * light_view;
+            vkCmdSetDepthBias(frame_info.m_command_buffer, depth_bias_constant, 0.0f, depth_bias_slope);
+        }
+
+        if (indirect) {
+            renderIndirect(frame_info);
+        } else if (instanced) {
+            renderInstanced(frame_info);
+        } else {
+            renderEntities(frame_info);
+        }
+
+        vkCmdEndRenderPass(frame_info.m_command_buffer);
+
+        if (m_benchmark) {
+            m_slot_position[frame_info.m_frame_index] = m_use_position_stream;
+
+            if (++m_window_frame == benchmark_window) {
+                std::cout << "shadow pass, " << (m_use_position_stream ? "position stream" : "interleaved stream") << ": " << std::fixed << std::setprecision(3)
+                          << m_window_ms / std::max(m_window_samples, 1u) << " ms gpu over " << m_window_samples << " frames" << std::endl;
+
+                if (m_windows++ > 0) {
+                    m_stream_ms[m_use_position_stream] += m_window_ms;
+                    m_stream_samples[m_use_position_stream] += m_window_samples;
+                }
+
+                m_use_position_stream = !m_use_position_stream;
+                m_window_frame        = 0;
+                m_window_ms           = 0.0;
+                m_window_samples      = 0;
+            }
+        }
+    }
+
+    void ShadowSystem::printBenchmarkSummary() const {
+        if (m_stream_samples[0] == 0 || m_stream_samples[1] == 0) {
+            std::cout << "shadow pass: too few frames to compare the mesh streams, run at least " << 3 * benchmark_window << std::endl;
+            return;
+        }
+
+        double interleaved_ms = m_stream_ms[0] / m_stream_samples[0];
+        double position_ms    = m_stream_ms[1] / m_stream_samples[1];
+        std::cout << "shadow pass over " << m_stream_samples[0] + m_stream_samples[1] << " frames: interleaved stream " << std::fixed << std::setprecision(3) << interleaved_ms
+                  << " ms, position stream " << position_ms << " ms gpu (" << std::setprecision(1) << 100.0 * (1.0 - position_ms / interleaved_ms) << "% less)" << std::endl;
+    }
+
+    void ShadowSystem::renderEntities(NexFrameInfo& frame_info) {
+        NexRegistry&                     registry = frame_info.m_registry;
+        NexComponentPool<MeshComponent>& meshes   = registry.pool<MeshComponent>();
+        const std::vector<NexEntity>&    entities = frame_info.m_visible_entities != nullptr ? frame_info.m_visible_entities->m_light : meshes.entities();
+
+        if (frame_info.m_parallel_recorder == nullptr) {
+            renderChunk(frame_info, entities, meshes);
+            return;
+        }
+
+        // the workers only look components up, every pool they read has to exist before they start
+        registry.pool<TransformComponent>();
+        frame_info.m_parallel_recorder->record(frame_info, entities.size(), [&](NexFrameInfo& chunk_info, size_t begin, size_t end) {
+            vkCmdSetDepthBias(chunk_info.m_command_buffer, depth_bias_constant, 0.0f, depth_bias_slope);
+            renderChunk(chunk_info, std::span(entities).subspan(begin, end - begin), meshes);
+        });
+    }
 
-        for (auto& kv : frame_info.m_entities) {
-            auto& entity = kv.second;
+    void ShadowSystem::renderChunk(NexFrameInfo& frame_info, std::span<const NexEntity> entities, NexComponentPool<MeshComponent>& meshes) {
+        NexPipeline*        bound_pipeline = nullptr;
+        NexGeometryBindings bound_geometry = {};
 
-            if (entity.m_model == nullptr) {
+        NexRegistry& registry = frame_info.m_registry;
+
+        for (NexEntity entity : entities) {
+            MeshComponent&      mesh      = meshes.get(entity);
+            TransformComponent* transform = registry.tryGet<TransformComponent>(entity);
+            if (mesh.m_mesh == nullptr || !mesh.m_mesh->isResident() || transform == nullptr) {
                 continue;
             }
 
+            bool         position_stream = m_use_position_stream && mesh.m_mesh->hasShadowStream();
+            uint32_t     format          = static_cast<uint32_t>(mesh.m_mesh->getVertexFormat());
+            NexPipeline* pipeline        = position_stream ? m_position_pipelines[format].get() : m_shadow_pipelines[format].get();
+            if (pipeline != bound_pipeline) {
+                pipeline->bind(frame_info.m_command_buffer);
+                bound_pipeline = pipeline;
+            }
+
             ShadowPushConstantsData push{};
-            push.m_light_space_model_matrix = m_light_space_matrix * entity.m_transform.mat4();
+            push.m_light_space_model_matrix = m_light_space_matrix * transform->mat4() * mesh.m_mesh->getDequantizeMatrix();
 
             vkCmdPushConstants(frame_info.m_command_buffer, m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(ShadowPushConstantsData), &push);
 
-            entity.m_model->bind(frame_info.m_command_buffer, 0);
-            entity.m_model->draw(frame_info.m_command_buffer, 0);
+            if (position_stream) {
+                mesh.m_mesh->bindShadow(frame_info.m_command_buffer, bound_geometry);
+                mesh.m_mesh->drawShadow(frame_info.m_command_buffer);
+            } else {
+                mesh.m_mesh->bind(frame_info.m_command_buffer, bound_geometry);
+                mesh.m_mesh->draw(frame_info.m_command_buffer);
+            }
         }
+    }
 
-        vkCmdEndRenderPass(frame_info.m_command_buffer);
+    void ShadowSystem::renderIndirect(NexFrameInfo& frame_info) {
+        NexGpuScene& scene = *frame_info.m_gpu_scene;
+
+        VkDescriptorSet object_set = scene.getObjectSet(frame_info.m_frame_index);
+        vkCmdBindDescriptorSets(frame_info.m_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_indirect_pipeline_layout, 0, 1, &object_set, 0, nullptr);
+
+        ShadowIndirectPushConstantsData push = {};
+        push.m_light_space_matrix            = m_light_space_matrix;
+        vkCmdPushConstants(frame_info.m_command_buffer, m_indirect_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ShadowIndirectPushConstantsData), &push);
+
+        NexPipeline*        bound_pipeline = nullptr;
+        NexGeometryBindings bound_geometry = {};
+
+        // the scene picks the position only stream wherever a mesh has one, the benchmark's alternation does not apply here
+        for (const auto& batch : scene.getShadowBatches()) {
+            NexPipeline* pipeline = m_indirect_pipelines[batch.m_position_stream][static_cast<uint32_t>(batch.m_vertex_format)].get();
+            if (pipeline != bound_pipeline) {
+                pipeline->bind(frame_info.m_command_buffer);
+                bound_pipeline = pipeline;
+            }
+
+            bound_geometry.bindVertices(frame_info.m_command_buffer, batch.m_vertex_buffer);
+            bound_geometry.bindIndices(frame_info.m_command_buffer, batch.m_index_buffer, batch.m_index_type);
+            scene.drawBatch(frame_info.m_command_buffer, frame_info.m_frame_index, batch);
+        }
+    }
+
+    void ShadowSystem::renderInstanced(NexFrameInfo& frame_info) {
+        NexInstancer& instancer = *frame_info.m_instancer;
+
+        VkDescriptorSet instance_set = instancer.getInstanceSet(frame_info.m_frame_index);
+        vkCmdBindDescriptorSets(frame_info.m_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_indirect_pipeline_layout, 0, 1, &instance_set, 0, nullptr);
+
+        ShadowIndirectPushConstantsData push = {};
+        push.m_light_space_matrix            = m_light_space_matrix;
+        vkCmdPushConstants(frame_info.m_command_buffer, m_indirect_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(ShadowIndirectPushConstantsData), &push);
+
+        NexPipeline*        bound_pipeline = nullptr;
+        NexGeometryBindings bound_geometry = {};
+
+        for (const auto& group : instancer.getShadowGroups()) {
+            const NexMesh& mesh            = *group.m_mesh;
+            bool           position_stream = m_use_position_stream && mesh.hasShadowStream();
+            NexPipeline*   pipeline        = m_indirect_pipelines[position_stream][static_cast<uint32_t>(mesh.getVertexFormat())].get();
+            if (pipeline != bound_pipeline) {
+                pipeline->bind(frame_info.m_command_buffer);
+                bound_pipeline = pipeline;
+            }
+
+            if (position_stream) {
+                mesh.bindShadow(frame_info.m_command_buffer, bound_geometry);
+                mesh.drawShadow(frame_info.m_command_buffer, group.m_instance_count, group.m_first_instance);
+            } else {
+                mesh.bind(frame_info.m_command_buffer, bound_geometry);
+                mesh.draw(frame_info.m_command_buffer, group.m_instance_count, group.m_first_instance);
+            }
+        }
     }
 
     VkDescriptorImageInfo ShadowSystem::getShadowMapDescriptor() {
@@ -112,7 +285,67 @@ namespace nex {
         pipeline_config.m_multisample_info.rasterizationSamples    = VK_SAMPLE_COUNT_1_BIT;
         pipeline_config.m_render_pass                              = m_shadow_map->getRenderPass();
         pipeline_config.m_pipeline_layout                          = m_pipeline_layout;
-        m_shadow_pipeline = std::make_unique<NexPipeline>(m_device, "./shaders_compiled/shadowmap_shader.vert.spv", "./shaders_compiled/shadowmap_shader.frag.spv", pipeline_config);
+
+        NexPipeline::setVertexFormat(pipeline_config, NexMesh::VertexFormat::Full);
+        m_shadow_pipelines[static_cast<uint32_t>(NexMesh::VertexFormat::Full)] =
+            std::make_unique<NexPipeline>(m_device, "./shaders_compiled/shadowmap_shader.vert.spv", "./shaders_compiled/shadowmap_shader.frag.spv", pipeline_config);
+
+        NexPipeline::setVertexFormat(pipeline_config, NexMesh::VertexFormat::Compact);
+        m_shadow_pipelines[static_cast<uint32_t>(NexMesh::VertexFormat::Compact)] =
+            std::make_unique<NexPipeline>(m_device, "./shaders_compiled/shadowmap_shader_compact.vert.spv", "./shaders_compiled/shadowmap_shader.frag.spv", pipeline_config);
+
+        // the position only streams keep the position at location 0 with the same format, so the shaders are shared
+        NexPipeline::setShadowVertexFormat(pipeline_config, NexMesh::VertexFormat::Full);
+        m_position_pipelines[static_cast<uint32_t>(NexMesh::VertexFormat::Full)] =
+            std::make_unique<NexPipeline>(m_device, "./shaders_compiled/shadowmap_shader.vert.spv", "./shaders_compiled/shadowmap_shader.frag.spv", pipeline_config);
+
+        NexPipeline::setShadowVertexFormat(pipeline_config, NexMesh::VertexFormat::Compact);
+        m_position_pipelines[static_cast<uint32_t>(NexMesh::VertexFormat::Compact)] =
+            std::make_unique<NexPipeline>(m_device, "./shaders_compiled/shadowmap_shader_compact.vert.spv", "./shaders_compiled/shadowmap_shader.frag.spv", pipeline_config);
+    }
+
+    void ShadowSystem::createIndirectPipelineLayout(VkDescriptorSetLayout object_set_layout) {
+        VkPushConstantRange push_constant_range = {};
+        push_constant_range.stageFlags          = VK_SHADER_STAGE_VERTEX_BIT;
+        push_constant_range.offset              = 0;
+        push_constant_range.size                = sizeof(ShadowIndirectPushConstantsData);
+
+        VkPipelineLayoutCreateInfo pipeline_layout_info = {};
+        pipeline_layout_info.sType                      = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipeline_layout_info.setLayoutCount             = 1;
+        pipeline_layout_info.pSetLayouts                = &object_set_layout;
+        pipeline_layout_info.pushConstantRangeCount     = 1;
+        pipeline_layout_info.pPushConstantRanges        = &push_constant_range;
+
+        if (vkCreatePipelineLayout(m_device.device(), &pipeline_layout_info, nullptr, &m_indirect_pipeline_layout) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create pipeline layout!");
+        }
+    }
+
+    void ShadowSystem::createIndirectPipeline() {
+        PipelineConfigInfo pipeline_config = {};
+        NexPipeline::defaultPipelineConfigInfo(pipeline_config);
+
+        pipeline_config.m_depth_stencil_info.depthTestEnable    = VK_TRUE;
+        pipeline_config.m_depth_stencil_info.depthWriteEnable   = VK_TRUE;
+        pipeline_config.m_depth_stencil_info.depthCompareOp     = VK_COMPARE_OP_LESS_OR_EQUAL;
+        pipeline_config.m_depth_stencil_info.stencilTestEnable  = VK_FALSE;
+        pipeline_config.m_multisample_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+        pipeline_config.m_render_pass                           = m_shadow_map->getRenderPass();
+        pipeline_config.m_pipeline_layout                       = m_indirect_pipeline_layout;
+
+        for (bool position_stream : {false, true}) {
+            auto& pipelines = m_indirect_pipelines[position_stream];
+
+            auto set_format = position_stream ? NexPipeline::setShadowVertexFormat : NexPipeline::setVertexFormat;
+            set_format(pipeline_config, NexMesh::VertexFormat::Full);
+            pipelines[static_cast<uint32_t>(NexMesh::VertexFormat::Full)] =
+                std::make_unique<NexPipeline>(m_device, "./shaders_compiled/shadowmap_shader_indirect.vert.spv", "./shaders_compiled/shadowmap_shader.frag.spv", pipeline_config);
+
+            set_format(pipeline_config, NexMesh::VertexFormat::Compact);
+            pipelines[static_cast<uint32_t>(NexMesh::VertexFormat::Compact)] =
+                std::make_unique<NexPipeline>(m_device, "./shaders_compiled/shadowmap_shader_compact_indirect.vert.spv", "./shaders_compiled/shadowmap_shader.frag.spv", pipeline_config);
+        }
     }
 
 }  // namespace nex
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <span>
+
 #include "../core/nex_device.hpp"
+#include "../core/nex_swapchain.hpp"
 #include "../scene/nex_frame_info.hpp"
 #include "../graphics/nex_pipeline.hpp"
 #include "../lighting/nex_shadowmap.hpp"
@@ -9,25 +12,61 @@ struct ShadowPushConstantsData {
     glm::mat4 m_light_space_model_matrix = {1.0f};
 };
 
+// the model matrix comes from the gpu scene's object buffer
+struct ShadowIndirectPushConstantsData {
+    glm::mat4 m_light_space_matrix = {1.0f};
+};
+
 namespace nex {
     class ShadowSystem {
       public:
-        ShadowSystem(NexDevice& device);
+        // with benchmark set the pass alternates between the interleaved and the position only mesh streams and prints its gpu time for each,
+        // timed by the "shadow" scope it opens on frame_info's gpu profiler
+        // with an object set layout the pass can also draw from a NexGpuScene or a NexInstancer
+        ShadowSystem(NexDevice& device, bool benchmark = false, VkDescriptorSetLayout object_set_layout = VK_NULL_HANDLE);
         ~ShadowSystem();
 
+        // the light space matrix renderShadowMap() and getLightSpaceMatrix() use, before anything culls against it
+        void                  updateLightSpaceMatrix();
         void                  renderShadowMap(NexFrameInfo& frame_info);
         VkDescriptorImageInfo getShadowMapDescriptor();
         glm::mat4             getLightSpaceMatrix();
 
+        // with benchmark set, the average gpu time of either stream over every window but the first, which warms up while assets stream in
+        void printBenchmarkSummary() const;
+
       private:
         void createPipelineLayout();
         void createPipeline();
+        void createIndirectPipelineLayout(VkDescriptorSetLayout object_set_layout);
+        void createIndirectPipeline();
+        void renderEntities(NexFrameInfo& frame_info);
+        void renderChunk(NexFrameInfo& frame_info, std::span<const NexEntity> entities, NexComponentPool<MeshComponent>& meshes);
+        void renderIndirect(NexFrameInfo& frame_info);
+        void renderInstanced(NexFrameInfo& frame_info);
+
+        static constexpr uint32_t benchmark_window    = 300;  // frames per stream before switching
+        static constexpr float    depth_bias_constant = 1.25f;
+        static constexpr float    depth_bias_slope    = 1.75f;
 
         NexDevice& m_device;
 
         std::unique_ptr<NexShadowMap> m_shadow_map;
-        std::unique_ptr<NexPipeline>  m_shadow_pipeline;
+        std::unique_ptr<NexPipeline>  m_shadow_pipelines[NexMesh::vertex_format_count];    // indexed by NexMesh::VertexFormat
+        std::unique_ptr<NexPipeline>  m_position_pipelines[NexMesh::vertex_format_count];  // same for meshes with a position only stream
         VkPipelineLayout              m_pipeline_layout;
-        glm::mat4                     m_light_space_matrix;
+        VkPipelineLayout              m_indirect_pipeline_layout = VK_NULL_HANDLE;
+        std::unique_ptr<NexPipeline>  m_indirect_pipelines[2][NexMesh::vertex_format_count];  // indexed by position stream, then NexMesh::VertexFormat
+        glm::mat4                     m_light_space_matrix = {1.0f};
+        bool                          m_use_position_stream = true;
+
+        bool     m_benchmark                                         = false;
+        bool     m_slot_position[NexSwapChain::max_frames_in_flight] = {};  // stream each frame slot's last shadow pass drew with
+        uint32_t m_window_frame                                      = 0;
+        double   m_window_ms                                         = 0.0;
+        uint32_t m_window_samples                                    = 0;
+        uint32_t m_windows                                           = 0;
+        double   m_stream_ms[2]                                      = {};  // indexed by position stream
+        uint32_t m_stream_samples[2]                                 = {};
     };
 };  // namespace nex
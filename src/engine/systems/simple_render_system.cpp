@@ -6,26 +6,48 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/constants.hpp>
 
+#include "../core/nex_parallel_recorder.hpp"
+#include "../core/nex_trace.hpp"
+#include "../graphics/nex_texture_table.hpp"
+#include "../scene/nex_entity_culler.hpp"
+#include "../scene/nex_gpu_scene.hpp"
+#include "../scene/nex_instancer.hpp"
+
 namespace nex {
     struct SimplePushConstantsData {
         glm::mat4 m_model_matrix       = {1.0f};
         glm::mat4 m_normal_matrix      = {1.0f};
         glm::mat4 m_light_space_matrix = {1.0f};
         int       m_material_index     = 0;
+        uint32_t  m_texture_index      = 0;  // into the texture table
+    };
+
+    // the model matrix, normal matrix, material and texture come from the gpu scene's object buffer
+    struct IndirectPushConstantsData {
+        glm::mat4 m_light_space_matrix    = {1.0f};
+        uint32_t  m_default_texture_index = 0;  // for the objects without a texture of their own
     };
 
-    SimpleRenderSystem::SimpleRenderSystem(NexDevice& device, VkRenderPass render_pass, VkDescriptorSetLayout global_set_layout) : m_device(device) {
+    SimpleRenderSystem::SimpleRenderSystem(NexDevice& device, VkRenderPass render_pass, VkDescriptorSetLayout global_set_layout, VkDescriptorSetLayout object_set_layout)
+        : m_device(device) {
         m_default_texture = NexTexture::createTextureFromFile(m_device, "../textures/missing.png");
         m_default_texture->updateDescriptor();
 
-        createTextureDescriptorLayout();
         createShadowDescriptorLayout();
 
         createPipelineLayout(global_set_layout);
         createPipeline(render_pass);
+
+        if (object_set_layout != VK_NULL_HANDLE) {
+            createIndirectPipelineLayout(global_set_layout, object_set_layout);
+            createIndirectPipeline(render_pass);
+        }
     }
 
     SimpleRenderSystem::~SimpleRenderSystem() {
+        if (m_indirect_pipeline_layout != VK_NULL_HANDLE) {
+            vkDestroyPipelineLayout(m_device.device(), m_indirect_pipeline_layout, nullptr);
+        }
         vkDestroyPipelineLayout(m_device.device(), m_pipeline_layout, nullptr);
     }
 
@@ -35,7 +57,7 @@ namespace nex {
         push_constant_range.offset              = 0;
         push_constant_range.size                = sizeof(SimplePushConstantsData);
 
-        std::vector<VkDescriptorSetLayout> descriptor_set_layouts = {global_set_layout, m_texture_set_layout->getDescriptorSetLayout(), m_shadow_set_layout->getDescriptorSetLayout()};
+        std::vector<VkDescriptorSetLayout> descriptor_set_layouts = {global_set_layout, m_device.textureTable().getSetLayout(), m_shadow_set_layout->getDescriptorSetLayout()};
 
         VkPipelineLayoutCreateInfo pipeline_layout_info = {};
         pipeline_layout_info.sType                      = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -56,46 +78,209 @@ namespace nex {
         pipeline_config.m_multisample_info.rasterizationSamples = m_device.getMaxUsableSamples();
         pipeline_config.m_render_pass                           = render_pass;
         pipeline_config.m_pipeline_layout                       = m_pipeline_layout;
-        m_pipeline = std::make_unique<NexPipeline>(m_device, "./shaders_compiled/simple_shader.vert.spv", "./shaders_compiled/simple_shader.frag.spv", pipeline_config);
+
+        // one pipeline per vertex format, they only differ in the vertex input state and the vertex shader decoding it
+        NexPipeline::setVertexFormat(pipeline_config, NexMesh::VertexFormat::Full);
+        m_pipelines[static_cast<uint32_t>(NexMesh::VertexFormat::Full)] =
+            std::make_unique<NexPipeline>(m_device, "./shaders_compiled/simple_shader.vert.spv", "./shaders_compiled/simple_shader.frag.spv", pipeline_config);
+
+        NexPipeline::setVertexFormat(pipeline_config, NexMesh::VertexFormat::Compact);
+        m_pipelines[static_cast<uint32_t>(NexMesh::VertexFormat::Compact)] =
+            std::make_unique<NexPipeline>(m_device, "./shaders_compiled/simple_shader_compact.vert.spv", "./shaders_compiled/simple_shader.frag.spv", pipeline_config);
+    }
+
+    void SimpleRenderSystem::createIndirectPipelineLayout(VkDescriptorSetLayout global_set_layout, VkDescriptorSetLayout object_set_layout) {
+        VkPushConstantRange push_constant_range = {};
+        push_constant_range.stageFlags          = VK_SHADER_STAGE_VERTEX_BIT;
+        push_constant_range.offset              = 0;
+        push_constant_range.size                = sizeof(IndirectPushConstantsData);
+
+        // sets 0 to 2 match the per entity layout, so the shared fragment shader sees the same bindings
+        std::vector<VkDescriptorSetLayout> descriptor_set_layouts = {global_set_layout, m_device.textureTable().getSetLayout(), m_shadow_set_layout->getDescriptorSetLayout(),
+                                                                     object_set_layout};
+
+        VkPipelineLayoutCreateInfo pipeline_layout_info = {};
+        pipeline_layout_info.sType                      = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+        pipeline_layout_info.setLayoutCount             = static_cast<uint32_t>(descriptor_set_layouts.size());
+        pipeline_layout_info.pSetLayouts                = descriptor_set_layouts.data();
+        pipeline_layout_info.pushConstantRangeCount     = 1;
+        pipeline_layout_info.pPushConstantRanges        = &push_constant_range;
+
+        if (vkCreatePipelineLayout(m_device.device(), &pipeline_layout_info, nullptr, &m_indirect_pipeline_layout) != VK_SUCCESS) {
+            throw std::runtime_error("Failed to create pipeline layout!");
+        }
     }
 
-    void SimpleRenderSystem::createTextureDescriptorLayout() {
-        m_texture_set_layout = NexDescriptorSetLayout::Builder(m_device).addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT).build();
+    void SimpleRenderSystem::createIndirectPipeline(VkRenderPass render_pass) {
+        PipelineConfigInfo pipeline_config = {};
+        NexPipeline::defaultPipelineConfigInfo(pipeline_config);
+
+        pipeline_config.m_multisample_info.rasterizationSamples = m_device.getMaxUsableSamples();
+        pipeline_config.m_render_pass                           = render_pass;
+        pipeline_config.m_pipeline_layout                       = m_indirect_pipeline_layout;
+
+        NexPipeline::setVertexFormat(pipeline_config, NexMesh::VertexFormat::Full);
+        m_indirect_pipelines[static_cast<uint32_t>(NexMesh::VertexFormat::Full)] =
+            std::make_unique<NexPipeline>(m_device, "./shaders_compiled/simple_shader_indirect.vert.spv", "./shaders_compiled/simple_shader.frag.spv", pipeline_config);
+
+        NexPipeline::setVertexFormat(pipeline_config, NexMesh::VertexFormat::Compact);
+        m_indirect_pipelines[static_cast<uint32_t>(NexMesh::VertexFormat::Compact)] =
+            std::make_unique<NexPipeline>(m_device, "./shaders_compiled/simple_shader_compact_indirect.vert.spv", "./shaders_compiled/simple_shader.frag.spv", pipeline_config);
     }
 
     void SimpleRenderSystem::createShadowDescriptorLayout() {
         m_shadow_set_layout = NexDescriptorSetLayout::Builder(m_device).addBinding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT).build();
+        m_shadow_pool       = NexDescriptorPool::Builder(m_device).setMaxSets(1).addPoolSize(VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1).build();
     }
 
     void SimpleRenderSystem::renderEntities(NexFrameInfo& frame_info, VkDescriptorImageInfo shadow_map_descriptor, glm::mat4 light_space_matrix) {
-        m_pipeline->bind(frame_info.m_command_buffer);
+        NEX_TRACE_SCOPE("record entities");
+        bool             indirect        = frame_info.m_gpu_scene != nullptr && m_indirect_pipeline_layout != VK_NULL_HANDLE;
+        bool             instanced       = frame_info.m_instancer != nullptr && m_indirect_pipeline_layout != VK_NULL_HANDLE;
+        VkPipelineLayout pipeline_layout = indirect || instanced ? m_indirect_pipeline_layout : m_pipeline_layout;
 
-        vkCmdBindDescriptorSets(frame_info.m_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout, 0, 1, &frame_info.m_global_descriptor_set, 0, nullptr);
+        // the shadow map lives as long as the shadow system, so its set is written on the first frame and kept
+        if (m_shadow_descriptor_set == VK_NULL_HANDLE) {
+            NexDescriptorWriter(*m_shadow_set_layout, *m_shadow_pool).writeImage(0, &shadow_map_descriptor).build(m_shadow_descriptor_set);
+        }
+
+        auto bind_frame_sets = [&](VkCommandBuffer command_buffer) {
+            VkDescriptorSet sets[] = {frame_info.m_global_descriptor_set, m_device.textureTable().getSet(), m_shadow_descriptor_set};
+            vkCmdBindDescriptorSets(command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline_layout, 0, 3, sets, 0, nullptr);
+        };
 
-        VkDescriptorSet shadow_descriptor_set;
-        NexDescriptorWriter(*m_shadow_set_layout, frame_info.m_frame_descriptor_pool).writeImage(0, &shadow_map_descriptor).build(shadow_descriptor_set);
-        vkCmdBindDescriptorSets(frame_info.m_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout, 2, 1, &shadow_descriptor_set, 0, nullptr);
+        if (indirect) {
+            bind_frame_sets(frame_info.m_command_buffer);
+            renderIndirect(frame_info, light_space_matrix);
+            return;
+        }
+        if (instanced) {
+            bind_frame_sets(frame_info.m_command_buffer);
+            renderInstanced(frame_info, light_space_matrix);
+            return;
+        }
 
-        for (auto& [id, entity] : frame_info.m_entities) {
-            if (!entity.m_model) {
+        NexRegistry&                     registry = frame_info.m_registry;
+        NexComponentPool<MeshComponent>& meshes   = registry.pool<MeshComponent>();
+        const std::vector<NexEntity>&    entities = frame_info.m_visible_entities != nullptr ? frame_info.m_visible_entities->m_camera : meshes.entities();
+
+        // the secondaries start with nothing bound, so each chunk binds the frame's sets itself
+        auto record = [&](NexFrameInfo& chunk_info, size_t begin, size_t end) {
+            bind_frame_sets(chunk_info.m_command_buffer);
+            renderChunk(chunk_info, std::span(entities).subspan(begin, end - begin), meshes, light_space_matrix);
+        };
+
+        if (frame_info.m_parallel_recorder != nullptr) {
+            // the workers only look components up, every pool they read has to exist before they start
+            registry.pool<TransformComponent>();
+            registry.pool<TextureComponent>();
+            frame_info.m_parallel_recorder->record(frame_info, entities.size(), record);
+        } else {
+            record(frame_info, 0, entities.size());
+        }
+    }
+
+    void SimpleRenderSystem::renderChunk(NexFrameInfo& frame_info, std::span<const NexEntity> entities, NexComponentPool<MeshComponent>& meshes, glm::mat4 light_space_matrix) {
+        // both pipelines share the layout, so the sets stay bound when switching between them
+        NexPipeline*        bound_pipeline = nullptr;
+        NexGeometryBindings bound_geometry = {};
+
+        NexRegistry& registry = frame_info.m_registry;
+
+        for (NexEntity entity : entities) {
+            MeshComponent&      mesh      = meshes.get(entity);
+            TransformComponent* transform = registry.tryGet<TransformComponent>(entity);
+            if (!mesh.m_mesh || transform == nullptr) {
                 continue;
             }
 
-            VkDescriptorSet texture_descriptor_set;
-            auto            texture_info = entity.m_texture == nullptr ? m_default_texture->getDescriptorInfo() : entity.m_texture->getDescriptorInfo();
-            NexDescriptorWriter(*m_texture_set_layout, frame_info.m_frame_descriptor_pool).writeImage(0, &texture_info).build(texture_descriptor_set);
-            vkCmdBindDescriptorSets(frame_info.m_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_pipeline_layout, 1, 1, &texture_descriptor_set, 0, nullptr);
+            // still streaming in
+            TextureComponent* texture_component = registry.tryGet<TextureComponent>(entity);
+            NexTexture*       texture           = texture_component == nullptr || texture_component->m_texture == nullptr ? m_default_texture.get() : texture_component->m_texture.get();
+            if (!mesh.m_mesh->isResident() || !texture->isResident()) {
+                continue;
+            }
+
+            NexPipeline* pipeline = m_pipelines[static_cast<uint32_t>(mesh.m_mesh->getVertexFormat())].get();
+            if (pipeline != bound_pipeline) {
+                pipeline->bind(frame_info.m_command_buffer);
+                bound_pipeline = pipeline;
+            }
 
             SimplePushConstantsData push = {};
 
-            push.m_model_matrix       = entity.m_transform.mat4();
-            push.m_normal_matrix      = entity.m_transform.normalMatrix();
+            push.m_model_matrix       = transform->mat4() * mesh.m_mesh->getDequantizeMatrix();
+            push.m_normal_matrix      = transform->normalMatrix();
             push.m_light_space_matrix = light_space_matrix;
-            push.m_material_index     = entity.m_material_index;
+            push.m_material_index     = mesh.m_material_index;
+            push.m_texture_index      = texture->getBindlessIndex();
 
             vkCmdPushConstants(frame_info.m_command_buffer, m_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(SimplePushConstantsData), &push);
-            entity.m_model->bind(frame_info.m_command_buffer, 0);
-            entity.m_model->draw(frame_info.m_command_buffer, 0);
+            mesh.m_mesh->bind(frame_info.m_command_buffer, bound_geometry);
+            mesh.m_mesh->draw(frame_info.m_command_buffer);
+        }
+    }
+
+    void SimpleRenderSystem::renderIndirect(NexFrameInfo& frame_info, glm::mat4 light_space_matrix) {
+        NexGpuScene& scene = *frame_info.m_gpu_scene;
+
+        VkDescriptorSet object_set = scene.getObjectSet(frame_info.m_frame_index);
+        vkCmdBindDescriptorSets(frame_info.m_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_indirect_pipeline_layout, 3, 1, &object_set, 0, nullptr);
+
+        IndirectPushConstantsData push = {};
+        push.m_light_space_matrix      = light_space_matrix;
+        push.m_default_texture_index   = m_default_texture->getBindlessIndex();
+        vkCmdPushConstants(frame_info.m_command_buffer, m_indirect_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(IndirectPushConstantsData), &push);
+
+        // the scene only draws entities whose own texture is resident, the default one is shared by every batch
+        if (!m_default_texture->isResident()) {
+            return;
+        }
+
+        NexPipeline*        bound_pipeline = nullptr;
+        NexGeometryBindings bound_geometry = {};
+
+        for (const auto& batch : scene.getBatches()) {
+            NexPipeline* pipeline = m_indirect_pipelines[static_cast<uint32_t>(batch.m_vertex_format)].get();
+            if (pipeline != bound_pipeline) {
+                pipeline->bind(frame_info.m_command_buffer);
+                bound_pipeline = pipeline;
+            }
+
+            bound_geometry.bindVertices(frame_info.m_command_buffer, batch.m_vertex_buffer);
+            bound_geometry.bindIndices(frame_info.m_command_buffer, batch.m_index_buffer, batch.m_index_type);
+            scene.drawBatch(frame_info.m_command_buffer, frame_info.m_frame_index, batch);
+        }
+    }
+
+    void SimpleRenderSystem::renderInstanced(NexFrameInfo& frame_info, glm::mat4 light_space_matrix) {
+        NexInstancer& instancer = *frame_info.m_instancer;
+
+        VkDescriptorSet instance_set = instancer.getInstanceSet(frame_info.m_frame_index);
+        vkCmdBindDescriptorSets(frame_info.m_command_buffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_indirect_pipeline_layout, 3, 1, &instance_set, 0, nullptr);
+
+        IndirectPushConstantsData push = {};
+        push.m_light_space_matrix      = light_space_matrix;
+        push.m_default_texture_index   = m_default_texture->getBindlessIndex();
+        vkCmdPushConstants(frame_info.m_command_buffer, m_indirect_pipeline_layout, VK_SHADER_STAGE_VERTEX_BIT, 0, sizeof(IndirectPushConstantsData), &push);
+
+        // the instancer only groups entities whose own texture is resident, the default one is shared by every group
+        if (!m_default_texture->isResident()) {
+            return;
+        }
+
+        NexPipeline*        bound_pipeline = nullptr;
+        NexGeometryBindings bound_geometry = {};
+
+        for (const auto& group : instancer.getGroups()) {
+            NexPipeline* pipeline = m_indirect_pipelines[static_cast<uint32_t>(group.m_mesh->getVertexFormat())].get();
+            if (pipeline != bound_pipeline) {
+                pipeline->bind(frame_info.m_command_buffer);
+                bound_pipeline = pipeline;
+            }
+
+            group.m_mesh->bind(frame_info.m_command_buffer, bound_geometry);
+            group.m_mesh->draw(frame_info.m_command_buffer, group.m_instance_count, group.m_first_instance);
         }
     }
 
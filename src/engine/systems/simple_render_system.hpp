@@ -1,6 +1,7 @@
 #pragma once
 
 #include <memory>
+#include <span>
 
 #include "../graphics/nex_descriptors.hpp"
 #include "../core/nex_device.hpp"
@@ -11,7 +12,8 @@
 namespace nex {
     class SimpleRenderSystem {
       public:
-        SimpleRenderSystem(NexDevice& device, VkRenderPass render_pass, VkDescriptorSetLayout global_set_layout);
+        // with an object set layout the system also builds the pipelines that draw from a NexGpuScene or a NexInstancer
+        SimpleRenderSystem(NexDevice& device, VkRenderPass render_pass, VkDescriptorSetLayout global_set_layout, VkDescriptorSetLayout object_set_layout = VK_NULL_HANDLE);
         ~SimpleRenderSystem();
 
         SimpleRenderSystem(const SimpleRenderSystem&)            = delete;
@@ -22,16 +24,25 @@ namespace nex {
       private:
         void createPipelineLayout(VkDescriptorSetLayout global_set_layout);
         void createPipeline(VkRenderPass render_pass);
-        void createTextureDescriptorLayout();
+        void createIndirectPipelineLayout(VkDescriptorSetLayout global_set_layout, VkDescriptorSetLayout object_set_layout);
+        void createIndirectPipeline(VkRenderPass render_pass);
+        void renderIndirect(NexFrameInfo& frame_info, glm::mat4 light_space_matrix);
+        void renderInstanced(NexFrameInfo& frame_info, glm::mat4 light_space_matrix);
+        void renderChunk(NexFrameInfo& frame_info, std::span<const NexEntity> entities, NexComponentPool<MeshComponent>& meshes, glm::mat4 light_space_matrix);
         void createShadowDescriptorLayout();
 
         NexDevice& m_device;
 
         VkPipelineLayout             m_pipeline_layout;
-        std::unique_ptr<NexPipeline> m_pipeline;
+        std::unique_ptr<NexPipeline> m_pipelines[NexMesh::vertex_format_count];  // indexed by NexMesh::VertexFormat
 
+        VkPipelineLayout             m_indirect_pipeline_layout = VK_NULL_HANDLE;
+        std::unique_ptr<NexPipeline> m_indirect_pipelines[NexMesh::vertex_format_count];
+
+        // textures are bound through the device's texture table, the shadow map through a set written once
         std::shared_ptr<NexTexture>             m_default_texture;
-        std::unique_ptr<NexDescriptorSetLayout> m_texture_set_layout;
         std::unique_ptr<NexDescriptorSetLayout> m_shadow_set_layout;
+        std::unique_ptr<NexDescriptorPool>      m_shadow_pool;
+        VkDescriptorSet                         m_shadow_descriptor_set = VK_NULL_HANDLE;
     };
 }  // namespace nex
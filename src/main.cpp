@@ -1,10 +1,88 @@
 #include <cstdlib>
 #include <iostream>
+#include <string>
+#include <string_view>
+#include <vector>
 
+#include "engine/benchmark/nex_dedup_benchmark.hpp"
+#include "engine/benchmark/nex_ecs_benchmark.hpp"
 #include "engine/core/nex_engine.hpp"
 
-int main() {
-    nex::NexEngine app{};
+int main(int argc, char** argv) {
+    std::vector<std::string_view> args(argv + 1, argv + argc);
+
+    // offline benchmarks, these run without creating a window or a device
+    if (!args.empty() && args[0] == "--bench-dedup") {
+        return nex::runDedupBenchmark(args.size() > 1 ? std::string(args[1]) : "../models");
+    }
+    if (!args.empty() && args[0] == "--bench-ecs") {
+        return nex::runEcsBenchmark(args.size() > 1 ? static_cast<uint32_t>(std::stoul(std::string(args[1]))) : 1000000);
+    }
+
+    nex::NexEngineOptions options = {};
+    for (size_t i = 0; i < args.size(); ++i) {
+        if (args[i] == "--bench-shadows") {
+            options.m_benchmark_shadows = true;
+        } else if (args[i] == "--gpu-driven") {
+            options.m_gpu_driven = true;
+        } else if (args[i] == "--gpu-cull") {
+            options.m_gpu_driven  = true;
+            options.m_gpu_culling = true;
+        } else if (args[i] == "--cpu-cull") {
+            options.m_cpu_culling = true;
+        } else if (args[i] == "--bench-cull") {
+            options.m_benchmark_culling = true;
+        } else if (args[i] == "--instancing") {
+            options.m_instancing = true;
+        } else if (args[i] == "--parallel") {
+            options.m_parallel_recording = true;
+        } else if (args[i] == "--gpu-profile") {
+            options.m_gpu_profiler = true;
+        } else if (args[i] == "--headless") {
+            // optional frame count, rendered once the assets have loaded
+            options.m_headless = true;
+            if (i + 1 < args.size() && !args[i + 1].starts_with("--")) {
+                options.m_headless_frames = static_cast<uint32_t>(std::stoul(std::string(args[++i])));
+            }
+        } else if (args[i] == "--capture" && i + 1 < args.size()) {
+            // the last headless frame, and with an interval every that many frames
+            options.m_capture_path = std::string(args[++i]);
+            if (i + 1 < args.size() && !args[i + 1].starts_with("--")) {
+                options.m_capture_interval = static_cast<uint32_t>(std::stoul(std::string(args[++i])));
+            }
+        } else if (args[i] == "--scene" && i + 1 < args.size()) {
+            options.m_scene = std::string(args[++i]);
+        } else if (args[i] == "--camera-path" && i + 1 < args.size()) {
+            // orbit, dolly or a file saved by --record-camera
+            options.m_camera_path = std::string(args[++i]);
+        } else if (args[i] == "--record-camera" && i + 1 < args.size()) {
+            options.m_record_camera_path = std::string(args[++i]);
+        } else if (args[i] == "--bench") {
+            // optional frame count and output prefix, 1000 frames to benchmark.json and benchmark.csv by default
+            options.m_benchmark_frames = 1000;
+            if (i + 1 < args.size() && !args[i + 1].starts_with("--")) {
+                options.m_benchmark_frames = static_cast<uint32_t>(std::stoul(std::string(args[++i])));
+            }
+            if (i + 1 < args.size() && !args[i + 1].starts_with("--")) {
+                options.m_benchmark_output = std::string(args[++i]);
+            }
+        } else if (args[i] == "--trace" && i + 1 < args.size()) {
+            options.m_trace_path = std::string(args[++i]);
+        } else if (args[i] == "--pipeline-cache" && i + 1 < args.size()) {
+            options.m_pipeline_cache_path = std::string(args[++i]);
+        } else if (args[i] == "--no-pipeline-cache") {
+            // compile every pipeline from scratch, to compare a cold startup against a warm one
+            options.m_pipeline_cache_path.clear();
+        } else if (args[i] == "--stress") {
+            // optional entity count, 100k monkeys by default
+            options.m_stress_count = 100000;
+            if (i + 1 < args.size() && !args[i + 1].starts_with("--")) {
+                options.m_stress_count = static_cast<uint32_t>(std::stoul(std::string(args[++i])));
+            }
+        }
+    }
+
+    nex::NexEngine app{options};
 
     try {
         app.run();